@@ -13,6 +13,23 @@ CONFIG += c++14
 #
 #DEFINES += TS_PACKET_V2
 
+# Compile-time maximum log verbosity.
+#
+# Logging statements guarded by SSCVN_VERBOSE(level) above this level
+# compile to nothing, which removes the branches and string setup for
+# debug tracing from hot code paths. For performance builds, run qmake
+# with, e.g., SSCVN_LOG_MAX_VERBOSE=0 additional argument.
+# Unset means no limit; verbosity is then only checked at run time.
+#
+#SSCVN_LOG_MAX_VERBOSE = 0
+!isEmpty(SSCVN_LOG_MAX_VERBOSE): DEFINES += SSCVN_LOG_MAX_VERBOSE=$${SSCVN_LOG_MAX_VERBOSE}
+
+# Static tracepoints (USDT probes, see libinfra/tracepoints.h) get compiled
+# in automatically where <sys/sdt.h> is available. To leave them out anyway,
+# run qmake with DEFINES+=SSCVN_NO_USDT additional argument.
+#
+#DEFINES += SSCVN_NO_USDT
+
 
 #
 # Qt Creator template-based configuration settings follow...
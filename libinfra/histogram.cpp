@@ -0,0 +1,134 @@
+#include "histogram.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace SSCvn {
+namespace stats {  // namespace SSCvn::stats
+
+namespace {
+
+// Index of the most significant bit set. (value must not be zero.)
+inline int msbIndex(quint64 value)
+{
+    return 63 - __builtin_clzll(value);
+}
+
+}  // namespace
+
+
+Histogram::Histogram(quint64 highestTrackableValue) :
+    _highestTrackableValue(highestTrackableValue)
+{
+    if (!(highestTrackableValue >= subBucketCount))
+        throw std::invalid_argument("Histogram ctor: Highest trackable value must be at least " +
+                                    std::to_string(subBucketCount) + ", but got " +
+                                    std::to_string(highestTrackableValue));
+
+    _bucketCount = bucketIndex(highestTrackableValue) + 1;
+    _counts.reset(new std::atomic<quint64>[_bucketCount]);
+    for (int i = 0; i < _bucketCount; i++)
+        _counts[i].store(0, std::memory_order_relaxed);
+}
+
+quint64 Histogram::highestTrackableValue() const
+{
+    return _highestTrackableValue;
+}
+
+void Histogram::record(quint64 value)
+{
+    if (value > _highestTrackableValue)
+        value = _highestTrackableValue;
+
+    _counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    _totalCount.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    quint64 current = _min.load(std::memory_order_relaxed);
+    while (value < current &&
+           !_min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    { }
+    current = _max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !_max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    { }
+}
+
+void Histogram::reset()
+{
+    for (int i = 0; i < _bucketCount; i++)
+        _counts[i].store(0, std::memory_order_relaxed);
+    _totalCount.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _min.store(~quint64(0), std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+quint64 Histogram::count() const
+{
+    return _totalCount.load(std::memory_order_relaxed);
+}
+
+quint64 Histogram::sum() const
+{
+    return _sum.load(std::memory_order_relaxed);
+}
+
+quint64 Histogram::min() const
+{
+    return count() > 0 ? _min.load(std::memory_order_relaxed) : 0;
+}
+
+quint64 Histogram::max() const
+{
+    return _max.load(std::memory_order_relaxed);
+}
+
+quint64 Histogram::valueAtPercentile(double percentile) const
+{
+    // (Sum up the buckets themselves, so a concurrent record()
+    // can't make the target unreachable.)
+    quint64 total = 0;
+    for (int i = 0; i < _bucketCount; i++)
+        total += _counts[i].load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    percentile = qBound(0.0, percentile, 100.0);
+    quint64 target = static_cast<quint64>(std::ceil(percentile / 100 * total));
+    target = qBound(quint64(1), target, total);
+
+    quint64 cumulative = 0;
+    for (int i = 0; i < _bucketCount; i++) {
+        cumulative += _counts[i].load(std::memory_order_relaxed);
+        if (cumulative >= target)
+            return qMin(highestEquivalentValue(i), max());
+    }
+    return max();
+}
+
+int Histogram::bucketIndex(quint64 value) const
+{
+    if (value < subBucketCount)
+        return static_cast<int>(value);
+
+    // Shift the value down into [subBucketHalfCount, subBucketCount).
+    const int shift = msbIndex(value) - subBucketBits + 1;
+    return subBucketCount + (shift - 1) * subBucketHalfCount +
+        static_cast<int>((value >> shift) - subBucketHalfCount);
+}
+
+quint64 Histogram::highestEquivalentValue(int index)
+{
+    if (index < subBucketCount)
+        return static_cast<quint64>(index);
+
+    const int shift = (index - subBucketCount) / subBucketHalfCount + 1;
+    const quint64 subBucket = (index - subBucketCount) % subBucketHalfCount + subBucketHalfCount;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+}  // namespace SSCvn::stats
+}  // namespace SSCvn
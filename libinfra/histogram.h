@@ -0,0 +1,64 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "libinfra_global.h"
+
+#include <atomic>
+#include <memory>
+#include <QtGlobal>
+
+namespace SSCvn {
+namespace stats {  // namespace SSCvn::stats
+
+// A histogram of non-negative integer values (e.g., latencies in
+// microseconds) with constant relative precision, in the style of
+// HdrHistogram: Values below subBucketCount are counted exactly; above,
+// every power-of-two range is split into subBucketCount / 2 buckets,
+// so any value is reported within about 2 / subBucketCount of itself.
+//
+// Recording is a couple of shifts plus relaxed atomic increments,
+// cheap enough for per-packet use; percentiles are computed on demand,
+// in time linear to the (fixed, small) number of buckets.
+class LIBINFRASHARED_EXPORT Histogram
+{
+    static const int  subBucketBits  = 7;
+    static const int  subBucketCount = 1 << subBucketBits;
+    static const int  subBucketHalfCount = subBucketCount / 2;
+
+    quint64  _highestTrackableValue;
+    int      _bucketCount;
+    std::unique_ptr<std::atomic<quint64>[]>  _counts;
+    std::atomic<quint64>  _totalCount { 0 };
+    std::atomic<quint64>  _sum { 0 };
+    std::atomic<quint64>  _min { ~quint64(0) };
+    std::atomic<quint64>  _max { 0 };
+
+public:
+    // Values above highestTrackableValue are counted as that.
+    explicit Histogram(quint64 highestTrackableValue = 60 * 1000 * 1000);
+
+    quint64 highestTrackableValue() const;
+
+    void record(quint64 value);
+    void reset();
+
+    quint64 count() const;
+    // Of the recorded values, after capping at highestTrackableValue.
+    quint64 sum() const;
+    // (Zero if nothing was recorded, yet.)
+    quint64 min() const;
+    quint64 max() const;
+    // The value that percentile percent of all recorded values are
+    // less than or equal to, e.g., 99.9 for the p999. (Reported as the
+    // highest value equivalent to it, so it's never an underestimate.)
+    quint64 valueAtPercentile(double percentile) const;
+
+private:
+    int bucketIndex(quint64 value) const;
+    static quint64 highestEquivalentValue(int index);
+};
+
+}  // namespace SSCvn::stats
+}  // namespace SSCvn
+
+#endif // HISTOGRAM_H
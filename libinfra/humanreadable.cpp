@@ -1,14 +1,40 @@
 #include "humanreadable.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <utility>
 #include <stdexcept>
 #include <QList>
+#include <QRegularExpression>
 
 namespace HumanReadable {
 
 namespace {
 
+const qint64 msecMax = std::numeric_limits<qint64>::max();
+
+// Adds count units of unitMsec, saturating instead of wrapping around.
+qint64 addMsecSaturated(qint64 msec, qint64 count, qint64 unitMsec)
+{
+    if (count > (msecMax - msec) / unitMsec)
+        return msecMax;
+    return msec + count * unitMsec;
+}
+
+// Digits only, but too many for a qint64? Then that's as much as there is.
+qint64 toCountSaturated(const QString &digits, bool *ok)
+{
+    bool numOk = false;
+    const qint64 count = digits.toLongLong(&numOk);
+    if (numOk) {
+        *ok = true;
+        return count;
+    }
+    *ok = !digits.isEmpty() && std::all_of(digits.cbegin(), digits.cend(), [](QChar c) { return c.isDigit(); });
+    return *ok ? msecMax : 0;
+}
+
 bool hasOtherThan(QChar hay, const QByteArray &haystack)
 {
     bool found = false;
@@ -99,6 +125,58 @@ QString timeDuration(qint64 msec, bool exact)
     return ret;
 }
 
+qint64 timeDurationToMsec(const QString &str, bool *ok)
+{
+    if (ok)
+        *ok = false;
+
+    const QString trimmed = str.trimmed();
+    if (trimmed.isEmpty())
+        return -1;
+
+    // A plain number is taken as seconds.
+    {
+        bool numOk = false;
+        const qint64 secs = toCountSaturated(trimmed, &numOk);
+        if (numOk) {
+            if (secs < 0)
+                return -1;
+            if (ok)
+                *ok = true;
+            return addMsecSaturated(0, secs, 1000);
+        }
+    }
+
+    static const QRegularExpression re("\\G\\s*(\\d+)\\s*(ms|s|min|h|d)");
+    qint64 msec = 0;
+    int offset = 0;
+    while (offset < trimmed.length()) {
+        const QRegularExpressionMatch match = re.match(trimmed, offset);
+        if (!match.hasMatch())
+            return -1;
+
+        bool valueOk = false;
+        const qint64 value = toCountSaturated(match.captured(1), &valueOk);
+        const QString unit = match.captured(2);
+        if (unit == "ms")
+            msec = addMsecSaturated(msec, value, 1);
+        else if (unit == "s")
+            msec = addMsecSaturated(msec, value, 1000);
+        else if (unit == "min")
+            msec = addMsecSaturated(msec, value, 60 * 1000);
+        else if (unit == "h")
+            msec = addMsecSaturated(msec, value, 60 * 60 * 1000);
+        else if (unit == "d")
+            msec = addMsecSaturated(msec, value, 24 * 60 * 60 * 1000);
+
+        offset = match.capturedEnd();
+    }
+
+    if (ok)
+        *ok = true;
+    return msec;
+}
+
 Hexdump &Hexdump::enableByteCount()
 {
     byteCount = true;
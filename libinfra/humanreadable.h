@@ -14,6 +14,11 @@ namespace HumanReadable {
 
     LIBINFRASHARED_EXPORT QString timeDuration(qint64 msec, bool exact = true);
 
+    // Parses durations like "30s", "1h30min", "1500ms" or "90" (seconds)
+    // back to milliseconds. Returns -1 (and sets ok to false) on error.
+    // Durations too long for a qint64 are clamped to its maximum.
+    LIBINFRASHARED_EXPORT qint64 timeDurationToMsec(const QString &str, bool *ok = nullptr);
+
 
     struct LIBINFRASHARED_EXPORT Hexdump {
         const QByteArray &data;
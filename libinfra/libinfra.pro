@@ -16,7 +16,10 @@ include(../config.pri)
 
 SOURCES += \
     humanreadable.cpp \
-    log_backend.cpp
+    log_backend.cpp \
+    lograte.cpp \
+    histogram.cpp \
+    stageprofiler.cpp
 
 HEADERS += libinfra_global.h \
     humanreadable.h \
@@ -25,7 +28,14 @@ HEADERS += libinfra_global.h \
     exceptionbuilder.h \
     demangle.h \
     log.h \
-    log_backend.h
+    log_backend.h \
+    monotonicclock.h \
+    statscounter.h \
+    mpscqueue.h \
+    lograte.h \
+    histogram.h \
+    stageprofiler.h \
+    tracepoints.h
 
 unix {
     target.path = /usr/lib/streamserver-cvn
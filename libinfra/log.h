@@ -13,4 +13,19 @@ extern int debug_level;
 }  // namespace SSCvn
 
 
+// Use as "if (SSCVN_VERBOSE(2)) qInfo() << ...;" in code that runs often.
+//
+// If the build defines a maximum verbosity via SSCVN_LOG_MAX_VERBOSE
+// (see config.pri), checks for higher levels are false at compile time,
+// so the compiler drops the whole logging statement, including any string
+// setup for it. Otherwise, this is just a run-time check of verbose.
+#ifdef SSCVN_LOG_MAX_VERBOSE
+#define SSCVN_VERBOSE(level) \
+    ((level) <= SSCVN_LOG_MAX_VERBOSE && ::SSCvn::log::verbose >= (level))
+#else
+#define SSCVN_VERBOSE(level) \
+    (::SSCvn::log::verbose >= (level))
+#endif
+
+
 #endif // LOG_H
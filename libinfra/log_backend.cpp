@@ -4,10 +4,22 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
 #include <QtGlobal>
 #include <QDateTime>
 #include <QCoreApplication>
 
+#include "mpscqueue.h"
+
 
 namespace SSCvn {
 namespace log {
@@ -32,12 +44,22 @@ QDateTime logLast;
 QTextStream *logoutPtr = nullptr;
 
 
-void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &msg) {
-    if (!logoutPtr)
-        qFatal("Log message handler: Missing output setup!");
-    QTextStream &errout(*logoutPtr);
+namespace {
 
-    QDateTime now = QDateTime::currentDateTime();
+// Filters out messages that wouldn't get output anyway,
+// before spending any work on them.
+bool isSuppressed(QtMsgType type)
+{
+    // Debug messages only at --debug.
+    return type == QtDebugMsg && !(debug_level > 0);
+}
+
+// Writes one complete log line (or two, on date change) to errout.
+// Returns whether the message is fatal.
+bool formatMessage(QTextStream &errout, QtMsgType type,
+                   const char *category, const char *file, int line, const char *function,
+                   const QString &msg, const QDateTime &now)
+{
     int sd_info = 5;  // SD_NOTICE
     bool is_fatal_msg = false;
     QString prefix;
@@ -45,9 +67,6 @@ void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &ms
     switch (type) {
     case QtDebugMsg:
         sd_info = 7;  // SD_DEBUG
-        // Only at --debug.
-        if (!(debug_level > 0))
-            return;
         prefix = "DEBUG: ";
         break;
     case QtInfoMsg:
@@ -99,21 +118,21 @@ void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &ms
     }
 
     // Optional category.
-    if (ctx.category && strcmp(ctx.category, "default") != 0) {
-        errout << "[" << ctx.category << "] ";
+    if (category && strcmp(category, "default") != 0) {
+        errout << "[" << category << "] ";
     }
 
     // Optional debugging aids.
     if (debug_level > 0) {
-        if (debug_level > 1 && ctx.file) {
-            errout << ctx.file;
-            if (ctx.line) {
-                errout << ":" << ctx.line;
+        if (debug_level > 1 && file) {
+            errout << file;
+            if (line) {
+                errout << ":" << line;
             }
             errout << ": ";
         }
-        if (ctx.function) {
-            errout << ctx.function << ": ";
+        if (function) {
+            errout << function << ": ";
         }
     }
 
@@ -128,6 +147,179 @@ void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &ms
         logLast = now;
     }
 
+    return is_fatal_msg;
+}
+
+
+// A message as queued for the background thread. The context strings
+// are kept as pointers, as Qt passes string literals (file, function)
+// and static category names.
+struct AsyncRecord {
+    QtMsgType    type = QtInfoMsg;
+    const char  *category = nullptr;
+    const char  *file = nullptr;
+    int          line = 0;
+    const char  *function = nullptr;
+    qint64       timestampMsecs = 0;
+    QString      msg;
+};
+
+class AsyncWriter {
+    BoundedMPSCQueue<AsyncRecord>  _queue;
+    std::atomic<quint64>     _droppedCount { 0 };
+    std::atomic<bool>        _isStopping { false };
+    std::atomic<bool>        _isWaiting { false };
+    std::mutex               _waitMutex;
+    std::condition_variable  _waitCond;
+    std::thread              _thread;
+
+public:
+    explicit AsyncWriter(int queueCapacity) :
+        _queue(static_cast<size_t>(queueCapacity))
+    {
+        _thread = std::thread(&AsyncWriter::run, this);
+    }
+
+    // Writes out what was queued, and ends the thread. The writer itself
+    // is never deleted, as other threads may still be about to push;
+    // what they push after this is lost, but harmlessly so.
+    void stop()
+    {
+        _isStopping.store(true);
+        wake();
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    quint64 droppedCount() const
+    {
+        return _droppedCount.load(std::memory_order_relaxed);
+    }
+
+    void push(AsyncRecord &&record)
+    {
+        if (!_queue.tryPush(std::move(record))) {
+            _droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Only bother the (possibly sleeping) writer when it is waiting.
+        if (_isWaiting.load(std::memory_order_relaxed))
+            wake();
+    }
+
+private:
+    void wake()
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+        _waitCond.notify_one();
+    }
+
+    void run()
+    {
+        QByteArray batch;
+        QTextStream batchStream(&batch, QIODevice::WriteOnly);
+        quint64 droppedReported = 0;
+
+        while (true) {
+            // Format everything available into one batch...
+            AsyncRecord record;
+            int count = 0;
+            while (_queue.tryPop(&record)) {
+                formatMessage(batchStream, record.type,
+                              record.category, record.file, record.line, record.function,
+                              record.msg, QDateTime::fromMSecsSinceEpoch(record.timestampMsecs));
+                count++;
+            }
+
+            const quint64 dropped = droppedCount();
+            if (dropped != droppedReported) {
+                batchStream << "<4>Log: Dropped " << (dropped - droppedReported)
+                            << " messages, as the log queue was full" << endl;
+                droppedReported = dropped;
+                count++;
+            }
+
+            // ..and write it out in one go.
+            if (count > 0) {
+                batchStream.flush();
+                writeAll(batch);
+                batch.clear();
+                batchStream.seek(0);
+                continue;
+            }
+
+            if (_isStopping.load())
+                return;
+
+            std::unique_lock<std::mutex> lock(_waitMutex);
+            _isWaiting.store(true);
+            // (The timeout limits latency for wake-ups lost to the race
+            // between checking the queue and setting the waiting flag.)
+            _waitCond.wait_for(lock, std::chrono::milliseconds(50));
+            _isWaiting.store(false);
+        }
+    }
+
+    static void writeAll(const QByteArray &bytes)
+    {
+        const int fd = fileno(stderr);
+        const char *data = bytes.constData();
+        size_t remaining = static_cast<size_t>(bytes.length());
+        while (remaining > 0) {
+            const ssize_t written = ::write(fd, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                // Nowhere left to report this to.
+                return;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+        }
+    }
+};
+
+// Intentionally leaked on stopAsync(), see AsyncWriter::stop().
+std::atomic<AsyncWriter*> asyncWriter { nullptr };
+// Serializes start & stop; a concurrent qFatal(), or one during atexit,
+// waits for the queue to be written out by whoever stops it first.
+std::mutex asyncStartStopMutex;
+bool asyncAtexitRegistered = false;
+
+}  // namespace
+
+
+void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &msg) {
+    if (isSuppressed(type))
+        return;
+
+    if (type != QtFatalMsg) {
+        AsyncWriter *const writer = asyncWriter.load(std::memory_order_acquire);
+        if (writer) {
+            AsyncRecord record;
+            record.type = type;
+            record.category = ctx.category;
+            record.file = ctx.file;
+            record.line = ctx.line;
+            record.function = ctx.function;
+            record.timestampMsecs = QDateTime::currentMSecsSinceEpoch();
+            record.msg = msg;
+            writer->push(std::move(record));
+            return;
+        }
+    }
+    else {
+        // Get everything before the fatal message out, first.
+        stopAsync();
+    }
+
+    if (!logoutPtr)
+        qFatal("Log message handler: Missing output setup!");
+
+    const bool is_fatal_msg = formatMessage(*logoutPtr, type, ctx.category, ctx.file, ctx.line, ctx.function,
+                                            msg, QDateTime::currentDateTime());
+
     // Fatal messages shall be fatal to the program execution.
     if (is_fatal_msg) {
         if (debug_level > 0)
@@ -137,6 +329,47 @@ void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &ms
     }
 }
 
+void startAsync(int queueCapacity)
+{
+    std::lock_guard<std::mutex> lock(asyncStartStopMutex);
+    if (asyncWriter.load(std::memory_order_acquire))
+        return;
+
+    // Anything written synchronously so far has to come out first.
+    if (logoutPtr)
+        logoutPtr->flush();
+
+    asyncWriter.store(new AsyncWriter(queueCapacity), std::memory_order_release);
+
+    if (!asyncAtexitRegistered) {
+        // (Also flushes on exit() from anywhere.)
+        std::atexit(&stopAsync);
+        asyncAtexitRegistered = true;
+    }
+}
+
+void stopAsync()
+{
+    std::lock_guard<std::mutex> lock(asyncStartStopMutex);
+    AsyncWriter *const writer = asyncWriter.exchange(nullptr, std::memory_order_acq_rel);
+    if (!writer)
+        return;
+
+    // (Joins the thread, after it has written out all queued messages.)
+    writer->stop();
+}
+
+bool isAsync()
+{
+    return asyncWriter.load(std::memory_order_acquire) != nullptr;
+}
+
+quint64 asyncDroppedCount()
+{
+    AsyncWriter *const writer = asyncWriter.load(std::memory_order_acquire);
+    return writer ? writer->droppedCount() : 0;
+}
+
 void updateIsSystemdJournal() {
     if (!qEnvironmentVariableIsSet(systemdJournalEnvVarName))
         return;
@@ -29,6 +29,17 @@ extern QTextStream *logoutPtr;
 
 void msgHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &msg);
 
+// Asynchronous mode: msgHandler() only queues messages, without ever
+// blocking, and a background thread formats and writes them in batches.
+// Messages that don't fit into the queue are dropped & counted, instead.
+// Fatal messages still get written synchronously, after everything queued.
+void startAsync(int queueCapacity = 8192);
+// Writes out what was queued, first. Safe to call from any thread, and
+// repeatedly; messages other threads queue meanwhile may get lost.
+void stopAsync();
+bool isAsync();
+quint64 asyncDroppedCount();
+
 void updateIsSystemdJournal();
 
 
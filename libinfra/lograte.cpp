@@ -0,0 +1,238 @@
+#include "lograte.h"
+
+#include "monotonicclock.h"
+
+#include <stdexcept>
+#include <string>
+#include <QDebug>
+#include <QSet>
+#include <QStringList>
+
+namespace SSCvn {
+namespace log {  // namespace SSCvn::log
+
+namespace {
+
+// All live rate limiters, for flushAll().
+struct Registry {
+    std::mutex           mutex;
+    QSet<RateLimiter *>  limiters;
+};
+
+Registry &registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+}  // namespace
+
+
+RateLimiter::RateLimiter(const QString &what, int burst, qint64 intervalMsec, QtMsgType summaryType) :
+    _what(what), _burst(burst), _intervalMsec(intervalMsec), _summaryType(summaryType)
+{
+    if (!(burst >= 0))
+        throw std::invalid_argument("Log rate limiter: Invalid burst " + std::to_string(burst));
+    if (!(intervalMsec > 0))
+        throw std::invalid_argument("Log rate limiter: Invalid interval " + std::to_string(intervalMsec) + " ms");
+
+    Registry &reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.limiters.insert(this);
+}
+
+RateLimiter::~RateLimiter()
+{
+    Registry &reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.limiters.remove(this);
+}
+
+const QString &RateLimiter::what() const
+{
+    return _what;
+}
+
+int RateLimiter::burst() const
+{
+    return _burst;
+}
+
+qint64 RateLimiter::intervalMsec() const
+{
+    return _intervalMsec;
+}
+
+qint64 RateLimiter::suppressedTotal() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _suppressedTotal;
+}
+
+bool RateLimiter::check(const QString &detail, const QString &reason)
+{
+    return check(clock::monotonicMillisecs(), detail, reason);
+}
+
+bool RateLimiter::check(qint64 nowMsec, const QString &detail, const QString &reason)
+{
+    return countMessage(nowMsec, reason, &detail, nullptr);
+}
+
+qint64 RateLimiter::nowMillisecs()
+{
+    return clock::monotonicMillisecs();
+}
+
+RateLimiter::Entry &RateLimiter::entry(const QString &reason)
+{
+    return reason.isEmpty() ? _defaultEntry : _entries[reason];
+}
+
+bool RateLimiter::countMessage(qint64 nowMsec, const QString &reason, const QString *detail, bool *detailWanted)
+{
+    QString summary;
+    bool pass;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Entry &entry(this->entry(reason));
+        if (entry.countInWindow == 0 || nowMsec - entry.windowStartMsec >= _intervalMsec) {
+            summary = takeSummary(reason, entry, nowMsec);
+            entry.windowStartMsec = nowMsec;
+            entry.countInWindow = 0;
+        }
+
+        pass = ++entry.countInWindow <= _burst;
+        if (!pass) {
+            entry.suppressedCount++;
+            if (detail) {
+                entry.lastDetail = *detail;
+                entry.detailIsFirst = false;
+            }
+            else if (detailWanted && entry.suppressedCount == 1) {
+                *detailWanted = true;
+            }
+            _suppressedTotal++;
+        }
+    }
+
+    // (Log outside of the lock, the message handler may take its time.)
+    if (!summary.isNull())
+        emitSummary(summary);
+    return pass;
+}
+
+void RateLimiter::recordFirstDetail(const QString &reason, const QString &detail)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry &entry(this->entry(reason));
+    // (Unless an eager check() got in between.)
+    if (entry.lastDetail.isEmpty()) {
+        entry.lastDetail = detail;
+        entry.detailIsFirst = true;
+    }
+}
+
+void RateLimiter::flush()
+{
+    flush(clock::monotonicMillisecs());
+}
+
+void RateLimiter::flush(qint64 nowMsec)
+{
+    QStringList summaries;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto flushEntry = [&](const QString &reason, Entry &entry) {
+            if (nowMsec - entry.windowStartMsec < _intervalMsec)
+                return;
+            const QString summary = takeSummary(reason, entry, nowMsec);
+            if (!summary.isNull())
+                summaries.append(summary);
+            // Start over with a full burst on the next occurrence.
+            entry.countInWindow = 0;
+        };
+        flushEntry(QString(), _defaultEntry);
+        for (auto iter = _entries.begin(); iter != _entries.end(); ++iter)
+            flushEntry(iter.key(), iter.value());
+    }
+
+    for (const QString &summary : summaries)
+        emitSummary(summary);
+}
+
+void RateLimiter::flushPending()
+{
+    const qint64 nowMsec = clock::monotonicMillisecs();
+    QStringList summaries;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto flushEntry = [&](const QString &reason, Entry &entry) {
+            const QString summary = takeSummary(reason, entry, nowMsec);
+            if (!summary.isNull())
+                summaries.append(summary);
+        };
+        flushEntry(QString(), _defaultEntry);
+        for (auto iter = _entries.begin(); iter != _entries.end(); ++iter)
+            flushEntry(iter.key(), iter.value());
+    }
+
+    for (const QString &summary : summaries)
+        emitSummary(summary);
+}
+
+void RateLimiter::flushAll()
+{
+    Registry &reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (RateLimiter *limiter : reg.limiters)
+        limiter->flush();
+}
+
+void RateLimiter::flushAllPending()
+{
+    Registry &reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (RateLimiter *limiter : reg.limiters)
+        limiter->flushPending();
+}
+
+QString RateLimiter::takeSummary(const QString &reason, RateLimiter::Entry &entry, qint64 nowMsec)
+{
+    if (entry.suppressedCount == 0)
+        return QString();
+
+    QString summary = QString::number(entry.suppressedCount) + " " + _what;
+    if (!reason.isEmpty())
+        summary += " (" + reason + ")";
+    // (Whole seconds are precise enough, here.)
+    const qint64 elapsedMsec = qMax(nowMsec - entry.windowStartMsec, qint64(0));
+    summary += " in last " + (elapsedMsec >= 1000 ?
+                                  QString::number(elapsedMsec / 1000) + "s" :
+                                  QString::number(elapsedMsec) + "ms");
+    if (!entry.lastDetail.isEmpty())
+        summary += (entry.detailIsFirst ? ", first: " : ", last: ") + entry.lastDetail;
+
+    entry.suppressedCount = 0;
+    entry.lastDetail.clear();
+    entry.detailIsFirst = false;
+    return summary;
+}
+
+void RateLimiter::emitSummary(const QString &summary) const
+{
+    switch (_summaryType) {
+    case QtDebugMsg:
+        qDebug().noquote() << summary;
+        break;
+    case QtInfoMsg:
+        qInfo().noquote() << summary;
+        break;
+    default:
+        qWarning().noquote() << summary;
+        break;
+    }
+}
+
+}  // namespace SSCvn::log
+}  // namespace SSCvn
@@ -0,0 +1,116 @@
+#ifndef LOGRATE_H
+#define LOGRATE_H
+
+#include "libinfra_global.h"
+
+#include <QHash>
+#include <QString>
+#include <mutex>
+
+namespace SSCvn {
+namespace log {  // namespace SSCvn::log
+
+// Collapses storms of repeated log messages into periodic summaries.
+//
+// Meant to be used as a function-local static at the call site of
+// a message that may be logged for every packet or every send:
+//
+//     static log::RateLimiter limiter("TS packet errors");
+//     if (verbose >= 0 && limiter.check(errmsg))
+//         qWarning() << "TS packet error:" << qPrintable(errmsg);
+//
+// Where the detail would have to be put together first, checkLazy()
+// takes a function building it, and only calls it when needed.
+//
+// Within each interval, the first burst messages per reason get through;
+// the rest are only counted, and once the interval has elapsed, a summary
+// like "4312 TS packet errors in last 1s, last: ..." gets logged instead.
+// Summaries of limiters that fell silent are emitted by flushAll(),
+// which the application should call periodically (e.g., by timer),
+// and what is left by flushAllPending() when main() is done.
+class LIBINFRASHARED_EXPORT RateLimiter
+{
+    struct Entry {
+        qint64   windowStartMsec = 0;
+        int      countInWindow   = 0;
+        qint64   suppressedCount = 0;
+        QString  lastDetail;
+        bool     detailIsFirst = false;  // From checkLazy(), which keeps the first one only.
+    };
+
+    const QString  _what;
+    const int      _burst;
+    const qint64   _intervalMsec;
+    const QtMsgType  _summaryType;
+    mutable std::mutex      _mutex;
+    Entry                   _defaultEntry;  // For the empty reason, without a hash lookup.
+    QHash<QString, Entry>   _entries;  // By (non-empty) reason.
+    qint64                  _suppressedTotal = 0;
+
+public:
+    explicit RateLimiter(const QString &what, int burst = 5, qint64 intervalMsec = 1000,
+                         QtMsgType summaryType = QtWarningMsg);
+    // Doesn't log: Function-local statics get destroyed after main()
+    // returned, when the log backend may be gone already.
+    ~RateLimiter();
+    RateLimiter(const RateLimiter &) = delete;
+    RateLimiter &operator=(const RateLimiter &) = delete;
+
+    const QString &what() const;
+    int burst() const;
+    qint64 intervalMsec() const;
+    // Number of messages suppressed over the limiter's lifetime.
+    qint64 suppressedTotal() const;
+
+    // Returns true if the caller should log the message itself.
+    // Otherwise, it has been counted for the next summary.
+    bool check(const QString &detail = QString(), const QString &reason = QString());
+    bool check(qint64 nowMsec, const QString &detail, const QString &reason = QString());
+
+    // Like check(), but calls makeDetail() (returning a QString) only
+    // for the first suppressed message per interval, for the summary;
+    // so a storm of messages costs just the counting.
+    // Messages that get through are the caller's to build & log.
+    template <typename DetailFunc>
+    bool checkLazy(const DetailFunc &makeDetail, const QString &reason = QString())
+    {
+        return checkLazy(nowMillisecs(), makeDetail, reason);
+    }
+    template <typename DetailFunc>
+    bool checkLazy(qint64 nowMsec, const DetailFunc &makeDetail, const QString &reason = QString())
+    {
+        bool detailWanted = false;
+        const bool pass = countMessage(nowMsec, reason, nullptr, &detailWanted);
+        if (detailWanted)
+            recordFirstDetail(reason, makeDetail());
+        return pass;
+    }
+
+    // Emits summaries for all reasons whose interval has elapsed.
+    void flush();
+    void flush(qint64 nowMsec);
+    // Emits pending summaries regardless of the interval.
+    void flushPending();
+
+    // Calls flush() on every live rate limiter.
+    static void flushAll();
+    // Calls flushPending() on every live rate limiter; for the end
+    // of main(), while the log backend is still there.
+    static void flushAllPending();
+
+private:
+    static qint64 nowMillisecs();
+    Entry &entry(const QString &reason);
+    // Returns whether the message gets through. For a suppressed one,
+    // keeps *detail if given, or else asks for one via *detailWanted
+    // if there is none yet.
+    bool countMessage(qint64 nowMsec, const QString &reason, const QString *detail, bool *detailWanted);
+    void recordFirstDetail(const QString &reason, const QString &detail);
+    QString takeSummary(const QString &reason, Entry &entry, qint64 nowMsec);
+    void emitSummary(const QString &summary) const;
+};
+
+}  // namespace SSCvn::log
+}  // namespace SSCvn
+
+#endif // LOGRATE_H
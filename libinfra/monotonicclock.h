@@ -0,0 +1,32 @@
+#ifndef MONOTONICCLOCK_H
+#define MONOTONICCLOCK_H
+
+#include <time.h>
+#include <errno.h>
+
+#include <system_error>
+#include <QtGlobal>
+
+namespace SSCvn {
+namespace clock {  // namespace SSCvn::clock
+
+// Current time of the monotonic clock, in nanoseconds.
+// (Unrelated to wall-clock time; only useful for differences.)
+inline qint64 monotonicNanosecs()
+{
+    struct timespec t;
+    if (clock_gettime(CLOCK_MONOTONIC, &t) != 0)
+        throw std::system_error(errno, std::generic_category(),
+                                "Can't get time for monotonic clock");
+    return static_cast<qint64>(t.tv_sec) * 1000000000 + t.tv_nsec;
+}
+
+inline qint64 monotonicMillisecs()
+{
+    return monotonicNanosecs() / 1000000;
+}
+
+}  // namespace SSCvn::clock
+}  // namespace SSCvn
+
+#endif // MONOTONICCLOCK_H
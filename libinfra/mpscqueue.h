@@ -0,0 +1,107 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace SSCvn {
+
+
+// A bounded, lock-free queue for many producer threads and a single
+// consumer thread. (After D. Vyukov's bounded MPMC queue: every cell
+// carries a sequence number telling whose turn it is.)
+//
+// Producers never block; tryPush() fails when the queue is full.
+template <typename T>
+class BoundedMPSCQueue
+{
+    struct Cell {
+        std::atomic<size_t>  sequence;
+        T                    data;
+    };
+
+    std::unique_ptr<Cell[]>  _cells;
+    const size_t             _mask;
+    // (Keep producer and consumer positions on separate cache lines.)
+    alignas(64) std::atomic<size_t>  _enqueuePos { 0 };
+    alignas(64) size_t               _dequeuePos = 0;
+
+    static size_t roundUpToPowerOfTwo(size_t capacity)
+    {
+        if (capacity < 2)
+            throw std::invalid_argument("Bounded MPSC queue: Capacity must be at least 2");
+        size_t ret = 1;
+        while (ret < capacity)
+            ret <<= 1;
+        return ret;
+    }
+
+public:
+    // Capacity gets rounded up to a power of two.
+    explicit BoundedMPSCQueue(size_t capacity) :
+        _cells(new Cell[roundUpToPowerOfTwo(capacity)]),
+        _mask(roundUpToPowerOfTwo(capacity) - 1)
+    {
+        for (size_t i = 0; i <= _mask; i++)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedMPSCQueue(const BoundedMPSCQueue &) = delete;
+    BoundedMPSCQueue &operator=(const BoundedMPSCQueue &) = delete;
+
+    size_t capacity() const
+    {
+        return _mask + 1;
+    }
+
+    // Safe to call from any thread.
+    bool tryPush(T &&value)
+    {
+        Cell *cell;
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &_cells[pos & _mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                // Full.
+                return false;
+            }
+            else {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only to be called from the single consumer thread.
+    bool tryPop(T *value)
+    {
+        Cell *const cell = &_cells[_dequeuePos & _mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if (seq != _dequeuePos + 1)
+            // Empty, or the producer isn't finished with the cell, yet.
+            return false;
+
+        *value = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(_dequeuePos + _mask + 1, std::memory_order_release);
+        _dequeuePos++;
+        return true;
+    }
+};
+
+
+}  // namespace SSCvn
+
+#endif // MPSCQUEUE_H
@@ -0,0 +1,81 @@
+#include "stageprofiler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <QSet>
+
+namespace SSCvn {
+namespace stats {  // namespace SSCvn::stats
+
+namespace {
+
+// All live profile stages, for snapshotAll().
+struct Registry {
+    std::mutex            mutex;
+    QSet<ProfileStage *>  stages;
+};
+
+Registry &registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+}  // namespace
+
+
+std::atomic<bool> ProfileStage::_enabled { false };
+
+ProfileStage::ProfileStage(const QString &name) :
+    _name(name)
+{
+    Registry &reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.stages.insert(this);
+}
+
+ProfileStage::~ProfileStage()
+{
+    Registry &reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.stages.remove(this);
+}
+
+const QString &ProfileStage::name() const
+{
+    return _name;
+}
+
+quint64 ProfileStage::nanosecs() const
+{
+    return _nanosecs.value();
+}
+
+quint64 ProfileStage::count() const
+{
+    return _count.value();
+}
+
+void ProfileStage::setEnabled(bool enable)
+{
+    _enabled.store(enable, std::memory_order_relaxed);
+}
+
+QList<ProfileStage::Snapshot> ProfileStage::snapshotAll()
+{
+    QList<Snapshot> snapshots;
+    {
+        Registry &reg(registry());
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const ProfileStage *stage : reg.stages)
+            snapshots.append({ stage->name(), stage->nanosecs(), stage->count() });
+    }
+
+    std::sort(snapshots.begin(), snapshots.end(), [](const Snapshot &a, const Snapshot &b) {
+        return a.name < b.name;
+    });
+    return snapshots;
+}
+
+}  // namespace SSCvn::stats
+}  // namespace SSCvn
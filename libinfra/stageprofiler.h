@@ -0,0 +1,102 @@
+#ifndef STAGEPROFILER_H
+#define STAGEPROFILER_H
+
+#include "libinfra_global.h"
+#include "monotonicclock.h"
+#include "statscounter.h"
+
+#include <atomic>
+#include <QList>
+#include <QString>
+
+namespace SSCvn {
+namespace stats {  // namespace SSCvn::stats
+
+// A named stage of a processing pipeline (e.g., "parse"), accumulating
+// the time spent in it. Meant to be defined as a static at file scope,
+// and timed by StageTimer:
+//
+//     static stats::ProfileStage parseStage("parse");
+//     ...
+//     {
+//         stats::StageTimer timer(parseStage);
+//         ...
+//     }
+//
+// Profiling is off by default; then, a StageTimer doesn't even read
+// the clock. Times of nested stages are included in the outer stage.
+class LIBINFRASHARED_EXPORT ProfileStage
+{
+    const QString  _name;
+    Counter        _nanosecs;
+    Counter        _count;
+
+    static std::atomic<bool>  _enabled;
+
+public:
+    explicit ProfileStage(const QString &name);
+    ~ProfileStage();
+    ProfileStage(const ProfileStage &) = delete;
+    ProfileStage &operator=(const ProfileStage &) = delete;
+
+    const QString &name() const;
+    quint64 nanosecs() const;
+    quint64 count() const;
+
+    void add(qint64 nanosecs)
+    {
+        _nanosecs.add(static_cast<quint64>(nanosecs));
+        _count.add();
+    }
+
+    static bool isEnabled()
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+    static void setEnabled(bool enable);
+
+    struct Snapshot {
+        QString  name;
+        quint64  nanosecs;
+        quint64  count;
+    };
+    // All live stages, sorted by name.
+    static QList<Snapshot> snapshotAll();
+};
+
+// Adds the time from construction until stop() or destruction
+// to the stage, if profiling is enabled.
+class StageTimer
+{
+    ProfileStage  &_stage;
+    qint64         _startNanosecs = -1;
+
+public:
+    explicit StageTimer(ProfileStage &stage) :
+        _stage(stage)
+    {
+        if (ProfileStage::isEnabled())
+            _startNanosecs = clock::monotonicNanosecs();
+    }
+
+    ~StageTimer()
+    {
+        stop();
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+    void stop()
+    {
+        if (_startNanosecs < 0)
+            return;
+        _stage.add(clock::monotonicNanosecs() - _startNanosecs);
+        _startNanosecs = -1;
+    }
+};
+
+}  // namespace SSCvn::stats
+}  // namespace SSCvn
+
+#endif // STAGEPROFILER_H
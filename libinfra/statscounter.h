@@ -0,0 +1,60 @@
+#ifndef STATSCOUNTER_H
+#define STATSCOUNTER_H
+
+#include <atomic>
+#include <QtGlobal>
+
+namespace SSCvn {
+namespace stats {  // namespace SSCvn::stats
+
+// Statistics that get updated on hot paths, and read from anywhere.
+// Relaxed atomics: no locks, no ordering guarantees between different
+// values; each value on its own is always consistent.
+
+// A monotonically increasing count, e.g., of packets or bytes.
+class Counter
+{
+    std::atomic<quint64>  _value { 0 };
+
+public:
+    void add(quint64 n = 1)
+    {
+        _value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    quint64 value() const
+    {
+        return _value.load(std::memory_order_relaxed);
+    }
+};
+
+// A value that goes up and down, e.g., a queue length or a jitter.
+class Gauge
+{
+    std::atomic<qint64>  _value { 0 };
+
+public:
+    void set(qint64 value)
+    {
+        _value.store(value, std::memory_order_relaxed);
+    }
+
+    // Only changes the value if the new one is greater.
+    void setMax(qint64 value)
+    {
+        qint64 current = _value.load(std::memory_order_relaxed);
+        while (value > current &&
+               !_value.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        { }
+    }
+
+    qint64 value() const
+    {
+        return _value.load(std::memory_order_relaxed);
+    }
+};
+
+}  // namespace SSCvn::stats
+}  // namespace SSCvn
+
+#endif // STATSCOUNTER_H
@@ -0,0 +1,52 @@
+#ifndef TRACEPOINTS_H
+#define TRACEPOINTS_H
+
+// Static tracepoints (USDT probes) at hot-path boundaries.
+//
+// Where <sys/sdt.h> is available (e.g., from systemtap-sdt-dev), each
+// SSCVN_TRACEn(name, args...) compiles to a single nop plus an ELF note
+// describing the probe "streamserver_cvn:name"; bpftrace, perf or
+// SystemTap can attach to it on a live process, e.g.:
+//
+//     bpftrace -e 'usdt:./streamserver-cvn-cli:streamserver_cvn:brake_sleep
+//                  { @sleep_us = hist(arg1); }'
+//
+// Otherwise, or when built with DEFINES+=SSCVN_NO_USDT, the macros
+// compile to nothing, and their arguments aren't evaluated.
+// Keep arguments to cheap integers (or pointers) that are at hand anyway;
+// with USDT, they are evaluated whether or not a tracer is attached.
+//
+// Probes in streamserver-cvn-cli (arguments in order):
+//
+//     packet_ingest      PID, bytes, ingest time (monotonic ns)
+//     parse_error        bytes, consecutive error count
+//     discontinuity      PCR (us), previous PCR (us)
+//     brake_sleep        PCR (us), sleep duration (us)
+//     client_connect     stream client id, HTTP client id
+//     client_disconnect  stream client id, packets sent, packets dropped
+//     client_queue_push  stream client id, PID, queue length
+//     client_queue_pop   stream client id, bytes, ingest-to-wire latency (us)
+//     socket_write       HTTP client id, bytes to write, bytes written
+
+#if !defined(SSCVN_NO_USDT) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define SSCVN_HAVE_USDT 1
+#  endif
+#endif
+
+#ifdef SSCVN_HAVE_USDT
+#define SSCVN_TRACE0(name)                  DTRACE_PROBE(streamserver_cvn, name)
+#define SSCVN_TRACE1(name, a1)              DTRACE_PROBE1(streamserver_cvn, name, a1)
+#define SSCVN_TRACE2(name, a1, a2)          DTRACE_PROBE2(streamserver_cvn, name, a1, a2)
+#define SSCVN_TRACE3(name, a1, a2, a3)      DTRACE_PROBE3(streamserver_cvn, name, a1, a2, a3)
+#define SSCVN_TRACE4(name, a1, a2, a3, a4)  DTRACE_PROBE4(streamserver_cvn, name, a1, a2, a3, a4)
+#else
+#define SSCVN_TRACE0(name)                  do { } while (false)
+#define SSCVN_TRACE1(name, a1)              do { } while (false)
+#define SSCVN_TRACE2(name, a1, a2)          do { } while (false)
+#define SSCVN_TRACE3(name, a1, a2, a3)      do { } while (false)
+#define SSCVN_TRACE4(name, a1, a2, a3, a4)  do { } while (false)
+#endif
+
+#endif // TRACEPOINTS_H
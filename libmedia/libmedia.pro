@@ -18,7 +18,13 @@ SOURCES += \
     tspacket.cpp \
     tspacketv2.cpp \
     tsreader.cpp \
-    tswriter.cpp
+    tswriter.cpp \
+    tstimeshiftring.cpp \
+    tscrc32.cpp \
+    tsstreamgenerator.cpp \
+    tspsi.cpp \
+    tskeyframe.cpp \
+    tspidanalyzer.cpp
 
 HEADERS += libmedia_global.h \
     conversionstore.h \
@@ -26,8 +32,15 @@ HEADERS += libmedia_global.h \
     tspacket.h \
     tspacketv2.h \
     tspacket_compat.h \
+    tspacketview.h \
     tsreader.h \
-    tswriter.h
+    tswriter.h \
+    tstimeshiftring.h \
+    tscrc32.h \
+    tsstreamgenerator.h \
+    tspsi.h \
+    tskeyframe.h \
+    tspidanalyzer.h
 
 unix {
     target.path = /usr/lib/streamserver-cvn
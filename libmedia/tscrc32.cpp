@@ -0,0 +1,59 @@
+#include "tscrc32.h"
+
+#include <array>
+
+namespace TS {
+
+namespace {
+
+// Slicing-by-8: table k gives the CRC contribution of a byte
+// followed by k zero bytes, so 8 input bytes can be folded in at once.
+using CrcTables = std::array<std::array<quint32, 256>, 8>;
+
+CrcTables makeCrcTables()
+{
+    CrcTables tables;
+    for (quint32 i = 0; i < 256; i++) {
+        quint32 crc = i << 24;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        tables[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            const quint32 prev = tables[k - 1][i];
+            tables[k][i] = (prev << 8) ^ tables[0][prev >> 24];
+        }
+    }
+    return tables;
+}
+
+const CrcTables crcTables = makeCrcTables();
+
+}  // namespace
+
+
+quint32 crc32Mpeg2(const char *data, int length, quint32 crc)
+{
+    const quint8 *bytes = reinterpret_cast<const quint8 *>(data);
+    const auto &t(crcTables);
+
+    while (length >= 8) {
+        crc ^= static_cast<quint32>(bytes[0]) << 24 |
+               static_cast<quint32>(bytes[1]) << 16 |
+               static_cast<quint32>(bytes[2]) <<  8 |
+               static_cast<quint32>(bytes[3]);
+        crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff] ^
+              t[5][(crc >> 8) & 0xff] ^ t[4][crc & 0xff] ^
+              t[3][bytes[4]] ^ t[2][bytes[5]] ^
+              t[1][bytes[6]] ^ t[0][bytes[7]];
+        bytes += 8;
+        length -= 8;
+    }
+
+    for (int i = 0; i < length; i++)
+        crc = (crc << 8) ^ t[0][((crc >> 24) ^ bytes[i]) & 0xff];
+    return crc;
+}
+
+}  // namespace TS
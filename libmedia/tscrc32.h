@@ -0,0 +1,27 @@
+#ifndef TSCRC32_H
+#define TSCRC32_H
+
+#include "libmedia_global.h"
+
+#include <QByteArray>
+
+namespace TS {
+
+
+// CRC-32/MPEG-2, as used to protect PSI sections (e.g., PAT, PMT):
+// polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection,
+// no final XOR. A section including its CRC_32 field checksums to zero.
+//
+// Pass the result of a previous call as crc to continue over
+// non-contiguous data.
+LIBMEDIASHARED_EXPORT quint32 crc32Mpeg2(const char *data, int length, quint32 crc = 0xffffffff);
+
+inline quint32 crc32Mpeg2(const QByteArray &bytes, quint32 crc = 0xffffffff)
+{
+    return crc32Mpeg2(bytes.constData(), bytes.length(), crc);
+}
+
+
+}  // namespace TS
+
+#endif // TSCRC32_H
@@ -0,0 +1,149 @@
+#include "tskeyframe.h"
+
+#include "tspacketview.h"
+#include "tspsi.h"
+
+#include <cstring>
+
+namespace TS {
+
+
+KeyframeDetector::KeyframeDetector()
+{
+    clear();
+}
+
+KeyframeDetector::Codec KeyframeDetector::codecForStreamType(quint8 streamType)
+{
+    switch (streamType) {
+    case 0x01:
+    case 0x02:
+        return Codec::MPEG2Video;
+    case 0x1b:
+        return Codec::H264;
+    case 0x24:
+        return Codec::HEVC;
+    default:
+        return Codec::Unknown;
+    }
+}
+
+void KeyframeDetector::update(const PSIDemux &psi)
+{
+    clear();
+    for (const ProgramInfo &program : psi.programs()) {
+        for (const ElementaryStreamInfo &stream : program.streams) {
+            if (stream.pid >= _pidCodecs.size())
+                continue;
+            if (stream.kind() == ElementaryStreamInfo::Kind::Video) {
+                _pidIsVideo[stream.pid] = true;
+                _hasVideo = true;
+            }
+            const Codec codec = codecForStreamType(stream.streamType);
+            if (codec != Codec::Unknown)
+                _pidCodecs[stream.pid] = codec;
+        }
+    }
+}
+
+void KeyframeDetector::clear()
+{
+    _pidCodecs.fill(Codec::Unknown);
+    _pidIsVideo.fill(false);
+    _hasVideo = false;
+}
+
+KeyframeDetector::Codec KeyframeDetector::pidCodec(quint16 pid) const
+{
+    return pid < _pidCodecs.size() ? _pidCodecs[pid] : Codec::Unknown;
+}
+
+bool KeyframeDetector::isRandomAccess(const PacketView &packet)
+{
+    // (Audio frames flagged as random access would cut video mid-GOP.)
+    if (_hasVideo && !packet.isNull() && !_pidIsVideo[packet.pid()])
+        return false;
+    if (packet.randomAccessIndicator())
+        return true;
+    if (!scanPacket(packet))
+        return false;
+    _detectedCount++;
+    return true;
+}
+
+bool KeyframeDetector::scanPacket(const PacketView &packet) const
+{
+    if (packet.isNull() || !packet.payloadUnitStartIndicator() || !packet.hasPayload())
+        return false;
+    const Codec codec = pidCodec(packet.pid());
+    if (codec == Codec::Unknown || packet.isScrambled())
+        return false;
+
+    // PES header: packet_start_code_prefix, stream_id, PES_packet_length,
+    // two bytes of flags, PES_header_data_length, optional fields.
+    const quint8 *const payload = packet.payload();
+    const int length = packet.payloadLength();
+    if (length < 9 || payload[0] != 0x00 || payload[1] != 0x00 || payload[2] != 0x01)
+        return false;
+    if ((payload[6] & 0xc0) != 0x80)
+        return false;
+    const int esOffset = 9 + payload[8];
+    if (esOffset >= length)
+        return false;
+
+    return containsRandomAccessPoint(payload + esOffset, length - esOffset, codec);
+}
+
+bool KeyframeDetector::containsRandomAccessPoint(const quint8 *data, int length, Codec codec)
+{
+    if (!data || codec == Codec::Unknown)
+        return false;
+
+    // Look for the 0x01 of the start code prefix, then check the zeros
+    // in front of it. memchr() is vectorized in any libc worth its salt,
+    // so this mostly skips over slice data a machine word or more at a time.
+    const quint8 *const end = data + length;
+    const quint8 *pos = data + 2;
+    while (pos < end - 1) {
+        pos = static_cast<const quint8 *>(std::memchr(pos, 0x01, end - 1 - pos));
+        if (!pos)
+            return false;
+        if (pos[-1] == 0x00 && pos[-2] == 0x00) {
+            const quint8 header = pos[1];
+            switch (codec) {
+            case Codec::MPEG2Video:
+                // sequence_header_code
+                if (header == 0xb3)
+                    return true;
+                break;
+            case Codec::H264: {
+                // IDR slice, or sequence parameter set (which encoders
+                // emit in front of each IDR picture or recovery point).
+                const quint8 nalType = header & 0x1f;
+                if (nalType == 5 || nalType == 7)
+                    return true;
+                break;
+            }
+            case Codec::HEVC: {
+                // IRAP picture (BLA, IDR, CRA), or video/sequence parameter set.
+                const quint8 nalType = (header >> 1) & 0x3f;
+                if ((nalType >= 16 && nalType <= 23) || nalType == 32 || nalType == 33)
+                    return true;
+                break;
+            }
+            case Codec::Unknown:
+                return false;
+            }
+        }
+        pos++;
+    }
+    return false;
+}
+
+qint64 KeyframeDetector::detectedCount() const
+{
+    return _detectedCount;
+}
+
+
+}  // namespace TS
@@ -0,0 +1,77 @@
+#ifndef TSKEYFRAME_H
+#define TSKEYFRAME_H
+
+#include "libmedia_global.h"
+
+#include <array>
+#include <QtGlobal>
+
+namespace TS {
+
+class PacketView;
+class PSIDemux;
+
+
+// Finds random access points (keyframes) on the video PIDs of a TS,
+// for muxers that don't set the adaptation field's random_access_indicator:
+// On packets starting a PES packet, skips the PES header and scans
+// the rest of that packet's payload for the start of an H.264 IDR
+// or HEVC IRAP picture (or the parameter sets leading one), or
+// an MPEG-2 sequence header.
+//
+// No PES reassembly takes place, so a keyframe whose first NAL unit
+// doesn't start in the PES packet's first TS packet goes unnoticed;
+// encoders put access unit delimiter and parameter sets right behind
+// the PES header, so in practice it's there.
+class LIBMEDIASHARED_EXPORT KeyframeDetector
+{
+public:
+    enum class Codec : quint8 {
+        Unknown,
+        MPEG2Video,
+        H264,
+        HEVC,
+    };
+
+private:
+    std::array<Codec, 8192>  _pidCodecs;
+    // Video PIDs of any codec, scanned or not; while there are any,
+    // random access points are only looked for on them.
+    std::array<bool, 8192>   _pidIsVideo;
+    bool    _hasVideo = false;
+    qint64  _detectedCount = 0;
+
+public:
+    KeyframeDetector();
+
+    // From PMT stream_type; Unknown for anything not scanned.
+    static Codec codecForStreamType(quint8 streamType);
+
+    // Takes over the video PIDs of all known programs.
+    // Call whenever the PSI changed.
+    void update(const PSIDemux &psi);
+    void clear();
+    Codec pidCodec(quint16 pid) const;
+
+    // random_access_indicator, or, for a PES start on a video PID,
+    // a random access point found by scanning the payload.
+    // When the PSI lists video PIDs, packets on other PIDs never are;
+    // random_access_indicator on any PID only counts for streams without video.
+    bool isRandomAccess(const PacketView &packet);
+    // Whether the packet starts a PES packet with a random access point,
+    // disregarding the adaptation field.
+    bool scanPacket(const PacketView &packet) const;
+
+    // Searches for a start code prefix (00 00 01) followed by a start code
+    // or NAL unit header marking a random access point for this codec.
+    static bool containsRandomAccessPoint(const quint8 *data, int length, Codec codec);
+
+    // Random access points found by scanning only, i.e. where
+    // random_access_indicator was missing.
+    qint64 detectedCount() const;
+};
+
+
+}  // namespace TS
+
+#endif // TSKEYFRAME_H
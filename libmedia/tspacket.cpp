@@ -23,6 +23,13 @@ TSPacket::TSPacket(const QByteArray &bytes) :
         _timeCode = _bytes.mid(byteIdx, static_cast<int>(_additionalInfoLength));
         byteIdx += static_cast<int>(_additionalInfoLength);
     }
+    else if (_bytes.length() == static_cast<int>(AdditionalInfoLengthType::ForwardErrorCorrection1) + lengthBasic) {
+        // (Parity bytes follow the basic packet, so the sync byte stays at offset 0.)
+        _additionalInfoLength = AdditionalInfoLengthType::ForwardErrorCorrection1;
+    }
+    else if (_bytes.length() == static_cast<int>(AdditionalInfoLengthType::ForwardErrorCorrection2) + lengthBasic) {
+        _additionalInfoLength = AdditionalInfoLengthType::ForwardErrorCorrection2;
+    }
     else {
         QDebug(&_errorMessage) << "Unrecognized packet length" << _bytes.length() << "bytes";
         return;
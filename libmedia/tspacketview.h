@@ -0,0 +1,136 @@
+#ifndef TSPACKETVIEW_H
+#define TSPACKETVIEW_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+namespace TS {
+
+
+// A light-weight, non-owning view onto the header fields of a basic
+// (188 bytes, no prefix/suffix) MPEG-TS packet.
+//
+// This does no parsing up-front and no validation besides keeping
+// within packet bounds, so it's suitable for per-packet inspection
+// on hot paths where a full TSPacket/PacketV2 parse would be too costly.
+// The viewed bytes must outlive the view.
+class PacketView
+{
+    const quint8 *_data = nullptr;
+
+public:
+    static constexpr int     sizeBasic = 188;
+    static constexpr quint8  syncByteFixedValue = 0x47;
+    static constexpr quint16 pidNullPacket = 0x1fff;
+
+    // Where the basic packet starts within a packet of the given size:
+    // 204 and 208 bytes have Reed-Solomon parity (or dummy) bytes after
+    // it; otherwise, what exceeds the basic packet is a prefix, like the
+    // 4-byte TimeCode prefix of 192-byte packets.
+    static constexpr int basicOffsetForPacketSize(int packetSize)
+    {
+        return packetSize == sizeBasic + 16 || packetSize == sizeBasic + 20 ? 0 :
+               packetSize > sizeBasic ? packetSize - sizeBasic : 0;
+    }
+
+    PacketView() { }
+    explicit PacketView(const char *basicData) :
+        _data(reinterpret_cast<const quint8 *>(basicData))
+    {
+
+    }
+    explicit PacketView(const QByteArray &basicBytes) :
+        PacketView(basicBytes.length() >= sizeBasic ? basicBytes.constData() : nullptr)
+    {
+
+    }
+
+    bool isNull() const          { return !_data; }
+    bool isSyncByteValid() const { return _data && _data[0] == syncByteFixedValue; }
+    const quint8 *data() const   { return _data; }
+
+    bool transportErrorIndicator() const   { return _data[1] & 0x80; }
+    bool payloadUnitStartIndicator() const { return _data[1] & 0x40; }
+    bool transportPriority() const         { return _data[1] & 0x20; }
+    quint16 pid() const                    { return static_cast<quint16>((_data[1] & 0x1f) << 8 | _data[2]); }
+    bool isNullPacket() const              { return pid() == pidNullPacket; }
+
+    quint8 transportScramblingControl() const { return _data[3] >> 6; }
+    bool isScrambled() const                  { return transportScramblingControl() >= 2; }
+    quint8 adaptationFieldControl() const     { return (_data[3] >> 4) & 0x03; }
+    bool hasAdaptationField() const           { return _data[3] & 0x20; }
+    bool hasPayload() const                   { return _data[3] & 0x10; }
+    quint8 continuityCounter() const          { return _data[3] & 0x0f; }
+
+    // Adaptation field length (not counting the length byte itself),
+    // or -1 if there is no adaptation field.
+    int adaptationFieldLength() const
+    {
+        return hasAdaptationField() ? _data[4] : -1;
+    }
+
+    // Adaptation field flags byte, or 0 if not present.
+    quint8 adaptationFieldFlags() const
+    {
+        if (!hasAdaptationField() || _data[4] == 0 || _data[4] > 183)
+            return 0;
+        return _data[5];
+    }
+
+    bool discontinuityIndicator() const { return adaptationFieldFlags() & 0x80; }
+    bool randomAccessIndicator() const  { return adaptationFieldFlags() & 0x40; }
+    bool hasPCR() const                 { return (adaptationFieldFlags() & 0x10) && _data[4] >= 7; }
+
+    // Adaptation field only, without any flags set: Nothing but stuffing.
+    // (Doesn't advance the continuity counter, so can be left out.)
+    bool isStuffingOnly() const { return adaptationFieldControl() == 0x2 && adaptationFieldFlags() == 0; }
+
+    // Program clock reference in 90 kHz base units.
+    quint64 pcrBase() const
+    {
+        if (!hasPCR())
+            return 0;
+        return static_cast<quint64>(_data[6]) << 25 |
+               static_cast<quint64>(_data[7]) << 17 |
+               static_cast<quint64>(_data[8]) <<  9 |
+               static_cast<quint64>(_data[9]) <<  1 |
+               static_cast<quint64>(_data[10]) >> 7;
+    }
+
+    // Program clock reference in 27 MHz units.
+    quint64 pcrValue() const
+    {
+        if (!hasPCR())
+            return 0;
+        const quint16 extension = static_cast<quint16>((_data[10] & 0x01) << 8 | _data[11]);
+        return pcrBase() * 300 + extension;
+    }
+
+    double pcrSecs() const
+    {
+        return static_cast<double>(pcrValue()) / 27000000.;
+    }
+
+    int payloadOffset() const
+    {
+        if (!hasAdaptationField())
+            return 4;
+        const int offset = 5 + _data[4];
+        return offset <= sizeBasic ? offset : sizeBasic;
+    }
+
+    int payloadLength() const
+    {
+        return hasPayload() ? sizeBasic - payloadOffset() : 0;
+    }
+
+    const quint8 *payload() const
+    {
+        return _data + payloadOffset();
+    }
+};
+
+
+}  // namespace TS
+
+#endif // TSPACKETVIEW_H
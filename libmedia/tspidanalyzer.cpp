@@ -0,0 +1,134 @@
+#include "tspidanalyzer.h"
+
+#include "tspacketview.h"
+
+#include <stdexcept>
+
+namespace TS {
+
+
+PIDAnalyzer::PIDAnalyzer(qint64 bitrateWindowNanosecs) :
+    _bitrateWindowNanosecs(bitrateWindowNanosecs)
+{
+    if (!(_bitrateWindowNanosecs > 0))
+        throw std::invalid_argument("TS PID analyzer: Bitrate window must be positive");
+}
+
+namespace {
+
+void updateBitrate(PIDAnalyzer::PIDStats &stats, qint64 nowNanosecs, qint64 windowNanosecs)
+{
+    if (stats.windowPackets++ == 0) {
+        stats.windowStartNanosecs = nowNanosecs;
+        return;
+    }
+    const qint64 elapsedNanosecs = nowNanosecs - stats.windowStartNanosecs;
+    if (elapsedNanosecs < windowNanosecs)
+        return;
+    // (The packet closing the window starts the next one.)
+    stats.bitrate = static_cast<qint64>(
+        (stats.windowPackets - 1) * double(PacketView::sizeBasic * 8) * 1e9 / elapsedNanosecs);
+    stats.windowStartNanosecs = nowNanosecs;
+    stats.windowPackets = 1;
+}
+
+}  // namespace
+
+PIDAnalyzer::Result PIDAnalyzer::addPacket(const PacketView &packet, qint64 nowNanosecs)
+{
+    if (!packet.isSyncByteValid())
+        throw std::invalid_argument("TS PID analyzer: Packet must have a valid sync byte");
+
+    const quint16 pid = packet.pid();
+    PIDStats &stats(_pids[pid]);
+    if (stats.packets++ == 0)
+        _activePIDs.append(pid);
+    _totals.packets++;
+    updateBitrate(stats, nowNanosecs, _bitrateWindowNanosecs);
+    updateBitrate(_totals, nowNanosecs, _bitrateWindowNanosecs);
+
+    // Header can't be trusted, so neither can the continuity counter;
+    // start over with the next one, to not count the same loss twice.
+    if (packet.transportErrorIndicator()) {
+        stats.transportErrors++;
+        _totals.transportErrors++;
+        stats.lastCC = -1;
+        return Result::TransportError;
+    }
+    if (packet.isScrambled()) {
+        stats.scrambledPackets++;
+        _totals.scrambledPackets++;
+    }
+
+    // Null packets have undefined continuity counters, and those of packets
+    // without payload must not advance; don't bother checking the latter.
+    if (packet.isNullPacket() || !packet.hasPayload())
+        return Result::OK;
+
+    const qint8 cc = static_cast<qint8>(packet.continuityCounter());
+    if (packet.discontinuityIndicator()) {
+        stats.discontinuityIndicators++;
+        _totals.discontinuityIndicators++;
+    }
+    else if (stats.lastCC >= 0 && cc != ((stats.lastCC + 1) & 0x0f)) {
+        // One repetition of a packet is allowed; a second one is an error.
+        if (cc == stats.lastCC && !stats.lastWasDuplicate) {
+            stats.duplicatePackets++;
+            _totals.duplicatePackets++;
+            stats.lastWasDuplicate = true;
+            return Result::Duplicate;
+        }
+        stats.continuityErrors++;
+        _totals.continuityErrors++;
+        stats.lastGap = cc == stats.lastCC ? 0 : static_cast<quint8>((cc - stats.lastCC - 1) & 0x0f);
+        stats.lostPackets += stats.lastGap;
+        _totals.lostPackets += stats.lastGap;
+        stats.lastCC = cc;
+        stats.lastWasDuplicate = false;
+        return Result::ContinuityError;
+    }
+    stats.lastCC = cc;
+    stats.lastWasDuplicate = false;
+    return Result::OK;
+}
+
+void PIDAnalyzer::resetContinuity()
+{
+    for (quint16 pid : _activePIDs) {
+        _pids[pid].lastCC = -1;
+        _pids[pid].lastWasDuplicate = false;
+    }
+}
+
+void PIDAnalyzer::clear()
+{
+    for (quint16 pid : _activePIDs)
+        _pids[pid] = PIDStats();
+    _activePIDs.clear();
+    _totals = PIDStats();
+}
+
+const PIDAnalyzer::PIDStats &PIDAnalyzer::pidStats(quint16 pid) const
+{
+    if (pid >= _pids.size())
+        throw std::out_of_range("TS PID analyzer: PID out of range");
+    return _pids[pid];
+}
+
+const QList<quint16> &PIDAnalyzer::activePIDs() const
+{
+    return _activePIDs;
+}
+
+const PIDAnalyzer::PIDStats &PIDAnalyzer::totals() const
+{
+    return _totals;
+}
+
+qint64 PIDAnalyzer::bitrateWindowNanosecs() const
+{
+    return _bitrateWindowNanosecs;
+}
+
+
+}  // namespace TS
@@ -0,0 +1,84 @@
+#ifndef TSPIDANALYZER_H
+#define TSPIDANALYZER_H
+
+#include "libmedia_global.h"
+
+#include <array>
+#include <QList>
+#include <QtGlobal>
+
+namespace TS {
+
+class PacketView;
+
+
+// Per-PID health of a TS, checked inline on every packet: continuity
+// counter gaps (i.e., packets lost before they reached us), duplicate
+// packets, transport_error_indicator, scrambling, and bitrate.
+//
+// All state is in a flat table indexed by PID, so a packet costs
+// a lookup and a few compares, and no allocation.
+class LIBMEDIASHARED_EXPORT PIDAnalyzer
+{
+public:
+    struct PIDStats {
+        quint64  packets = 0;
+        quint64  continuityErrors = 0;
+        // Estimated from the continuity counter gaps, so modulo 16 each.
+        quint64  lostPackets = 0;
+        quint64  duplicatePackets = 0;
+        quint64  transportErrors = 0;
+        quint64  scrambledPackets = 0;
+        quint64  discontinuityIndicators = 0;
+        // Over the last complete bitrate window, as of the latest packet;
+        // 0 until there is one.
+        qint64   bitrate = 0;
+
+        qint64   windowStartNanosecs = 0;
+        quint32  windowPackets = 0;
+        qint8    lastCC = -1;  // -1 while unknown.
+        bool     lastWasDuplicate = false;
+        // Packets missing at the latest continuity error.
+        quint8   lastGap = 0;
+    };
+
+    enum class Result {
+        OK,
+        Duplicate,
+        ContinuityError,  // See pidStats(pid).lastGap.
+        TransportError,
+    };
+
+    static constexpr qint64 bitrateWindowNanosecsDefault = 1000000000;
+
+private:
+    std::array<PIDStats, 8192>  _pids;
+    QList<quint16>  _activePIDs;  // In order of appearance.
+    PIDStats        _totals;
+    qint64          _bitrateWindowNanosecs = bitrateWindowNanosecsDefault;
+
+public:
+    explicit PIDAnalyzer(qint64 bitrateWindowNanosecs = bitrateWindowNanosecsDefault);
+
+    // nowNanosecs is any monotonic time of arrival (or e.g. derived
+    // from the PCR), and is only used for the bitrates.
+    Result addPacket(const PacketView &packet, qint64 nowNanosecs);
+
+    // Forgets the last continuity counters, e.g. when the input
+    // starts over or had to be re-synced, so what we skipped
+    // doesn't get blamed on upstream. Keeps the counts.
+    void resetContinuity();
+    // Forgets everything.
+    void clear();
+
+    const PIDStats &pidStats(quint16 pid) const;
+    const QList<quint16> &activePIDs() const;
+    // Sums of the counters over all PIDs; bitrate over all PIDs, too.
+    const PIDStats &totals() const;
+    qint64 bitrateWindowNanosecs() const;
+};
+
+
+}  // namespace TS
+
+#endif // TSPIDANALYZER_H
@@ -0,0 +1,646 @@
+#include "tspsi.h"
+
+#include "tscrc32.h"
+#include "tspacketview.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <unordered_map>
+#include <QHash>
+#include <QMap>
+
+namespace TS {
+
+
+/*
+ * SectionAssembler
+ */
+
+void SectionAssembler::addPacket(const PacketView &packet, QList<QByteArray> *sections)
+{
+    if (!sections)
+        throw std::invalid_argument("TS section assembler: Sections can't be null");
+
+    if (!packet.isSyncByteValid() || packet.transportErrorIndicator() || packet.isScrambled()) {
+        reset();
+        return;
+    }
+
+    // (Continuity counter only increments on packets with payload.)
+    if (!packet.hasPayload())
+        return;
+
+    const int cc = packet.continuityCounter();
+    if (_lastCC >= 0) {
+        if (cc == _lastCC) {
+            // Duplicate packet.
+            return;
+        }
+        if (cc != ((_lastCC + 1) & 0x0f))
+            reset();
+    }
+    _lastCC = cc;
+
+    const quint8 *payload = packet.payload();
+    int length = packet.payloadLength();
+    if (length <= 0)
+        return;
+
+    if (!packet.payloadUnitStartIndicator()) {
+        // Continuation of a section, if we're in one.
+        if (!_section.isEmpty())
+            appendBytes(payload, length, sections);
+        return;
+    }
+
+    const int pointerField = payload[0];
+    payload++;
+    length--;
+    if (pointerField > length) {
+        reset();
+        return;
+    }
+
+    // Bytes up to the pointer finish the previous section.
+    if (!_section.isEmpty()) {
+        appendBytes(payload, pointerField, sections);
+        if (!_section.isEmpty()) {
+            // Still incomplete; truncated.
+            _discardCount++;
+            _section.clear();
+            _sectionLength = -1;
+        }
+    }
+    payload += pointerField;
+    length -= pointerField;
+
+    // Then, one or more sections start, until stuffing.
+    while (length > 0 && payload[0] != 0xff) {
+        const int used = appendBytes(payload, length, sections);
+        if (used <= 0 || !_section.isEmpty())
+            // Continues in next packet (or was discarded).
+            break;
+        payload += used;
+        length -= used;
+    }
+}
+
+int SectionAssembler::appendBytes(const quint8 *data, int length, QList<QByteArray> *sections)
+{
+    int used = 0;
+
+    // Need the 3-byte header for the length.
+    if (_sectionLength < 0) {
+        const int headerNeeded = std::min(3 - _section.length(), length);
+        _section.append(reinterpret_cast<const char *>(data), headerNeeded);
+        used += headerNeeded;
+        if (_section.length() < 3)
+            return used;
+
+        _sectionLength = 3 + ((static_cast<quint8>(_section.at(1)) & 0x0f) << 8 |
+                              static_cast<quint8>(_section.at(2)));
+        if (_sectionLength > sectionSizeMax) {
+            _discardCount++;
+            _section.clear();
+            _sectionLength = -1;
+            return 0;
+        }
+        _section.reserve(_sectionLength);
+    }
+
+    const int needed = std::min(_sectionLength - _section.length(), length - used);
+    _section.append(reinterpret_cast<const char *>(data + used), needed);
+    used += needed;
+    if (_section.length() < _sectionLength)
+        return used;
+
+    sections->append(_section);
+    _section.clear();
+    _sectionLength = -1;
+    return used;
+}
+
+void SectionAssembler::reset()
+{
+    if (!_section.isEmpty())
+        _discardCount++;
+    _section.clear();
+    _sectionLength = -1;
+    _lastCC = -1;
+}
+
+qint64 SectionAssembler::discardCount() const
+{
+    return _discardCount;
+}
+
+
+/*
+ * ElementaryStreamInfo
+ */
+
+namespace {
+
+// Calls func(tag, data, length) for each descriptor in the loop.
+template <typename Func>
+void forEachDescriptor(const QByteArray &descriptors, Func func)
+{
+    const quint8 *data = reinterpret_cast<const quint8 *>(descriptors.constData());
+    const int length = descriptors.length();
+    for (int pos = 0; pos + 2 <= length; ) {
+        const quint8 tag = data[pos];
+        const int descriptorLength = data[pos + 1];
+        pos += 2;
+        if (pos + descriptorLength > length)
+            break;
+        func(tag, data + pos, descriptorLength);
+        pos += descriptorLength;
+    }
+}
+
+}  // namespace
+
+ElementaryStreamInfo::Kind ElementaryStreamInfo::kind() const
+{
+    switch (streamType) {
+    case 0x01:  // MPEG-1 video
+    case 0x02:  // MPEG-2 video
+    case 0x10:  // MPEG-4 part 2 video
+    case 0x1b:  // H.264
+    case 0x24:  // HEVC
+    case 0x42:  // AVS
+    case 0xea:  // VC-1
+        return Kind::Video;
+    case 0x03:  // MPEG-1 audio
+    case 0x04:  // MPEG-2 audio
+    case 0x0f:  // AAC (ADTS)
+    case 0x11:  // AAC (LATM)
+    case 0x1c:  // MPEG-4 audio, raw
+    case 0x81:  // AC-3 (ATSC)
+    case 0x87:  // E-AC-3 (ATSC)
+        return Kind::Audio;
+    case 0x06: {
+        // Private data; DVB signals audio codecs via descriptors.
+        bool isAudio = false;
+        forEachDescriptor(descriptors, [&isAudio](quint8 tag, const quint8 *data, int length) {
+            switch (tag) {
+            case 0x6a:  // AC-3
+            case 0x7a:  // E-AC-3
+            case 0x7b:  // DTS
+            case 0x7c:  // AAC
+                isAudio = true;
+                break;
+            case 0x05:  // Registration
+                if (length >= 4) {
+                    const QByteArray formatIdentifier(reinterpret_cast<const char *>(data), 4);
+                    if (formatIdentifier == "AC-3" || formatIdentifier == "EAC3" ||
+                        formatIdentifier == "Opus" || formatIdentifier == "BSSD")
+                        isAudio = true;
+                }
+                break;
+            }
+        });
+        return isAudio ? Kind::Audio : Kind::Other;
+    }
+    default:
+        return Kind::Other;
+    }
+}
+
+QString ElementaryStreamInfo::streamTypeName() const
+{
+    switch (streamType) {
+    case 0x01:  return "MPEG-1 video";
+    case 0x02:  return "MPEG-2 video";
+    case 0x03:  return "MPEG-1 audio";
+    case 0x04:  return "MPEG-2 audio";
+    case 0x05:  return "private sections";
+    case 0x06:  return "private PES";
+    case 0x0f:  return "AAC";
+    case 0x10:  return "MPEG-4 video";
+    case 0x11:  return "AAC (LATM)";
+    case 0x15:  return "metadata";
+    case 0x1b:  return "H.264";
+    case 0x1c:  return "MPEG-4 audio";
+    case 0x24:  return "HEVC";
+    case 0x42:  return "AVS";
+    case 0x81:  return "AC-3";
+    case 0x86:  return "SCTE-35";
+    case 0x87:  return "E-AC-3";
+    case 0xea:  return "VC-1";
+    default:
+        return "type 0x" + QString::number(streamType, 16).rightJustified(2, '0');
+    }
+}
+
+
+/*
+ * PSIDemux
+ */
+
+namespace impl {
+class PSIDemuxImpl {
+    PSIDemux *q;
+    friend PSIDemux;
+
+public:
+    enum PIDKind : quint8 {
+        PIDKindNone = 0,
+        PIDKindPAT,
+        PIDKindPMT,
+    };
+
+    struct PIDState {
+        SectionAssembler  assembler;
+        // Last accepted section by table_id, table_id_extension, section_number;
+        // to recognize repetitions.
+        QHash<quint32, QByteArray>  knownSections;
+    };
+
+private:
+    std::array<quint8, 8192>  _pidKinds {};
+    std::unordered_map<quint16, PIDState>  _pidStates;
+    QList<QByteArray>  _sections;  // (Re-used for every packet.)
+
+    int      _patVersion = -1;
+    quint16  _transportStreamId = 0;
+    quint16  _networkPID = 0x1fff;
+    int      _patPendingVersion = -1;
+    QMap<int, QByteArray>  _patPendingSections;
+    QList<ProgramInfo>  _programs;
+
+    qint64  _sectionCount = 0;
+    qint64  _sectionRepeatCount = 0;
+    qint64  _crcErrorCount = 0;
+    qint64  _sectionErrorCount = 0;
+
+public:
+    explicit PSIDemuxImpl(PSIDemux *q) : q(q)
+    {
+        _pidKinds[PSIDemux::pidPAT] = PIDKindPAT;
+    }
+
+    void handleSection(quint16 pid, PIDState &state, const QByteArray &section);
+    bool handlePATSection(const QByteArray &section);
+    bool handlePMTSection(quint16 pid, const QByteArray &section);
+    void applyPAT(quint16 transportStreamId, int version);
+    void sectionError(quint16 pid, const QString &errorMessage);
+};
+
+void PSIDemuxImpl::sectionError(quint16 pid, const QString &errorMessage)
+{
+    _sectionErrorCount++;
+    emit q->sectionError(pid, errorMessage);
+}
+
+void PSIDemuxImpl::handleSection(quint16 pid, PIDState &state, const QByteArray &section)
+{
+    _sectionCount++;
+
+    const quint8 *data = reinterpret_cast<const quint8 *>(section.constData());
+    const quint8 tableId = data[0];
+    // (Stuffing and short-form sections aren't of interest here.)
+    if (tableId == 0xff || !(data[1] & 0x80))
+        return;
+
+    // Long form: 8 bytes header, CRC_32 at the end.
+    if (section.length() < 8 + 4) {
+        sectionError(pid, "Section of table_id " + QString::number(tableId) +
+                          " too short: " + QString::number(section.length()) + " bytes");
+        return;
+    }
+
+    const quint16 tableIdExtension = static_cast<quint16>(data[3] << 8 | data[4]);
+    const quint8 sectionNumber = data[6];
+    const quint32 key = static_cast<quint32>(tableId) << 24 | static_cast<quint32>(tableIdExtension) << 8 | sectionNumber;
+    const auto knownIt = state.knownSections.constFind(key);
+    if (knownIt != state.knownSections.constEnd() && *knownIt == section) {
+        _sectionRepeatCount++;
+        return;
+    }
+
+    if (crc32Mpeg2(section) != 0) {
+        _crcErrorCount++;
+        emit q->sectionError(pid, "CRC mismatch in section of table_id " + QString::number(tableId));
+        return;
+    }
+
+    // Not applicable, yet?
+    const bool currentNextIndicator = data[5] & 0x01;
+    if (!currentNextIndicator)
+        return;
+
+    bool accepted = false;
+    if (tableId == 0x00 && _pidKinds[pid] == PIDKindPAT)
+        accepted = handlePATSection(section);
+    else if (tableId == 0x02 && _pidKinds[pid] == PIDKindPMT)
+        accepted = handlePMTSection(pid, section);
+
+    // (The PAT might have just dropped this PID.)
+    if (accepted && _pidKinds[pid] != PIDKindNone)
+        state.knownSections.insert(key, section);
+}
+
+bool PSIDemuxImpl::handlePATSection(const QByteArray &section)
+{
+    const quint8 *data = reinterpret_cast<const quint8 *>(section.constData());
+    const quint16 transportStreamId = static_cast<quint16>(data[3] << 8 | data[4]);
+    const int version = (data[5] >> 1) & 0x1f;
+    const int sectionNumber = data[6];
+    const int lastSectionNumber = data[7];
+    if (sectionNumber > lastSectionNumber) {
+        sectionError(PSIDemux::pidPAT, "PAT section number " + QString::number(sectionNumber) +
+                                       " beyond last section number " + QString::number(lastSectionNumber));
+        return false;
+    }
+
+    // Collect all sections of a version before applying it.
+    if (version != _patPendingVersion) {
+        _patPendingSections.clear();
+        _patPendingVersion = version;
+    }
+    _patPendingSections.insert(sectionNumber, section);
+    for (int i = 0; i <= lastSectionNumber; i++) {
+        if (!_patPendingSections.contains(i))
+            return true;
+    }
+
+    applyPAT(transportStreamId, version);
+    return true;
+}
+
+void PSIDemuxImpl::applyPAT(quint16 transportStreamId, int version)
+{
+    QList<ProgramInfo> programs;
+    quint16 networkPID = 0x1fff;
+    for (const QByteArray &section : _patPendingSections) {
+        const quint8 *data = reinterpret_cast<const quint8 *>(section.constData());
+        const int end = section.length() - 4;
+        for (int pos = 8; pos + 4 <= end; pos += 4) {
+            const quint16 programNumber = static_cast<quint16>(data[pos] << 8 | data[pos + 1]);
+            const quint16 pid = static_cast<quint16>((data[pos + 2] & 0x1f) << 8 | data[pos + 3]);
+            if (programNumber == 0) {
+                networkPID = pid;
+                continue;
+            }
+
+            // Keep what we know about unchanged programs.
+            ProgramInfo program;
+            for (const ProgramInfo &old : _programs) {
+                if (old.programNumber == programNumber && old.pmtPID == pid) {
+                    program = old;
+                    break;
+                }
+            }
+            program.programNumber = programNumber;
+            program.pmtPID = pid;
+            programs.append(program);
+        }
+    }
+    _patPendingSections.clear();
+
+    QList<quint16> removedProgramNumbers;
+    for (const ProgramInfo &old : _programs) {
+        bool found = false;
+        for (const ProgramInfo &program : programs) {
+            if (program.programNumber == old.programNumber) {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            removedProgramNumbers.append(old.programNumber);
+    }
+
+    // Re-register PMT PIDs.
+    for (int pid = 0; pid < static_cast<int>(_pidKinds.size()); pid++) {
+        if (_pidKinds[pid] == PIDKindPMT)
+            _pidKinds[pid] = PIDKindNone;
+    }
+    for (const ProgramInfo &program : programs) {
+        if (program.pmtPID != PSIDemux::pidPAT)
+            _pidKinds[program.pmtPID] = PIDKindPMT;
+    }
+    for (auto it = _pidStates.begin(); it != _pidStates.end(); ) {
+        if (_pidKinds[it->first] == PIDKindNone)
+            it = _pidStates.erase(it);
+        else
+            ++it;
+    }
+
+    _programs = programs;
+    _patVersion = version;
+    _transportStreamId = transportStreamId;
+    _networkPID = networkPID;
+
+    for (const quint16 programNumber : removedProgramNumbers)
+        emit q->programRemoved(programNumber);
+    emit q->patChanged();
+}
+
+bool PSIDemuxImpl::handlePMTSection(quint16 pid, const QByteArray &section)
+{
+    const quint8 *data = reinterpret_cast<const quint8 *>(section.constData());
+    const quint16 programNumber = static_cast<quint16>(data[3] << 8 | data[4]);
+    const int version = (data[5] >> 1) & 0x1f;
+
+    ProgramInfo *programPtr = nullptr;
+    for (ProgramInfo &program : _programs) {
+        if (program.programNumber == programNumber && program.pmtPID == pid) {
+            programPtr = &program;
+            break;
+        }
+    }
+    if (!programPtr) {
+        // Not (or no longer) in the PAT.
+        return false;
+    }
+
+    const int end = section.length() - 4;
+    if (end < 12) {
+        sectionError(pid, "PMT of program " + QString::number(programNumber) + " too short");
+        return false;
+    }
+
+    ProgramInfo program = *programPtr;
+    program.pmtVersion = version;
+    program.pcrPID = static_cast<quint16>((data[8] & 0x1f) << 8 | data[9]);
+    const int programInfoLength = (data[10] & 0x0f) << 8 | data[11];
+    int pos = 12;
+    if (pos + programInfoLength > end) {
+        sectionError(pid, "PMT of program " + QString::number(programNumber) +
+                          ": Program info length " + QString::number(programInfoLength) + " exceeds section");
+        return false;
+    }
+    program.descriptors = section.mid(pos, programInfoLength);
+    pos += programInfoLength;
+
+    program.streams.clear();
+    while (pos + 5 <= end) {
+        ElementaryStreamInfo stream;
+        stream.streamType = data[pos];
+        stream.pid = static_cast<quint16>((data[pos + 1] & 0x1f) << 8 | data[pos + 2]);
+        const int esInfoLength = (data[pos + 3] & 0x0f) << 8 | data[pos + 4];
+        pos += 5;
+        if (pos + esInfoLength > end) {
+            sectionError(pid, "PMT of program " + QString::number(programNumber) +
+                              ": ES info length " + QString::number(esInfoLength) + " exceeds section");
+            return false;
+        }
+        stream.descriptors = section.mid(pos, esInfoLength);
+        pos += esInfoLength;
+        program.streams.append(stream);
+    }
+
+    *programPtr = program;
+    emit q->pmtChanged(programNumber);
+    return true;
+}
+}  // namespace TS::impl
+
+
+PSIDemux::PSIDemux(QObject *parent) : QObject(parent),
+    _implPtr(std::make_unique<impl::PSIDemuxImpl>(this))
+{
+
+}
+
+PSIDemux::~PSIDemux()
+{
+
+}
+
+void PSIDemux::addPacket(const PacketView &packet)
+{
+    impl::PSIDemuxImpl &d(*_implPtr);
+
+    if (!packet.isSyncByteValid())
+        return;
+
+    // Fast path: Not a PSI PID.
+    const quint16 pid = packet.pid();
+    if (d._pidKinds[pid] == impl::PSIDemuxImpl::PIDKindNone)
+        return;
+
+    impl::PSIDemuxImpl::PIDState &state(d._pidStates[pid]);
+    d._sections.clear();
+    state.assembler.addPacket(packet, &d._sections);
+    if (d._sections.isEmpty())
+        return;
+
+    // (Handling a PAT may drop this PID's state; work on a copy of the list.)
+    const QList<QByteArray> sections = d._sections;
+    for (const QByteArray &section : sections) {
+        auto it = d._pidStates.find(pid);
+        if (it == d._pidStates.end())
+            break;
+        d.handleSection(pid, it->second, section);
+    }
+}
+
+void PSIDemux::reset()
+{
+    impl::PSIDemuxImpl &d(*_implPtr);
+
+    d._pidKinds.fill(impl::PSIDemuxImpl::PIDKindNone);
+    d._pidKinds[pidPAT] = impl::PSIDemuxImpl::PIDKindPAT;
+    d._pidStates.clear();
+    d._patVersion = -1;
+    d._transportStreamId = 0;
+    d._networkPID = 0x1fff;
+    d._patPendingVersion = -1;
+    d._patPendingSections.clear();
+    d._programs.clear();
+}
+
+bool PSIDemux::isPSIPID(quint16 pid) const
+{
+    return pid < _implPtr->_pidKinds.size() &&
+           _implPtr->_pidKinds[pid] != impl::PSIDemuxImpl::PIDKindNone;
+}
+
+int PSIDemux::patVersion() const
+{
+    return _implPtr->_patVersion;
+}
+
+quint16 PSIDemux::transportStreamId() const
+{
+    return _implPtr->_transportStreamId;
+}
+
+quint16 PSIDemux::networkPID() const
+{
+    return _implPtr->_networkPID;
+}
+
+const QList<ProgramInfo> &PSIDemux::programs() const
+{
+    return _implPtr->_programs;
+}
+
+const ProgramInfo *PSIDemux::program(quint16 programNumber) const
+{
+    for (const ProgramInfo &program : _implPtr->_programs) {
+        if (program.programNumber == programNumber)
+            return &program;
+    }
+    return nullptr;
+}
+
+qint64 PSIDemux::sectionCount() const
+{
+    return _implPtr->_sectionCount;
+}
+
+qint64 PSIDemux::sectionRepeatCount() const
+{
+    return _implPtr->_sectionRepeatCount;
+}
+
+qint64 PSIDemux::crcErrorCount() const
+{
+    return _implPtr->_crcErrorCount;
+}
+
+qint64 PSIDemux::sectionErrorCount() const
+{
+    return _implPtr->_sectionErrorCount;
+}
+
+
+QDebug operator<<(QDebug debug, const ElementaryStreamInfo &stream)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "PID 0x" << qPrintable(QString::number(stream.pid, 16).rightJustified(4, '0'))
+                    << " " << qPrintable(stream.streamTypeName());
+    switch (stream.kind()) {
+    case ElementaryStreamInfo::Kind::Video:
+        debug << " (video)";
+        break;
+    case ElementaryStreamInfo::Kind::Audio:
+        debug << " (audio)";
+        break;
+    case ElementaryStreamInfo::Kind::Other:
+        break;
+    }
+    return debug;
+}
+
+QDebug operator<<(QDebug debug, const ProgramInfo &program)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "program " << program.programNumber
+                    << " (PMT PID 0x" << qPrintable(QString::number(program.pmtPID, 16).rightJustified(4, '0'));
+    if (!program.hasPMT())
+        return debug << ", no PMT yet)";
+
+    debug << " version " << program.pmtVersion
+          << ", PCR PID 0x" << qPrintable(QString::number(program.pcrPID, 16).rightJustified(4, '0')) << "):";
+    for (const ElementaryStreamInfo &stream : program.streams)
+        debug << " " << stream;
+    return debug;
+}
+
+}  // namespace TS
@@ -0,0 +1,136 @@
+#ifndef TSPSI_H
+#define TSPSI_H
+
+#include "libmedia_global.h"
+
+#include <QObject>
+
+#include <memory>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QDebug>
+
+namespace TS {
+
+class PacketView;
+
+
+// Reassembles PSI sections (e.g., PAT, PMT) from the TS packets
+// of a single PID: follows pointer_field, sections spanning packets
+// and multiple sections per packet, and drops a section in progress
+// on continuity counter gaps or transport errors.
+//
+// Doesn't check CRCs; that's up to the user of the sections.
+class LIBMEDIASHARED_EXPORT SectionAssembler
+{
+    QByteArray  _section;
+    int         _sectionLength = -1;  // Total incl. header; -1 while unknown.
+    int         _lastCC = -1;
+    qint64      _discardCount = 0;
+
+    // Returns how many bytes were used, at most up to the end of the section.
+    int appendBytes(const quint8 *data, int length, QList<QByteArray> *sections);
+
+public:
+    // Largest section allowed by ISO/IEC 13818-1 (private sections).
+    static constexpr int sectionSizeMax = 4096;
+
+    // Appends the sections completed by this packet to sections.
+    void addPacket(const PacketView &packet, QList<QByteArray> *sections);
+    void reset();
+
+    // Sections in progress that had to be thrown away.
+    qint64 discardCount() const;
+};
+
+
+// An elementary stream, as listed in a PMT.
+struct LIBMEDIASHARED_EXPORT ElementaryStreamInfo {
+    enum class Kind {
+        Video,
+        Audio,
+        Other,
+    };
+
+    quint8      streamType = 0;
+    quint16     pid = 0x1fff;
+    QByteArray  descriptors;
+
+    // Guessed from stream_type, and for private data (0x06)
+    // from well-known DVB audio descriptors.
+    Kind kind() const;
+    QString streamTypeName() const;
+};
+
+// A program, as listed in the PAT, and described by its PMT.
+struct ProgramInfo {
+    quint16     programNumber = 0;
+    quint16     pmtPID = 0x1fff;
+    int         pmtVersion = -1;  // -1 while no PMT has been received.
+    quint16     pcrPID = 0x1fff;
+    QByteArray  descriptors;
+    QList<ElementaryStreamInfo>  streams;
+
+    bool hasPMT() const { return pmtVersion >= 0; }
+};
+
+
+namespace impl {
+class PSIDemuxImpl;
+}
+
+// Tracks PAT and PMTs on a stream of TS packets, and keeps a model
+// of the programs and their PIDs up to date.
+//
+// Meant to be fed every ingested packet: Packets on non-PSI PIDs
+// are dismissed by a table lookup, and sections that are byte-for-byte
+// repetitions of already-known ones (as PSI gets repeated every
+// fraction of a second) are dismissed without CRC check or parsing.
+// So only version changes (or corruption) cost more.
+class LIBMEDIASHARED_EXPORT PSIDemux : public QObject
+{
+    Q_OBJECT
+    std::unique_ptr<impl::PSIDemuxImpl>  _implPtr;
+
+public:
+    static constexpr quint16 pidPAT = 0x0000;
+
+    explicit PSIDemux(QObject *parent = nullptr);
+    ~PSIDemux();
+
+    void addPacket(const PacketView &packet);
+    // Forgets all PSI, e.g. when the input starts over.
+    void reset();
+
+    // Whether packets on this PID are looked at (PAT or a PMT).
+    bool isPSIPID(quint16 pid) const;
+
+    // -1 while no PAT has been received.
+    int patVersion() const;
+    quint16 transportStreamId() const;
+    // 0x1fff if none listed.
+    quint16 networkPID() const;
+
+    const QList<ProgramInfo> &programs() const;
+    // Null if not listed in the PAT. Valid until the next packet is added.
+    const ProgramInfo *program(quint16 programNumber) const;
+
+    qint64 sectionCount() const;         // Completed sections seen.
+    qint64 sectionRepeatCount() const;   // Of those, dismissed as repetitions.
+    qint64 crcErrorCount() const;
+    qint64 sectionErrorCount() const;    // Malformed, besides CRC errors.
+
+signals:
+    void patChanged();
+    void pmtChanged(quint16 programNumber);
+    void programRemoved(quint16 programNumber);
+    void sectionError(quint16 pid, const QString &errorMessage);
+};
+
+LIBMEDIASHARED_EXPORT QDebug operator<<(QDebug debug, const ElementaryStreamInfo &stream);
+LIBMEDIASHARED_EXPORT QDebug operator<<(QDebug debug, const ProgramInfo &program);
+
+}  // namespace TS
+
+#endif // TSPSI_H
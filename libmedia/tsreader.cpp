@@ -1,4 +1,5 @@
 #include "log.h"
+#include "lograte.h"
 #include "tsreader.h"
 
 #ifndef TS_PACKET_V2
@@ -6,6 +7,8 @@
 #endif
 // (Always need V2, to avoid ifdef-ing every place where the basic packet size or sync byte fixed value are used.)
 #include "tspacketv2.h"
+#include "tspacketview.h"
+#include "tspsi.h"
 
 #include <cmath>
 #include <stdexcept>
@@ -14,8 +17,6 @@
 #include <QFile>
 #include <QSocketNotifier>
 
-using SSCvn::log::verbose;
-
 namespace TS {
 
 namespace impl {
@@ -34,6 +35,7 @@ class ReaderImpl {
     int                               _discontSegment = 1;
     bool                              _discontLastPCRValid = false;
     double                            _discontLastPCR;
+    PSIDemux                          _psiDemux;
     friend Reader;
 
 public:
@@ -120,7 +122,7 @@ void Reader::setTSPacketSize(qint64 size)
 #endif
         throw std::invalid_argument("TS reader: Set TS packet size: Invalid size " + std::to_string(size));
 
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << theLogPrefix << thePositionString << "Setting fixed packet size of" << size << "bytes.";
     _implPtr->_tsPacketSize = size;
 #ifdef TS_PACKET_V2
@@ -138,6 +140,11 @@ qint64 Reader::tsPacketCount() const
     return _implPtr->_tsPacketCount;
 }
 
+PSIDemux &Reader::psiDemux() const
+{
+    return _implPtr->_psiDemux;
+}
+
 int Reader::discontSegment() const
 {
     return _implPtr->_discontSegment;
@@ -166,7 +173,7 @@ void Reader::readData()
         int bufLenPrev   = buf.length();
         int bufLenTarget = (bufLenPrev / prePacketSize + 1) * prePacketSize;  // Target next full packet.
         if (bufLenPrev < bufLenTarget) {
-            if (verbose >= 3) {
+            if (SSCVN_VERBOSE(3)) {
                 qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                         << "Trying to read from" << bufLenPrev << "bytes to" << bufLenTarget << "bytes,"
                         << "that is" << (bufLenTarget - bufLenPrev) << "bytes...";
@@ -176,7 +183,7 @@ void Reader::readData()
             if (readResult < 0) {
                 buf.resize(bufLenPrev);
                 const QString errMsg = dev.errorString();
-                if (verbose >= 3) {
+                if (SSCVN_VERBOSE(3)) {
                     qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                             << "Got error:" << errMsg;
                 }
@@ -185,7 +192,7 @@ void Reader::readData()
             }
             else if (readResult == 0) {
                 buf.resize(bufLenPrev);
-                if (verbose >= 3) {
+                if (SSCVN_VERBOSE(3)) {
                     qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                             << "Got end-of-file (EOF).";
                 }
@@ -195,7 +202,7 @@ void Reader::readData()
             else if (bufLenPrev + readResult < bufLenTarget) {
                 // Short read. Guess all we can do is return...
                 buf.resize(bufLenPrev + readResult);
-                if (verbose >= 3) {
+                if (SSCVN_VERBOSE(3)) {
                     qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                             << "Got short read of" << readResult << "bytes.";
                 }
@@ -203,7 +210,7 @@ void Reader::readData()
             }
 
             // A full read!
-            if (verbose >= 3) {
+            if (SSCVN_VERBOSE(3)) {
                 qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                         << "Got a full read.";
             }
@@ -217,7 +224,7 @@ void Reader::readData()
                 break;
             }
         }
-        if (verbose >= 3) {
+        if (SSCVN_VERBOSE(3)) {
             qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                     << (noMoreDrainBuffer ? "No more drain buffer possible." : "Buffer can't be processed, yet.")
                     << "Continuing read data loop...";
@@ -238,7 +245,7 @@ bool Reader::drainBuffer()
 
     const int packetSize = _implPtr->tsPacketSizeEffective();
     if (buf.length() < packetSize) {
-        if (verbose >= 3) {
+        if (SSCVN_VERBOSE(3)) {
             qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                     << "Drain buffer: Buffer length" << buf.length() << "is smaller than packet size" << packetSize;
         }
@@ -246,14 +253,14 @@ bool Reader::drainBuffer()
     }
 
     // Try to interpret as TS packet.
-    if (verbose >= 3) {
+    if (SSCVN_VERBOSE(3)) {
         qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                 << "Extracting packet size" << packetSize << "bytes from buffer...";
     }
     auto bytesNode_ptr = QSharedPointer<ConversionNode<QByteArray>>::create(buf.left(packetSize));
     buf.remove(0, packetSize);
 #ifndef TS_PACKET_V2
-    if (verbose >= 3) {
+    if (SSCVN_VERBOSE(3)) {
         qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                 << "Parsing as TSPacket (V1)...";
     }
@@ -262,7 +269,7 @@ bool Reader::drainBuffer()
     const bool success = errMsg.isNull();
     conversionNodeAddEdge(bytesNode_ptr, packetNode_ptr);
 #else
-    if (verbose >= 3) {
+    if (SSCVN_VERBOSE(3)) {
         qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                 << "Parsing as TS::PacketV2...";
     }
@@ -271,7 +278,7 @@ bool Reader::drainBuffer()
     const bool success = _implPtr->_tsParser.parse(bytesNode_ptr, &packetNode_ptr, &errMsg);
 #endif
     _implPtr->_tsPacketCount++;
-    if (verbose >= 3) {
+    if (SSCVN_VERBOSE(3)) {
         qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                 << (success ? "Successfully" : "Failedly") << "parsed packet.";
     }
@@ -279,7 +286,7 @@ bool Reader::drainBuffer()
     double pcrPrev = pcrLast();
     if (packetNode_ptr && _implPtr->checkIsDiscontinuity(packetNode_ptr->data)) {
         _implPtr->_discontSegment++;
-        if (verbose >= 2) {
+        if (SSCVN_VERBOSE(2)) {
             qInfo() << qPrintable(_implPtr->_logPrefix) << qPrintable(positionString())
                     << "Detected discontinuity!";
         }
@@ -290,6 +297,17 @@ bool Reader::drainBuffer()
     if (!success) {
         emit errorEncountered(ErrorKind::TS, errMsg);
     }
+    else {
+        const QByteArray &bytes(bytesNode_ptr->data);
+        const int prefixLength =
+#ifndef TS_PACKET_V2
+            bytes.length() == 4 + TSPacket::lengthBasic ? 4 : 0;
+#else
+            _implPtr->_tsParser.prefixLength();
+#endif
+        if (bytes.length() >= prefixLength + PacketView::sizeBasic)
+            _implPtr->_psiDemux.addPacket(PacketView(bytes.constData() + prefixLength));
+    }
 
     if (packetNode_ptr)
         emit tsPacketReady(packetNode_ptr);
@@ -350,7 +368,7 @@ bool impl::ReaderImpl::checkIsReady()
             int bufSyncByteCount = 0;
             bool isReadyOldSize = checkIsReady(bufPacketSize, bufPrefixLength, &bufPacketCount, &bufSyncByteCount);
 
-            if (verbose >= 3) {
+            if (SSCVN_VERBOSE(3)) {
                 qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                         << "Check is ready: Already running at TS packet size" << _tsPacketSize
                         << "with" << bufSyncByteCount << "of" << bufPacketCount << "packets in the buffer"
@@ -362,7 +380,8 @@ bool impl::ReaderImpl::checkIsReady()
             if (bufPacketCount <= limitPacketCount)
                 return isReadyOldSize;
 
-            if (verbose >= 2) {
+            static SSCvn::log::RateLimiter limitLimiter("exceeded packets-in-buffer limits");
+            if (SSCVN_VERBOSE(2) && limitLimiter.check(positionString())) {
                 qWarning() << qPrintable(_logPrefix) << qPrintable(positionString())
                            << "Check is ready: Exceeded packets-in-buffer limit!"
                            << bufPacketCount << "vs" << limitPacketCount;
@@ -370,7 +389,7 @@ bool impl::ReaderImpl::checkIsReady()
 
             // If enabled, maybe just do packet size auto-detection instead of resync.
             if (_tsPacketAutoSize) {
-                if (verbose >= 2) {
+                if (SSCVN_VERBOSE(2)) {
                     qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                             << "Check is ready: Resetting TS packet size to 0, thus forcing auto-detection...";
                 }
@@ -404,7 +423,7 @@ bool impl::ReaderImpl::checkIsReady()
                     int bufSyncByteCount = 0;
                     checkIsReady(testPacketSize, testPrefixLength, &bufPacketCount, &bufSyncByteCount);
                     double score = static_cast<double>(bufSyncByteCount) / static_cast<double>(bufPacketCount);
-                    if (verbose >= 3) {
+                    if (SSCVN_VERBOSE(3)) {
                         qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                                 << "TS packet size auto-detection: Score" << score << "for"
                                 << "test packet size" << testPacketSize << "with"
@@ -412,7 +431,7 @@ bool impl::ReaderImpl::checkIsReady()
                                 << "test suffix length" << testSuffixLength;
                     }
                     if (score > bestScore) {
-                        if (verbose >= 3) {
+                        if (SSCVN_VERBOSE(3)) {
                             qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                                     << "TS packet size auto-detection: Remembering as best score for now...";
                         }
@@ -433,7 +452,7 @@ bool impl::ReaderImpl::checkIsReady()
             // Do we have a winner? Stick to that packet size for a while
             // and indicate buffer can now be processed.
             if (bestScore >= 0.5) {
-                if (verbose >= 0) {
+                if (SSCVN_VERBOSE(0)) {
                     qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                             << "TS packet size auto-detection: Final best score is" << bestScore << "and"
                             << "packet size gets set permanently to" << bufPacketSize << "with"
@@ -462,7 +481,8 @@ bool impl::ReaderImpl::checkIsReady()
 
             // Otherwise, fall-through to general resync.
 
-            if (verbose >= 1) {
+            static SSCvn::log::RateLimiter autoDetectLimiter("failed TS packet size auto-detections");
+            if (SSCVN_VERBOSE(1) && autoDetectLimiter.check(positionString())) {
                 qWarning() << qPrintable(_logPrefix) << qPrintable(positionString())
                         << "TS packet size auto-detection failed:"
                         << "Final best score of" << bestScore << "is not enough; refusing to set"
@@ -474,16 +494,19 @@ bool impl::ReaderImpl::checkIsReady()
 
         // Need resync. If possible, we should drop bytes until we have a sync byte at the correct position.
 
-        if (verbose >= 2) {
+        if (SSCVN_VERBOSE(2)) {
             qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                     << "Trying resync...";
         }
 
+        // (Corrupt input may need a resync for every buffer-full.)
+        static SSCvn::log::RateLimiter resyncLimiter("failed resyncs");
+
         int syncBytePos1 = _buf.indexOf(TS::PacketV2::syncByteFixedValue);
         if (!(syncBytePos1 >= 0)) {
             // If no sync byte can be found at all, indicate buffer
             // should be processed (with every "packet" parsed being invalid).
-            if (verbose >= 1) {
+            if (SSCVN_VERBOSE(1) && resyncLimiter.check(positionString(), "no sync byte")) {
                 qWarning() << qPrintable(_logPrefix) << qPrintable(positionString())
                            << "Resync: No first sync byte found, allowing to process buffer as invalid packets...";
             }
@@ -495,7 +518,7 @@ bool impl::ReaderImpl::checkIsReady()
             // No sync byte belonging to another packet following first
             // sync byte found, can't do any sensible adjustment based on that.
             // Process as invalid packets...
-            if (verbose >= 1) {
+            if (SSCVN_VERBOSE(1) && resyncLimiter.check(positionString(), "no second sync byte")) {
                 qWarning() << qPrintable(_logPrefix) << qPrintable(positionString())
                            << "Resync: No sync byte belonging to another packet following first sync byte found,"
                            << "allowing to process buffer as invalid packets...";
@@ -508,7 +531,7 @@ bool impl::ReaderImpl::checkIsReady()
             // Assume we found two consecutive valid packets, and
             // remove garbage before the first one.
             _buf.remove(0, syncBytePos1);
-            if (verbose >= 0) {
+            if (SSCVN_VERBOSE(0)) {
                 qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                         << "Resync: Found two consecutive sync bytes with distance" << syncBytePosDiff
                         << "which is one basic TS packet size!"
@@ -520,7 +543,7 @@ bool impl::ReaderImpl::checkIsReady()
             if (syncBytePos1 >= 4) {
                 // Remove garbage.
                 _buf.remove(0, syncBytePos1 - 4);
-                if (verbose >= 0) {
+                if (SSCVN_VERBOSE(0)) {
                     qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                             << "Resync: Found two consecutive sync bytes with distance" << syncBytePosDiff
                             << "which is a timecode prefix plus basic TS packet size!"
@@ -533,7 +556,7 @@ bool impl::ReaderImpl::checkIsReady()
                 // the whole packet, or somehow fill up/in (potentially)
                 // invalid prefix bytes. ...
                 _buf.insert(0, 4 - syncBytePos1, 0x00);
-                if (verbose >= 0) {
+                if (SSCVN_VERBOSE(0)) {
                     qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                             << "Resync: Found two consecutive sync bytes with distance" << syncBytePosDiff
                             << "which is a timecode prefix plus basic TS packet size!"
@@ -548,7 +571,7 @@ bool impl::ReaderImpl::checkIsReady()
             // Anyhow, they should just be trailing bytes.
             // Remove garbage before first detected packet...
             _buf.remove(0, syncBytePos1);
-            if (verbose >= 0) {
+            if (SSCVN_VERBOSE(0)) {
                 qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                         << "Resync: Found two consecutive sync bytes with distance" << syncBytePosDiff
                         << "which is a basic TS packet with forward-error-correction size!"
@@ -559,7 +582,7 @@ bool impl::ReaderImpl::checkIsReady()
             // Does not look sensible. Maybe it's not a sync byte at all.
             // We could try to randomly drop some packets, but at the lack
             // of clear information, process as invalid packets...
-            if (verbose >= 1) {
+            if (SSCVN_VERBOSE(1) && resyncLimiter.check(positionString(), "implausible sync byte distance")) {
                 qWarning() << qPrintable(_logPrefix) << qPrintable(positionString())
                            << "Resync: Two sync bytes found, but distance" << syncBytePosDiff << "doesn't make sense,"
                            << "allowing to process buffer as invalid packets...";
@@ -568,14 +591,14 @@ bool impl::ReaderImpl::checkIsReady()
         }
 
         // Go on with the same process again, until we run out of buffer bytes...
-        if (verbose >= 3) {
+        if (SSCVN_VERBOSE(3)) {
             qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                     << "Check is ready: Going for a next round...";
         }
     }
 
     // Ran out of buffer bytes. Indicate buffer can't be processed, yet.
-    if (verbose >= 3) {
+    if (SSCVN_VERBOSE(3)) {
         qInfo() << qPrintable(_logPrefix) << qPrintable(positionString())
                 << "Check is ready: Ran out of buffer bytes.";
     }
@@ -14,6 +14,8 @@
 
 namespace TS {
 
+class PSIDemux;
+
 namespace impl {
 class ReaderImpl;
 }
@@ -48,6 +50,8 @@ public:
     qint64 tsPacketCount() const;
     int discontSegment() const;
     double pcrLast() const;
+    // PAT/PMT, as of the packet last made ready.
+    PSIDemux &psiDemux() const;
 
 signals:
     void tsPacketReady(const QSharedPointer<ConversionNode<Packet>> &packetNode);
@@ -0,0 +1,445 @@
+#include "tsstreamgenerator.h"
+
+#include "tspacketv2.h"
+#include "tscrc32.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace TS {
+
+namespace impl {
+
+class StreamGeneratorImpl {
+    struct ElementaryStream {
+        quint16  pid;
+        quint8   streamId;
+        bool     isVideo;
+        qint64   bitrate;
+        double   payloadBytesSent = 0;
+        qint64   nextFrameNanosecs = 0;
+        quint8   nextCC = 0;
+    };
+
+    const StreamGenerator::Config  _config;
+    PacketV2Generator  _tsGenerator;
+    ElementaryStream   _video, _audio;
+    quint8   _patCC = 0, _pmtCC = 0;
+    qint64   _packetCount = 0;
+    qint64   _nextPSINanosecs = 0;
+    bool     _pmtPending = false;
+    qint64   _nextPCRNanosecs = 0;
+    qint64   _nextRandomAccessNanosecs = 0;
+    qint64   _nextDiscontinuityNanosecs = 0;
+    bool     _discontinuityPending = false;
+    qint64   _clockOffsetNanosecs = 0;
+    bool     _corruptCCPending = false;
+    quint64  _rngState;
+    friend StreamGenerator;
+
+public:
+    explicit StreamGeneratorImpl(const StreamGenerator::Config &config);
+
+    qint64 packetNanosecs(qint64 packetIndex) const;
+
+    void buildPSIPacket(PacketV2 *packetPtr, quint16 pid, quint8 *ccPtr, const QByteArray &section);
+    QByteArray patSection() const;
+    QByteArray pmtSection() const;
+    void buildElementaryPacket(PacketV2 *packetPtr, ElementaryStream *streamPtr,
+                               qint64 nowNanosecs, bool withPCR, bool withPayload);
+    QByteArray pesHeader(const ElementaryStream &stream, qint64 nowNanosecs, bool randomAccess) const;
+    bool isPayloadDue(const ElementaryStream &stream, qint64 nowNanosecs) const;
+    void appendFiller(QByteArray *bytes, int length);
+};
+
+namespace {
+
+// Finishes a PSI section: fills in section_length and appends CRC_32.
+// (The section must have been built with a zero section_length.)
+QByteArray finishSection(QByteArray section)
+{
+    const int sectionLength = section.length() - 3 + 4;
+    section[1] = static_cast<char>(section.at(1) | ((sectionLength >> 8) & 0x0f));
+    section[2] = static_cast<char>(sectionLength & 0xff);
+
+    const quint32 crc = crc32Mpeg2(section);
+    section.append(static_cast<char>(crc >> 24));
+    section.append(static_cast<char>(crc >> 16));
+    section.append(static_cast<char>(crc >>  8));
+    section.append(static_cast<char>(crc));
+    return section;
+}
+
+}  // namespace
+
+StreamGeneratorImpl::StreamGeneratorImpl(const StreamGenerator::Config &config) :
+    _config(config),
+    _video { config.videoPID, 0xe0, true,  config.videoBitrate },
+    _audio { config.audioPID, 0xc0, false, config.audioBitrate },
+    _rngState(config.seed ? config.seed : 1)
+{
+    _tsGenerator.setPrefixLength(config.packetSize == 192 ? 4 : 0);
+    _nextDiscontinuityNanosecs = config.discontinuityIntervalNanosecs;
+}
+
+qint64 StreamGeneratorImpl::packetNanosecs(qint64 packetIndex) const
+{
+    return static_cast<qint64>(static_cast<double>(packetIndex) *
+        PacketV2::sizeBasic * 8 * 1000000000 / _config.bitrate);
+}
+
+void StreamGeneratorImpl::buildPSIPacket(PacketV2 *packetPtr, quint16 pid, quint8 *ccPtr, const QByteArray &section)
+{
+    PacketV2 &packet(*packetPtr);
+    packet.pid.value = pid;
+    packet.payloadUnitStartIndicator.value = true;
+    packet.adaptationFieldControl.value = PacketV2::AdaptationFieldControlType::PayloadOnly;
+    packet.continuityCounter.value = *ccPtr;
+    *ccPtr = (*ccPtr + 1) & 0x0f;
+
+    // pointer_field, section, then stuffing.
+    packet.payloadDataBytes.reserve(PacketV2::sizeBasic - 4);
+    packet.payloadDataBytes.append('\x00');
+    packet.payloadDataBytes.append(section);
+    packet.payloadDataBytes.append(QByteArray(PacketV2::sizeBasic - 4 - packet.payloadDataBytes.length(), '\xff'));
+}
+
+QByteArray StreamGeneratorImpl::patSection() const
+{
+    QByteArray section(12, 0x00);
+    BitStream bitSink(section);
+    bitSink
+        << uimsbf< 8, quint8 > { 0x00 }  // table_id: program_association_section
+        << bslbf1 { true }  // section_syntax_indicator
+        << bslbf1 { false }
+        << bslbf < 2, quint8 > { 0x3 }  // reserved
+        << uimsbf<12, quint16> { 0 }  // section_length (see finishSection())
+        << uimsbf<16, quint16> { _config.transportStreamId }
+        << bslbf < 2, quint8 > { 0x3 }  // reserved
+        << uimsbf< 5, quint8 > { 0 }  // version_number
+        << bslbf1 { true }  // current_next_indicator
+        << uimsbf< 8, quint8 > { 0 }  // section_number
+        << uimsbf< 8, quint8 > { 0 }  // last_section_number
+        << uimsbf<16, quint16> { _config.programNumber }
+        << bslbf < 3, quint8 > { 0x7 }  // reserved
+        << uimsbf<13, quint16> { _config.pmtPID };
+    return finishSection(bitSink.bytes());
+}
+
+QByteArray StreamGeneratorImpl::pmtSection() const
+{
+    QByteArray section(22, 0x00);
+    BitStream bitSink(section);
+    bitSink
+        << uimsbf< 8, quint8 > { 0x02 }  // table_id: TS_program_map_section
+        << bslbf1 { true }  // section_syntax_indicator
+        << bslbf1 { false }
+        << bslbf < 2, quint8 > { 0x3 }  // reserved
+        << uimsbf<12, quint16> { 0 }  // section_length (see finishSection())
+        << uimsbf<16, quint16> { _config.programNumber }
+        << bslbf < 2, quint8 > { 0x3 }  // reserved
+        << uimsbf< 5, quint8 > { 0 }  // version_number
+        << bslbf1 { true }  // current_next_indicator
+        << uimsbf< 8, quint8 > { 0 }  // section_number
+        << uimsbf< 8, quint8 > { 0 }  // last_section_number
+        << bslbf < 3, quint8 > { 0x7 }  // reserved
+        << uimsbf<13, quint16> { _config.videoPID }  // PCR_PID
+        << bslbf < 4, quint8 > { 0xf }  // reserved
+        << uimsbf<12, quint16> { 0 }  // program_info_length
+        // Video: H.264
+        << uimsbf< 8, quint8 > { 0x1b }  // stream_type
+        << bslbf < 3, quint8 > { 0x7 }  // reserved
+        << uimsbf<13, quint16> { _config.videoPID }
+        << bslbf < 4, quint8 > { 0xf }  // reserved
+        << uimsbf<12, quint16> { 0 }  // ES_info_length
+        // Audio: AAC (ADTS)
+        << uimsbf< 8, quint8 > { 0x0f }  // stream_type
+        << bslbf < 3, quint8 > { 0x7 }  // reserved
+        << uimsbf<13, quint16> { _config.audioPID }
+        << bslbf < 4, quint8 > { 0xf }  // reserved
+        << uimsbf<12, quint16> { 0 };  // ES_info_length
+    return finishSection(bitSink.bytes());
+}
+
+bool StreamGeneratorImpl::isPayloadDue(const ElementaryStream &stream, qint64 nowNanosecs) const
+{
+    return stream.bitrate > 0 &&
+        stream.payloadBytesSent * 8 <= static_cast<double>(stream.bitrate) * nowNanosecs / 1000000000;
+}
+
+QByteArray StreamGeneratorImpl::pesHeader(const ElementaryStream &stream, qint64 nowNanosecs, bool randomAccess) const
+{
+    // Presentation time a bit after the PCR, in 90 kHz units.
+    const quint64 pts = static_cast<quint64>((nowNanosecs + _clockOffsetNanosecs + 100000000) / 100000 * 9)
+        & ((quint64(1) << 33) - 1);
+
+    QByteArray header(14, 0x00);
+    BitStream bitSink(header);
+    bitSink
+        << uimsbf<24, quint32> { 0x000001 }  // packet_start_code_prefix
+        << uimsbf< 8, quint8 > { stream.streamId }
+        << uimsbf<16, quint16> { 0 }  // PES_packet_length: unbounded
+        << bslbf < 8, quint8 > { 0x80 }  // '10', no scrambling, no flags
+        << bslbf < 8, quint8 > { 0x80 }  // PTS_DTS_flags: PTS only
+        << uimsbf< 8, quint8 > { 5 }  // PES_header_data_length
+        << bslbf < 4, quint8 > { 0x2 }
+        << uimsbf< 3, quint8 > { static_cast<quint8>(pts >> 30) }
+        << bslbf1 { true }  // marker_bit
+        << uimsbf<15, quint16> { static_cast<quint16>((pts >> 15) & 0x7fff) }
+        << bslbf1 { true }  // marker_bit
+        << uimsbf<15, quint16> { static_cast<quint16>(pts & 0x7fff) }
+        << bslbf1 { true };  // marker_bit
+    header = bitSink.bytes();
+
+    if (stream.isVideo) {
+        // Access unit delimiter, then the start of an IDR or non-IDR slice.
+        header.append("\x00\x00\x00\x01\x09\xf0", 6);
+        header.append(randomAccess ? "\x00\x00\x00\x01\x65" : "\x00\x00\x00\x01\x41", 5);
+    }
+    else {
+        // Start of an ADTS header (sync word, MPEG-4, layer 0, no CRC).
+        header.append("\xff\xf1", 2);
+    }
+    return header;
+}
+
+void StreamGeneratorImpl::appendFiller(QByteArray *bytes, int length)
+{
+    // xorshift64; forced odd bytes can't form start code prefixes.
+    for (int i = 0; i < length; i++) {
+        _rngState ^= _rngState << 13;
+        _rngState ^= _rngState >> 7;
+        _rngState ^= _rngState << 17;
+        bytes->append(static_cast<char>(_rngState | 0x01));
+    }
+}
+
+void StreamGeneratorImpl::buildElementaryPacket(PacketV2 *packetPtr, ElementaryStream *streamPtr,
+                                                qint64 nowNanosecs, bool withPCR, bool withPayload)
+{
+    PacketV2 &packet(*packetPtr);
+    ElementaryStream &stream(*streamPtr);
+    PacketV2::AdaptationField &af(packet.adaptationField);
+    packet.pid.value = stream.pid;
+
+    QByteArray payloadStart;
+    bool randomAccess = false;
+    if (withPayload && nowNanosecs >= stream.nextFrameNanosecs) {
+        packet.payloadUnitStartIndicator.value = true;
+        if (stream.isVideo && nowNanosecs >= _nextRandomAccessNanosecs) {
+            randomAccess = true;
+            while (_nextRandomAccessNanosecs <= nowNanosecs)
+                _nextRandomAccessNanosecs += _config.randomAccessIntervalNanosecs;
+        }
+        payloadStart = pesHeader(stream, nowNanosecs, randomAccess);
+        while (stream.nextFrameNanosecs <= nowNanosecs)
+            stream.nextFrameNanosecs += _config.frameIntervalNanosecs;
+    }
+
+    const bool discontinuity = withPCR && _discontinuityPending;
+    const bool hasAF = withPCR || randomAccess || !withPayload;
+    int afBytes = 0;  // (Including the length byte.)
+    if (hasAF) {
+        af.pcrFlag.value = withPCR;
+        af.randomAccessIndicator.value = randomAccess;
+        af.discontinuityIndicator.value = discontinuity;
+        int afLen = 1 + (withPCR ? 6 : 0);
+        if (!withPayload)
+            afLen = PacketV2::sizeBasic - 4 - 1;
+        af.stuffingBytes = QByteArray(afLen - 1 - (withPCR ? 6 : 0), '\xff');
+        af.adaptationFieldLength.value = static_cast<quint8>(afLen);
+        afBytes = 1 + afLen;
+
+        if (withPCR) {
+            const quint64 pcr = static_cast<quint64>(nowNanosecs + _clockOffsetNanosecs) * 27 / 1000;
+            af.programClockReference.pcrBase.value = (pcr / ProgramClockReference::pcrBaseFactor) & ((quint64(1) << 33) - 1);
+            af.programClockReference.pcrExtension.value = static_cast<quint16>(pcr % ProgramClockReference::pcrBaseFactor);
+        }
+    }
+
+    if (discontinuity)
+        _discontinuityPending = false;
+
+    if (withPayload) {
+        packet.adaptationFieldControl.value = hasAF ?
+            PacketV2::AdaptationFieldControlType::AdaptationFieldThenPayload :
+            PacketV2::AdaptationFieldControlType::PayloadOnly;
+
+        if (_corruptCCPending) {
+            stream.nextCC = (stream.nextCC + 1) & 0x0f;
+            _corruptCCPending = false;
+        }
+        packet.continuityCounter.value = stream.nextCC;
+        stream.nextCC = (stream.nextCC + 1) & 0x0f;
+
+        const int payloadLength = PacketV2::sizeBasic - 4 - afBytes;
+        packet.payloadDataBytes = payloadStart.left(payloadLength);
+        packet.payloadDataBytes.reserve(payloadLength);
+        appendFiller(&packet.payloadDataBytes, payloadLength - packet.payloadDataBytes.length());
+        stream.payloadBytesSent += payloadLength;
+    }
+    else {
+        packet.adaptationFieldControl.value = PacketV2::AdaptationFieldControlType::AdaptationFieldOnly;
+        // (The counter doesn't advance on packets without payload.)
+        packet.continuityCounter.value = (stream.nextCC - 1) & 0x0f;
+    }
+}
+
+}  // namespace TS::impl
+
+
+StreamGenerator::StreamGenerator() :
+    StreamGenerator(Config())
+{
+
+}
+
+StreamGenerator::StreamGenerator(const Config &config)
+{
+    if (!(config.bitrate >= 10000))
+        throw std::invalid_argument("TS stream generator ctor: Bitrate must be at least 10000, but got " +
+                                    std::to_string(config.bitrate));
+    if (!(config.videoBitrate >= 0 && config.audioBitrate >= 0))
+        throw std::invalid_argument("TS stream generator ctor: Elementary stream bitrates must not be negative");
+    // Leave room for PSI, PCRs and packet headers.
+    if (!(config.videoBitrate + config.audioBitrate <= config.bitrate / 100 * 90))
+        throw std::invalid_argument("TS stream generator ctor: Elementary stream bitrates must add up "
+                                    "to at most 90% of the bitrate, but got " +
+                                    std::to_string(config.videoBitrate + config.audioBitrate) + " of " +
+                                    std::to_string(config.bitrate));
+    if (!(config.packetSize == 188 || config.packetSize == 192 ||
+          config.packetSize == 204 || config.packetSize == 208))
+        throw std::invalid_argument("TS stream generator ctor: Packet size must be 188, 192, 204 or 208, but got " +
+                                    std::to_string(config.packetSize));
+
+    const quint16 pids[] { config.pmtPID, config.videoPID, config.audioPID };
+    for (quint16 pid : pids) {
+        if (!(pid >= 0x0010 && pid < PacketV2::pidNullPacket))
+            throw std::invalid_argument("TS stream generator ctor: PIDs must be in 0x0010 to 0x1ffe, but got " +
+                                        std::to_string(pid));
+    }
+    if (config.pmtPID == config.videoPID || config.pmtPID == config.audioPID || config.videoPID == config.audioPID)
+        throw std::invalid_argument("TS stream generator ctor: PIDs must be distinct");
+
+    if (!(config.psiIntervalNanosecs > 0 && config.pcrIntervalNanosecs > 0 &&
+          config.frameIntervalNanosecs > 0 && config.randomAccessIntervalNanosecs > 0))
+        throw std::invalid_argument("TS stream generator ctor: Intervals must be positive");
+    if (!(config.discontinuityIntervalNanosecs >= 0 && config.corruptInterval >= 0))
+        throw std::invalid_argument("TS stream generator ctor: Discontinuity and corrupt intervals must not be negative");
+
+    _implPtr = std::make_unique<impl::StreamGeneratorImpl>(config);
+}
+
+StreamGenerator::~StreamGenerator()
+{
+
+}
+
+const StreamGenerator::Config &StreamGenerator::config() const
+{
+    return _implPtr->_config;
+}
+
+qint64 StreamGenerator::packetCount() const
+{
+    return _implPtr->_packetCount;
+}
+
+qint64 StreamGenerator::streamNanosecs() const
+{
+    return _implPtr->packetNanosecs(_implPtr->_packetCount);
+}
+
+void StreamGenerator::injectDiscontinuity()
+{
+    _implPtr->_discontinuityPending = true;
+    _implPtr->_clockOffsetNanosecs += _implPtr->_config.discontinuityJumpNanosecs;
+    // Announce it right away.
+    _implPtr->_nextPCRNanosecs = 0;
+}
+
+void StreamGenerator::generatePacket(QByteArray *bytes)
+{
+    if (!bytes)
+        throw std::invalid_argument("TS stream generator: Bytes can't be null");
+
+    impl::StreamGeneratorImpl &d(*_implPtr);
+    const Config &config(d._config);
+    const qint64 now = d.packetNanosecs(d._packetCount);
+    const qint64 packetIndex = d._packetCount++;
+
+    if (config.discontinuityIntervalNanosecs > 0 && now >= d._nextDiscontinuityNanosecs) {
+        injectDiscontinuity();
+        d._nextDiscontinuityNanosecs += config.discontinuityIntervalNanosecs;
+    }
+
+    const bool corrupt = config.corruptInterval > 0 && (packetIndex + 1) % config.corruptInterval == 0;
+    if (corrupt && config.corruptionKind == CorruptionKind::ContinuityCounter)
+        d._corruptCCPending = true;
+
+    // Decide what to send, by priority.
+    PacketV2 packet;
+    if (now >= d._nextPSINanosecs) {
+        d.buildPSIPacket(&packet, 0x0000, &d._patCC, d.patSection());
+        d._pmtPending = true;
+        while (d._nextPSINanosecs <= now)
+            d._nextPSINanosecs += config.psiIntervalNanosecs;
+    }
+    else if (d._pmtPending) {
+        d.buildPSIPacket(&packet, config.pmtPID, &d._pmtCC, d.pmtSection());
+        d._pmtPending = false;
+    }
+    else if (now >= d._nextPCRNanosecs) {
+        d.buildElementaryPacket(&packet, &d._video, now, true, d.isPayloadDue(d._video, now));
+        d._nextPCRNanosecs = now + config.pcrIntervalNanosecs;
+    }
+    else if (d.isPayloadDue(d._video, now)) {
+        d.buildElementaryPacket(&packet, &d._video, now, false, true);
+    }
+    else if (d.isPayloadDue(d._audio, now)) {
+        d.buildElementaryPacket(&packet, &d._audio, now, false, true);
+    }
+    // (Otherwise, leave it a null packet.)
+
+    if (corrupt && config.corruptionKind == CorruptionKind::TransportErrorIndicator)
+        packet.transportErrorIndicator.value = true;
+
+    const int from = bytes->length();
+    QString errMsg;
+    if (!d._tsGenerator.generate(packet, bytes, &errMsg))
+        throw std::runtime_error("TS stream generator: Error converting packet to bytes: " + errMsg.toStdString());
+
+    char *const data = bytes->data() + from;
+    const int prefixLength = d._tsGenerator.prefixLength();
+    if (packet.isNullPacket()) {
+        // (PacketV2Generator leaves all but PID of null packets zero.)
+        data[prefixLength + 3] = '\x10';
+        std::memset(data + prefixLength + 4, 0xff, PacketV2::sizeBasic - 4);
+    }
+    if (prefixLength == 4) {
+        // Time-code prefix: 30 bits arrival time stamp, in 27 MHz units.
+        const quint32 ats = static_cast<quint32>(static_cast<quint64>(now) * 27 / 1000) & 0x3fffffff;
+        data[0] = static_cast<char>(ats >> 24);
+        data[1] = static_cast<char>(ats >> 16);
+        data[2] = static_cast<char>(ats >>  8);
+        data[3] = static_cast<char>(ats);
+    }
+    if (corrupt && config.corruptionKind == CorruptionKind::SyncByte)
+        data[prefixLength] = '\x00';
+
+    const int suffixLength = config.packetSize - prefixLength - PacketV2::sizeBasic;
+    if (suffixLength > 0)
+        bytes->append(QByteArray(suffixLength, 0x00));
+}
+
+QByteArray StreamGenerator::generatePackets(int count)
+{
+    QByteArray bytes;
+    bytes.reserve(count * _implPtr->_config.packetSize);
+    for (int i = 0; i < count; i++)
+        generatePacket(&bytes);
+    return bytes;
+}
+
+}  // namespace TS
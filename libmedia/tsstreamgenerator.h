@@ -0,0 +1,96 @@
+#ifndef TSSTREAMGENERATOR_H
+#define TSSTREAMGENERATOR_H
+
+#include "libmedia_global.h"
+
+#include <QObject>
+
+#include <memory>
+#include <QByteArray>
+
+namespace TS {
+
+namespace impl {
+class StreamGeneratorImpl;
+}
+
+// Generates a synthetic, reproducible MPEG-TS stream of a single program
+// at a given bitrate, for benchmarks and tests without media files:
+//
+// PAT and PMT are repeated at psiIntervalNanosecs; a video and an audio
+// elementary stream carry PES packets with pseudo-random payload at their
+// configured bitrates, starting a new PES packet every frame; PCRs go
+// out on the video PID every pcrIntervalNanosecs; every
+// randomAccessIntervalNanosecs, a video frame is marked as random access
+// point (and starts with an IDR NAL unit); the rest is null packets.
+//
+// Optionally, PCR discontinuities and corrupt packets get injected.
+//
+// The packets are built as PacketV2 and converted to bytes
+// by PacketV2Generator; stream time advances by one basic (188 bytes)
+// packet's worth of the bitrate per packet, regardless of packetSize.
+class LIBMEDIASHARED_EXPORT StreamGenerator
+{
+    Q_GADGET
+    std::unique_ptr<impl::StreamGeneratorImpl>  _implPtr;
+
+public:
+    enum class CorruptionKind {
+        TransportErrorIndicator,  // Flag set, packet otherwise intact.
+        SyncByte,                 // Wrong sync byte.
+        ContinuityCounter,        // Continuity counter skips one.
+    };
+    Q_ENUM(CorruptionKind)
+
+    struct Config {
+        qint64   bitrate      = 4000000;  // bits per second, of the whole stream
+        qint64   videoBitrate = 3000000;
+        qint64   audioBitrate =  128000;
+        // 188, or 192 (4 bytes time-code prefix), or 204/208 (16/20 bytes dummy suffix).
+        int      packetSize   = 188;
+
+        quint16  transportStreamId = 1;
+        quint16  programNumber     = 1;
+        quint16  pmtPID   = 0x1000;
+        quint16  videoPID = 0x0100;  // (Also carries the PCR.)
+        quint16  audioPID = 0x0101;
+
+        qint64   psiIntervalNanosecs           =  100000000;
+        qint64   pcrIntervalNanosecs           =   40000000;
+        qint64   frameIntervalNanosecs         =   40000000;
+        qint64   randomAccessIntervalNanosecs  = 1000000000;
+        // 0 disables periodic discontinuities.
+        qint64   discontinuityIntervalNanosecs = 0;
+        // How far the PCR jumps forward at a discontinuity.
+        qint64   discontinuityJumpNanosecs     = 10000000000;
+        // Every corruptInterval-th packet gets corrupted; 0 disables it.
+        qint64          corruptInterval = 0;
+        CorruptionKind  corruptionKind  = CorruptionKind::TransportErrorIndicator;
+
+        quint64  seed = 1;
+    };
+
+    explicit StreamGenerator();
+    explicit StreamGenerator(const Config &config);
+    ~StreamGenerator();
+
+    const Config &config() const;
+
+    // Number of packets generated so far.
+    qint64 packetCount() const;
+    // Stream time of the next packet, relative to the first one;
+    // for pacing output at wall-clock rate.
+    qint64 streamNanosecs() const;
+
+    // Appends the next packet (config().packetSize bytes) to bytes.
+    void generatePacket(QByteArray *bytes);
+    QByteArray generatePackets(int count);
+
+    // Have the next PCR jump forward (by discontinuityJumpNanosecs)
+    // and carry the discontinuity indicator.
+    void injectDiscontinuity();
+};
+
+}  // namespace TS
+
+#endif // TSSTREAMGENERATOR_H
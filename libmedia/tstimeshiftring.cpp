@@ -0,0 +1,265 @@
+#include "tstimeshiftring.h"
+
+#include "log.h"
+#include "tspacketview.h"
+
+#include <fcntl.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <QDebug>
+#include <QFile>
+
+namespace TS {
+
+namespace impl {
+class TimeShiftRingImpl {
+public:
+    struct IndexEntry {
+        qint64  seq;
+        qint64  ingestMillisec;
+    };
+
+private:
+    QFile                   _file;
+    uchar                  *_map = nullptr;
+    qint64                  _capacityPackets = 0;
+    qint64                  _nextSeq = 0;
+    qint64                  _lastIngestMillisec = 0;
+    std::deque<IndexEntry>  _timeIndex;
+    std::deque<IndexEntry>  _rapIndex;
+    friend TimeShiftRing;
+
+public:
+    // Index the first packet after at least this much ingest time;
+    // bounds how late seqLimitForTime() may be.
+    static constexpr qint64 timeIndexIntervalMillisec = 100;
+    static constexpr qint64 capacityPacketsMin = 1024;
+
+    qint64 firstSeq() const
+    {
+        return std::max<qint64>(0, _nextSeq - _capacityPackets);
+    }
+
+    void trimIndexes();
+};
+
+void TimeShiftRingImpl::trimIndexes()
+{
+    const qint64 first = firstSeq();
+    while (!_timeIndex.empty() && _timeIndex.front().seq < first)
+        _timeIndex.pop_front();
+    while (!_rapIndex.empty() && _rapIndex.front().seq < first)
+        _rapIndex.pop_front();
+}
+}  // namespace TS::impl
+
+
+TimeShiftRing::TimeShiftRing() :
+    _implPtr(std::make_unique<impl::TimeShiftRingImpl>())
+{
+
+}
+
+TimeShiftRing::~TimeShiftRing()
+{
+    close();
+}
+
+bool TimeShiftRing::open(const QString &fileName, qint64 capacityBytes, QString *errorMessage)
+{
+    if (isOpen()) {
+        if (errorMessage)
+            QDebug(errorMessage).nospace() << "Time-shift ring already open on " << _implPtr->_file.fileName();
+        return false;
+    }
+
+    const qint64 capacityPackets = capacityBytes / PacketView::sizeBasic;
+    if (capacityPackets < impl::TimeShiftRingImpl::capacityPacketsMin) {
+        if (errorMessage)
+            QDebug(errorMessage).nospace() << "Time-shift ring capacity " << capacityBytes << " bytes too small,"
+                << " need at least " << impl::TimeShiftRingImpl::capacityPacketsMin * PacketView::sizeBasic << " bytes";
+        return false;
+    }
+    const qint64 mapSize = capacityPackets * PacketView::sizeBasic;
+
+    QFile &file(_implPtr->_file);
+    file.setFileName(fileName);
+    if (!file.open(QFile::ReadWrite)) {
+        if (errorMessage)
+            QDebug(errorMessage).nospace() << "Can't open time-shift ring file " << fileName << ": " << qPrintable(file.errorString());
+        return false;
+    }
+
+    if (!file.resize(mapSize)) {
+        if (errorMessage)
+            QDebug(errorMessage).nospace() << "Can't resize time-shift ring file " << fileName << ": " << qPrintable(file.errorString());
+        file.close();
+        return false;
+    }
+
+    // Reserve the disk space up-front, so we won't run into ENOSPC
+    // (as SIGBUS on the mapping!) while streaming.
+    const int fallocateErr = posix_fallocate(file.handle(), 0, mapSize);
+    if (fallocateErr != 0) {
+        if (errorMessage)
+            QDebug(errorMessage).nospace() << "Can't preallocate time-shift ring file " << fileName << ": " << strerror(fallocateErr);
+        file.close();
+        return false;
+    }
+
+    uchar *map = file.map(0, mapSize);
+    if (!map) {
+        if (errorMessage)
+            QDebug(errorMessage).nospace() << "Can't memory-map time-shift ring file " << fileName << ": " << qPrintable(file.errorString());
+        file.close();
+        return false;
+    }
+
+    _implPtr->_map = map;
+    _implPtr->_capacityPackets = capacityPackets;
+    _implPtr->_nextSeq = 0;
+    _implPtr->_lastIngestMillisec = 0;
+    _implPtr->_timeIndex.clear();
+    _implPtr->_rapIndex.clear();
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Time-shift ring: Opened" << fileName
+                << "with capacity for" << capacityPackets << "packets";
+
+    return true;
+}
+
+void TimeShiftRing::close()
+{
+    if (!isOpen())
+        return;
+
+    _implPtr->_file.unmap(_implPtr->_map);
+    _implPtr->_map = nullptr;
+    _implPtr->_file.close();
+    _implPtr->_capacityPackets = 0;
+    _implPtr->_timeIndex.clear();
+    _implPtr->_rapIndex.clear();
+}
+
+bool TimeShiftRing::isOpen() const
+{
+    return _implPtr->_map != nullptr;
+}
+
+QString TimeShiftRing::fileName() const
+{
+    return isOpen() ? _implPtr->_file.fileName() : QString();
+}
+
+qint64 TimeShiftRing::capacityPackets() const
+{
+    return _implPtr->_capacityPackets;
+}
+
+qint64 TimeShiftRing::firstSeq() const
+{
+    return _implPtr->firstSeq();
+}
+
+qint64 TimeShiftRing::nextSeq() const
+{
+    return _implPtr->_nextSeq;
+}
+
+void TimeShiftRing::append(const QByteArray &basicBytes, qint64 ingestMillisec, bool isRandomAccess)
+{
+    impl::TimeShiftRingImpl &d(*_implPtr);
+
+    if (!isOpen())
+        throw std::runtime_error("TS time-shift ring: Append: Not open");
+    if (basicBytes.length() != PacketView::sizeBasic)
+        throw std::invalid_argument("TS time-shift ring: Append: Invalid packet length " +
+                                    std::to_string(basicBytes.length()));
+
+    const qint64 seq = d._nextSeq++;
+    const qint64 slot = seq % d._capacityPackets;
+    memcpy(d._map + slot * PacketView::sizeBasic, basicBytes.constData(), PacketView::sizeBasic);
+
+    if (d._timeIndex.empty() ||
+        ingestMillisec - d._timeIndex.back().ingestMillisec >= impl::TimeShiftRingImpl::timeIndexIntervalMillisec)
+    {
+        d._timeIndex.push_back({ seq, ingestMillisec });
+    }
+    d._lastIngestMillisec = ingestMillisec;
+    if (isRandomAccess)
+        d._rapIndex.push_back({ seq, ingestMillisec });
+
+    d.trimIndexes();
+}
+
+qint64 TimeShiftRing::seekRandomAccess(qint64 ingestMillisec) const
+{
+    const auto &index(_implPtr->_rapIndex);
+    auto iter = std::upper_bound(index.cbegin(), index.cend(), ingestMillisec,
+        [](qint64 t, const impl::TimeShiftRingImpl::IndexEntry &entry) {
+            return t < entry.ingestMillisec;
+        });
+    if (iter == index.cbegin())
+        return -1;
+    return (--iter)->seq;
+}
+
+qint64 TimeShiftRing::nextRandomAccess(qint64 seq) const
+{
+    const auto &index(_implPtr->_rapIndex);
+    auto iter = std::lower_bound(index.cbegin(), index.cend(), seq,
+        [](const impl::TimeShiftRingImpl::IndexEntry &entry, qint64 s) {
+            return entry.seq < s;
+        });
+    if (iter == index.cend())
+        return -1;
+    return iter->seq;
+}
+
+qint64 TimeShiftRing::seqLimitForTime(qint64 ingestMillisec) const
+{
+    const impl::TimeShiftRingImpl &d(*_implPtr);
+
+    if (d._nextSeq > 0 && ingestMillisec >= d._lastIngestMillisec)
+        return d._nextSeq;
+
+    // Past the last indexed packet known to be old enough. (Not up to
+    // the next indexed one: What's in between may be too recent.)
+    const auto &index(d._timeIndex);
+    auto iter = std::upper_bound(index.cbegin(), index.cend(), ingestMillisec,
+        [](qint64 t, const impl::TimeShiftRingImpl::IndexEntry &entry) {
+            return t < entry.ingestMillisec;
+        });
+    if (iter == index.cbegin())
+        return d.firstSeq();
+    return (--iter)->seq + 1;
+}
+
+int TimeShiftRing::copyPackets(qint64 seq, int maxCount, QByteArray *out) const
+{
+    const impl::TimeShiftRingImpl &d(*_implPtr);
+
+    if (!out)
+        throw std::invalid_argument("TS time-shift ring: Copy packets: Output buffer must not be null");
+    if (!isOpen() || seq < d.firstSeq())
+        return -1;
+
+    const qint64 count = std::min<qint64>(maxCount, d._nextSeq - seq);
+    qint64 done = 0;
+    while (done < count) {
+        // Copy contiguous runs, splitting only at the ring's wrap-around.
+        const qint64 slot = (seq + done) % d._capacityPackets;
+        const qint64 run = std::min(count - done, d._capacityPackets - slot);
+        out->append(reinterpret_cast<const char *>(d._map + slot * PacketView::sizeBasic),
+                    static_cast<int>(run * PacketView::sizeBasic));
+        done += run;
+    }
+
+    return static_cast<int>(count);
+}
+
+}  // namespace TS
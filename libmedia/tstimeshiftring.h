@@ -0,0 +1,67 @@
+#ifndef TSTIMESHIFTRING_H
+#define TSTIMESHIFTRING_H
+
+#include "libmedia_global.h"
+
+#include <memory>
+#include <QByteArray>
+#include <QString>
+
+namespace TS {
+
+namespace impl {
+class TimeShiftRingImpl;
+}
+
+// A preallocated, memory-mapped on-disk ring of the most recent
+// basic (188 bytes) TS packets, for time-shifted (DVR-like) playback.
+//
+// Packets are addressed by an ever-increasing sequence number;
+// only the last capacityPackets() of them are retained.
+// An in-memory index of ingest times (one packet per 100 ms)
+// and of random access points (RAPs) allows O(log n) lookup
+// of a starting point for a given delay.
+class LIBMEDIASHARED_EXPORT TimeShiftRing
+{
+    std::unique_ptr<impl::TimeShiftRingImpl>  _implPtr;
+
+public:
+    explicit TimeShiftRing();
+    ~TimeShiftRing();
+
+    bool open(const QString &fileName, qint64 capacityBytes, QString *errorMessage = nullptr);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+
+    qint64 capacityPackets() const;
+    // Oldest packet still available.
+    qint64 firstSeq() const;
+    // Sequence number that the next appended packet will get.
+    qint64 nextSeq() const;
+
+    // Stores a basic packet. The ingest time should come from
+    // a monotonic clock (see SSCvn::clock::monotonicMillisecs()).
+    void append(const QByteArray &basicBytes, qint64 ingestMillisec, bool isRandomAccess);
+
+    // Sequence number of the last RAP ingested at or before the given time,
+    // or -1 if there is none retained.
+    qint64 seekRandomAccess(qint64 ingestMillisec) const;
+    // Sequence number of the first retained RAP at or after the given sequence number,
+    // or -1 if there is none.
+    qint64 nextRandomAccess(qint64 seq) const;
+    // Limit of the packets ingested at or before the given time, which
+    // are safe to play out for a delayed client. At index granularity,
+    // so up to 100 ms of such packets may be held back, but a packet
+    // ingested later is never let through.
+    qint64 seqLimitForTime(qint64 ingestMillisec) const;
+
+    // Appends up to maxCount packets starting at seq to out.
+    // Returns the number of packets appended, or -1 if seq
+    // has already been overwritten.
+    int copyPackets(qint64 seq, int maxCount, QByteArray *out) const;
+};
+
+}  // namespace TS
+
+#endif // TSTIMESHIFTRING_H
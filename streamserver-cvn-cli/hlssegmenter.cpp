@@ -0,0 +1,341 @@
+#include "hlssegmenter.h"
+
+#include "log.h"
+#include "tspacketview.h"
+#include "tspsi.h"
+#include "http/httprequest_netside.h"
+#include "http/httpresponse.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <QDebug>
+
+namespace SSCvn {
+
+
+/*
+ * HLSSegmenter
+ */
+
+HLSSegmenter::HLSSegmenter()
+{
+    renderPlaylist();
+}
+
+double HLSSegmenter::targetDurationSecs() const
+{
+    return _targetDurationSecs;
+}
+
+void HLSSegmenter::setTargetDurationSecs(double secs)
+{
+    if (!(secs >= 1))
+        throw std::invalid_argument("HLS segmenter: Target duration must be at least 1 second, got " +
+                                    std::to_string(secs));
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing HLS target duration from" << _targetDurationSecs << "to" << secs;
+    _targetDurationSecs = secs;
+}
+
+int HLSSegmenter::segmentCountMax() const
+{
+    return _segmentCountMax;
+}
+
+void HLSSegmenter::setSegmentCountMax(int count)
+{
+    if (!(count >= 3))
+        throw std::invalid_argument("HLS segmenter: Segment count must be at least 3, got " +
+                                    std::to_string(count));
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing HLS segment count from" << _segmentCountMax << "to" << count;
+    _segmentCountMax = count;
+}
+
+int HLSSegmenter::segmentBytesMax() const
+{
+    return _segmentBytesMax;
+}
+
+void HLSSegmenter::setSegmentBytesMax(int bytes)
+{
+    if (!(bytes >= 1024 * 1024))
+        throw std::invalid_argument("HLS segmenter: Segment size must be at least 1 MiB, got " +
+                                    std::to_string(bytes));
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing HLS segment size maximum from" << _segmentBytesMax << "to" << bytes;
+    _segmentBytesMax = bytes;
+}
+
+void HLSSegmenter::update(const TS::PSIDemux &psi)
+{
+    // Keep the PMT packets already seen for programs still in the PAT.
+    QMap<quint16, QByteArray> pmtPackets;
+    quint16 pcrPID = TS::PacketView::pidNullPacket;
+    for (const TS::ProgramInfo &program : psi.programs()) {
+        pmtPackets.insert(program.pmtPID, _pmtPackets.value(program.pmtPID));
+        if (program.hasPMT() && pcrPID == TS::PacketView::pidNullPacket)
+            pcrPID = program.pcrPID;
+    }
+    _pmtPackets = pmtPackets;
+    if (pcrPID == _pcrPID)
+        return;
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "HLS segmenter: Changing PCR PID from" << _pcrPID << "to" << pcrPID;
+    _pcrPID = pcrPID;
+    // (A different clock; its first PCR is no discontinuity.)
+    _lastPCRValid = false;
+}
+
+quint16 HLSSegmenter::pcrPID() const
+{
+    return _pcrPID;
+}
+
+void HLSSegmenter::addPacket(const QByteArray &basicBytes, bool isRandomAccess)
+{
+    const TS::PacketView view(basicBytes);
+    if (view.isNull())
+        return;
+
+    updatePSI(view, basicBytes);
+
+    double elapsedSecs = 0;
+    if (updateClock(view, &elapsedSecs)) {
+        // Start a new segment right at the discontinuity,
+        // and mark it as such in the playlist.
+        if (!_current.data.isEmpty())
+            finishSegment();
+        _nextDiscontinuity = true;
+    }
+
+    if (!_started) {
+        // Segments should start with a random access point; but don't wait forever.
+        _waitedSecs += elapsedSecs;
+        _waitedBytes += basicBytes.length();
+        if (!isRandomAccess && _waitedSecs < 2 * _targetDurationSecs && _waitedBytes < _segmentBytesMax)
+            return;
+        if (SSCVN_VERBOSE(0))
+            qInfo() << "HLS segmenter: Starting first segment"
+                    << (isRandomAccess ? "at random access point" : "without random access point");
+        _started = true;
+        elapsedSecs = 0;
+    }
+
+    _current.durationSecs += elapsedSecs;
+    // (By size as well, as the duration stays 0 without a clock.)
+    const int currentBytes = _current.data.length();
+    if (currentBytes > 0 &&
+        ((isRandomAccess && _current.durationSecs >= _targetDurationSecs) ||
+         _current.durationSecs >= 2 * _targetDurationSecs ||
+         (isRandomAccess && currentBytes >= _segmentBytesMax / 2) ||
+         currentBytes + basicBytes.length() > _segmentBytesMax))
+    {
+        finishSegment();
+    }
+
+    if (_current.data.isEmpty()) {
+        if (view.pid() != 0 && !_patPacket.isEmpty()) {
+            _current.data.append(_patPacket);
+            for (const QByteArray &pmtPacket : _pmtPackets)
+                _current.data.append(pmtPacket);
+        }
+    }
+
+    _current.data.append(basicBytes);
+}
+
+QSharedPointer<const HLSSegmenter::Segment> HLSSegmenter::segment(quint64 sequence) const
+{
+    return _segments.value(sequence);
+}
+
+const QByteArray &HLSSegmenter::playlist() const
+{
+    return _playlist;
+}
+
+void HLSSegmenter::updatePSI(const TS::PacketView &view, const QByteArray &basicBytes)
+{
+    // (Which PIDs carry PMTs is up to update(), from the PSI demux.)
+    if (!view.payloadUnitStartIndicator())
+        return;
+    const quint16 pid = view.pid();
+    if (pid == 0)
+        _patPacket = basicBytes;
+    else if (_pmtPackets.contains(pid))
+        _pmtPackets[pid] = basicBytes;
+}
+
+bool HLSSegmenter::updateClock(const TS::PacketView &view, double *elapsedSecs)
+{
+    *elapsedSecs = 0;
+    if (view.pid() != _pcrPID || !view.hasPCR())
+        return false;
+
+    const double pcrSecs = view.pcrSecs();
+    if (!_lastPCRValid) {
+        _lastPCRValid = true;
+        _lastPCRSecs = pcrSecs;
+        return false;
+    }
+
+    const double delta = pcrSecs - _lastPCRSecs;
+    _lastPCRSecs = pcrSecs;
+    if (delta < 0 || delta > 1 || view.discontinuityIndicator())
+        return true;
+
+    *elapsedSecs = delta;
+    return false;
+}
+
+void HLSSegmenter::finishSegment()
+{
+    auto segment = QSharedPointer<Segment>::create();
+    segment->sequence = _nextSequence++;
+    segment->durationSecs = _current.durationSecs;
+    segment->discontinuity = _nextDiscontinuity;
+    segment->data = std::move(_current.data);
+    _nextDiscontinuity = false;
+    _current = Segment();
+
+    _segments.insert(segment->sequence, segment);
+    while (_segments.size() > _segmentCountMax)
+        _segments.remove(_firstSequence++);
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "HLS segmenter: Finished segment" << segment->sequence
+                << "of" << segment->durationSecs << "s"
+                << "and" << segment->data.length() << "bytes";
+
+    renderPlaylist();
+}
+
+void HLSSegmenter::renderPlaylist()
+{
+    int targetDuration = static_cast<int>(std::ceil(_targetDurationSecs));
+    for (const auto &segment : _segments)
+        targetDuration = std::max(targetDuration, static_cast<int>(std::ceil(segment->durationSecs)));
+
+    QByteArray playlist;
+    playlist.append("#EXTM3U\n"
+                    "#EXT-X-VERSION:3\n");
+    playlist.append("#EXT-X-TARGETDURATION:" + QByteArray::number(targetDuration) + "\n");
+    playlist.append("#EXT-X-MEDIA-SEQUENCE:" + QByteArray::number(_firstSequence) + "\n");
+    for (quint64 sequence = _firstSequence; sequence < _nextSequence; sequence++) {
+        const auto segment = _segments.value(sequence);
+        if (!segment)
+            continue;
+        if (segment->discontinuity)
+            playlist.append("#EXT-X-DISCONTINUITY\n");
+        playlist.append("#EXTINF:" + QByteArray::number(segment->durationSecs, 'f', 3) + ",\n");
+        playlist.append("segment" + QByteArray::number(sequence) + ".ts\n");
+    }
+
+    _playlist = playlist;
+}
+
+
+/*
+ * HLSHandler
+ */
+
+const QByteArray HLSHandler::pathPrefix = "/hls/";
+
+class HLSHandlerPrivate {
+    HLSHandler *q_ptr;
+    Q_DECLARE_PUBLIC(HLSHandler)
+
+    const HLSSegmenter *_segmenter;
+
+    explicit HLSHandlerPrivate(const HLSSegmenter *segmenter, HLSHandler *q);
+};
+
+HLSHandlerPrivate::HLSHandlerPrivate(const HLSSegmenter *segmenter, HLSHandler *q) : q_ptr(q),
+    _segmenter(segmenter)
+{
+    const std::string prefix = "HLSHandler hidden implementation ctor: ";
+
+    if (!q_ptr)
+        throw std::invalid_argument(prefix + "Back-pointer must not be null");
+    if (!_segmenter)
+        throw std::invalid_argument(prefix + "Segmenter must not be null");
+}
+
+
+HLSHandler::HLSHandler(const HLSSegmenter *segmenter) :
+    d_ptr(new HLSHandlerPrivate(segmenter, this))
+{
+
+}
+
+HLSHandler::~HLSHandler()
+{
+
+}
+
+QString HLSHandler::name() const
+{
+    return "HLS playlist & segments";
+}
+
+void HLSHandler::handleRequest(HTTP::ServerContext *ctx)
+{
+    Q_D(HLSHandler);
+
+    const QByteArray &path(ctx->request().urlPath());
+    if (!path.startsWith(pathPrefix)) {
+        ctx->setResponseError(HTTP::SC_404_NotFound, "Path not found.\n");
+        return;
+    }
+    const QByteArray name = path.mid(pathPrefix.length());
+
+    QByteArray body;
+    QString contentType;
+    QString cacheControl;
+    if (name == "index.m3u8") {
+        body = d->_segmenter->playlist();
+        contentType = "application/vnd.apple.mpegurl";
+        cacheControl = "max-age=1";
+    }
+    else if (name.startsWith("segment") && name.endsWith(".ts")) {
+        bool ok = false;
+        const quint64 sequence = name.mid(7, name.length() - 7 - 3).toULongLong(&ok);
+        const auto segment = ok ? d->_segmenter->segment(sequence) : QSharedPointer<const HLSSegmenter::Segment>();
+        if (!segment) {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(ctx->logPrefix()) << "HLS segment not available:" << name;
+            ctx->setResponseError(HTTP::SC_404_NotFound, "Segment not available.\n");
+            return;
+        }
+        body = segment->data;
+        contentType = "video/mp2t";
+        // (Segments never change, so they can be cached for as long as they're listed.)
+        cacheControl = "max-age=" + QString::number(static_cast<int>(
+            std::ceil(d->_segmenter->segmentCountMax() * d->_segmenter->targetDurationSecs())));
+    }
+    else {
+        if (SSCVN_VERBOSE(0))
+            qInfo() << qPrintable(ctx->logPrefix()) << "HLS path not found:" << path;
+        ctx->setResponseError(HTTP::SC_404_NotFound, "Path not found.\n");
+        return;
+    }
+
+    QScopedPointer<HTTP::Response> response_ptr(new HTTP::Response(HTTP::SC_200_OK, "OK"));
+    response_ptr->setHeader("Content-Type", contentType);
+    response_ptr->setHeader("Cache-Control", cacheControl);
+    if (ctx->request().method() == "HEAD")
+        response_ptr->setHeader("Content-Length", QString::number(body.length()));
+    else
+        response_ptr->setBody(body);
+    ctx->setResponse(response_ptr.take());
+}
+
+
+}  // namespace SSCvn
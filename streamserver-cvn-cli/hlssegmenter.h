@@ -0,0 +1,109 @@
+#ifndef HLSSEGMENTER_H
+#define HLSSEGMENTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QScopedPointer>
+#include <QSharedPointer>
+
+#include "http/httpserver.h"
+
+namespace TS {
+class PacketView;
+class PSIDemux;
+}
+
+namespace SSCvn {
+
+
+// Cuts the ingested TS into HLS media segments at random access points,
+// once a segment has reached the target duration, and keeps the most
+// recent ones in memory together with a pre-rendered playlist.
+class HLSSegmenter
+{
+public:
+    struct Segment {
+        quint64     sequence = 0;
+        double      durationSecs = 0;
+        bool        discontinuity = false;
+        QByteArray  data;
+    };
+
+private:
+    double      _targetDurationSecs = 6;
+    int         _segmentCountMax = 6;
+    // Cuts segments by size, too, so they stay bounded where there is
+    // no clock to go by (no PMT, no PCR PID, or no PCRs on it).
+    int         _segmentBytesMax = 64 * 1024 * 1024;
+
+    // The segment clock only follows the program's PCR PID, as signalled
+    // in the PMT; 0x1fff while unknown. (Other PIDs may carry PCRs of
+    // other programs, or stray ones.)
+    quint16     _pcrPID = 0x1fff;
+    bool        _started = false;
+    double      _waitedSecs = 0;
+    qint64      _waitedBytes = 0;
+    bool        _lastPCRValid = false;
+    double      _lastPCRSecs = 0;
+    bool        _nextDiscontinuity = false;
+    Segment     _current;
+    quint64     _nextSequence = 0;
+    QHash<quint64, QSharedPointer<const Segment>>  _segments;
+    quint64     _firstSequence = 0;
+    QByteArray  _playlist;
+
+    // Latest PSI, to prefix every segment with, so each one can be
+    // decoded on its own.
+    QByteArray  _patPacket;
+    QMap<quint16, QByteArray>  _pmtPackets;
+
+public:
+    explicit HLSSegmenter();
+
+    double targetDurationSecs() const;
+    void   setTargetDurationSecs(double secs);
+    int    segmentCountMax() const;
+    void   setSegmentCountMax(int count);
+    int    segmentBytesMax() const;
+    void   setSegmentBytesMax(int bytes);
+
+    // Takes the PMT PIDs to keep packets of from the PAT, and the PCR PID
+    // from the first program that has a PMT. Call whenever the PSI changed.
+    void update(const TS::PSIDemux &psi);
+    quint16 pcrPID() const;
+
+    void addPacket(const QByteArray &basicBytes, bool isRandomAccess);
+
+    // Returns null if the segment is not (or no longer) available.
+    QSharedPointer<const Segment> segment(quint64 sequence) const;
+    const QByteArray &playlist() const;
+
+private:
+    void updatePSI(const TS::PacketView &view, const QByteArray &basicBytes);
+    bool updateClock(const TS::PacketView &view, double *elapsedSecs);
+    void finishSegment();
+    void renderPlaylist();
+};
+
+
+class HLSHandlerPrivate;
+
+class HLSHandler : public HTTP::ServerHandler {
+    QScopedPointer<HLSHandlerPrivate>  d_ptr;
+    Q_DECLARE_PRIVATE(HLSHandler)
+
+public:
+    explicit HLSHandler(const HLSSegmenter *segmenter);
+    ~HLSHandler();
+
+    static const QByteArray pathPrefix;
+
+    QString name() const override;
+    void handleRequest(HTTP::ServerContext *ctx) override;
+};
+
+
+}  // namespace SSCvn
+
+#endif // HLSSEGMENTER_H
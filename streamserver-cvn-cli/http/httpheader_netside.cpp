@@ -4,41 +4,169 @@
 #include "httputil.h"
 #include "humanreadable.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <QDebug>
-#include <QMultiMap>
+#include <QHash>
 
 namespace SSCvn {
 namespace HTTP {  // namespace SSCvn::HTTP
 
 namespace impl {  // namespace SSCvn::HTTP::impl
 
+namespace {
+
+inline char toLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+inline bool isSpaceOrTab(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// A field name, pointing into the header buffer or to the lookup
+// argument, compared and hashed without regard to (ASCII) case.
+struct FieldNameKey {
+    const char  *data;
+    int          length;
+};
+
+bool operator==(const FieldNameKey &a, const FieldNameKey &b)
+{
+    if (a.length != b.length)
+        return false;
+    for (int i = 0; i < a.length; i++) {
+        if (toLowerAscii(a.data[i]) != toLowerAscii(b.data[i]))
+            return false;
+    }
+    return true;
+}
+
+uint qHash(const FieldNameKey &key, uint seed)
+{
+    uint h = seed;
+    for (int i = 0; i < key.length; i++)
+        h = 31 * h + static_cast<uchar>(toLowerAscii(key.data[i]));
+    return h;
+}
+
+}  // namespace
+
 class HeaderNetsideImpl {
-    QList<HeaderNetside::Field>  _fields;
-    QMultiMap<QByteArray, int>  _fieldNameIndices;
+    // Indices into _fields of all fields sharing a name.
+    struct NameIndices {
+        int  first = -1;
+        int  last = -1;
+        int  count = 0;
+    };
+
+    QByteArray                         _buf;
+    QVector<HeaderNetside::Field>      _fields;
+    QVector<int>                       _nextSameName;
+    QHash<FieldNameKey, NameIndices>   _nameIndices;
     friend HeaderNetside;
 
 public:
-    void append(const HeaderNetside::Field &theField)
+    void clear()
     {
-        _fields.append(theField);
-        _fieldNameIndices.insert(
-            theField.fieldName.toLower(),
-            _fields.length() - 1);
+        _fields.clear();
+        _nextSameName.clear();
+        _nameIndices.clear();
+        _buf.clear();
     }
 
-    void regenerateIndices()
+    NameIndices nameIndices(const QByteArray &fieldName) const
     {
-        _fieldNameIndices.clear();
-        for (int i = 0; i < _fields.length(); i++) {
-            const HeaderNetside::Field &theField(_fields.at(i));
-            _fieldNameIndices.insert(theField.fieldName.toLower(), i);
+        return _nameIndices.value(FieldNameKey { fieldName.constData(), fieldName.length() });
+    }
+
+    void appendField(const char *data, int length)
+    {
+        const void *colon = std::memchr(data, fieldSepHeaderParse.at(0), static_cast<size_t>(length));
+        if (!colon) {
+            QString exMsg;
+            QDebug(&exMsg).nospace()
+                << "HTTP header netside: Field bytes are missing the field separator "
+                << fieldSepHeaderParse << ": "
+                << HumanReadable::Hexdump { QByteArray::fromRawData(data, length), true, true };
+            throw std::runtime_error(exMsg.toStdString());
         }
+
+        HeaderNetside::Field theField;
+        theField._data = data;
+        theField._length = length;
+        theField._nameLength = static_cast<int>(static_cast<const char *>(colon) - data);
+        if (theField._nameLength == 0) {
+            QString exMsg;
+            QDebug(&exMsg)
+                << "HTTP header netside: Empty field name in field bytes"
+                << HumanReadable::Hexdump { QByteArray::fromRawData(data, length), true, true };
+            throw std::runtime_error(exMsg.toStdString());
+        }
+
+        // Simplify linear white-space to single SPs, with LWS at start
+        // and end trimmed. Usually, that just means trimming, which
+        // doesn't need a copy.
+        int valueFrom = theField._nameLength + 1, valueEnd = length;
+        while (valueFrom < valueEnd && isSpaceOrTab(data[valueFrom]))
+            valueFrom++;
+        while (valueEnd > valueFrom && isSpaceOrTab(data[valueEnd - 1]))
+            valueEnd--;
+        for (int i = valueFrom; i < valueEnd; i++) {
+            const char c = data[i];
+            if (c == '\r' || c == '\n' || c == '\t' || (c == ' ' && data[i + 1] == ' ')) {
+                theField._isValueCopied = true;
+                theField._valueCopy = simplifiedLinearWhiteSpace(theField.fieldValueRaw());
+                break;
+            }
+        }
+        theField._valueFrom = valueFrom;
+        theField._valueLength = valueEnd - valueFrom;
+
+        const int index = _fields.length();
+        _fields.append(theField);
+        _nextSameName.append(-1);
+
+        NameIndices &indices(_nameIndices[FieldNameKey { data, theField._nameLength }]);
+        if (indices.last >= 0)
+            _nextSameName[indices.last] = index;
+        else
+            indices.first = index;
+        indices.last = index;
+        indices.count++;
     }
 };
 
 }  // namespace SSCvn::HTTP::impl
 
+
+QByteArray HeaderNetside::Field::bytes() const
+{
+    return QByteArray::fromRawData(_data, _length);
+}
+
+QByteArray HeaderNetside::Field::fieldName() const
+{
+    return QByteArray::fromRawData(_data, _nameLength);
+}
+
+QByteArray HeaderNetside::Field::fieldValueRaw() const
+{
+    return QByteArray::fromRawData(_data + _nameLength + 1, _length - _nameLength - 1);
+}
+
+QByteArray HeaderNetside::Field::fieldValue() const
+{
+    if (_isValueCopied)
+        return _valueCopy;
+
+    return QByteArray::fromRawData(_data + _valueFrom, _valueLength);
+}
+
+
 HeaderNetside::HeaderNetside() :
     _implPtr(std::make_unique<impl::HeaderNetsideImpl>())
 {
@@ -50,7 +178,7 @@ HeaderNetside::~HeaderNetside()
 
 }
 
-QList<HeaderNetside::Field> HeaderNetside::fields() const
+const QVector<HeaderNetside::Field> &HeaderNetside::fields() const
 {
     return _implPtr->_fields;
 }
@@ -58,70 +186,64 @@ QList<HeaderNetside::Field> HeaderNetside::fields() const
 QList<HeaderNetside::Field> HeaderNetside::fields(const QByteArray &fieldName) const
 {
     QList<Field> ret;
-    QList<int> indicesReverse = _implPtr->_fieldNameIndices.values(fieldName.toLower());
-    for (auto i = indicesReverse.crbegin(); i != indicesReverse.crend(); i++)
-        ret.append(_implPtr->_fields.at(*i));
+    for (int i = _implPtr->nameIndices(fieldName).first; i >= 0; i = _implPtr->_nextSameName.at(i))
+        ret.append(_implPtr->_fields.at(i));
 
     return ret;
 }
 
-QList<QByteArray> HeaderNetside::fieldValues(const QByteArray &fieldName) const
+int HeaderNetside::fieldCount(const QByteArray &fieldName) const
 {
-    QList<QByteArray> ret;
-    for (const Field &theField : fields(fieldName))
-        ret.append(theField.fieldValue);
-
-    return ret;
+    return _implPtr->nameIndices(fieldName).count;
 }
 
-void HeaderNetside::setField(const QByteArray &fieldName, const QByteArray &fieldValue)
+const HeaderNetside::Field *HeaderNetside::field(const QByteArray &fieldName) const
 {
-    if (fieldName.isEmpty())
-        throw std::invalid_argument("HTTP header netside: Set field: Field name can't be empty");
+    const int i = _implPtr->nameIndices(fieldName).first;
+    if (i < 0)
+        return nullptr;
 
-    Field theField;
-    theField.fieldName = fieldName;
-    theField.fieldValue = fieldValue;
+    return &_implPtr->_fields.at(i);
+}
 
-    QList<int> indicesReverse = _implPtr->_fieldNameIndices.values(fieldName.toLower());
-    if (indicesReverse.isEmpty()) {
-        _implPtr->append(theField);
-    }
-    else {
-        // Remove every occurence except first.
-        while (indicesReverse.length() > 1)
-            _implPtr->_fields.removeAt(indicesReverse.takeFirst());
+QList<QByteArray> HeaderNetside::fieldValues(const QByteArray &fieldName) const
+{
+    QList<QByteArray> ret;
+    for (int i = _implPtr->nameIndices(fieldName).first; i >= 0; i = _implPtr->_nextSameName.at(i))
+        ret.append(_implPtr->_fields.at(i).fieldValue());
 
-        _implPtr->_fields.replace(indicesReverse.last(), theField);
-        _implPtr->regenerateIndices();
-    }
+    return ret;
 }
 
-void HeaderNetside::append(const QByteArray &fieldBytes)
+void HeaderNetside::parse(const QByteArray &buf, int from, int length)
 {
-    int i = fieldBytes.indexOf(fieldSepHeaderParse);
-    if (!(i >= 0)) {
-        QString exMsg;
-        QDebug(&exMsg).nospace()
-            << "HTTP header netside: Field bytes are missing the field separator "
-            << fieldSepHeaderParse << ": " << HumanReadable::Hexdump { fieldBytes, true, true };
-        throw std::runtime_error(exMsg.toStdString());
-    }
+    if (!(from >= 0 && length >= 0 && from + length <= buf.length()))
+        throw std::invalid_argument("HTTP header netside: Parse: Range out of buffer bounds");
 
-    Field theField { fieldBytes, fieldBytes.mid(0, i), fieldBytes.mid(i + 1), QByteArray() };
-    if (theField.fieldName.isEmpty()) {
-        QString exMsg;
-        QDebug(&exMsg)
-            << "HTTP header netside: Empty field name in field bytes"
-            << HumanReadable::Hexdump { fieldBytes, true, true };
-        throw std::runtime_error(exMsg.toStdString());
-    }
+    _implPtr->clear();
+    // (Shares the data; the fields below point into it.)
+    _implPtr->_buf = buf;
+
+    const char *const data = _implPtr->_buf.constData();
+    const int end = from + length;
+    int i = from;
+    while (i < end) {
+        if (isSpaceOrTab(data[i]))
+            throw std::runtime_error("HTTP header netside: Continuation line without a field to continue");
 
-    // Simplify linear white-space to single SPs,
-    // with LWS at start and end trimmed.
-    theField.fieldValue = simplifiedLinearWhiteSpace(theField.fieldValueRaw);
+        // Any following lines starting with linear white-space
+        // continue this field.
+        const int fieldFrom = i;
+        int fieldEnd;
+        do {
+            fieldEnd = _implPtr->_buf.indexOf(lineSep, i);
+            if (fieldEnd < 0 || fieldEnd > end)
+                fieldEnd = end;
+            i = std::min(fieldEnd + lineSep.length(), end);
+        } while (i < end && isSpaceOrTab(data[i]));
 
-    _implPtr->append(theField);
+        _implPtr->appendField(data + fieldFrom, fieldEnd - fieldFrom);
+    }
 }
 
 QDebug operator<<(QDebug debug, const HeaderNetside::Field &field)
@@ -130,8 +252,8 @@ QDebug operator<<(QDebug debug, const HeaderNetside::Field &field)
     debug.nospace();
 
     debug << "HTTP::HeaderNetside::Field(";
-    debug << "fieldName="  << field.fieldName << " ";
-    debug << "fieldValue=" << field.fieldValue << ")";
+    debug << "fieldName="  << field.fieldName() << " ";
+    debug << "fieldValue=" << field.fieldValue() << ")";
 
     return debug;
 }
@@ -4,6 +4,7 @@
 #include <memory>
 #include <QByteArray>
 #include <QList>
+#include <QVector>
 #include <QDebug>
 
 namespace SSCvn {
@@ -13,30 +14,51 @@ namespace impl {
 class HeaderNetsideImpl;
 }
 
+// An HTTP header from the wire.
+//
+// Parsed in a single pass over the receive buffer, which gets shared
+// (not copied); fields are kept as positions into that buffer.
 class HeaderNetside
 {
     std::unique_ptr<impl::HeaderNetsideImpl>  _implPtr;
 
 public:
-    struct Field {
-        QByteArray  bytes;
-        QByteArray  fieldName;
-        QByteArray  fieldValueRaw;
-        QByteArray  fieldValue;
+    // The accessors return non-copying views into the header's buffer,
+    // which stay valid for as long as the HeaderNetside is alive.
+    class Field {
+        const char  *_data = nullptr;
+        int          _length = 0;
+        int          _nameLength = 0;
+        int          _valueFrom = 0;
+        int          _valueLength = 0;
+        // Only used when simplifying linear white-space had to change
+        // more than the value's start and end.
+        bool         _isValueCopied = false;
+        QByteArray   _valueCopy;
+        friend impl::HeaderNetsideImpl;
+
+    public:
+        QByteArray bytes() const;
+        QByteArray fieldName() const;
+        QByteArray fieldValueRaw() const;
+        QByteArray fieldValue() const;
     };
 
     explicit HeaderNetside();
     ~HeaderNetside();
 
-    QList<Field> fields() const;
+    const QVector<Field> &fields() const;
+    // Field name lookups are case-insensitive, and don't depend
+    // on the number of fields in the header.
     QList<Field> fields(const QByteArray &fieldName) const;
+    int fieldCount(const QByteArray &fieldName) const;
+    // Returns the first field of that name, or null if there is none.
+    const Field *field(const QByteArray &fieldName) const;
     QList<QByteArray> fieldValues(const QByteArray &fieldName) const;
-    void setField(const QByteArray &fieldName, const QByteArray &fieldValue);
-
-    void append(const QByteArray &fieldBytes);
 
-    // Reverse direction
-    //QByteArray toBytes() const;
+    // Parses the header lines (each terminated by CR-LF) in buf,
+    // starting at from, replacing any fields parsed before.
+    void parse(const QByteArray &buf, int from, int length);
 };
 
 QDebug operator<<(QDebug debug, const HeaderNetside::Field &field);
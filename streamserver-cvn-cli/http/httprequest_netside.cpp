@@ -3,6 +3,7 @@
 #include "httputil.h"
 #include "humanreadable.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace SSCvn {
@@ -37,11 +38,6 @@ const QByteArray &RequestNetside::buf() const
     return _buf;
 }
 
-const QByteArray &RequestNetside::headerLinesBuf() const
-{
-    return _headerLinesBuf;
-}
-
 RequestNetside::ReceiveState RequestNetside::receiveState() const
 {
     return _receiveState;
@@ -49,7 +45,7 @@ RequestNetside::ReceiveState RequestNetside::receiveState() const
 
 const QByteArray &RequestNetside::requestLine() const
 {
-    if (_receiveState <= ReceiveState::RequestLine)
+    if (_receiveState <= ReceiveState::Header)
         throw std::runtime_error("HTTP request netside: Request line is not available, yet");
 
     return _requestLine;
@@ -57,7 +53,7 @@ const QByteArray &RequestNetside::requestLine() const
 
 const QByteArray &RequestNetside::method() const
 {
-    if (_receiveState <= ReceiveState::RequestLine)
+    if (_receiveState <= ReceiveState::Header)
         throw std::runtime_error("HTTP request netside: Request method is not available, yet");
 
     return _method;
@@ -65,15 +61,31 @@ const QByteArray &RequestNetside::method() const
 
 const QByteArray &RequestNetside::path() const
 {
-    if (_receiveState <= ReceiveState::RequestLine)
+    if (_receiveState <= ReceiveState::Header)
         throw std::runtime_error("HTTP request netside: Request path is not available, yet");
 
     return _path;
 }
 
+const QByteArray &RequestNetside::urlPath() const
+{
+    if (_receiveState <= ReceiveState::Header)
+        throw std::runtime_error("HTTP request netside: Request URL path is not available, yet");
+
+    return _urlPath;
+}
+
+const QByteArray &RequestNetside::urlQuery() const
+{
+    if (_receiveState <= ReceiveState::Header)
+        throw std::runtime_error("HTTP request netside: Request URL query is not available, yet");
+
+    return _urlQuery;
+}
+
 const QByteArray &RequestNetside::httpVersion() const
 {
-    if (_receiveState <= ReceiveState::RequestLine)
+    if (_receiveState <= ReceiveState::Header)
         throw std::runtime_error("HTTP request netside: HTTP version is not available, yet");
 
     return _httpVersion;
@@ -88,6 +100,8 @@ void RequestNetside::processChunk(const QByteArray &in)
 {
     if (_receiveState >= ReceiveState::Ready)
         throw std::runtime_error("HTTP request netside: Can't process chunk, as request is already ready");
+    if (_receiveState == ReceiveState::Body)
+        throw std::runtime_error("HTTP request netside: Request body not supported, yet");
 
     _buf.append(in);
     _byteCount += in.length();
@@ -96,89 +110,84 @@ void RequestNetside::processChunk(const QByteArray &in)
                                  std::to_string(_byteCount) + " bytes = " +
                                  HumanReadable::byteCount(_byteCount).toStdString() + ")");
 
-    while (_buf.length() > 0) {
-        switch (_receiveState) {
-        case ReceiveState::RequestLine:
-        {
-            int iLineSep = _buf.indexOf(lineSep);
-            if (iLineSep < 0)
-                // Not completely received, yet.
-                return;
-            _requestLine = _buf.left(iLineSep);
-
-            int iFrom = 0, iFieldSep;
-
-            iFieldSep = _requestLine.indexOf(fieldSepStartLine, iFrom);
-            if (iFieldSep < 0)
-                throw std::runtime_error("HTTP request netside: No field separator after HTTP method");
-            _method = _requestLine.mid(iFrom, iFieldSep - iFrom);
-            if (_method.isEmpty())
-                throw std::runtime_error("HTTP request netside: HTTP method is missing");
-            iFrom = iFieldSep + fieldSepStartLine.length();
-
-            iFieldSep = _requestLine.indexOf(fieldSepStartLine, iFrom);
-            if (iFieldSep < 0)
-                throw std::runtime_error("HTTP request netside: No field separator after request path");
-            _path = _requestLine.mid(iFrom, iFieldSep - iFrom);
-            if (_path.isEmpty())
-                throw std::runtime_error("HTTP request netside: Request path is missing");
-            iFrom = iFieldSep + fieldSepStartLine.length();
-
-            _httpVersion = _requestLine.mid(iFrom);
-            if (_httpVersion.isEmpty())
-                throw std::runtime_error("HTTP request netside: Request version is missing");
-
-            _buf.remove(0, iLineSep + lineSep.length());
+    while (true) {
+        const int iLineSep = _buf.indexOf(lineSep, _scanFrom);
+        if (iLineSep < 0) {
+            // Not completely received, yet. Next time, resume where
+            // a line separator could start.
+            _scanFrom = std::max(_lineFrom, _buf.length() - (lineSep.length() - 1));
+            return;
+        }
+        const int lineFrom = _lineFrom;
+        _lineFrom = _scanFrom = iLineSep + lineSep.length();
+
+        if (_receiveState == ReceiveState::RequestLine) {
+            _requestLineLength = iLineSep;
             _receiveState = ReceiveState::Header;
-            break;
+            continue;
         }
-        case ReceiveState::Header:
-            while (true) {
-                int iLineSep = _buf.indexOf(lineSep);
-                if (iLineSep < 0) {
-                    // Not completely received, yet.
-                    return;
-                }
-                else if (iLineSep == 0) {
-                    // Empty line that terminates the header.
-                    _buf.remove(0, lineSep.length());
-
-                    // One last couple of header lines?
-                    if (!_headerLinesBuf.isEmpty()) {
-                        _headerLinesBuf.chop(lineSep.length());
-                        _header.append(_headerLinesBuf);
-                        _headerLinesBuf.clear();
-                    }
-
-                    _receiveState = ReceiveState::Body;
-                    if (_method == "GET" || _method == "HEAD")
-                        _receiveState = ReceiveState::Ready;
-                    break;
-                }
-
-                QByteArray line = _buf.left(iLineSep + lineSep.length());
-                _buf.remove(0, iLineSep + lineSep.length());
-                if (line.startsWith(' ') || line.startsWith('\t')) {
-                    // Linear white-space (LWS).
-                    _headerLinesBuf.append(line);
-                }
-                else {
-                    // Has there been unprocessed header lines before?
-                    if (!_headerLinesBuf.isEmpty()) {
-                        _headerLinesBuf.chop(lineSep.length());
-                        _header.append(_headerLinesBuf);
-                    }
-
-                    _headerLinesBuf = line;
-                }
-            }
-            break;
-        case ReceiveState::Body:
+
+        if (iLineSep > lineFrom) {
+            // A header line; these get parsed together, below.
+            continue;
+        }
+
+        // Empty line that terminates the header. From now on, the buffer
+        // won't change anymore, so views into it stay valid.
+        parseRequestLine();
+        const int headerFrom = _requestLineLength + lineSep.length();
+        _header.parse(_buf, headerFrom, lineFrom - headerFrom);
+
+        _receiveState = ReceiveState::Body;
+        if (_method == "GET" || _method == "HEAD")
+            _receiveState = ReceiveState::Ready;
+        break;
+    }
+
+    if (_lineFrom < _buf.length()) {
+        if (_receiveState == ReceiveState::Body)
             throw std::runtime_error("HTTP request netside: Request body not supported, yet");
-        case ReceiveState::Ready:
-            throw std::runtime_error("HTTP request netside: Trailing data");
+        throw std::runtime_error("HTTP request netside: Trailing data");
+    }
+}
+
+void RequestNetside::parseRequestLine()
+{
+    const char *const data = _buf.constData();
+    _requestLine = QByteArray::fromRawData(data, _requestLineLength);
+
+    int iFrom = 0, iFieldSep;
+
+    iFieldSep = _requestLine.indexOf(fieldSepStartLine, iFrom);
+    if (iFieldSep < 0)
+        throw std::runtime_error("HTTP request netside: No field separator after HTTP method");
+    _method = QByteArray::fromRawData(data + iFrom, iFieldSep - iFrom);
+    if (_method.isEmpty())
+        throw std::runtime_error("HTTP request netside: HTTP method is missing");
+    iFrom = iFieldSep + fieldSepStartLine.length();
+
+    iFieldSep = _requestLine.indexOf(fieldSepStartLine, iFrom);
+    if (iFieldSep < 0)
+        throw std::runtime_error("HTTP request netside: No field separator after request path");
+    _path = QByteArray::fromRawData(data + iFrom, iFieldSep - iFrom);
+    if (_path.isEmpty())
+        throw std::runtime_error("HTTP request netside: Request path is missing");
+    {
+        const int iQuery = _path.indexOf('?');
+        if (iQuery < 0) {
+            _urlPath  = _path;
+            _urlQuery = QByteArray();
+        }
+        else {
+            _urlPath  = QByteArray::fromRawData(data + iFrom, iQuery);
+            _urlQuery = QByteArray::fromRawData(data + iFrom + iQuery + 1, _path.length() - iQuery - 1);
         }
     }
+    iFrom = iFieldSep + fieldSepStartLine.length();
+
+    _httpVersion = QByteArray::fromRawData(data + iFrom, _requestLineLength - iFrom);
+    if (_httpVersion.isEmpty())
+        throw std::runtime_error("HTTP request netside: Request version is missing");
 }
 
 }  // namespace SSCvn::HTTP
@@ -9,12 +9,19 @@ namespace SSCvn {
 namespace HTTP {  // namespace SSCvn::HTTP
 
 // An HTTP request from the wire.
+//
+// Everything received is kept in a single buffer, which is scanned
+// incrementally for the end of the header; only then, the request line
+// and header get parsed, in one pass. The parsed parts are non-copying
+// views into that buffer, valid for as long as the request is alive.
 class RequestNetside
 {
     qint64      _byteCount = 0;
     qint64      _byteCountMax = 10 * 1024;  // 10 KiB
     QByteArray  _buf;
-    QByteArray  _headerLinesBuf;
+    int         _lineFrom = 0;  // Start of the line currently being received.
+    int         _scanFrom = 0;  // Where to resume looking for its end.
+    int         _requestLineLength = -1;
 public:
     enum class ReceiveState {
         RequestLine,
@@ -27,6 +34,8 @@ private:
     QByteArray    _requestLine;
     QByteArray    _method;
     QByteArray    _path;
+    QByteArray    _urlPath;
+    QByteArray    _urlQuery;
     QByteArray    _httpVersion;
     HeaderNetside  _header;
     QByteArray    _body;
@@ -37,17 +46,23 @@ public:
     qint64 byteCount() const;
     qint64 byteCountMax() const;
     void setByteCountMax(qint64 max);
+    // Everything received so far.
     const QByteArray &buf() const;
-    const QByteArray &headerLinesBuf() const;
 
     ReceiveState receiveState() const;
     const QByteArray &requestLine() const;
     const QByteArray &method() const;
     const QByteArray &path() const;
+    // The request path split at the first '?'.
+    const QByteArray &urlPath() const;
+    const QByteArray &urlQuery() const;
     const QByteArray &httpVersion() const;
     const HeaderNetside &header() const;
 
     void processChunk(const QByteArray &in);
+
+private:
+    void parseRequestLine();
 };
 
 }  // namespace SSCvn::HTTP
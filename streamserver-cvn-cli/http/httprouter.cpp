@@ -0,0 +1,145 @@
+#include "httprouter.h"
+
+#include "log.h"
+#include "httpserver.h"
+
+#include <stdexcept>
+#include <QDebug>
+
+namespace SSCvn {
+namespace HTTP {  // namespace SSCvn::HTTP
+
+
+namespace {
+
+// Calls func with each non-empty path segment, as a non-copying view
+// into path, until func returns false.
+template <typename Func>
+void forEachPathSegment(const QByteArray &path, Func func)
+{
+    const char *const data = path.constData();
+    const int length = path.length();
+    int iFrom = 0;
+    while (iFrom < length) {
+        int iSep = path.indexOf('/', iFrom);
+        if (iSep < 0)
+            iSep = length;
+        if (iSep > iFrom) {
+            if (!func(QByteArray::fromRawData(data + iFrom, iSep - iFrom)))
+                return;
+        }
+        iFrom = iSep + 1;
+    }
+}
+
+}  // namespace
+
+
+Router::Router()
+{
+
+}
+
+int Router::routeCount() const
+{
+    return _routeCount;
+}
+
+void Router::addRoute(const QByteArray &path, QSharedPointer<ServerHandler> handler, Router::MatchKind kind)
+{
+    if (!path.startsWith('/'))
+        throw std::invalid_argument("HTTP router: Add route: Path must start with a slash, got \"" +
+                                    path.toStdString() + "\"");
+    if (!handler)
+        throw std::invalid_argument("HTTP router: Add route: Handler must not be null");
+
+    bool replaced = false;
+    switch (kind) {
+    case MatchKind::Exact:
+        replaced = _exactRoutes.contains(path);
+        _exactRoutes.insert(path, handler);
+        break;
+    case MatchKind::Prefix:
+    {
+        PrefixNode *node = &_prefixRoot;
+        forEachPathSegment(path, [&node](const QByteArray &segment) {
+            // (Store a deep copy as key, not the view.)
+            QSharedPointer<PrefixNode> &child(node->children[QByteArray(segment.constData(), segment.length())]);
+            if (!child)
+                child = QSharedPointer<PrefixNode>::create();
+            node = child.data();
+            return true;
+        });
+        replaced = node->handler;
+        node->handler = handler;
+        break;
+    }
+    }
+
+    if (!replaced)
+        _routeCount++;
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "HTTP router:" << (replaced ? "Replacing" : "Adding")
+                << (kind == MatchKind::Exact ? "exact" : "prefix")
+                << "route" << path << "to" << handler->name();
+}
+
+bool Router::removeRoute(const QByteArray &path, Router::MatchKind kind)
+{
+    bool removed = false;
+    switch (kind) {
+    case MatchKind::Exact:
+        removed = _exactRoutes.remove(path) > 0;
+        break;
+    case MatchKind::Prefix:
+    {
+        PrefixNode *node = &_prefixRoot;
+        forEachPathSegment(path, [&node](const QByteArray &segment) {
+            node = node->children.value(segment).data();
+            return node != nullptr;
+        });
+        if (node && node->handler) {
+            node->handler.reset();
+            removed = true;
+        }
+        break;
+    }
+    }
+
+    if (removed) {
+        _routeCount--;
+        if (SSCVN_VERBOSE(1))
+            qInfo() << "HTTP router: Removed"
+                    << (kind == MatchKind::Exact ? "exact" : "prefix")
+                    << "route" << path;
+    }
+    return removed;
+}
+
+QSharedPointer<ServerHandler> Router::route(const QByteArray &path) const
+{
+    {
+        auto iter = _exactRoutes.constFind(path);
+        if (iter != _exactRoutes.constEnd())
+            return iter.value();
+    }
+
+    // Longest matching prefix.
+    QSharedPointer<ServerHandler> handler = _prefixRoot.handler;
+    const PrefixNode *node = &_prefixRoot;
+    forEachPathSegment(path, [&node, &handler](const QByteArray &segment) {
+        auto iter = node->children.constFind(segment);
+        if (iter == node->children.constEnd())
+            return false;
+        node = iter.value().data();
+        if (node->handler)
+            handler = node->handler;
+        return true;
+    });
+    return handler;
+}
+
+
+}  // namespace SSCvn::HTTP
+}  // namespace SSCvn
@@ -0,0 +1,56 @@
+#ifndef HTTPROUTER_H
+#define HTTPROUTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSharedPointer>
+
+namespace SSCvn {
+namespace HTTP {  // namespace SSCvn::HTTP
+
+
+class ServerHandler;
+
+// Maps request paths to handlers.
+//
+// Exact paths are looked up in a hash; path prefixes in a trie keyed by
+// path segment. So the cost of routing a request depends on the depth
+// of its path, not on the number of registered routes.
+class Router
+{
+public:
+    enum class MatchKind {
+        Exact,
+        // Matches the path itself and everything below it,
+        // at path segment boundaries. ("/hls/" matches "/hls/index.m3u8".)
+        Prefix,
+    };
+
+private:
+    struct PrefixNode {
+        QHash<QByteArray, QSharedPointer<PrefixNode>>  children;
+        QSharedPointer<ServerHandler>                  handler;
+    };
+
+    QHash<QByteArray, QSharedPointer<ServerHandler>>  _exactRoutes;
+    PrefixNode  _prefixRoot;
+    int         _routeCount = 0;
+
+public:
+    explicit Router();
+
+    int routeCount() const;
+
+    void addRoute(const QByteArray &path, QSharedPointer<ServerHandler> handler, MatchKind kind = MatchKind::Exact);
+    bool removeRoute(const QByteArray &path, MatchKind kind = MatchKind::Exact);
+
+    // Returns null if no route matches. Exact routes take precedence
+    // over prefix routes, and longer prefixes over shorter ones.
+    QSharedPointer<ServerHandler> route(const QByteArray &path) const;
+};
+
+
+}  // namespace SSCvn::HTTP
+}  // namespace SSCvn
+
+#endif // HTTPROUTER_H
@@ -2,6 +2,8 @@
 
 #include "log.h"
 #include "humanreadable.h"
+#include "stageprofiler.h"
+#include "tracepoints.h"
 #include "httputil.h"
 #include "httprequest_netside.h"
 #include "httpresponse.h"
@@ -13,6 +15,7 @@
 #include <QString>
 #include <QStringList>
 #include <QByteArray>
+#include <QSet>
 #include <QTcpSocket>
 #include <QTcpServer>
 #include <QDateTime>
@@ -22,10 +25,31 @@
 namespace SSCvn {
 namespace HTTP {  // namespace SSCvn::HTTP
 
-using log::verbose;
 using log::debug_level;
 
 
+namespace {
+
+stats::ProfileStage profBufferResponse("buffer response");
+stats::ProfileStage profSocketWrite("socket write");
+
+// Brings an HTTP host (with optional port) into a canonical form
+// that can be compared directly: lower case, with explicit port.
+QByteArray normalizedHost(const QByteArray &host)
+{
+    QByteArray ret = host.toLower();
+    const int iColon = ret.lastIndexOf(':');
+    // (Handles IPv6 literals like "[::1]", too.)
+    if (iColon < 0 || iColon < ret.lastIndexOf(']'))
+        ret.append(":80");
+    else if (iColon == ret.length() - 1)
+        ret.append("80");
+    return ret;
+}
+
+}  // namespace
+
+
 /*
  * Server
  */
@@ -38,7 +62,9 @@ class ServerPrivate
     quint16      _listenPort;
     QTcpServer   _listenSocket;
     QStringList  _serverHostWhitelist;
+    QSet<QByteArray>  _serverHostWhitelistNormalized;
 
+    Router       _router;
     QSharedPointer<ServerHandler> _defaultHandler;
 
     quint64 _nextClientID = 1;
@@ -62,7 +88,7 @@ Server::Server(quint16 listenPort, QObject *parent) : QObject(parent),
 
     connect(&d->_listenSocket, &QTcpServer::newConnection, this, &Server::handleClientConnected);
 
-    if (verbose >= -1)
+    if (SSCVN_VERBOSE(-1))
         qInfo() << "Listening on port" << d->_listenPort << "...";
     if (!d->_listenSocket.listen(QHostAddress::Any, d->_listenPort)) {
         qCritical() << "Error listening on port" << d->_listenPort
@@ -91,9 +117,14 @@ const QStringList &Server::serverHostWhitelist() const
 void Server::setServerHostWhitelist(const QStringList &whitelist)
 {
     Q_D(Server);
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "HTTP server: Changing server host white-list from" << d->_serverHostWhitelist << "to" << whitelist;
     d->_serverHostWhitelist = whitelist;
+
+    // Normalize once here, so requests only need a set lookup.
+    d->_serverHostWhitelistNormalized.clear();
+    for (const QString &hostWhite : whitelist)
+        d->_serverHostWhitelistNormalized.insert(normalizedHost(hostWhite.toUtf8()));
 }
 
 QSharedPointer<ServerHandler> Server::defaultHandler() const
@@ -112,7 +143,7 @@ void Server::setDefaultHandler(QSharedPointer<ServerHandler> handler)
     bool haveNext = handler;
     const QString nextName = haveNext ? handler->name() : QString();
 
-    if (verbose >= 0) {
+    if (SSCVN_VERBOSE(0)) {
         if (hadPrevious && haveNext)
             qInfo() << "HTTP server: Replacing default handler" << prevName << "with" << nextName;
         else if (hadPrevious)
@@ -124,6 +155,24 @@ void Server::setDefaultHandler(QSharedPointer<ServerHandler> handler)
     d->_defaultHandler = handler;
 }
 
+const Router &Server::router() const
+{
+    const Q_D(Server);
+    return d->_router;
+}
+
+void Server::addRoute(const QByteArray &path, QSharedPointer<ServerHandler> handler, Router::MatchKind kind)
+{
+    Q_D(Server);
+    d->_router.addRoute(path, handler, kind);
+}
+
+bool Server::removeRoute(const QByteArray &path, Router::MatchKind kind)
+{
+    Q_D(Server);
+    return d->_router.removeRoute(path, kind);
+}
+
 const QList<ServerClient*> &Server::clients() const
 {
     const Q_D(Server);
@@ -139,7 +188,7 @@ void Server::handleClientConnected()
         qDebug() << "HTTP server: No next pending connection";
         return;
     }
-    if (verbose >= -1) {
+    if (SSCVN_VERBOSE(-1)) {
         qInfo() << "HTTP server: HTTP client" << d->_nextClientID << "connected:"
                 << "From" << socket_ptr->peerAddress()
                 << "port" << socket_ptr->peerPort();
@@ -153,7 +202,7 @@ void Server::handleClientConnected()
     // Store client object in list.
     d->_clients.append(client);
 
-    if (verbose >= 0)
+    if (SSCVN_VERBOSE(0))
         qInfo() << "HTTP server: HTTP client count:" << d->_clients.length();
 
     emit clientConnected(client);
@@ -179,7 +228,7 @@ void Server::handleClientDestroyed(QObject *obj)
         break;
     }
 
-    if (verbose >= 0)
+    if (SSCVN_VERBOSE(0))
         qInfo() << "HTTP server: Client count:" << d->_clients.length();
 
     emit clientDestroyed(obj);
@@ -192,7 +241,7 @@ void Server::processRequest(ServerContext *ctx)
     const QString &ctxLogPrefix(ctx->logPrefix());
     const RequestNetside &request(ctx->request());
 
-    if (verbose >= 0) {
+    if (SSCVN_VERBOSE(0)) {
         qInfo().nospace()
                 << qPrintable(ctxLogPrefix) << " Processing HTTP client request: "
                 << "Method " << request.method() << ", "
@@ -205,7 +254,7 @@ void Server::processRequest(ServerContext *ctx)
                 << "Host:"       << header.fieldValues("Host")
                 << "User-Agent:" << header.fieldValues("User-Agent");
     }
-    if (verbose >= 1) {
+    if (SSCVN_VERBOSE(1)) {
         qInfo() << qPrintable(ctxLogPrefix) << "HTTP header:";
         for (const HeaderNetside::Field &headerField : request.header().fields())
             qInfo() << qPrintable(ctxLogPrefix) << headerField;
@@ -213,7 +262,7 @@ void Server::processRequest(ServerContext *ctx)
 
     const QByteArray &httpVersion(request.httpVersion());
     if (!(httpVersion == "HTTP/1.0" || httpVersion == "HTTP/1.1")) {
-        if (verbose >= 0)
+        if (SSCVN_VERBOSE(0))
             qInfo() << qPrintable(ctxLogPrefix) << "HTTP version not recognized:" << httpVersion;
         ctx->setResponseError(SC_400_BadRequest, "HTTP version not recognized.\n");
         return;
@@ -221,49 +270,27 @@ void Server::processRequest(ServerContext *ctx)
 
     // TODO: Determine host according to RFC2616 5.2
     QByteArray host;
-    const QList<HeaderNetside::Field> hostHeaders = request.header().fields("Host");
-    if (hostHeaders.length() > 1) {
-        if (verbose >= 0) {
-            QDebug info = qInfo();
-            info << qPrintable(ctxLogPrefix) << "Multiple HTTP Host headers:";
-            for (const HeaderNetside::Field &hostHeader : hostHeaders)
-                info << hostHeader.fieldValue;
+    const int hostHeaderCount = request.header().fieldCount("Host");
+    if (hostHeaderCount > 1) {
+        if (SSCVN_VERBOSE(0)) {
+            qInfo() << qPrintable(ctxLogPrefix) << "Multiple HTTP Host headers:"
+                    << request.header().fieldValues("Host");
         }
         ctx->setResponseError(SC_400_BadRequest, "Multiple HTTP Host headers in request.\n");
         return;
     }
-    else if (hostHeaders.length() == 1) {
-        host = hostHeaders.first().fieldValue;
+    else if (hostHeaderCount == 1) {
+        host = request.header().field("Host")->fieldValue();
     }
     else {
         // TODO: For HTTP/1.1 requests, give 400 Bad Request according to RFC2616 14.23
     }
 
     // Check HTTP host of request.
-    const auto &hostWhitelist(d->_serverHostWhitelist);
+    const auto &hostWhitelist(d->_serverHostWhitelistNormalized);
     if (!hostWhitelist.isEmpty()) {
-        QString compareHost = host.toLower();
-        if (!compareHost.contains(':'))
-            compareHost.append(":80");
-        else if (compareHost.endsWith(':'))
-            compareHost.append("80");
-
-        bool found = false;
-        for (QString hostWhite : hostWhitelist) {
-            QString compareHostWhite = hostWhite.toLower();
-            if (!compareHostWhite.contains(':'))
-                compareHostWhite.append(":80");
-            else if (compareHostWhite.endsWith(':'))
-                compareHostWhite.append("80");
-
-            if (compareHost == compareHostWhite) {
-                found = true;
-                break;
-            }
-        }
-
-        if (!found) {
-            if (verbose >= 0)
+        if (!hostWhitelist.contains(normalizedHost(host))) {
+            if (SSCVN_VERBOSE(0))
                 qInfo() << qPrintable(ctxLogPrefix) << "HTTP host invalid for this server:" << host;
             ctx->setResponseError(SC_400_BadRequest, "HTTP host invalid for this server\n");
             return;
@@ -272,21 +299,24 @@ void Server::processRequest(ServerContext *ctx)
 
     const QByteArray &method(request.method());
     if (!(method == "GET" || method == "HEAD")) {
-        if (verbose >= 0)
+        if (SSCVN_VERBOSE(0))
             qInfo() << qPrintable(ctxLogPrefix) << "HTTP method not supported:" << method;
         ctx->setResponseError(SC_400_BadRequest, "HTTP method not supported.\n");
         return;
     }
 
-    // TODO: Decide which handler to set, based on previously registered/configured paths.
     auto handler = ctx->handler();
-    if (!handler && d->_defaultHandler)
-        handler = d->_defaultHandler;
     if (!handler) {
-        if (verbose >= 0)
-            qCritical() << qPrintable(ctxLogPrefix) << "No handler set for request!";
-        ctx->setResponseError(SC_500_InternalServerError, "No handler set for request.\n");
-        return;
+        handler = d->_router.route(request.urlPath());
+        if (!handler)
+            handler = d->_defaultHandler;
+        if (!handler) {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(ctxLogPrefix) << "Path not found:" << request.urlPath();
+            ctx->setResponseError(SC_404_NotFound, "Path not found.\n");
+            return;
+        }
+        ctx->setHandler(handler);
     }
     handler->handleRequest(ctx);
 }
@@ -354,17 +384,15 @@ void ServerClientPrivate::_handleDisconnected()
     if (_currentContext) {
         const RequestNetside &request(_currentContext->request());
         if (request.receiveState() != RequestNetside::ReceiveState::Ready) {
-            if (verbose >= 0) {
+            if (SSCVN_VERBOSE(0)) {
                 qInfo() << qPrintable(_logPrefix) << "No valid HTTP request before disconnect!";
                 qInfo() << qPrintable(_logPrefix) << "Buffer was"
                         << HumanReadable::Hexdump { request.buf(), true, true, true };
-                qInfo() << qPrintable(_logPrefix) << "Header lines buffer was"
-                        << HumanReadable::Hexdump { request.headerLinesBuf(), true, true, true };
             }
         }
     }
 
-    if (verbose >= -1) {
+    if (SSCVN_VERBOSE(-1)) {
         if (!_socket_ptr) {
             qInfo() << qPrintable(_logPrefix)
                     << "Client disconnected: (Socket already unavailable, peer address/port unknown.)";
@@ -395,7 +423,7 @@ void ServerClientPrivate::_createContext()
 {
     Q_Q(ServerClient);
 
-    if (verbose >= 0) {
+    if (SSCVN_VERBOSE(0)) {
         qInfo() << qPrintable(_logPrefix)
                 << "Creating HTTP context" << _nextContextID;
     }
@@ -408,7 +436,7 @@ void ServerClientPrivate::_receiveData()
 {
     Q_Q(ServerClient);
 
-    if (verbose >= 2)
+    if (SSCVN_VERBOSE(2))
         qDebug() << qPrintable(_logPrefix) << "Begin receive data";
 
     if (!_currentContext)
@@ -417,16 +445,16 @@ void ServerClientPrivate::_receiveData()
     QByteArray buf;
     while (!(buf = _socket_ptr->read(1024)).isEmpty()) {
         _socketBytesReceived += buf.length();
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qInfo() << qPrintable(_logPrefix) << "Received" << buf.length() << "bytes of data,"
                     << "total received" << _socketBytesReceived;
-        if (verbose >= 3)
+        if (SSCVN_VERBOSE(3))
             qDebug() << qPrintable(_logPrefix) << "Received data:" << buf;
 
         if (!_isReceiving) {
-            if (verbose >= 0)
+            if (SSCVN_VERBOSE(0))
                 qInfo() << qPrintable(_logPrefix) << "Unrecognized client data, aborting connection.";
-            if (verbose >= 3)
+            if (SSCVN_VERBOSE(3))
                 qInfo() << qPrintable(_logPrefix) << "Unrecognized client data was:" << buf;
 
             _socket_ptr->abort();
@@ -439,12 +467,10 @@ void ServerClientPrivate::_receiveData()
         }
         catch (const std::exception &ex) {
             _isReceiving = false;
-            if (verbose >= 0) {
+            if (SSCVN_VERBOSE(0)) {
                 qInfo() << qPrintable(_logPrefix) << "Unable to parse network bytes as HTTP request:" << ex.what();
                 qInfo() << qPrintable(_logPrefix) << "Buffer was"
                         << HumanReadable::Hexdump { request.buf(), true, true, true };
-                qInfo() << qPrintable(_logPrefix) << "Header lines buffer was"
-                        << HumanReadable::Hexdump { request.headerLinesBuf(), true, true, true };
                 qInfo() << qPrintable(_logPrefix) << "Rejected chunk was"
                         << HumanReadable::Hexdump { buf, true, true, true };
             }
@@ -463,12 +489,12 @@ void ServerClientPrivate::_receiveData()
 
     if (_currentContext->request().receiveState() == HTTP::RequestNetside::ReceiveState::Ready) {
         _isReceiving = false;
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qDebug() << qPrintable(_logPrefix) << "Received request; raising ready signal...";
         emit q->requestReady(_currentContext);
 
         if (!_currentContext->response()) {
-            if (verbose >= 0)
+            if (SSCVN_VERBOSE(0))
                 qCritical() << qPrintable(_logPrefix) << "No response was produced!";
             _currentContext->setResponseError(SC_500_InternalServerError, "No response was produced.\n");
         }
@@ -478,23 +504,23 @@ void ServerClientPrivate::_receiveData()
         _sendData();
     }
 
-    if (verbose >= 2)
+    if (SSCVN_VERBOSE(2))
         qDebug() << qPrintable(_logPrefix) << "Finish receive data";
 }
 
 void ServerClientPrivate::_sendData()
 {
-    if (verbose >= 2)
+    if (SSCVN_VERBOSE(2))
         qDebug() << qPrintable(_logPrefix) << "Begin send data";
 
     if (_socket_ptr->state() == QTcpSocket::ClosingState) {
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qDebug() << qPrintable(_logPrefix) << "Socket in closing state, leaving send data early";
         return;
     }
 
     if (!_currentContext) {
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qDebug() << qPrintable(_logPrefix) << "Current context missing, leaving send data early";
         return;
     }
@@ -506,7 +532,10 @@ void ServerClientPrivate::_sendData()
 
     while (!_sendBuf.isEmpty()) {
         // Try to send.
+        stats::StageTimer writeTimer(profSocketWrite);
         qint64 count = _socket_ptr->write(_sendBuf);
+        writeTimer.stop();
+        SSCVN_TRACE3(socket_write, _id, _sendBuf.length(), count);
         if (count < 0) {
             qInfo() << qPrintable(_logPrefix) << "Write error:" << _socket_ptr->errorString()
                     << ", aborting connection";
@@ -515,10 +544,10 @@ void ServerClientPrivate::_sendData()
         }
 
         _socketBytesSent += count;
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qDebug() << qPrintable(_logPrefix) << "Sent" << count << "bytes,"
                      << "total sent" << _socketBytesSent;
-        if (verbose >= 3)
+        if (SSCVN_VERBOSE(3))
             qDebug() << qPrintable(_logPrefix) << "Sent data:" << _sendBuf.left(count);
 
         // No more send is possible.
@@ -530,12 +559,12 @@ void ServerClientPrivate::_sendData()
     }
 
     if (_sendBuf.isEmpty() && _isBufferSendDone) {
-        if (verbose >= 0)
+        if (SSCVN_VERBOSE(0))
             qInfo() << qPrintable(_logPrefix) << "Closing client connection after HTTP response";
         _socket_ptr->close();
     }
 
-    if (verbose >= 2)
+    if (SSCVN_VERBOSE(2))
         qDebug() << qPrintable(_logPrefix) << "Finish send data";
 }
 
@@ -677,9 +706,10 @@ ServerContextPrivate::ServerContextPrivate(ServerClient *client, quint64 id, Ser
 bool ServerContextPrivate::_bufferResponse(QByteArray &buf)
 {
     Q_Q(ServerContext);
+    stats::StageTimer bufferTimer(profBufferResponse);
 
     if (!_response_ptr) {
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qDebug() << qPrintable(_logPrefix) << "No response generated, yet, leaving buffer response early";
         return true;
     }
@@ -687,7 +717,7 @@ bool ServerContextPrivate::_bufferResponse(QByteArray &buf)
     if (!_responseHeaderSent) {
         // Initially fill send buffer with HTTP response.
 
-        if (verbose >= 0) {
+        if (SSCVN_VERBOSE(0)) {
             qInfo() << qPrintable(_logPrefix) << "Sending server response:"
                     << "HTTP version"   << _response_ptr->httpVersion()
                     << "Status code"    << _response_ptr->statusCode()
@@ -695,7 +725,7 @@ bool ServerContextPrivate::_bufferResponse(QByteArray &buf)
         }
 
         const QByteArray response = _response_ptr->toBytes();
-        if (verbose >= 3)
+        if (SSCVN_VERBOSE(3))
             qDebug() << qPrintable(_logPrefix) << "Filling send buffer with response data:" << response;
 
         buf.append(response);
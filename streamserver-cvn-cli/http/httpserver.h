@@ -4,6 +4,7 @@
 #include <QObject>
 
 #include "httputil.h"
+#include "httprouter.h"
 
 #include <memory>
 #include <QScopedPointer>
@@ -43,9 +44,15 @@ public:
     const QStringList &serverHostWhitelist() const;
     void setServerHostWhitelist(const QStringList &whitelist);
 
+    // Fallback handler for requests that no route matches.
     QSharedPointer<ServerHandler> defaultHandler() const;
     void setDefaultHandler(QSharedPointer<ServerHandler> handler);
 
+    const Router &router() const;
+    void addRoute(const QByteArray &path, QSharedPointer<ServerHandler> handler,
+                  Router::MatchKind kind = Router::MatchKind::Exact);
+    bool removeRoute(const QByteArray &path, Router::MatchKind kind = Router::MatchKind::Exact);
+
     const QList<ServerClient*> &clients() const;
 
 signals:
@@ -0,0 +1,234 @@
+#include "inputcapture.h"
+
+#include <stdexcept>
+#include <QDebug>
+
+#include "log.h"
+
+using SSCvn::log::verbose;
+
+namespace SSCvn {
+
+
+namespace {
+
+const QByteArray captureMagic = "SSCVNCAP";
+const char captureVersion = 1;
+
+// (A single input read is at most a few packets; anything way larger
+// means the file is corrupt.)
+const quint64 recordBytesMax = 64 * 1024 * 1024;
+
+void appendVarint(QByteArray *buf, quint64 value)
+{
+    do {
+        quint8 byte = value & 0x7f;
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        buf->append(static_cast<char>(byte));
+    } while (value);
+}
+
+bool readVarint(QFile &file, quint64 *valuePtr)
+{
+    quint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        char c;
+        if (!file.getChar(&c))
+            return false;
+        const quint8 byte = static_cast<quint8>(c);
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *valuePtr = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+
+/*
+ * InputRecorder
+ */
+
+InputRecorder::InputRecorder(const QString &fileName) :
+    _file(fileName)
+{
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        throw std::runtime_error("Input capture: Can't create file \"" + fileName.toStdString() +
+                                 "\": " + _file.errorString().toStdString());
+
+    QByteArray header = captureMagic;
+    header.append(captureVersion);
+    if (_file.write(header) != header.length())
+        throw std::runtime_error("Input capture: Can't write header to file \"" + fileName.toStdString() +
+                                 "\": " + _file.errorString().toStdString());
+
+    if (SSCVN_VERBOSE(0))
+        qInfo() << "Capturing input reads to" << fileName;
+}
+
+InputRecorder::~InputRecorder()
+{
+    if (!_file.isOpen())
+        return;
+
+    _file.close();
+    if (SSCVN_VERBOSE(0))
+        qInfo() << "Captured" << _recordCount << "input reads to" << _file.fileName();
+}
+
+QString InputRecorder::fileName() const
+{
+    return _file.fileName();
+}
+
+bool InputRecorder::isOpen() const
+{
+    return _file.isOpen();
+}
+
+qint64 InputRecorder::recordCount() const
+{
+    return _recordCount;
+}
+
+void InputRecorder::record(qint64 nowNanosecs, bool isPeek, const QByteArray &bytes)
+{
+    if (!_file.isOpen())
+        return;
+
+    if (_startNanosecs < 0) {
+        _startNanosecs = nowNanosecs;
+        _lastNanosecs = nowNanosecs;
+    }
+
+    quint8 flags = 0;
+    if (isPeek)
+        flags |= InputCaptureRecord::Peek;
+    if (bytes.isNull())
+        flags |= InputCaptureRecord::Null;
+
+    QByteArray header;
+    appendVarint(&header, static_cast<quint64>(qMax<qint64>(0, nowNanosecs - _lastNanosecs)));
+    appendVarint(&header, flags);
+    appendVarint(&header, static_cast<quint64>(bytes.length()));
+    _lastNanosecs = qMax(_lastNanosecs, nowNanosecs);
+
+    if (_file.write(header) != header.length() ||
+        (!bytes.isEmpty() && _file.write(bytes) != bytes.length()))
+    {
+        qCritical() << "Input capture: Error writing to" << _file.fileName()
+                    << "after" << _recordCount << "reads:" << qPrintable(_file.errorString())
+                    << "- Stopping capture";
+        _file.close();
+        return;
+    }
+
+    _recordCount++;
+}
+
+void InputRecorder::flush()
+{
+    if (_file.isOpen())
+        _file.flush();
+}
+
+
+/*
+ * InputReplayer
+ */
+
+InputReplayer::InputReplayer(const QString &fileName) :
+    _file(fileName)
+{
+    if (!_file.open(QIODevice::ReadOnly))
+        throw std::runtime_error("Input replay: Can't open file \"" + fileName.toStdString() +
+                                 "\": " + _file.errorString().toStdString());
+
+    const QByteArray header = _file.read(captureMagic.length() + 1);
+    if (!header.startsWith(captureMagic) || header.length() != captureMagic.length() + 1)
+        throw std::runtime_error("Input replay: Not an input capture file: \"" + fileName.toStdString() + "\"");
+    if (header.at(captureMagic.length()) != captureVersion)
+        throw std::runtime_error("Input replay: Unsupported capture file version " +
+                                 std::to_string(header.at(captureMagic.length())) +
+                                 " in \"" + fileName.toStdString() + "\"");
+
+    readNext();
+
+    if (SSCVN_VERBOSE(0))
+        qInfo() << "Replaying input reads from" << fileName;
+}
+
+QString InputReplayer::fileName() const
+{
+    return _file.fileName();
+}
+
+qint64 InputReplayer::recordCount() const
+{
+    return _recordCount;
+}
+
+bool InputReplayer::atEnd() const
+{
+    return !_hasNext;
+}
+
+qint64 InputReplayer::nextNanosecs() const
+{
+    return _next.nanosecs;
+}
+
+InputCaptureRecord InputReplayer::take()
+{
+    if (!_hasNext)
+        throw std::logic_error("Input replay: Take beyond end of capture");
+
+    InputCaptureRecord record = _next;
+    _recordCount++;
+    readNext();
+    return record;
+}
+
+void InputReplayer::readNext()
+{
+    _hasNext = false;
+    if (_file.atEnd())
+        return;
+
+    quint64 deltaNanosecs = 0, flags = 0, length = 0;
+    if (!readVarint(_file, &deltaNanosecs) ||
+        !readVarint(_file, &flags) ||
+        !readVarint(_file, &length) ||
+        length > recordBytesMax)
+    {
+        qWarning() << "Input replay: Truncated or corrupt record after" << _recordCount
+                   << "reads in" << _file.fileName() << "- Ending replay there";
+        return;
+    }
+
+    InputCaptureRecord next;
+    next.nanosecs = _next.nanosecs + static_cast<qint64>(deltaNanosecs);
+    next.flags = static_cast<quint8>(flags);
+    if (!next.isNull()) {
+        next.bytes = _file.read(static_cast<qint64>(length));
+        if (static_cast<quint64>(next.bytes.length()) != length) {
+            qWarning() << "Input replay: Truncated record after" << _recordCount
+                       << "reads in" << _file.fileName() << "- Ending replay there";
+            return;
+        }
+        // (An empty, but non-null read has to stay that way.)
+        if (next.bytes.isNull())
+            next.bytes = QByteArray("");
+    }
+
+    _next = next;
+    _hasNext = true;
+}
+
+
+}  // namespace SSCvn
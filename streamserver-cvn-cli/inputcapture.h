@@ -0,0 +1,84 @@
+#ifndef INPUTCAPTURE_H
+#define INPUTCAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+namespace SSCvn {
+
+
+// Captures of the reads StreamServer does on its input, with their timing,
+// so arrival-timing dependent behaviour (pacing, packet size detection,
+// re-sync) can be reproduced exactly, e.g. to compare builds on an
+// identical workload.
+//
+// File format: The magic "SSCVNCAP" and a version byte; then per read,
+// as unsigned LEB128 varints: nanoseconds since the previous read
+// (since the capture start, for the first one), flags and byte count;
+// followed by the bytes read.
+
+struct InputCaptureRecord {
+    enum Flag : quint8 {
+        Peek = 0x01,  // Data was only peeked at, not consumed.
+        Null = 0x02,  // Read returned a null byte array (nothing available, or EOF).
+    };
+
+    qint64      nanosecs = 0;  // Since capture start.
+    quint8      flags    = 0;
+    QByteArray  bytes;
+
+    bool isPeek() const { return flags & Peek; }
+    bool isNull() const { return flags & Null; }
+};
+
+
+class InputRecorder
+{
+    QFile   _file;
+    qint64  _startNanosecs = -1;
+    qint64  _lastNanosecs  = 0;
+    qint64  _recordCount   = 0;
+
+public:
+    // Throws if the capture file can't be created.
+    explicit InputRecorder(const QString &fileName);
+    ~InputRecorder();
+
+    QString fileName() const;
+    bool    isOpen() const;
+    qint64  recordCount() const;
+
+    // On write errors, logs them and stops capturing.
+    void record(qint64 nowNanosecs, bool isPeek, const QByteArray &bytes);
+    void flush();
+};
+
+
+class InputReplayer
+{
+    QFile   _file;
+    bool    _hasNext = false;
+    InputCaptureRecord  _next;
+    qint64  _recordCount = 0;
+
+    void readNext();
+
+public:
+    // Throws if the capture file can't be opened or has a bad header.
+    explicit InputReplayer(const QString &fileName);
+
+    QString fileName() const;
+    // Records taken so far.
+    qint64  recordCount() const;
+
+    bool    atEnd() const;
+    // Time of the next record since capture start; only valid if !atEnd().
+    qint64  nextNanosecs() const;
+    InputCaptureRecord take();
+};
+
+
+}  // namespace SSCvn
+
+#endif // INPUTCAPTURE_H
@@ -1,6 +1,7 @@
 #include <QCoreApplication>
 
 #include "log_backend.h"
+#include "lograte.h"
 #include "http/httpserver.h"
 #include "streamserver.h"
 #include "demangle.h"
@@ -13,6 +14,7 @@
 #include <system_error>
 #include <QPointer>
 #include <QTextStream>
+#include <QTimer>
 #include <QCommandLineParser>
 #include <QSettings>
 
@@ -37,6 +39,8 @@ QString signalNumberToString(int signum)
         return "SIGINT/^C";
     case SIGTERM:
         return "SIGTERM/kill";
+    case SIGUSR1:
+        return "SIGUSR1";
     default:
         return "(unrecognized signal number " + QString::number(signum) + ")";
     }
@@ -65,6 +69,15 @@ static void handleSignalShutdown(int sigNum)
         qFatal("Handle signal %s: No stream server!", qPrintable(sigStr));
 }
 
+static void handleSignalDumpProfile(int sigNum)
+{
+    Q_UNUSED(sigNum)
+
+    StreamServer *theServer = SSCvn::server;
+    if (theServer)
+        QMetaObject::invokeMethod(theServer, "dumpProfile", Qt::QueuedConnection);
+}
+
 void setupSignals()
 {
     struct ::sigaction act;
@@ -75,6 +88,10 @@ void setupSignals()
         throw std::system_error(errno, std::generic_category(), "Can't set signal handler for " + signalNumberToString(SIGINT).toStdString());
     if (sigaction(SIGTERM, &act, nullptr) != 0)
         throw std::system_error(errno, std::generic_category(), "Can't set signal handler for " + signalNumberToString(SIGTERM).toStdString());
+
+    act.sa_handler = &handleSignalDumpProfile;
+    if (sigaction(SIGUSR1, &act, nullptr) != 0)
+        throw std::system_error(errno, std::generic_category(), "Can't set signal handler for " + signalNumberToString(SIGUSR1).toStdString());
 }
 
 namespace {  // namespace SSCvn::(anonymous)
@@ -207,11 +224,24 @@ int main(int argc, char *argv[])
           "none, date, time, timess/timesubsecond"
           " (default: time, or none when running with systemd journal)",
           "mode" },
+        { "log-async", "Write log messages from a background thread, in batches;"
+          " drops messages instead of blocking when it falls behind (default: off)"
+          ".\nValid flag values: " + flagSyntax + ".",
+          "flag" },
         { { "s", "ts-packet-size" }, "MPEG-TS packet size (e.g., 188 bytes)"
           " (default: auto-detect)",
           "size" },
         { "ts-strip-additional-info", "Strip additional info beyond 188 bytes basic packet size "
-          "from TS packets (default: on)"
+          "from TS packets (default: on); when off, time-shifted requests are refused"
+          " unless the input has 188-byte packets"
+          ".\nValid flag values: " + flagSyntax + ".",
+          "flag" },
+        { "ts-drop-null-packets", "Leave out null packets (PID 0x1fff) before passing the input on"
+          " (default: off)"
+          ".\nValid flag values: " + flagSyntax + ".",
+          "flag" },
+        { "ts-drop-stuffing-packets", "Leave out packets carrying nothing but adaptation field stuffing"
+          " before passing the input on; packets with a PCR are always kept (default: off)"
           ".\nValid flag values: " + flagSyntax + ".",
           "flag" },
         { "brake", "Set brake type to use to slow down input that is coming in too fast: "
@@ -223,6 +253,40 @@ int main(int argc, char *argv[])
         { "input-reopen-timeout", "Timeout before reopening input after EOF"
           " (default: 1000 ms)",
           "timeMillisec" },
+        { "input-capture", "Record every input read with its timing to a file,"
+          " for reproducing a run with --input-replay (default: none)",
+          "file_path" },
+        { "input-replay", "Take input from a file recorded with --input-capture"
+          " (with the recorded chunking and timing) instead of the input file,"
+          " and exit when done (default: none)",
+          "file_path" },
+        { "input-replay-speed", "Replay speed factor, e.g. 10 for ten times as fast;"
+          " 0 for no waiting at all (default: 1, real time)",
+          "factor" },
+        { "timeshift-file", "File to use as on-disk ring for time-shifted playback"
+          " (e.g., \"/live.m2ts?delay=30s\"), which holds basic 188-byte packets only"
+          " (default: none, time-shift disabled)",
+          "file_path" },
+        { "timeshift-size", "Size of the time-shift ring file"
+          " (default: 1024 MiB)",
+          "sizeMiB" },
+        { "hls", "Segment input for HTTP Live Streaming, served on /hls/index.m3u8 (default: off)"
+          ".\nValid flag values: " + flagSyntax + ".",
+          "flag" },
+        { "hls-target-duration", "Target duration of HLS segments; segments are cut at the next"
+          " random access point after this (default: 6 s)",
+          "timeSec" },
+        { "hls-segment-count", "Number of HLS segments to keep in memory & list in the playlist"
+          " (default: 6)",
+          "count" },
+        { "stats", "Serve statistics on /stats (JSON) and /metrics (Prometheus text format)"
+          " (default: off)"
+          ".\nValid flag values: " + flagSyntax + ".",
+          "flag" },
+        { "profile", "Measure time spent per processing stage; dumped to the log on SIGUSR1,"
+          " and served with the statistics (default: off)"
+          ".\nValid flag values: " + flagSyntax + ".",
+          "flag" },
     });
     parser.addPositionalArgument("input", "Input file name");
     parser.process(a);
@@ -291,6 +355,19 @@ int main(int argc, char *argv[])
         }
     }
 
+    bool logAsync = false;
+    {
+        QVariant valueVar = effectiveValue("log-async");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            logAsync = flagConverter.flagToBool(valueVar, &ok);
+            if (!ok) {
+                qCritical() << "Invalid log async flag: Can't convert to boolean:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
     // Prepare start values to be changed by incremental options.
     {
         QVariant valueVar = effectiveValue("verbose-level");
@@ -333,6 +410,12 @@ int main(int argc, char *argv[])
 #endif
     }
 
+#ifdef SSCVN_LOG_MAX_VERBOSE
+    if (verbose > SSCVN_LOG_MAX_VERBOSE)
+        qWarning("Verbose level %d exceeds the compiled-in maximum of %d, more verbose messages won't be shown!",
+                 verbose, SSCVN_LOG_MAX_VERBOSE);
+#endif
+
 
     quint16 listenPort = HTTP::Server::listenPort_default;
     {
@@ -386,6 +469,34 @@ int main(int argc, char *argv[])
         }
     }
 
+    std::unique_ptr<bool> tsDropNullPacketsPtr;
+    {
+        QVariant valueVar = effectiveValue("ts-drop-null-packets");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            tsDropNullPacketsPtr = std::make_unique<bool>(flagConverter.flagToBool(valueVar, &ok));
+            if (!ok) {
+                tsDropNullPacketsPtr.reset();
+                qCritical() << "Invalid TS drop null packets flag: Can't convert to boolean:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+    std::unique_ptr<bool> tsDropStuffingPacketsPtr;
+    {
+        QVariant valueVar = effectiveValue("ts-drop-stuffing-packets");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            tsDropStuffingPacketsPtr = std::make_unique<bool>(flagConverter.flagToBool(valueVar, &ok));
+            if (!ok) {
+                tsDropStuffingPacketsPtr.reset();
+                qCritical() << "Invalid TS drop stuffing packets flag: Can't convert to boolean:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
     std::unique_ptr<StreamServer::BrakeType> brakeTypePtr;
     {
         QVariant valueVar = effectiveValue("brake");
@@ -435,8 +546,129 @@ int main(int argc, char *argv[])
         }
     }
 
+    QString inputCaptureFileName;
+    {
+        QVariant valueVar = effectiveValue("input-capture");
+        if (valueVar.isValid())
+            inputCaptureFileName = valueVar.toString();
+    }
+
+    QString inputReplayFileName;
+    {
+        QVariant valueVar = effectiveValue("input-replay");
+        if (valueVar.isValid())
+            inputReplayFileName = valueVar.toString();
+    }
+
+    double inputReplaySpeed = 1;
+    {
+        QVariant valueVar = effectiveValue("input-replay-speed");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            inputReplaySpeed = valueVar.toDouble(&ok);
+            if (!ok || !(inputReplaySpeed >= 0)) {
+                qCritical() << "Invalid input replay speed: Can't convert to non-negative number:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+
+    QString timeShiftFileName;
+    {
+        QVariant valueVar = effectiveValue("timeshift-file");
+        if (valueVar.isValid())
+            timeShiftFileName = valueVar.toString();
+    }
+
+    qint64 timeShiftSizeMiB = 1024;
+    {
+        QVariant valueVar = effectiveValue("timeshift-size");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            timeShiftSizeMiB = valueVar.toLongLong(&ok);
+            if (!ok || timeShiftSizeMiB <= 0) {
+                qCritical() << "Invalid time-shift size: Can't convert to positive number:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+    std::unique_ptr<bool> hlsEnabledPtr;
+    {
+        QVariant valueVar = effectiveValue("hls");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            hlsEnabledPtr = std::make_unique<bool>(flagConverter.flagToBool(valueVar, &ok));
+            if (!ok) {
+                hlsEnabledPtr.reset();
+                qCritical() << "Invalid HLS flag: Can't convert to boolean:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+    std::unique_ptr<double> hlsTargetDurationSecsPtr;
+    {
+        QVariant valueVar = effectiveValue("hls-target-duration");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            hlsTargetDurationSecsPtr = std::make_unique<double>(valueVar.toDouble(&ok));
+            if (!ok) {
+                hlsTargetDurationSecsPtr.reset();
+                qCritical() << "Invalid HLS target duration: Can't convert to number:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+    std::unique_ptr<int> hlsSegmentCountPtr;
+    {
+        QVariant valueVar = effectiveValue("hls-segment-count");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            hlsSegmentCountPtr = std::make_unique<int>(valueVar.toInt(&ok));
+            if (!ok) {
+                hlsSegmentCountPtr.reset();
+                qCritical() << "Invalid HLS segment count: Can't convert to number:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+    std::unique_ptr<bool> statsEnabledPtr;
+    {
+        QVariant valueVar = effectiveValue("stats");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            statsEnabledPtr = std::make_unique<bool>(flagConverter.flagToBool(valueVar, &ok));
+            if (!ok) {
+                statsEnabledPtr.reset();
+                qCritical() << "Invalid statistics flag: Can't convert to boolean:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
+    std::unique_ptr<bool> profilingEnabledPtr;
+    {
+        QVariant valueVar = effectiveValue("profile");
+        if (valueVar.isValid()) {
+            bool ok = false;
+            profilingEnabledPtr = std::make_unique<bool>(flagConverter.flagToBool(valueVar, &ok));
+            if (!ok) {
+                profilingEnabledPtr.reset();
+                qCritical() << "Invalid profiling flag: Can't convert to boolean:" << valueVar;
+                return 2;
+            }
+        }
+    }
+
 
     QStringList args = parser.positionalArguments();
+    // (When replaying, the input file isn't opened; it's optional.)
+    if (args.isEmpty() && !inputReplayFileName.isEmpty())
+        args.append(inputReplayFileName);
     if (args.length() != 1) {
         qCritical().nospace()
             << "Invalid number of arguments " << args.length()
@@ -448,6 +680,8 @@ int main(int argc, char *argv[])
 
 
     log::backend::logStarting = false;
+    if (logAsync)
+        log::backend::startAsync();
 
 
     QPointer<HTTP::Server> httpServer;
@@ -474,6 +708,11 @@ int main(int argc, char *argv[])
         if (tsStripAdditionalInfoPtr)
             server.setTSStripAdditionalInfoDefault(*tsStripAdditionalInfoPtr);
 
+        if (tsDropNullPacketsPtr)
+            server.setTSDropNullPackets(*tsDropNullPacketsPtr);
+        if (tsDropStuffingPacketsPtr)
+            server.setTSDropStuffingPackets(*tsDropStuffingPacketsPtr);
+
         if (brakeTypePtr)
             server.setBrakeType(*brakeTypePtr);
 
@@ -483,6 +722,29 @@ int main(int argc, char *argv[])
         if (inputFileReopenTimeoutMillisecPtr)
             server.setInputFileReopenTimeoutMillisec(*inputFileReopenTimeoutMillisecPtr);
 
+        if (!inputCaptureFileName.isEmpty())
+            server.setInputCapture(inputCaptureFileName);
+        if (!inputReplayFileName.isEmpty())
+            server.setInputReplay(inputReplayFileName, inputReplaySpeed);
+
+        if (!timeShiftFileName.isEmpty())
+            server.setTimeShift(timeShiftFileName, timeShiftSizeMiB * 1024 * 1024);
+
+        if (hlsEnabledPtr)
+            server.setHLSEnabled(*hlsEnabledPtr);
+        if (server.hlsSegmenter()) {
+            if (hlsTargetDurationSecsPtr)
+                server.hlsSegmenter()->setTargetDurationSecs(*hlsTargetDurationSecsPtr);
+            if (hlsSegmentCountPtr)
+                server.hlsSegmenter()->setSegmentCountMax(*hlsSegmentCountPtr);
+        }
+
+        if (statsEnabledPtr)
+            server.setStatsEnabled(*statsEnabledPtr);
+
+        if (profilingEnabledPtr)
+            server.setProfilingEnabled(*profilingEnabledPtr);
+
         server.initInput();
     }
     catch (std::exception &ex) {
@@ -498,5 +760,14 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    return a.exec();
+    // Have rate-limited log messages summarized even when they stop coming.
+    QTimer logRateFlushTimer;
+    QObject::connect(&logRateFlushTimer, &QTimer::timeout, &log::RateLimiter::flushAll);
+    logRateFlushTimer.start(1000);
+
+    const int ret = a.exec();
+
+    // Don't lose what was suppressed last; later, errout is gone.
+    log::RateLimiter::flushAllPending();
+    return ret;
 }
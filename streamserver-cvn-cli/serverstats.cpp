@@ -0,0 +1,403 @@
+#include "serverstats.h"
+
+#include "log.h"
+#include "streamserver.h"
+#include "streamclient.h"
+#include "http/httprequest_netside.h"
+#include "http/httpresponse.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace SSCvn {
+
+using log::verbose;
+
+
+const QByteArray StatsHandler::statsPath   = "/stats";
+const QByteArray StatsHandler::metricsPath = "/metrics";
+
+
+namespace {
+
+// The percentiles exposed for latency histograms.
+const struct {
+    double       percentile;
+    const char  *name;      // For logs & JSON.
+    const char  *quantile;  // For Prometheus.
+} latencyPercentiles[] = {
+    { 50,   "p50",  "0.5"   },
+    { 99,   "p99",  "0.99"  },
+    { 99.9, "p999", "0.999" },
+};
+
+QString microsecsToString(quint64 microsecs)
+{
+    if (microsecs < 1000)
+        return QString::number(microsecs) + "us";
+    if (microsecs < 1000 * 1000)
+        return QString::number(microsecs / 1e3, 'g', 3) + "ms";
+    return QString::number(microsecs / 1e6, 'g', 3) + "s";
+}
+
+QJsonObject latencyToJson(const stats::Histogram &histogram)
+{
+    QJsonObject obj;
+    obj.insert("count", static_cast<double>(histogram.count()));
+    for (const auto &p : latencyPercentiles)
+        obj.insert(p.name, static_cast<double>(histogram.valueAtPercentile(p.percentile)));
+    obj.insert("max", static_cast<double>(histogram.max()));
+    return obj;
+}
+
+}  // namespace
+
+
+QString latencySummary(const stats::Histogram &histogram)
+{
+    QString summary;
+    for (const auto &p : latencyPercentiles)
+        summary += QString(p.name) + " " + microsecsToString(histogram.valueAtPercentile(p.percentile)) + ", ";
+    summary += "max " + microsecsToString(histogram.max()) +
+        " (" + QString::number(histogram.count()) + " packets)";
+    return summary;
+}
+
+QStringList profileReport(const QList<stats::ProfileStage::Snapshot> &prev,
+                          const QList<stats::ProfileStage::Snapshot> &cur,
+                          qint64 elapsedNanosecs)
+{
+    QHash<QString, stats::ProfileStage::Snapshot> prevByName;
+    for (const stats::ProfileStage::Snapshot &snapshot : prev)
+        prevByName.insert(snapshot.name, snapshot);
+
+    // Differences to the previous snapshot.
+    QList<stats::ProfileStage::Snapshot> deltas;
+    for (const stats::ProfileStage::Snapshot &snapshot : cur) {
+        const stats::ProfileStage::Snapshot prevSnapshot = prevByName.value(snapshot.name, { snapshot.name, 0, 0 });
+        deltas.append({ snapshot.name,
+                        snapshot.nanosecs - prevSnapshot.nanosecs,
+                        snapshot.count    - prevSnapshot.count });
+    }
+    std::stable_sort(deltas.begin(), deltas.end(), [](const stats::ProfileStage::Snapshot &a,
+                                                      const stats::ProfileStage::Snapshot &b) {
+        return a.nanosecs > b.nanosecs;
+    });
+
+    const double elapsedSecs = std::max(elapsedNanosecs, qint64(1)) / 1e9;
+    QStringList lines;
+    for (const stats::ProfileStage::Snapshot &delta : deltas) {
+        const double nanosecsPerSec = delta.nanosecs / elapsedSecs;
+        lines.append(QString("%1: %2 ms/s (%3% of a core), %4 calls/s, %5 ns/call")
+                     .arg(delta.name)
+                     .arg(nanosecsPerSec / 1e6, 0, 'f', 1)
+                     .arg(nanosecsPerSec / 1e7, 0, 'f', 2)
+                     .arg(delta.count / elapsedSecs, 0, 'f', 0)
+                     .arg(delta.count > 0 ? delta.nanosecs / delta.count : 0));
+    }
+    return lines;
+}
+
+
+class StatsHandlerPrivate {
+    StatsHandler *q_ptr;
+    Q_DECLARE_PUBLIC(StatsHandler)
+
+    const StreamServer *_streamServer;
+
+    explicit StatsHandlerPrivate(const StreamServer *streamServer, StatsHandler *q);
+};
+
+StatsHandlerPrivate::StatsHandlerPrivate(const StreamServer *streamServer, StatsHandler *q) : q_ptr(q),
+    _streamServer(streamServer)
+{
+    const std::string prefix = "StatsHandler hidden implementation ctor: ";
+
+    if (!q_ptr)
+        throw std::invalid_argument(prefix + "Back-pointer must not be null");
+    if (!_streamServer)
+        throw std::invalid_argument(prefix + "Stream server must not be null");
+}
+
+
+StatsHandler::StatsHandler(const StreamServer *streamServer) :
+    d_ptr(new StatsHandlerPrivate(streamServer, this))
+{
+
+}
+
+StatsHandler::~StatsHandler()
+{
+
+}
+
+QByteArray StatsHandler::toJson() const
+{
+    const Q_D(StatsHandler);
+    const IngestStats &ingest(d->_streamServer->ingestStats());
+
+    QJsonObject ingestObj;
+    // (JSON numbers are doubles; fine for these magnitudes.)
+    ingestObj.insert("packets",         static_cast<double>(ingest.packets.value()));
+    ingestObj.insert("bytes",           static_cast<double>(ingest.bytes.value()));
+    ingestObj.insert("errors",          static_cast<double>(ingest.errors.value()));
+    ingestObj.insert("desyncs",         static_cast<double>(ingest.desyncs.value()));
+    ingestObj.insert("resyncs",         static_cast<double>(ingest.resyncs.value()));
+    ingestObj.insert("discontinuities", static_cast<double>(ingest.discontinuities.value()));
+    ingestObj.insert("brakeSleepSecs",  ingest.brakeSleepNanosecs.value() / 1e9);
+    ingestObj.insert("paddingPacketsDropped", static_cast<double>(ingest.paddingPacketsDropped.value()));
+    ingestObj.insert("paddingBytesDropped",   static_cast<double>(ingest.paddingBytesDropped.value()));
+    ingestObj.insert("pcrJitterMicrosecs",    static_cast<double>(ingest.pcrJitterMicrosecs.value()));
+    ingestObj.insert("pcrJitterMaxMicrosecs", static_cast<double>(ingest.pcrJitterMaxMicrosecs.value()));
+
+    // Losses upstream of us, as opposed to the clients' droppedPackets.
+    const TS::PIDAnalyzer &analyzer(d->_streamServer->pidAnalyzer());
+    const TS::PIDAnalyzer::PIDStats &health(analyzer.totals());
+    ingestObj.insert("bitrate",          static_cast<double>(health.bitrate));
+    ingestObj.insert("continuityErrors", static_cast<double>(health.continuityErrors));
+    ingestObj.insert("lostPackets",      static_cast<double>(health.lostPackets));
+    ingestObj.insert("duplicatePackets", static_cast<double>(health.duplicatePackets));
+    ingestObj.insert("transportErrors",  static_cast<double>(health.transportErrors));
+    ingestObj.insert("scrambledPackets", static_cast<double>(health.scrambledPackets));
+
+    QJsonArray pidsArr;
+    for (quint16 pid : analyzer.activePIDs()) {
+        const TS::PIDAnalyzer::PIDStats &pidStats(analyzer.pidStats(pid));
+        QJsonObject pidObj;
+        pidObj.insert("pid",              pid);
+        pidObj.insert("packets",          static_cast<double>(pidStats.packets));
+        pidObj.insert("bitrate",          static_cast<double>(pidStats.bitrate));
+        pidObj.insert("continuityErrors", static_cast<double>(pidStats.continuityErrors));
+        pidObj.insert("lostPackets",      static_cast<double>(pidStats.lostPackets));
+        pidObj.insert("duplicatePackets", static_cast<double>(pidStats.duplicatePackets));
+        pidObj.insert("transportErrors",  static_cast<double>(pidStats.transportErrors));
+        pidObj.insert("scrambledPackets", static_cast<double>(pidStats.scrambledPackets));
+        pidObj.insert("discontinuityIndicators", static_cast<double>(pidStats.discontinuityIndicators));
+        pidsArr.append(pidObj);
+    }
+    ingestObj.insert("pids", pidsArr);
+
+    QJsonArray clientsArr;
+    for (const StreamClient *client : d->_streamServer->clients()) {
+        QJsonObject clientObj;
+        clientObj.insert("id",             static_cast<double>(client->id()));
+        clientObj.insert("connectedSecs",  client->createdElapsed().elapsed() / 1e3);
+        clientObj.insert("forwarding",     client->isForwardingPackets());
+        clientObj.insert("timeShiftDelayMillisecs", static_cast<double>(client->timeShiftDelayMillisec()));
+        clientObj.insert("queuePackets",   client->queueLength());
+        clientObj.insert("bytesSent",      static_cast<double>(client->bytesSent()));
+        clientObj.insert("droppedPackets", static_cast<double>(client->droppedPacketCount()));
+        clientObj.insert("lagPackets",     static_cast<double>(client->lagPackets()));
+        clientObj.insert("latencyMicrosecs", latencyToJson(client->latencyHistogram()));
+        clientsArr.append(clientObj);
+    }
+
+    QJsonObject rootObj;
+    rootObj.insert("uptimeSecs", d->_streamServer->uptimeElapsed().elapsed() / 1e3);
+    rootObj.insert("ingest", ingestObj);
+    rootObj.insert("latencyMicrosecs", latencyToJson(d->_streamServer->latencyHistogram()));
+    if (d->_streamServer->isProfilingEnabled()) {
+        QJsonObject profileObj;
+        for (const stats::ProfileStage::Snapshot &snapshot : stats::ProfileStage::snapshotAll()) {
+            QJsonObject stageObj;
+            stageObj.insert("secs",  snapshot.nanosecs / 1e9);
+            stageObj.insert("calls", static_cast<double>(snapshot.count));
+            profileObj.insert(snapshot.name, stageObj);
+        }
+        rootObj.insert("profile", profileObj);
+    }
+    rootObj.insert("clients", clientsArr);
+    return QJsonDocument(rootObj).toJson();
+}
+
+namespace {
+
+void appendMetricHeader(QByteArray &out, const char *name, const char *type, const char *help)
+{
+    out.append("# HELP streamserver_cvn_").append(name).append(' ').append(help).append('\n');
+    out.append("# TYPE streamserver_cvn_").append(name).append(' ').append(type).append('\n');
+}
+
+void appendMetric(QByteArray &out, const char *name, const char *type, const char *help, double value)
+{
+    appendMetricHeader(out, name, type, help);
+    out.append("streamserver_cvn_").append(name).append(' ')
+       .append(QByteArray::number(value, 'g', 15)).append('\n');
+}
+
+void appendPIDSample(QByteArray &out, const char *name, quint16 pid, double value)
+{
+    out.append("streamserver_cvn_").append(name)
+       .append("{pid=\"0x").append(QByteArray::number(pid, 16).rightJustified(4, '0')).append("\"} ")
+       .append(QByteArray::number(value, 'g', 15)).append('\n');
+}
+
+void appendClientSample(QByteArray &out, const char *name, quint64 clientId, double value)
+{
+    out.append("streamserver_cvn_").append(name)
+       .append("{client=\"").append(QByteArray::number(clientId)).append("\"} ")
+       .append(QByteArray::number(value, 'g', 15)).append('\n');
+}
+
+// Samples of a Prometheus summary, from a histogram of microseconds.
+// labels is either empty or like "client=\"1\"".
+void appendLatencySamples(QByteArray &out, const char *name, const QByteArray &labels,
+                          const stats::Histogram &histogram)
+{
+    const QByteArray labelsPrefix = labels.isEmpty() ? QByteArray() : labels + ',';
+    for (const auto &p : latencyPercentiles) {
+        out.append("streamserver_cvn_").append(name)
+           .append('{').append(labelsPrefix).append("quantile=\"").append(p.quantile).append("\"} ")
+           .append(QByteArray::number(histogram.valueAtPercentile(p.percentile) / 1e6, 'g', 15)).append('\n');
+    }
+    const QByteArray labelsBraced = labels.isEmpty() ? QByteArray() : '{' + labels + '}';
+    out.append("streamserver_cvn_").append(name).append("_sum").append(labelsBraced).append(' ')
+       .append(QByteArray::number(histogram.sum() / 1e6, 'g', 15)).append('\n');
+    out.append("streamserver_cvn_").append(name).append("_count").append(labelsBraced).append(' ')
+       .append(QByteArray::number(histogram.count())).append('\n');
+}
+
+}  // namespace
+
+QByteArray StatsHandler::toPrometheus() const
+{
+    const Q_D(StatsHandler);
+    const IngestStats &ingest(d->_streamServer->ingestStats());
+
+    QByteArray out;
+    appendMetric(out, "uptime_seconds", "gauge", "Time since the server started.",
+                 d->_streamServer->uptimeElapsed().elapsed() / 1e3);
+    appendMetric(out, "ingest_packets_total", "counter", "TS packets read from the input.",
+                 ingest.packets.value());
+    appendMetric(out, "ingest_bytes_total", "counter", "Bytes read from the input.",
+                 ingest.bytes.value());
+    appendMetric(out, "ingest_errors_total", "counter", "Input TS packets that failed to parse.",
+                 ingest.errors.value());
+    appendMetric(out, "ingest_desyncs_total", "counter", "Short reads from the input.",
+                 ingest.desyncs.value());
+    appendMetric(out, "ingest_resyncs_total", "counter", "Re-syncs after consecutive input errors.",
+                 ingest.resyncs.value());
+    appendMetric(out, "ingest_discontinuities_total", "counter", "PCR discontinuities in the input.",
+                 ingest.discontinuities.value());
+    appendMetric(out, "brake_sleep_seconds_total", "counter", "Time spent sleeping to pace the input.",
+                 ingest.brakeSleepNanosecs.value() / 1e9);
+    appendMetric(out, "ingest_padding_packets_dropped_total", "counter", "Null and stuffing-only input packets not passed on.",
+                 ingest.paddingPacketsDropped.value());
+    appendMetric(out, "ingest_padding_bytes_dropped_total", "counter", "Bytes of null and stuffing-only input packets not passed on.",
+                 ingest.paddingBytesDropped.value());
+    appendMetric(out, "pcr_jitter_seconds", "gauge", "PCR versus wall-clock advance, at the latest PCR.",
+                 ingest.pcrJitterMicrosecs.value() / 1e6);
+    appendMetric(out, "pcr_jitter_max_seconds", "gauge", "Maximum absolute PCR jitter seen.",
+                 ingest.pcrJitterMaxMicrosecs.value() / 1e6);
+
+    const TS::PIDAnalyzer &analyzer(d->_streamServer->pidAnalyzer());
+    const TS::PIDAnalyzer::PIDStats &health(analyzer.totals());
+    appendMetric(out, "ingest_bitrate_bps", "gauge", "Input bitrate over the last second, in bits per second.",
+                 health.bitrate);
+    appendMetric(out, "ingest_continuity_errors_total", "counter", "Continuity counter errors in the input, i.e. upstream losses.",
+                 health.continuityErrors);
+    appendMetric(out, "ingest_lost_packets_total", "counter", "Input packets lost upstream, estimated from continuity counter gaps.",
+                 health.lostPackets);
+    appendMetric(out, "ingest_duplicate_packets_total", "counter", "Duplicate input packets.",
+                 health.duplicatePackets);
+    appendMetric(out, "ingest_transport_errors_total", "counter", "Input packets with transport_error_indicator set.",
+                 health.transportErrors);
+    appendMetric(out, "ingest_scrambled_packets_total", "counter", "Scrambled input packets.",
+                 health.scrambledPackets);
+
+    appendMetricHeader(out, "ingest_pid_packets_total", "counter", "Input packets, by PID.");
+    for (quint16 pid : analyzer.activePIDs())
+        appendPIDSample(out, "ingest_pid_packets_total", pid, analyzer.pidStats(pid).packets);
+    appendMetricHeader(out, "ingest_pid_bitrate_bps", "gauge", "Input bitrate by PID, over the last second, in bits per second.");
+    for (quint16 pid : analyzer.activePIDs())
+        appendPIDSample(out, "ingest_pid_bitrate_bps", pid, analyzer.pidStats(pid).bitrate);
+    appendMetricHeader(out, "ingest_pid_continuity_errors_total", "counter", "Continuity counter errors in the input, by PID.");
+    for (quint16 pid : analyzer.activePIDs())
+        appendPIDSample(out, "ingest_pid_continuity_errors_total", pid, analyzer.pidStats(pid).continuityErrors);
+    appendMetricHeader(out, "ingest_pid_lost_packets_total", "counter", "Input packets lost upstream, by PID.");
+    for (quint16 pid : analyzer.activePIDs())
+        appendPIDSample(out, "ingest_pid_lost_packets_total", pid, analyzer.pidStats(pid).lostPackets);
+
+    appendMetricHeader(out, "latency_seconds", "summary", "Time from reading a TS packet until handing it to a client's socket.");
+    appendLatencySamples(out, "latency_seconds", QByteArray(), d->_streamServer->latencyHistogram());
+
+    const QList<StreamClient*> &clients(d->_streamServer->clients());
+    appendMetric(out, "clients", "gauge", "Connected stream clients.", clients.length());
+
+    appendMetricHeader(out, "client_queue_packets", "gauge", "TS packets queued for a client.");
+    for (const StreamClient *client : clients)
+        appendClientSample(out, "client_queue_packets", client->id(), client->queueLength());
+    appendMetricHeader(out, "client_sent_bytes_total", "counter", "Bytes sent to a client's socket.");
+    for (const StreamClient *client : clients)
+        appendClientSample(out, "client_sent_bytes_total", client->id(), client->bytesSent());
+    appendMetricHeader(out, "client_dropped_packets_total", "counter", "TS packets dropped for a client.");
+    for (const StreamClient *client : clients)
+        appendClientSample(out, "client_dropped_packets_total", client->id(), client->droppedPacketCount());
+    appendMetricHeader(out, "client_lag_packets", "gauge", "TS packets a client is behind the input.");
+    for (const StreamClient *client : clients)
+        appendClientSample(out, "client_lag_packets", client->id(), client->lagPackets());
+    appendMetricHeader(out, "client_latency_seconds", "summary", "Time from reading a TS packet until handing it to a client's socket.");
+    for (const StreamClient *client : clients) {
+        appendLatencySamples(out, "client_latency_seconds",
+                             "client=\"" + QByteArray::number(client->id()) + '"', client->latencyHistogram());
+    }
+
+    if (d->_streamServer->isProfilingEnabled()) {
+        const QList<stats::ProfileStage::Snapshot> snapshots = stats::ProfileStage::snapshotAll();
+        appendMetricHeader(out, "stage_seconds_total", "counter", "Time spent in a processing stage, including nested stages.");
+        for (const stats::ProfileStage::Snapshot &snapshot : snapshots) {
+            out.append("streamserver_cvn_stage_seconds_total{stage=\"").append(snapshot.name.toUtf8()).append("\"} ")
+               .append(QByteArray::number(snapshot.nanosecs / 1e9, 'g', 15)).append('\n');
+        }
+        appendMetricHeader(out, "stage_calls_total", "counter", "Times a processing stage was run.");
+        for (const stats::ProfileStage::Snapshot &snapshot : snapshots) {
+            out.append("streamserver_cvn_stage_calls_total{stage=\"").append(snapshot.name.toUtf8()).append("\"} ")
+               .append(QByteArray::number(snapshot.count)).append('\n');
+        }
+    }
+
+    return out;
+}
+
+QString StatsHandler::name() const
+{
+    return "Statistics & metrics";
+}
+
+void StatsHandler::handleRequest(HTTP::ServerContext *ctx)
+{
+    const QByteArray &path(ctx->request().urlPath());
+
+    QByteArray body;
+    QString contentType;
+    if (path == statsPath) {
+        body = toJson();
+        contentType = "application/json";
+    }
+    else if (path == metricsPath) {
+        body = toPrometheus();
+        contentType = "text/plain; version=0.0.4";
+    }
+    else {
+        if (verbose >= 0)
+            qInfo() << qPrintable(ctx->logPrefix()) << "Statistics path not found:" << path;
+        ctx->setResponseError(HTTP::SC_404_NotFound, "Path not found.\n");
+        return;
+    }
+
+    QScopedPointer<HTTP::Response> response_ptr(new HTTP::Response(HTTP::SC_200_OK, "OK"));
+    response_ptr->setHeader("Content-Type", contentType);
+    response_ptr->setHeader("Cache-Control", "no-cache");
+    if (ctx->request().method() == "HEAD")
+        response_ptr->setHeader("Content-Length", QString::number(body.length()));
+    else
+        response_ptr->setBody(body);
+    ctx->setResponse(response_ptr.take());
+}
+
+
+}  // namespace SSCvn
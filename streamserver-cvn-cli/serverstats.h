@@ -0,0 +1,73 @@
+#ifndef SERVERSTATS_H
+#define SERVERSTATS_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "statscounter.h"
+#include "histogram.h"
+#include "stageprofiler.h"
+#include "http/httpserver.h"
+
+namespace SSCvn {
+
+
+// Counters of the input side, updated per packet by StreamServer.
+struct IngestStats {
+    stats::Counter  packets;
+    stats::Counter  bytes;
+    stats::Counter  errors;           // Packets that failed to parse.
+    stats::Counter  desyncs;          // Short reads.
+    stats::Counter  resyncs;          // Re-syncs after consecutive errors.
+    stats::Counter  discontinuities;  // PCR jumps.
+    stats::Counter  brakeSleepNanosecs;
+    // Null and stuffing-only packets left out before fan-out.
+    stats::Counter  paddingPacketsDropped;
+    stats::Counter  paddingBytesDropped;
+    // Difference between PCR and wall-clock advance, since the previous PCR.
+    stats::Gauge    pcrJitterMicrosecs;
+    stats::Gauge    pcrJitterMaxMicrosecs;
+};
+
+
+// E.g., "p50 812us, p99 4.1ms, p999 12ms, max 30ms (123456 packets)",
+// for a histogram of microseconds.
+QString latencySummary(const stats::Histogram &histogram);
+
+// One line per stage, busiest first, with the time spent per second
+// between the two snapshots, like
+// "parse: 12.3 ms/s (1.23% of a core), 21000 calls/s, 585 ns/call".
+QStringList profileReport(const QList<stats::ProfileStage::Snapshot> &prev,
+                          const QList<stats::ProfileStage::Snapshot> &cur,
+                          qint64 elapsedNanosecs);
+
+
+class StreamServer;
+class StatsHandlerPrivate;
+
+// Serves StreamServer statistics as JSON (statsPath)
+// and in the Prometheus text format (metricsPath).
+class StatsHandler : public HTTP::ServerHandler {
+    QScopedPointer<StatsHandlerPrivate>  d_ptr;
+    Q_DECLARE_PRIVATE(StatsHandler)
+
+public:
+    explicit StatsHandler(const StreamServer *streamServer);
+    ~StatsHandler();
+
+    static const QByteArray statsPath;
+    static const QByteArray metricsPath;
+
+    QByteArray toJson() const;
+    QByteArray toPrometheus() const;
+
+    QString name() const override;
+    void handleRequest(HTTP::ServerContext *ctx) override;
+};
+
+
+}  // namespace SSCvn
+
+#endif // SERVERSTATS_H
@@ -1,17 +1,34 @@
 #include "streamclient.h"
 
 #include "log.h"
+#include "lograte.h"
 #include "streamserver.h"
+#include "serverstats.h"
 #include "http/httputil.h"
 #include "http/httprequest_netside.h"
 #include "http/httpresponse.h"
 #include "humanreadable.h"
+#include "monotonicclock.h"
+#include "stageprofiler.h"
+#include "tracepoints.h"
+#include "tspacketview.h"
+#include "tspsi.h"
+#include "tstimeshiftring.h"
+
+#include <algorithm>
+#include <QUrlQuery>
 
 namespace SSCvn {
 
-using log::verbose;
+namespace {
+
+stats::ProfileStage profEncode("encode");
+
+}  // namespace
 
 
+const QByteArray StreamClient::programPathPrefix = "/program/";
+
 StreamClient::StreamClient(HTTP::ServerContext *httpServerContext, quint64 id, QObject *parent) :
     QObject(parent), _id(id), _createdTimestamp(QDateTime::currentDateTime()),
     _httpServerContext(httpServerContext)
@@ -28,14 +45,14 @@ StreamServer *StreamClient::parentServer() const
 {
     QObject *theParent = parent();
     if (!theParent) {
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qWarning() << qPrintable(_logPrefix) << "Parent server: Parent not set";
         return nullptr;
     }
 
     auto theParentServer = dynamic_cast<StreamServer *>(theParent);
     if (!theParentServer) {
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qWarning() << qPrintable(_logPrefix) << "Parent server: Is not a StreamServer";
         return nullptr;
     }
@@ -73,6 +90,58 @@ bool StreamClient::isForwardingPackets() const
     return _forwardPackets;
 }
 
+bool StreamClient::isTimeShifted() const
+{
+    return _timeShiftDelayMillisec > 0;
+}
+
+qint64 StreamClient::timeShiftDelayMillisec() const
+{
+    return _timeShiftDelayMillisec;
+}
+
+StreamFilter *StreamClient::streamFilter() const
+{
+    return _streamFilterPtr.data();
+}
+
+int StreamClient::queueLength() const
+{
+    return _queue.length();
+}
+
+quint64 StreamClient::bytesSent() const
+{
+    if (!_httpServerContext)
+        return 0;
+    const HTTP::ServerClient *const httpServerClient = _httpServerContext->client();
+    if (!httpServerClient)
+        return 0;
+    return httpServerClient->socketBytesSent();
+}
+
+quint64 StreamClient::droppedPacketCount() const
+{
+    return _droppedPackets.value();
+}
+
+qint64 StreamClient::lagPackets() const
+{
+    if (!isTimeShifted())
+        return _queue.length();
+
+    const StreamServer *const server = parentServer();
+    const TS::TimeShiftRing *const ring = server ? server->timeShiftRing() : nullptr;
+    if (!ring)
+        return 0;
+    return ring->nextSeq() - _timeShiftSeq;
+}
+
+const stats::Histogram &StreamClient::latencyHistogram() const
+{
+    return _latencyHistogram;
+}
+
 bool StreamClient::tsStripAdditionalInfo() const
 {
     return _tsStripAdditionalInfo;
@@ -80,7 +149,7 @@ bool StreamClient::tsStripAdditionalInfo() const
 
 void StreamClient::setTSStripAdditionalInfo(bool strip)
 {
-    if (verbose >= 2)
+    if (SSCVN_VERBOSE(2))
         qInfo() << qPrintable(_logPrefix) << "Changing TS strip additional info from" << _tsStripAdditionalInfo << "to" << strip;
     _tsStripAdditionalInfo = strip;
 #ifdef TS_PACKET_V2
@@ -114,30 +183,40 @@ const TS::PacketV2Generator &StreamClient::tsGenerator() const
 #endif
 
 #ifndef TS_PACKET_V2
-void StreamClient::queuePacket(const TSPacket &packet)
+void StreamClient::queuePacket(const TSPacket &packet, qint64 ingestNanosecs)
 #else
-void StreamClient::queuePacket(const QSharedPointer<ConversionNode<TS::PacketV2>> &packetNode)
+void StreamClient::queuePacket(const QSharedPointer<ConversionNode<TS::PacketV2>> &packetNode, qint64 ingestNanosecs)
 #endif
 {
     if (!_forwardPackets) {
-        if (verbose >= 2)
+        if (SSCVN_VERBOSE(2))
             qDebug() << qPrintable(_logPrefix) << "Not queueing packet. Not set to forward packets (yet?)";
 
         return;
     }
 
-    if (verbose >= 2)
+    if (isTimeShifted()) {
+        // Packets will be taken from the time-shift ring, instead;
+        // just use the new input as a trigger to check for more data to send.
+        if (_httpServerContext && _httpServerContext->client())
+            _httpServerContext->client()->sendData();
+        return;
+    }
+
+    if (SSCVN_VERBOSE(2))
         qDebug() << qPrintable(_logPrefix) << "Queueing packet";
-    if (verbose >= 3)
+    if (SSCVN_VERBOSE(3))
         qDebug() << qPrintable(_logPrefix) << "Packet data:"
 #ifndef TS_PACKET_V2
                  << packet.bytes();
 
-    _queue.append(packet);
+    _queue.append({ packet, ingestNanosecs });
+    SSCVN_TRACE3(client_queue_push, _id, packet.PID(), _queue.length());
 #else
                  << packetNode->data;
 
-    _queue.append(packetNode);
+    _queue.append({ packetNode, ingestNanosecs });
+    SSCVN_TRACE3(client_queue_push, _id, packetNode->data.pid.value, _queue.length());
 #endif
 
     // Start sending data to the client, (again?).
@@ -158,22 +237,37 @@ bool StreamClient::handleGenerateResponseBody(QByteArray &buf)
     // Need to wrap entire function into try-catch block, as we might be called via Qt event loop, and Qt doesn't like / recover from exceptions.
     try {
 
+        if (isTimeShifted()) {
+            fillFromTimeShiftRing(buf);
+            return true;
+        }
+
+        StreamServer *const server = parentServer();
+        const qint64 nowNanosecs = clock::monotonicNanosecs();
+
         // Fill send buffer up to 1KiB.
         while (!_queue.isEmpty()) {
+            const QueueEntry &entry(_queue.front());
+            stats::StageTimer encodeTimer(profEncode);
 #ifndef TS_PACKET_V2
-            const TSPacket &packet(_queue.front());
+            const TSPacket &packet(entry.packet);
             const QByteArray bytes = _tsStripAdditionalInfo ?
                 packet.toBasicPacketBytes() :
                 packet.bytes();
+            encodeTimer.stop();
 #else
-            QSharedPointer<ConversionNode<TS::PacketV2>> packetNode = _queue.front();
+            QSharedPointer<ConversionNode<TS::PacketV2>> packetNode = entry.packetNode;
             QSharedPointer<ConversionNode<QByteArray>> bytesNode;
             QString errMsg;
-            if (!_tsGenerator.generate(packetNode, &bytesNode, &errMsg)) {
-                if (verbose >= 1)
+            const bool generated = _tsGenerator.generate(packetNode, &bytesNode, &errMsg);
+            encodeTimer.stop();
+            if (!generated) {
+                static log::RateLimiter generateErrorLimiter("client packet generation errors", 5, 1000, QtInfoMsg);
+                if (SSCVN_VERBOSE(1) && generateErrorLimiter.check(_logPrefix + " " + errMsg))
                     qInfo() << qPrintable(_logPrefix) << "Packet generation error, discarding packet:" << errMsg;
 
                 _queue.pop_front();
+                _droppedPackets.add();
                 continue;
             }
             const QByteArray &bytes(bytesNode->data);
@@ -181,19 +275,32 @@ bool StreamClient::handleGenerateResponseBody(QByteArray &buf)
             if (!(buf.length() + bytes.length() <= 1024))
                 break;
 
-            if (verbose >= 2)
+            if (SSCVN_VERBOSE(2))
                 qDebug() << qPrintable(_logPrefix) << "Filling send buffer with" << bytes.length() << "bytes";
-            if (verbose >= 3)
+            if (SSCVN_VERBOSE(3))
                 qDebug() << qPrintable(_logPrefix) << "Filling with data:" << bytes;
 
             buf.append(bytes);
+
+            // (The send buffer is written to the socket right after
+            // filling it, so this is close enough to the actual write.)
+            const quint64 latencyMicrosecs = static_cast<quint64>(
+                std::max(nowNanosecs - entry.ingestNanosecs, qint64(0)) / 1000);
+            _latencyHistogram.record(latencyMicrosecs);
+            if (server)
+                server->latencyHistogram().record(latencyMicrosecs);
+            SSCVN_TRACE3(client_queue_pop, _id, bytes.length(), latencyMicrosecs);
+
             _queue.pop_front();
         }
 
     // End of try block.
     }
     catch (const std::exception &ex) {
-        if (verbose >= 0) {
+        // (Shared by all clients; one broken client should not flood the log.)
+        static log::RateLimiter sendErrorLimiter("exceptions while sending data");
+        const bool doLog = sendErrorLimiter.check(_logPrefix + " " + ex.what());
+        if (SSCVN_VERBOSE(0) && doLog) {
             qWarning().nospace()
                 << qPrintable(_logPrefix) << " "
                 << "Sending data: Got exception: " << ex.what();
@@ -203,45 +310,197 @@ bool StreamClient::handleGenerateResponseBody(QByteArray &buf)
 
         // Let's try to drop the first packet. (So hopefully we won't loop on this forever.)
         if (!_queue.isEmpty()) {
-            if (verbose >= 1)
+            if (SSCVN_VERBOSE(1) && doLog)
                 qInfo() << qPrintable(_logPrefix) << "Sending data: Dropping one outgoing packet...";
             _queue.removeFirst();
+            _droppedPackets.add();
         }
     }
 
     return true;
 }
 
+bool StreamClient::startTimeShift(qint64 delayMillisec)
+{
+    const StreamServer *const server = parentServer();
+    const TS::TimeShiftRing *const ring = server ? server->timeShiftRing() : nullptr;
+    if (!ring)
+        return false;
+
+    // Start at the last random access point before the requested point in time,
+    // or the oldest one retained, if the ring doesn't reach back that far.
+    // (Pacing in fillFromTimeShiftRing() keeps up the requested delay either way.)
+    const qint64 targetMillisec = clock::monotonicMillisecs() - delayMillisec;
+    qint64 seq = ring->seekRandomAccess(targetMillisec);
+    if (seq < 0)
+        seq = ring->nextRandomAccess(ring->firstSeq());
+    if (seq < 0) {
+        if (SSCVN_VERBOSE(0))
+            qInfo() << qPrintable(_logPrefix) << "Time-shift: No random access point available, starting without";
+        seq = std::max(ring->firstSeq(), ring->seqLimitForTime(targetMillisec));
+    }
+
+    _timeShiftDelayMillisec = delayMillisec;
+    _timeShiftSeq = seq;
+
+    if (SSCVN_VERBOSE(0))
+        qInfo() << qPrintable(_logPrefix) << "Time-shift: Starting with a delay of"
+                << qPrintable(HumanReadable::timeDuration(delayMillisec))
+                << "at packet" << _timeShiftSeq << "of"
+                << ring->firstSeq() << "to" << ring->nextSeq();
+    return true;
+}
+
+void StreamClient::fillFromTimeShiftRing(QByteArray &buf)
+{
+    const StreamServer *const server = parentServer();
+    const TS::TimeShiftRing *const ring = server ? server->timeShiftRing() : nullptr;
+    if (!ring)
+        throw std::runtime_error("StreamClient fill from time-shift ring: Ring missing");
+
+    const qint64 firstSeq = ring->firstSeq();
+    if (_timeShiftSeq < firstSeq) {
+        // Fell behind so far that the ring has overwritten our position already.
+        qint64 seq = ring->nextRandomAccess(firstSeq);
+        if (seq < 0)
+            seq = firstSeq;
+        if (SSCVN_VERBOSE(0))
+            qInfo() << qPrintable(_logPrefix) << "Time-shift: Overrun by input, skipping"
+                    << (seq - _timeShiftSeq) << "packets";
+        _droppedPackets.add(static_cast<quint64>(seq - _timeShiftSeq));
+        _timeShiftSeq = seq;
+    }
+
+    // Only hand out what has been in the ring for at least the requested delay.
+    const qint64 limitSeq = ring->seqLimitForTime(clock::monotonicMillisecs() - _timeShiftDelayMillisec);
+    const qint64 available = limitSeq - _timeShiftSeq;
+    const int room = (1024 - buf.length()) / TS::PacketView::sizeBasic;
+    if (available <= 0 || room <= 0)
+        return;
+
+    const int count = ring->copyPackets(_timeShiftSeq, static_cast<int>(std::min<qint64>(room, available)), &buf);
+    if (count > 0) {
+        if (SSCVN_VERBOSE(2))
+            qDebug() << qPrintable(_logPrefix) << "Filling send buffer with" << count << "packets from time-shift ring";
+        _timeShiftSeq += count;
+    }
+}
+
 void StreamClient::handleHTTPServerContextDestroyed(QObject *obj)
 {
     if (!obj)
         return;
 
+    SSCVN_TRACE3(client_disconnect, _id, _latencyHistogram.count(), _droppedPackets.value());
+
+    if (SSCVN_VERBOSE(0) && _latencyHistogram.count() > 0)
+        qInfo() << qPrintable(_logPrefix) << "Ingest-to-wire latency:" << qPrintable(latencySummary(_latencyHistogram));
+
     _queue.clear();
+    _streamFilterPtr.reset();
     deleteLater();
 }
 
 void StreamClient::processRequest(HTTP::ServerContext *ctx)
 {
-    // TODO: Trust path matching done in HTTP::Server when that has been implemented!
-    const QByteArray &path(ctx->request().path());
-    if (!(path == "/" || path == "/stream.m2ts" || path == "/live.m2ts")) {
-        if (verbose >= 0)
-            qInfo() << qPrintable(_logPrefix) << "Path not found:" << path;
-        ctx->setResponseError(HTTP::SC_404_NotFound, "Path not found.\n");
+    // Time-shifted playback requested? (E.g., "/live.m2ts?delay=30s".)
+    const QUrlQuery query(QString::fromLatin1(ctx->request().urlQuery()));
+    QString delayStr = query.queryItemValue("delay");
+    if (delayStr.isEmpty())
+        delayStr = query.queryItemValue("offset");
+    if (!delayStr.isEmpty()) {
+        bool ok = false;
+        const qint64 delayMillisec = HumanReadable::timeDurationToMsec(delayStr, &ok);
+        if (!ok) {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(_logPrefix) << "Invalid time-shift delay:" << delayStr;
+            ctx->setResponseError(HTTP::SC_400_BadRequest, "Invalid delay.\n");
+            return;
+        }
+        // The ring only keeps basic packets, so a client wanting its
+        // additional info can't be served from there.
+        const StreamServer *const server = parentServer();
+        if (delayMillisec > 0 && !_tsStripAdditionalInfo &&
+            !(server && server->tsPacketSize() == TS::PacketView::sizeBasic))
+        {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(_logPrefix) << "Time-shift requested, but additional info isn't stripped";
+            ctx->setResponseError(HTTP::SC_400_BadRequest,
+                                  "Delay only available with basic 188-byte packets (strip additional info).\n");
+            return;
+        }
+        if (delayMillisec > 0 && !startTimeShift(delayMillisec)) {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(_logPrefix) << "Time-shift requested, but not available";
+            ctx->setResponseError(HTTP::SC_404_NotFound, "Time-shift not available.\n");
+            return;
+        }
+    }
+
+    // Only some of the elementary streams? (E.g., "/live.m2ts?streams=audio".)
+    StreamFilter::Spec filterSpec;
+    QString filterErrMsg;
+    if (!StreamFilter::Spec::fromQuery(query, &filterSpec, &filterErrMsg)) {
+        if (SSCVN_VERBOSE(0))
+            qInfo() << qPrintable(_logPrefix) << "Invalid stream filter:" << qPrintable(filterErrMsg);
+        ctx->setResponseError(HTTP::SC_400_BadRequest, "Invalid stream filter: " + filterErrMsg.toUtf8() + "\n");
         return;
     }
+    // (Without the query, which the router didn't match on, either.)
+    const QByteArray &path(ctx->request().urlPath());
+    if (path.startsWith(programPathPrefix)) {
+        const QByteArray suffix = ".m2ts";
+        const QByteArray name = path.mid(programPathPrefix.length());
+        bool ok = false;
+        const uint programNumber = name.endsWith(suffix) ? name.left(name.length() - suffix.length()).toUInt(&ok) : 0;
+        if (!ok || programNumber == 0 || programNumber > 0xffff ||
+            (filterSpec.programNumber >= 0 && filterSpec.programNumber != static_cast<int>(programNumber)))
+        {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(_logPrefix) << "Invalid program path:" << path;
+            ctx->setResponseError(HTTP::SC_404_NotFound, "No such program.\n");
+            return;
+        }
+        filterSpec.programNumber = static_cast<int>(programNumber);
+    }
+    if (filterSpec.programNumber >= 0) {
+        // (If the PAT isn't known yet, the program may still show up.)
+        const StreamServer *const server = parentServer();
+        const TS::PSIDemux *const psi = server ? &server->psiDemux() : nullptr;
+        if (psi && psi->patVersion() >= 0 && !psi->program(static_cast<quint16>(filterSpec.programNumber))) {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(_logPrefix) << "Program" << filterSpec.programNumber << "not in input";
+            ctx->setResponseError(HTTP::SC_404_NotFound, "No such program.\n");
+            return;
+        }
+    }
+    if (!filterSpec.isEmpty()) {
+        if (isTimeShifted()) {
+            if (SSCVN_VERBOSE(0))
+                qInfo() << qPrintable(_logPrefix) << "Stream filter requested together with time-shift, which isn't supported";
+            ctx->setResponseError(HTTP::SC_400_BadRequest, "Stream filters are not supported with time-shift.\n");
+            return;
+        }
+        StreamServer *const server = parentServer();
+        if (!server) {
+            ctx->setResponseError(HTTP::SC_500_InternalServerError, "Stream filter not available.\n");
+            return;
+        }
+        _streamFilterPtr = server->streamFilter(filterSpec);
+        if (SSCVN_VERBOSE(-1))
+            qInfo() << qPrintable(_logPrefix) << "Filtering stream:" << qPrintable(filterSpec.toString());
+    }
 
     QScopedPointer<HTTP::Response> response_ptr(new HTTP::Response(HTTP::SC_200_OK, "OK"));
     response_ptr->setHeader("Content-Type", "video/mp2t");
     ctx->setResponse(response_ptr.take());
 
     if (ctx->request().method() == "HEAD") {
-        if (verbose >= -1)
+        if (SSCVN_VERBOSE(-1))
             qInfo() << qPrintable(_logPrefix) << "Request OK, HEAD only";
     }
     else {
-        if (verbose >= -1)
+        if (SSCVN_VERBOSE(-1))
             qInfo() << qPrintable(_logPrefix) << "Request OK, start forwarding TS packets";
         _forwardPackets = true;
         connect(ctx, &HTTP::ServerContext::generateResponseBody, this, &StreamClient::handleGenerateResponseBody);
@@ -255,7 +514,7 @@ void StreamClient::close()
     //       and ensure that all proper requests
     //       receive a proper response...
 
-    if (verbose >= 0)
+    if (SSCVN_VERBOSE(0))
         qInfo() << qPrintable(_logPrefix) << "Checking for close down. (programmatic request)";
     if (!_httpServerContext)
         return;
@@ -263,7 +522,7 @@ void StreamClient::close()
     if (!client)
         return;
 
-    if (verbose >= 0)
+    if (SSCVN_VERBOSE(0))
         qInfo() << qPrintable(_logPrefix) << "Closing down our remaining client... (programmatic request)";
     client->close();
 }
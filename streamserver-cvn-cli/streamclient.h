@@ -9,8 +9,12 @@
 #include <QDateTime>
 #include <QString>
 #include <QElapsedTimer>
+#include <QSharedPointer>
 
+#include "statscounter.h"
+#include "histogram.h"
 #include "http/httpserver.h"
+#include "streamfilter.h"
 
 #ifndef TS_PACKET_V2
 #include "tspacket.h"
@@ -27,6 +31,12 @@ class StreamClient : public QObject
 {
     Q_OBJECT
 
+public:
+    // Serves a single program of the input, as "/program/<n>.m2ts".
+    static const QByteArray programPathPrefix;
+
+private:
+
     quint64                      _id;
     QString                      _logPrefix;
     QDateTime                    _createdTimestamp;
@@ -34,12 +44,23 @@ class StreamClient : public QObject
     QPointer<HTTP::ServerContext>  _httpServerContext;
     bool                         _forwardPackets = false;
     bool                         _tsStripAdditionalInfo = true;
+    qint64                       _timeShiftDelayMillisec = 0;  // (0: live)
+    qint64                       _timeShiftSeq = 0;
+    QSharedPointer<StreamFilter>  _streamFilterPtr;
+    stats::Counter               _droppedPackets;
+    stats::Histogram             _latencyHistogram;  // Microseconds.
+    struct QueueEntry {
 #ifndef TS_PACKET_V2
-    QList<TSPacket>              _queue;
+        TSPacket  packet;
 #else
+        QSharedPointer<ConversionNode<TS::PacketV2>>  packetNode;
+#endif
+        qint64    ingestNanosecs;  // Monotonic clock, when read from input.
+    };
+#ifdef TS_PACKET_V2
     TS::PacketV2Generator        _tsGenerator;
-    QList<QSharedPointer<ConversionNode<TS::PacketV2>>>  _queue;
 #endif
+    QList<QueueEntry>            _queue;
 
 public:
     explicit StreamClient(HTTP::ServerContext *httpServerContext, quint64 id = 0, QObject *parent = 0);
@@ -53,6 +74,21 @@ public:
     HTTP::ServerContext *httpServerContext() const;
 
     bool isForwardingPackets() const;
+    bool isTimeShifted() const;
+    qint64 timeShiftDelayMillisec() const;
+    // Null if the client gets the whole stream.
+    StreamFilter *streamFilter() const;
+
+    // Statistics
+    int queueLength() const;
+    quint64 bytesSent() const;
+    quint64 droppedPacketCount() const;
+    // How many packets the client is behind the input.
+    qint64 lagPackets() const;
+    // Time from reading a packet from the input until handing it
+    // to the client's socket, in microseconds. (Live playback only.)
+    const stats::Histogram &latencyHistogram() const;
+
     bool tsStripAdditionalInfo() const;
     void setTSStripAdditionalInfo(bool strip);
 #ifdef TS_PACKET_V2
@@ -61,11 +97,15 @@ public:
 #endif
 
 #ifndef TS_PACKET_V2
-    void queuePacket(const TSPacket &packet);
+    void queuePacket(const TSPacket &packet, qint64 ingestNanosecs);
 #else
-    void queuePacket(const QSharedPointer<ConversionNode<TS::PacketV2>> &packetNode);
+    void queuePacket(const QSharedPointer<ConversionNode<TS::PacketV2>> &packetNode, qint64 ingestNanosecs);
 #endif
 
+private:
+    bool startTimeShift(qint64 delayMillisec);
+    void fillFromTimeShiftRing(QByteArray &buf);
+
 signals:
 
 private slots:
@@ -0,0 +1,392 @@
+#include "streamfilter.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <QDebug>
+#include <QMap>
+#include <QStringList>
+
+#include "log.h"
+#include "lograte.h"
+#include "tscrc32.h"
+#include "tspacketview.h"
+#include "tspsi.h"
+
+using SSCvn::log::verbose;
+
+namespace SSCvn {
+
+
+/*
+ * StreamFilter::Spec
+ */
+
+QString StreamFilter::Spec::toString() const
+{
+    QStringList parts;
+
+    if (programNumber >= 0)
+        parts.append("program=" + QString::number(programNumber));
+
+    QStringList kinds;
+    if (video)
+        kinds.append("video");
+    if (audio)
+        kinds.append("audio");
+    if (other)
+        kinds.append("other");
+    if (!kinds.isEmpty())
+        parts.append("streams=" + kinds.join(','));
+
+    if (!pids.isEmpty()) {
+        QList<quint16> sortedPIDs = pids.toList();
+        std::sort(sortedPIDs.begin(), sortedPIDs.end());
+        QStringList pidStrings;
+        for (const quint16 pid : sortedPIDs)
+            pidStrings.append("0x" + QString::number(pid, 16).rightJustified(4, '0'));
+        parts.append("pids=" + pidStrings.join(','));
+    }
+
+    return parts.join('&');
+}
+
+bool StreamFilter::Spec::fromQuery(const QUrlQuery &query, Spec *spec, QString *errorMessage)
+{
+    if (!spec)
+        throw std::invalid_argument("Stream filter spec from query: Spec can't be null");
+
+    Spec result;
+
+    const QString programStr = query.queryItemValue("program");
+    if (!programStr.isEmpty()) {
+        bool ok = false;
+        const uint programNumber = programStr.toUInt(&ok);
+        // (Program number 0 is reserved for the network PID.)
+        if (!ok || programNumber == 0 || programNumber > 0xffff) {
+            if (errorMessage)
+                *errorMessage = "Invalid program number \"" + programStr + "\"";
+            return false;
+        }
+        result.programNumber = static_cast<int>(programNumber);
+    }
+
+    const QString streamsStr = query.queryItemValue("streams");
+    if (!streamsStr.isEmpty()) {
+        for (const QString &kind : streamsStr.split(',', QString::SkipEmptyParts)) {
+            if (kind == "video")
+                result.video = true;
+            else if (kind == "audio")
+                result.audio = true;
+            else if (kind == "other")
+                result.other = true;
+            else {
+                if (errorMessage)
+                    *errorMessage = "Invalid stream kind \"" + kind + "\", expected video, audio or other";
+                return false;
+            }
+        }
+    }
+
+    const QString pidsStr = query.queryItemValue("pids");
+    if (!pidsStr.isEmpty()) {
+        for (const QString &pidStr : pidsStr.split(',', QString::SkipEmptyParts)) {
+            bool ok = false;
+            // (Base 0: Accepts decimal, and hexadecimal with "0x" prefix.)
+            const uint pid = pidStr.toUInt(&ok, 0);
+            if (!ok || pid >= 0x1fff) {
+                if (errorMessage)
+                    *errorMessage = "Invalid PID \"" + pidStr + "\"";
+                return false;
+            }
+            result.pids.insert(static_cast<quint16>(pid));
+        }
+    }
+
+    *spec = result;
+    return true;
+}
+
+
+/*
+ * StreamFilter
+ */
+
+StreamFilter::StreamFilter(const Spec &spec) :
+    _spec(spec)
+{
+    _pidActions.fill(Action::Drop);
+}
+
+const StreamFilter::Spec &StreamFilter::spec() const
+{
+    return _spec;
+}
+
+StreamFilter::Action StreamFilter::pidAction(quint16 pid) const
+{
+    return pid < _pidActions.size() ? _pidActions[pid] : Action::Drop;
+}
+
+quint64 StreamFilter::passedCount() const
+{
+    return _passedCount;
+}
+
+quint64 StreamFilter::droppedCount() const
+{
+    return _droppedCount;
+}
+
+QByteArray StreamFilter::makeSection(quint16 pid, quint8 tableId, quint16 tableIdExtension, const QByteArray &body)
+{
+    // Keep the version as long as the content stays the same.
+    const quint32 key = static_cast<quint32>(pid) << 16 | tableIdExtension;
+    int version = _psiVersions.value(key, -1);
+    if (version < 0 || _psiBodies.value(key) != body) {
+        version = (version + 1) & 0x1f;
+        _psiVersions.insert(key, version);
+        _psiBodies.insert(key, body);
+    }
+
+    const int sectionLength = 5 + body.length() + 4;
+    QByteArray section;
+    section.reserve(3 + sectionLength);
+    section.append(static_cast<char>(tableId));
+    section.append(static_cast<char>(0xb0 | ((sectionLength >> 8) & 0x0f)));
+    section.append(static_cast<char>(sectionLength & 0xff));
+    section.append(static_cast<char>(tableIdExtension >> 8));
+    section.append(static_cast<char>(tableIdExtension & 0xff));
+    section.append(static_cast<char>(0xc1 | (version << 1)));  // current_next_indicator set
+    section.append('\x00');  // section_number
+    section.append('\x00');  // last_section_number
+    section.append(body);
+
+    const quint32 crc = TS::crc32Mpeg2(section);
+    section.append(static_cast<char>(crc >> 24));
+    section.append(static_cast<char>(crc >> 16));
+    section.append(static_cast<char>(crc >>  8));
+    section.append(static_cast<char>(crc));
+    return section;
+}
+
+QList<QByteArray> StreamFilter::packetize(quint16 pid, const QByteArray &sections)
+{
+    QList<QByteArray> packets;
+    int pos = 0;
+    bool first = true;
+    do {
+        QByteArray packet;
+        packet.reserve(TS::PacketView::sizeBasic);
+        packet.append(static_cast<char>(TS::PacketView::syncByteFixedValue));
+        packet.append(static_cast<char>((first ? 0x40 : 0x00) | ((pid >> 8) & 0x1f)));
+        packet.append(static_cast<char>(pid & 0xff));
+        packet.append('\x10');  // Payload only; continuity counter gets set on output.
+        if (first)
+            packet.append('\x00');  // pointer_field
+        const QByteArray chunk = sections.mid(pos, TS::PacketView::sizeBasic - packet.length());
+        packet.append(chunk);
+        pos += chunk.length();
+        packet.append(QByteArray(TS::PacketView::sizeBasic - packet.length(), '\xff'));
+        packets.append(packet);
+        first = false;
+    } while (pos < sections.length());
+    return packets;
+}
+
+void StreamFilter::update(const TS::PSIDemux &psi)
+{
+    _pidActions.fill(Action::Drop);
+    _psiPackets.clear();
+
+    // Other PSI/SI tables (CAT, NIT, SDT, EIT, ...) are small,
+    // and help players present the stream.
+    for (quint16 pid = 0x0001; pid < 0x0020; pid++)
+        _pidActions[pid] = Action::Pass;
+    for (const quint16 pid : _spec.pids)
+        _pidActions[pid] = Action::Pass;
+
+    if (psi.patVersion() < 0)
+        return;
+
+    QByteArray patBody;
+    if (psi.networkPID() != 0x1fff && _spec.programNumber < 0) {
+        patBody.append('\x00');
+        patBody.append('\x00');
+        patBody.append(static_cast<char>(0xe0 | (psi.networkPID() >> 8)));
+        patBody.append(static_cast<char>(psi.networkPID() & 0xff));
+    }
+
+    // (Programs may share a PMT PID.)
+    QMap<quint16, QByteArray> pmtSections;
+    QList<quint16> pcrPIDs;
+    for (const TS::ProgramInfo &program : psi.programs()) {
+        if (_spec.programNumber >= 0 && program.programNumber != _spec.programNumber)
+            continue;
+        // Can't tell what to keep, yet.
+        if (!program.hasPMT())
+            continue;
+
+        QByteArray esLoop;
+        for (const TS::ElementaryStreamInfo &stream : program.streams) {
+            bool selected = _spec.selectsAllStreams() || _spec.pids.contains(stream.pid);
+            switch (stream.kind()) {
+            case TS::ElementaryStreamInfo::Kind::Video:
+                selected = selected || _spec.video;
+                break;
+            case TS::ElementaryStreamInfo::Kind::Audio:
+                selected = selected || _spec.audio;
+                break;
+            case TS::ElementaryStreamInfo::Kind::Other:
+                selected = selected || _spec.other;
+                break;
+            }
+            if (!selected)
+                continue;
+
+            _pidActions[stream.pid] = Action::Pass;
+            esLoop.append(static_cast<char>(stream.streamType));
+            esLoop.append(static_cast<char>(0xe0 | (stream.pid >> 8)));
+            esLoop.append(static_cast<char>(stream.pid & 0xff));
+            esLoop.append(static_cast<char>(0xf0 | ((stream.descriptors.length() >> 8) & 0x0f)));
+            esLoop.append(static_cast<char>(stream.descriptors.length() & 0xff));
+            esLoop.append(stream.descriptors);
+        }
+        // Nothing left of this program.
+        if (esLoop.isEmpty())
+            continue;
+
+        QByteArray pmtBody;
+        pmtBody.append(static_cast<char>(0xe0 | (program.pcrPID >> 8)));
+        pmtBody.append(static_cast<char>(program.pcrPID & 0xff));
+        pmtBody.append(static_cast<char>(0xf0 | ((program.descriptors.length() >> 8) & 0x0f)));
+        pmtBody.append(static_cast<char>(program.descriptors.length() & 0xff));
+        pmtBody.append(program.descriptors);
+        pmtBody.append(esLoop);
+        pmtSections[program.pmtPID].append(makeSection(program.pmtPID, 0x02, program.programNumber, pmtBody));
+        pcrPIDs.append(program.pcrPID);
+
+        patBody.append(static_cast<char>(program.programNumber >> 8));
+        patBody.append(static_cast<char>(program.programNumber & 0xff));
+        patBody.append(static_cast<char>(0xe0 | (program.pmtPID >> 8)));
+        patBody.append(static_cast<char>(program.pmtPID & 0xff));
+    }
+
+    for (const quint16 pid : pcrPIDs) {
+        if (pid < 0x1fff && _pidActions[pid] == Action::Drop)
+            _pidActions[pid] = Action::PCROnly;
+    }
+    for (auto it = pmtSections.constBegin(); it != pmtSections.constEnd(); ++it) {
+        _pidActions[it.key()] = Action::ReplacePSI;
+        _psiPackets.insert(it.key(), packetize(it.key(), it.value()));
+    }
+
+    _pidActions[pidPAT] = Action::ReplacePSI;
+    _psiPackets.insert(pidPAT, packetize(pidPAT, makeSection(pidPAT, 0x00, psi.transportStreamId(), patBody)));
+
+    if (SSCVN_VERBOSE(1)) {
+        qInfo().nospace() << "Stream filter " << qPrintable(_spec.toString()) << ": Updated for PAT version "
+                          << psi.patVersion() << ", keeping " << pmtSections.size() << " PMT PID(s)";
+    }
+}
+
+StreamFilter::Result StreamFilter::processPacket(const QByteArray &packetBytes)
+{
+    _replacementPackets.clear();
+
+    if (packetBytes.length() < TS::PacketView::sizeBasic) {
+        _droppedCount++;
+        return _lastResult = Result::Drop;
+    }
+    // (A 192-byte packet has a time code prefix, 204/208-byte ones have parity bytes as suffix.)
+    const int basicOffset = TS::PacketView::basicOffsetForPacketSize(packetBytes.length());
+    const QByteArray prefix = packetBytes.left(basicOffset);
+    const QByteArray suffix = packetBytes.mid(basicOffset + TS::PacketView::sizeBasic);
+    const TS::PacketView view(packetBytes.constData() + basicOffset);
+    // (Let the clients' usual handling deal with broken packets.)
+    if (!view.isSyncByteValid()) {
+        _passedCount++;
+        return _lastResult = Result::Pass;
+    }
+
+    const quint16 pid = view.pid();
+    switch (_pidActions[pid]) {
+    case Action::Drop:
+        break;
+    case Action::Pass:
+        _passedCount++;
+        return _lastResult = Result::Pass;
+    case Action::PCROnly:
+        if (view.hasPCR()) {
+            // Adaptation field only, with nothing but the PCR.
+            QByteArray basicBytes(TS::PacketView::sizeBasic, '\xff');
+            const quint8 *const data = view.data();
+            basicBytes[0] = static_cast<char>(TS::PacketView::syncByteFixedValue);
+            basicBytes[1] = static_cast<char>(data[1] & 0x1f);
+            basicBytes[2] = static_cast<char>(data[2]);
+            // (The continuity counter doesn't advance without payload.)
+            basicBytes[3] = static_cast<char>(0x20 | _continuityCounters.value(pid, 0));
+            basicBytes[4] = static_cast<char>(TS::PacketView::sizeBasic - 5);
+            basicBytes[5] = static_cast<char>(data[5] & 0x90);  // discontinuity_indicator, PCR_flag
+            for (int i = 6; i < 12; i++)
+                basicBytes[i] = static_cast<char>(data[i]);
+            appendReplacementPacket(prefix, basicBytes, suffix);
+        }
+        break;
+    case Action::ReplacePSI:
+        // Send the rewritten table(s) once for every original one.
+        if (view.payloadUnitStartIndicator()) {
+            quint8 &cc(_continuityCounters[pid]);
+            for (QByteArray basicBytes : _psiPackets.value(pid)) {
+                basicBytes[3] = static_cast<char>(0x10 | cc);
+                cc = (cc + 1) & 0x0f;
+                appendReplacementPacket(prefix, basicBytes, suffix);
+            }
+        }
+        break;
+    }
+
+    if (_replacementPackets.isEmpty()) {
+        _droppedCount++;
+        return _lastResult = Result::Drop;
+    }
+    _passedCount += static_cast<quint64>(_replacementPackets.length());
+    return _lastResult = Result::Replace;
+}
+
+StreamFilter::Result StreamFilter::lastResult() const
+{
+    return _lastResult;
+}
+
+void StreamFilter::appendReplacementPacket(const QByteArray &prefix, const QByteArray &basicBytes, const QByteArray &suffix)
+{
+#ifndef TS_PACKET_V2
+    _replacementPackets.append(TSPacket(prefix + basicBytes + suffix));
+#else
+    // (PacketV2 only knows about a prefix; the suffix can't be carried along.)
+    Q_UNUSED(suffix)
+    auto bytesNode = QSharedPointer<ConversionNode<QByteArray>>::create(prefix + basicBytes);
+    QSharedPointer<ConversionNode<TS::PacketV2>> packetNode;
+    QString errMsg;
+    _parser.setPrefixLength(prefix.length());
+    if (!_parser.parse(bytesNode, &packetNode, &errMsg) || !packetNode) {
+        static log::RateLimiter parseErrorLimiter("stream filter replacement packet errors");
+        if (SSCVN_VERBOSE(0) && parseErrorLimiter.check(errMsg))
+            qWarning() << "Stream filter: Can't parse replacement packet:" << qPrintable(errMsg);
+        return;
+    }
+    _replacementPackets.append(packetNode);
+#endif
+}
+
+#ifndef TS_PACKET_V2
+const QList<TSPacket> &StreamFilter::replacementPackets() const
+#else
+const QList<QSharedPointer<ConversionNode<TS::PacketV2>>> &StreamFilter::replacementPackets() const
+#endif
+{
+    return _replacementPackets;
+}
+
+
+}  // namespace SSCvn
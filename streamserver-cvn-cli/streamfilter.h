@@ -0,0 +1,124 @@
+#ifndef STREAMFILTER_H
+#define STREAMFILTER_H
+
+#include <array>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QUrlQuery>
+
+#include "conversionstore.h"
+#ifndef TS_PACKET_V2
+#include "tspacket.h"
+#else
+#include "tspacketv2.h"
+#endif
+
+namespace TS {
+class PSIDemux;
+}
+
+namespace SSCvn {
+
+
+// Reduces the ingested TS to a subset of its programs and elementary
+// streams for clients that don't want all of them (e.g., one program
+// of a multi-program input at "/program/<n>.m2ts", or "?streams=audio"):
+// Packets of unwanted PIDs are dropped, PAT and PMTs are replaced by
+// rewritten ones listing only what's left, and where the PCR PID got
+// dropped, just its PCRs are passed on, in adaptation-field-only packets.
+//
+// One instance is shared by all clients with the same filter, so each
+// input packet is looked at (and rewritten PSI is built) only once per
+// distinct filter; see StreamServer::streamFilter().
+class StreamFilter
+{
+public:
+    struct Spec {
+        // Only this program (gets a single-program PAT); -1 for all.
+        int   programNumber = -1;
+        // Elementary streams to keep; all, if none are given.
+        bool  video = false;
+        bool  audio = false;
+        bool  other = false;
+        QSet<quint16>  pids;
+
+        bool selectsAllStreams() const { return !video && !audio && !other && pids.isEmpty(); }
+        bool isEmpty() const { return programNumber < 0 && selectsAllStreams(); }
+        // Canonical form, e.g. "program=2&streams=audio&pids=0x0100,0x0101".
+        QString toString() const;
+
+        // From "program=2", "streams=video,audio" and/or "pids=0x100,257";
+        // returns false (and sets errorMessage) on invalid values.
+        static bool fromQuery(const QUrlQuery &query, Spec *spec, QString *errorMessage);
+    };
+
+    enum class Action : quint8 {
+        Drop,
+        Pass,
+        PCROnly,
+        ReplacePSI,
+    };
+
+    enum class Result {
+        Drop,
+        Pass,
+        Replace,  // See replacementPackets().
+    };
+
+    static constexpr quint16 pidPAT = 0x0000;
+
+private:
+    Spec    _spec;
+    std::array<Action, 8192>  _pidActions;
+    // Rewritten PAT/PMT, as basic packets with continuity counter 0.
+    QHash<quint16, QList<QByteArray>>  _psiPackets;
+    // Last generated section bodies and versions, by PID and table_id_extension,
+    // to bump the version on change.
+    QHash<quint32, QByteArray>  _psiBodies;
+    QHash<quint32, int>         _psiVersions;
+    QHash<quint16, quint8>      _continuityCounters;
+    Result  _lastResult = Result::Pass;
+#ifndef TS_PACKET_V2
+    QList<TSPacket>             _replacementPackets;
+#else
+    TS::PacketV2Parser          _parser;
+    QList<QSharedPointer<ConversionNode<TS::PacketV2>>>  _replacementPackets;
+#endif
+    quint64  _passedCount = 0;
+    quint64  _droppedCount = 0;
+
+public:
+    explicit StreamFilter(const Spec &spec);
+
+    const Spec &spec() const;
+    Action pidAction(quint16 pid) const;
+    quint64 passedCount() const;
+    quint64 droppedCount() const;
+
+    // Recomputes which PIDs to pass, and the rewritten PAT/PMTs.
+    // Call whenever the PSI changed.
+    void update(const TS::PSIDemux &psi);
+
+    // Decides about one input packet (including prefix or suffix, if any).
+    // For Result::Replace, replacementPackets() is valid until the next call.
+    Result processPacket(const QByteArray &packetBytes);
+    Result lastResult() const;
+#ifndef TS_PACKET_V2
+    const QList<TSPacket> &replacementPackets() const;
+#else
+    const QList<QSharedPointer<ConversionNode<TS::PacketV2>>> &replacementPackets() const;
+#endif
+
+private:
+    QByteArray makeSection(quint16 pid, quint8 tableId, quint16 tableIdExtension, const QByteArray &body);
+    static QList<QByteArray> packetize(quint16 pid, const QByteArray &sections);
+    void appendReplacementPacket(const QByteArray &prefix, const QByteArray &basicBytes, const QByteArray &suffix);
+};
+
+
+}  // namespace SSCvn
+
+#endif // STREAMFILTER_H
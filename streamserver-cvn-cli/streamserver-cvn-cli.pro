@@ -10,20 +10,30 @@ TEMPLATE = app
 SOURCES += main.cpp \
     streamserver.cpp \
     streamclient.cpp \
+    hlssegmenter.cpp \
+    serverstats.cpp \
+    inputcapture.cpp \
+    streamfilter.cpp \
     http/httputil.cpp \
     http/httpheader_netside.cpp \
     http/httprequest_netside.cpp \
     http/httpresponse.cpp \
-    http/httpserver.cpp
+    http/httpserver.cpp \
+    http/httprouter.cpp
 
 HEADERS += \
     streamserver.h \
     streamclient.h \
+    hlssegmenter.h \
+    serverstats.h \
+    inputcapture.h \
+    streamfilter.h \
     http/httputil.h \
     http/httpheader_netside.h \
     http/httprequest_netside.h \
     http/httpresponse.h \
-    http/httpserver.h
+    http/httpserver.h \
+    http/httprouter.h
 
 include(../config.pri)
 
@@ -7,7 +7,10 @@
 
 #include <stdexcept>
 #include <system_error>
+#include <algorithm>
 #include <functional>
+#include <cstdlib>
+#include <limits>
 #include <QDebug>
 #include <QCoreApplication>
 #include <QTcpServer>
@@ -15,17 +18,29 @@
 // (Note: As of 2019-04-17, we need both old and new packet defined...)
 #include "tspacket.h"
 #include "tspacketv2.h"
+#include "tspacketview.h"
 #include "humanreadable.h"
 #include "log.h"
+#include "lograte.h"
+#include "monotonicclock.h"
+#include "stageprofiler.h"
+#include "tracepoints.h"
 #include "http/httprequest_netside.h"
 
 namespace SSCvn {
 
-using log::verbose;
-
 
 namespace {
 
+stats::ProfileStage profInputRead("input read");
+stats::ProfileStage profAutodetect("autodetect/resync");
+stats::ProfileStage profParse("parse");
+stats::ProfileStage profPSI("PSI");
+stats::ProfileStage profAnalyze("analyze");
+stats::ProfileStage profBrake("brake");
+stats::ProfileStage profEncodeBasic("encode basic");
+stats::ProfileStage profFanOut("fan-out");
+
 double timenow()
 {
     double now;
@@ -83,7 +98,7 @@ void StreamHandler::handleRequest(HTTP::ServerContext *ctx)
 
     auto client_ptr = d->_streamServer->client(ctx);
     if (!client_ptr) {
-        if (verbose >= -1)
+        if (SSCVN_VERBOSE(-1))
             qCritical() << qPrintable(name() + ":") << "StreamServer returned no stream client";
         return;
     }
@@ -100,16 +115,64 @@ StreamServer::StreamServer(std::unique_ptr<QFile> inputFilePtr, HTTP::Server *ht
     QObject(parent),
     _httpServer(httpServer),
     _httpServerHandler(new StreamHandler(this)),
-    _inputFilePtr(std::move(inputFilePtr))
+    _inputFilePtr(std::move(inputFilePtr)),
+    _pidAnalyzerPtr(std::make_unique<TS::PIDAnalyzer>())
 {
     if (!_httpServer)
         throw std::runtime_error("StreamServer ctor: HTTP server must not be null");
 
+    _uptimeElapsed.start();
+
     // (This is required (at least) for clean & timely exit.)
     connect(httpServer, &HTTP::Server::clientDestroyed, this, &StreamServer::handleHTTPServerClientDestroyed);
 
-    // TODO: Be more specific.
-    _httpServer->setDefaultHandler(_httpServerHandler);
+    _httpServer->addRoute("/",           _httpServerHandler);
+    _httpServer->addRoute("/stream.m2ts", _httpServerHandler);
+    _httpServer->addRoute("/live.m2ts",   _httpServerHandler);
+    _httpServer->addRoute(StreamClient::programPathPrefix, _httpServerHandler, HTTP::Router::MatchKind::Prefix);
+
+    _inputReplayTimer.setSingleShot(true);
+    _inputReplayTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_inputReplayTimer, &QTimer::timeout, this, &StreamServer::processReplayInput);
+
+    connect(&_psiDemux, &TS::PSIDemux::patChanged, this, [this]() {
+        if (SSCVN_VERBOSE(0)) {
+            qInfo().nospace() << "PAT version " << _psiDemux.patVersion()
+                              << ", transport stream ID " << _psiDemux.transportStreamId()
+                              << ": " << _psiDemux.programs().length() << " program(s)";
+        }
+        if (SSCVN_VERBOSE(1)) {
+            for (const TS::ProgramInfo &program : _psiDemux.programs()) {
+                qInfo().nospace() << "Program " << program.programNumber << " available at "
+                                  << StreamClient::programPathPrefix.constData() << program.programNumber << ".m2ts";
+            }
+        }
+    });
+    connect(&_psiDemux, &TS::PSIDemux::pmtChanged, this, [this](quint16 programNumber) {
+        const TS::ProgramInfo *programPtr = _psiDemux.program(programNumber);
+        if (SSCVN_VERBOSE(0) && programPtr)
+            qInfo() << "PMT changed:" << *programPtr;
+    });
+    connect(&_psiDemux, &TS::PSIDemux::programRemoved, this, [](quint16 programNumber) {
+        if (SSCVN_VERBOSE(0))
+            qInfo() << "Program" << programNumber << "removed from PAT";
+    });
+    auto updateKeyframeDetector = [this]() { _keyframeDetector.update(_psiDemux); };
+    connect(&_psiDemux, &TS::PSIDemux::patChanged, this, updateKeyframeDetector);
+    connect(&_psiDemux, &TS::PSIDemux::pmtChanged, this, updateKeyframeDetector);
+    auto updateHLSSegmenter = [this]() {
+        if (_hlsSegmenterPtr)
+            _hlsSegmenterPtr->update(_psiDemux);
+    };
+    connect(&_psiDemux, &TS::PSIDemux::patChanged, this, updateHLSSegmenter);
+    connect(&_psiDemux, &TS::PSIDemux::pmtChanged, this, updateHLSSegmenter);
+    connect(&_psiDemux, &TS::PSIDemux::patChanged, this, &StreamServer::updateStreamFilters);
+    connect(&_psiDemux, &TS::PSIDemux::pmtChanged, this, &StreamServer::updateStreamFilters);
+    connect(&_psiDemux, &TS::PSIDemux::sectionError, this, [](quint16 pid, const QString &errorMessage) {
+        static log::RateLimiter psiErrorLimiter("PSI section errors");
+        if (SSCVN_VERBOSE(0) && psiErrorLimiter.check(errorMessage))
+            qWarning().nospace() << "PSI error on PID " << pid << ": " << qPrintable(errorMessage);
+    });
 }
 
 bool StreamServer::isShuttingDown() const
@@ -124,7 +187,7 @@ HTTP::Server *StreamServer::httpServer() const
 
 StreamClient *StreamServer::client(HTTP::ServerContext *ctx)
 {
-    if (verbose >= -1) {
+    if (SSCVN_VERBOSE(-1)) {
         qInfo() << "StreamServer: Creating stream client" << _nextClientID
                 << "from HTTP context" << ctx->id()
                 << "of HTTP client" << ctx->client()->id()
@@ -133,6 +196,8 @@ StreamClient *StreamServer::client(HTTP::ServerContext *ctx)
                 << "requesting" << ctx->request().path();
     }
 
+    SSCVN_TRACE2(client_connect, _nextClientID, ctx->client()->id());
+
     // Set up client object and signal mapping.
     auto *client_ptr = new StreamClient(ctx, _nextClientID++, this);
     connect(client_ptr, &QObject::destroyed, this, &StreamServer::handleStreamClientDestroyed);
@@ -143,12 +208,22 @@ StreamClient *StreamServer::client(HTTP::ServerContext *ctx)
     // Store client object in list.
     _clients.append(client_ptr);
 
-    if (verbose >= 0)
+    if (SSCVN_VERBOSE(0))
         qInfo() << "Stream client count:" << _clients.length();
 
     return client_ptr;
 }
 
+const QList<StreamClient*> &StreamServer::clients() const
+{
+    return _clients;
+}
+
+const QElapsedTimer &StreamServer::uptimeElapsed() const
+{
+    return _uptimeElapsed;
+}
+
 QFile &StreamServer::inputFile()
 {
     if (!_inputFilePtr)
@@ -172,7 +247,7 @@ bool StreamServer::inputFileOpenNonblocking() const
 
 void StreamServer::setInputFileOpenNonblocking(bool nonblock)
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Changing input file open non-blocking from" << _inputFileOpenNonblocking << "to" << nonblock;
     _inputFileOpenNonblocking = nonblock;
 }
@@ -184,11 +259,47 @@ int StreamServer::inputFileReopenTimeoutMillisec() const
 
 void StreamServer::setInputFileReopenTimeoutMillisec(int timeoutMillisec)
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Changing input file reopen timeout from" << _inputFileReopenTimeoutMillisec << "ms to" << timeoutMillisec << "ms";
     _inputFileReopenTimeoutMillisec = timeoutMillisec;
 }
 
+InputRecorder *StreamServer::inputRecorder() const
+{
+    return _inputRecorderPtr.get();
+}
+
+void StreamServer::setInputCapture(const QString &fileName)
+{
+    _inputRecorderPtr.reset();
+    if (!fileName.isEmpty())
+        _inputRecorderPtr = std::make_unique<InputRecorder>(fileName);
+}
+
+InputReplayer *StreamServer::inputReplayer() const
+{
+    return _inputReplayerPtr.get();
+}
+
+void StreamServer::setInputReplay(const QString &fileName, double speed)
+{
+    if (!(speed >= 0))
+        throw std::invalid_argument("StreamServer: Set input replay: Invalid speed " + std::to_string(speed));
+
+    _inputReplayTimer.stop();
+    _inputReplayActive = false;
+    _inputReplayStartNanosecs = -1;
+    _inputReplayerPtr.reset();
+    if (!fileName.isEmpty())
+        _inputReplayerPtr = std::make_unique<InputReplayer>(fileName);
+    _inputReplaySpeed = speed;
+}
+
+double StreamServer::inputReplaySpeed() const
+{
+    return _inputReplaySpeed;
+}
+
 qint64 StreamServer::tsPacketSize() const
 {
     return _tsPacketSize;
@@ -199,7 +310,7 @@ void StreamServer::setTSPacketSize(qint64 size)
     if (!(TSPacket::lengthBasic <= size && size <= TSPacket::lengthBasic * 2))
         throw std::runtime_error("Stream server: Can't set TS packet size to invalid value " + std::to_string(size));
 
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Changing TS packet size from" << _tsPacketSize << "to" << size;
     _tsPacketSize = size;
 }
@@ -211,7 +322,7 @@ bool StreamServer::tsPacketAutosize() const
 
 void StreamServer::setTSPacketAutosize(bool autosize)
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Changing TS packet autosize from" << _tsPacketAutosize << "to" << autosize;
     _tsPacketAutosize = autosize;
 }
@@ -223,11 +334,35 @@ bool StreamServer::tsStripAdditionalInfoDefault() const
 
 void StreamServer::setTSStripAdditionalInfoDefault(bool strip)
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Changing TS strip additional info default from" << _tsStripAdditionalInfoDefault << "to" << strip;
     _tsStripAdditionalInfoDefault = strip;
 }
 
+bool StreamServer::tsDropNullPackets() const
+{
+    return _tsDropNullPackets;
+}
+
+void StreamServer::setTSDropNullPackets(bool drop)
+{
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing TS drop null packets from" << _tsDropNullPackets << "to" << drop;
+    _tsDropNullPackets = drop;
+}
+
+bool StreamServer::tsDropStuffingPackets() const
+{
+    return _tsDropStuffingPackets;
+}
+
+void StreamServer::setTSDropStuffingPackets(bool drop)
+{
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing TS drop stuffing packets from" << _tsDropStuffingPackets << "to" << drop;
+    _tsDropStuffingPackets = drop;
+}
+
 StreamServer::BrakeType StreamServer::brakeType() const
 {
     return _brakeType;
@@ -235,11 +370,160 @@ StreamServer::BrakeType StreamServer::brakeType() const
 
 void StreamServer::setBrakeType(StreamServer::BrakeType type)
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Changing brake type from" << _brakeType << "to" << type;
     _brakeType = type;
 }
 
+TS::TimeShiftRing *StreamServer::timeShiftRing() const
+{
+    return _timeShiftRingPtr.get();
+}
+
+void StreamServer::setTimeShift(const QString &fileName, qint64 capacityBytes)
+{
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing time-shift ring from"
+                << (_timeShiftRingPtr ? _timeShiftRingPtr->fileName() : QString("(none)"))
+                << "to" << fileName << "of" << qPrintable(HumanReadable::byteCount(capacityBytes));
+
+    if (fileName.isEmpty()) {
+        _timeShiftRingPtr.reset();
+        return;
+    }
+
+    auto ringPtr = std::make_unique<TS::TimeShiftRing>();
+    QString errMsg;
+    if (!ringPtr->open(fileName, capacityBytes, &errMsg))
+        throw std::runtime_error("Stream server: Can't set up time-shift ring: " + errMsg.toStdString());
+    _timeShiftRingPtr = std::move(ringPtr);
+}
+
+HLSSegmenter *StreamServer::hlsSegmenter() const
+{
+    return _hlsSegmenterPtr.get();
+}
+
+QSharedPointer<HLSHandler> StreamServer::hlsHandler() const
+{
+    return _hlsHandler;
+}
+
+void StreamServer::setHLSEnabled(bool enable)
+{
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing HLS enabled from" << static_cast<bool>(_hlsSegmenterPtr) << "to" << enable;
+
+    if (!enable) {
+        if (_hlsHandler)
+            _httpServer->removeRoute(HLSHandler::pathPrefix, HTTP::Router::MatchKind::Prefix);
+        _hlsHandler.reset();
+        _hlsSegmenterPtr.reset();
+        return;
+    }
+    if (_hlsSegmenterPtr)
+        return;
+
+    _hlsSegmenterPtr = std::make_unique<HLSSegmenter>();
+    _hlsSegmenterPtr->update(_psiDemux);
+    _hlsHandler = QSharedPointer<HLSHandler>(new HLSHandler(_hlsSegmenterPtr.get()));
+    _httpServer->addRoute(HLSHandler::pathPrefix, _hlsHandler, HTTP::Router::MatchKind::Prefix);
+}
+
+const TS::PSIDemux &StreamServer::psiDemux() const
+{
+    return _psiDemux;
+}
+
+QSharedPointer<StreamFilter> StreamServer::streamFilter(const StreamFilter::Spec &spec)
+{
+    const QString key = spec.toString();
+    QSharedPointer<StreamFilter> filterPtr = _streamFilters.value(key).toStrongRef();
+    if (filterPtr)
+        return filterPtr;
+
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Creating stream filter" << key;
+    filterPtr = QSharedPointer<StreamFilter>::create(spec);
+    filterPtr->update(_psiDemux);
+    _streamFilters.insert(key, filterPtr);
+    return filterPtr;
+}
+
+void StreamServer::updateStreamFilters()
+{
+    for (auto it = _streamFilters.begin(); it != _streamFilters.end(); ) {
+        const QSharedPointer<StreamFilter> filterPtr = it.value().toStrongRef();
+        if (!filterPtr) {
+            it = _streamFilters.erase(it);
+            continue;
+        }
+        filterPtr->update(_psiDemux);
+        ++it;
+    }
+}
+
+const TS::PIDAnalyzer &StreamServer::pidAnalyzer() const
+{
+    return *_pidAnalyzerPtr;
+}
+
+const IngestStats &StreamServer::ingestStats() const
+{
+    return _ingestStats;
+}
+
+stats::Histogram &StreamServer::latencyHistogram()
+{
+    return _latencyHistogram;
+}
+
+const stats::Histogram &StreamServer::latencyHistogram() const
+{
+    return _latencyHistogram;
+}
+
+QSharedPointer<StatsHandler> StreamServer::statsHandler() const
+{
+    return _statsHandler;
+}
+
+bool StreamServer::isProfilingEnabled() const
+{
+    return stats::ProfileStage::isEnabled();
+}
+
+void StreamServer::setProfilingEnabled(bool enable)
+{
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing profiling enabled from" << stats::ProfileStage::isEnabled() << "to" << enable;
+
+    stats::ProfileStage::setEnabled(enable);
+    _profileSnapshotPrev = stats::ProfileStage::snapshotAll();
+    _profileSnapshotPrevNanosecs = clock::monotonicNanosecs();
+}
+
+void StreamServer::setStatsEnabled(bool enable)
+{
+    if (SSCVN_VERBOSE(1))
+        qInfo() << "Changing statistics endpoints enabled from" << static_cast<bool>(_statsHandler) << "to" << enable;
+
+    if (!enable) {
+        if (_statsHandler) {
+            _httpServer->removeRoute(StatsHandler::statsPath);
+            _httpServer->removeRoute(StatsHandler::metricsPath);
+        }
+        _statsHandler.reset();
+        return;
+    }
+    if (_statsHandler)
+        return;
+
+    _statsHandler = QSharedPointer<StatsHandler>(new StatsHandler(this));
+    _httpServer->addRoute(StatsHandler::statsPath,   _statsHandler);
+    _httpServer->addRoute(StatsHandler::metricsPath, _statsHandler);
+}
+
 void StreamServer::handleStreamClientDestroyed(QObject *obj)
 {
     if (!obj)
@@ -260,7 +544,7 @@ void StreamServer::handleStreamClientDestroyed(QObject *obj)
 void StreamServer::handleHTTPServerClientDestroyed(QObject * /* obj */)
 {
     if (_isShuttingDown && (!_httpServer || _httpServer->clients().isEmpty())) {
-        if (verbose >= -1)
+        if (SSCVN_VERBOSE(-1))
             qInfo() << "Shutdown: No HTTP clients left, exiting event loop";
         if (qApp)
             qApp->exit();
@@ -271,13 +555,40 @@ void StreamServer::handleHTTPServerClientDestroyed(QObject * /* obj */)
 
 void StreamServer::initInput()
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Initializing input";
 
+    if (_inputReplayerPtr) {
+        if (_tsPacketAutosize)
+            _tsPacketSize = 0;  // Request immediate re-detection.
+        _openRealTimeValid = false;
+        _openRealTime = 0;
+        _psiDemux.reset();
+        _keyframeDetector.clear();
+        _pidAnalyzerPtr->resetContinuity();
+
+        if (_inputReplayerPtr->atEnd()) {
+            if (SSCVN_VERBOSE(-1))
+                qInfo() << "Input replay finished after" << _inputReplayerPtr->recordCount() << "reads";
+            // (Might not be in the event loop, yet.)
+            QTimer::singleShot(0, this, [this]() { shutdown(); });
+            return;
+        }
+
+        if (_inputReplayStartNanosecs < 0)
+            _inputReplayStartNanosecs = clock::monotonicNanosecs();
+        _inputReplayActive = true;
+        scheduleReplayInput();
+
+        if (SSCVN_VERBOSE(1))
+            qInfo() << "Successfully initialized input from replay of" << _inputReplayerPtr->fileName();
+        return;
+    }
+
     if (!_inputFilePtr->isOpen()) {
         if (_inputFileName.isNull()) {
             _inputFileName = _inputFilePtr->fileName();
-            if (verbose >= 1)
+            if (SSCVN_VERBOSE(1))
                 qInfo() << "Initialized input file name from passed-in input file:"
                         << _inputFileName;
         }
@@ -287,11 +598,14 @@ void StreamServer::initInput()
             _tsPacketSize = 0;  // Request immediate re-detection.
         _openRealTimeValid = false;
         _openRealTime = 0;
+        _psiDemux.reset();
+        _keyframeDetector.clear();
+        _pidAnalyzerPtr->resetContinuity();
 
         bool openSucceeded = false;
         QString errMsgInfix;
         if (_inputFileOpenNonblocking) {
-            if (verbose >= -1)
+            if (SSCVN_VERBOSE(-1))
                 qInfo() << "Opening input file" << fileName << "in non-blocking mode...";
 
             int fd = open(QFile::encodeName(fileName).constData(), O_RDONLY | O_NONBLOCK);
@@ -305,7 +619,7 @@ void StreamServer::initInput()
             }
         }
         else {
-            if (verbose >= -1)
+            if (SSCVN_VERBOSE(-1))
                 qInfo() << "Opening input file" << fileName << "in normal (blocking) mode...";
 
             openSucceeded = _inputFilePtr->open(QFile::ReadOnly);
@@ -330,16 +644,16 @@ void StreamServer::initInput()
         inputFileHandle, QSocketNotifier::Read, this);
     connect(_inputFileNotifierPtr.get(), &QSocketNotifier::activated, this, &StreamServer::processInput);
 
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Successfully initialized input";
 }
 
 void StreamServer::finalizeInput()
 {
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Finalizing input";
 
-    if (verbose >= -1)
+    if (SSCVN_VERBOSE(-1))
         qInfo() << "Closing input...";
     _inputFilePtr->close();
 
@@ -349,10 +663,105 @@ void StreamServer::finalizeInput()
         _inputFileNotifierPtr.reset();
     }
 
-    if (verbose >= 1)
+    _inputReplayTimer.stop();
+    _inputReplayActive = false;
+    if (_inputRecorderPtr)
+        _inputRecorderPtr->flush();
+
+    if (SSCVN_VERBOSE(0) && _ingestStats.paddingPacketsDropped.value() > 0) {
+        qInfo() << "Left out" << _ingestStats.paddingPacketsDropped.value() << "padding packets so far, saving"
+                << qPrintable(HumanReadable::byteCount(_ingestStats.paddingBytesDropped.value())) << "per client";
+    }
+
+    const TS::PIDAnalyzer::PIDStats &health(_pidAnalyzerPtr->totals());
+    if (SSCVN_VERBOSE(0) && (health.continuityErrors > 0 || health.transportErrors > 0 || health.duplicatePackets > 0)) {
+        qInfo() << "Input health so far:" << health.continuityErrors << "continuity errors (about"
+                << health.lostPackets << "packets lost upstream)," << health.duplicatePackets << "duplicate packets,"
+                << health.transportErrors << "packets with transport errors";
+    }
+
+    if (SSCVN_VERBOSE(1) && _keyframeDetector.detectedCount() > 0) {
+        qInfo() << "Found" << _keyframeDetector.detectedCount()
+                << "keyframes lacking random_access_indicator so far, by scanning the video PES";
+    }
+
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Successfully finalized input";
 }
 
+QByteArray StreamServer::readInput(qint64 maxSize)
+{
+    const QByteArray bytes = _inputReplayerPtr ?
+        takeReplayInput(maxSize, false) : _inputFilePtr->read(maxSize);
+    if (_inputRecorderPtr)
+        _inputRecorderPtr->record(clock::monotonicNanosecs(), false, bytes);
+    return bytes;
+}
+
+QByteArray StreamServer::peekInput(qint64 maxSize)
+{
+    const QByteArray bytes = _inputReplayerPtr ?
+        takeReplayInput(maxSize, true) : _inputFilePtr->peek(maxSize);
+    if (_inputRecorderPtr)
+        _inputRecorderPtr->record(clock::monotonicNanosecs(), true, bytes);
+    return bytes;
+}
+
+QByteArray StreamServer::takeReplayInput(qint64 maxSize, bool isPeek)
+{
+    // End of capture looks like EOF.
+    if (_inputReplayerPtr->atEnd())
+        return QByteArray();
+
+    const InputCaptureRecord record = _inputReplayerPtr->take();
+    if (record.isPeek() != isPeek || record.bytes.length() > maxSize) {
+        // E.g., when replaying with a build that reads differently.
+        static log::RateLimiter divergeLimiter("input replay divergences");
+        QString detail;
+        QDebug(&detail).nospace()
+            << "Read " << _inputReplayerPtr->recordCount() << " was recorded as "
+            << (record.isPeek() ? "peek" : "read") << " of " << record.bytes.length() << " bytes, "
+            << "but now is " << (isPeek ? "peek" : "read") << " of up to " << maxSize << " bytes";
+        if (SSCVN_VERBOSE(0) && divergeLimiter.check(detail))
+            qWarning() << "Input replay diverged from capture:" << qPrintable(detail);
+    }
+
+    if (record.isNull())
+        return QByteArray();
+    return record.bytes;
+}
+
+void StreamServer::scheduleReplayInput()
+{
+    qint64 delayMillisec = 0;
+    if (!_inputReplayerPtr->atEnd() && _inputReplaySpeed > 0) {
+        const qint64 dueNanosecs = _inputReplayStartNanosecs +
+            static_cast<qint64>(_inputReplayerPtr->nextNanosecs() / _inputReplaySpeed);
+        delayMillisec = std::max<qint64>(0, (dueNanosecs - clock::monotonicNanosecs() + 999999) / 1000000);
+    }
+    _inputReplayTimer.start(static_cast<int>(std::min<qint64>(delayMillisec, std::numeric_limits<int>::max())));
+}
+
+void StreamServer::processReplayInput()
+{
+    // One input processing per recorded notifier activation;
+    // the reads it does take as many records as they did when captured.
+    processInput();
+
+    if (_inputReplayActive)
+        scheduleReplayInput();
+}
+
+void StreamServer::acceptPacketSize(qint64 readSize)
+{
+    _inputConsecutiveErrorCount = 0;
+    if (_tsPacketSize == 0) {
+        _tsPacketSize = readSize;
+        if (SSCVN_VERBOSE(0))
+            qInfo().nospace() << "Detected TS packet size of " << _tsPacketSize << ", which is basic length plus " << (_tsPacketSize - TSPacket::lengthBasic);
+    }
+}
+
 void StreamServer::initInputSlot()
 {
     bool succeeded = false;
@@ -379,39 +788,43 @@ void StreamServer::processInput()
         if (!_tsPacketAutosize)
             qFatal("TS packet autosize turned off but no fixed packet size set!");
 
-        if (verbose >= 1)
+        if (SSCVN_VERBOSE(1))
             qInfo() << "Input TS packet size set to" << _tsPacketSize << "/ immediate automatic detection."
                     << "Starting with basic length" << TSPacket::lengthBasic;
         readSize = TSPacket::lengthBasic;
     }
 
-    QByteArray packetBytes = _inputFilePtr->read(readSize);
+    stats::StageTimer readTimer(profInputRead);
+    QByteArray packetBytes = readInput(readSize);
+    readTimer.stop();
+    const qint64 ingestNanosecs = clock::monotonicNanosecs();
     if (_tsPacketSize == 0 && !packetBytes.isNull() && packetBytes.length() == readSize) {
+        stats::StageTimer detectTimer(profAutodetect);
         if (packetBytes.startsWith(TSPacket::syncByte)) {
             // If additional data is already available, try to detect formats with suffix after basic packet.
-            const QByteArray nextPacketBytes = _inputFilePtr->peek(readSize);
+            const QByteArray nextPacketBytes = peekInput(readSize);
             if (nextPacketBytes.startsWith(TSPacket::syncByte)) {
-                if (verbose >= 1)
+                if (SSCVN_VERBOSE(1))
                     qInfo() << "Good; sync byte found in this and next packet";
             }
             else {
                 if (nextPacketBytes.length() <= 20) {
-                    if (verbose >= 1)
+                    if (SSCVN_VERBOSE(1))
                         qInfo() << "Sync byte found, but not enough further data available to detect packet length";
                 }
                 else {
-                    if (verbose >= 1)
+                    if (SSCVN_VERBOSE(1))
                         qInfo() << "Next packet does not start with sync byte";
                     if (nextPacketBytes.length() > 16 && nextPacketBytes.at(16) == TSPacket::syncByte) {
-                        if (verbose >= 1)
+                        if (SSCVN_VERBOSE(1))
                             qInfo() << "Next packet offset 16 contains sync byte, assuming 16-byte suffix";
-                        packetBytes.append(_inputFilePtr->read(16));
+                        packetBytes.append(readInput(16));
                         readSize += 16;
                     }
                     else if (nextPacketBytes.length() > 20 && nextPacketBytes.at(20) == TSPacket::syncByte) {
-                        if (verbose >= 1)
+                        if (SSCVN_VERBOSE(1))
                             qInfo() << "Next packet offset 20 contains sync byte, assuming 20-byte suffix";
-                        packetBytes.append(_inputFilePtr->read(20));
+                        packetBytes.append(readInput(20));
                         readSize += 20;
                     }
                     else {
@@ -422,12 +835,12 @@ void StreamServer::processInput()
             }
         }
         else {
-            if (verbose >= 1)
+            if (SSCVN_VERBOSE(1))
                 qInfo() << "Initial packet does not start with sync byte";
             if (packetBytes.at(4) == TSPacket::syncByte) {
-                if (verbose >= 1)
+                if (SSCVN_VERBOSE(1))
                     qInfo() << "Offset 4 contains sync byte, assuming 4-byte TimeCode prefix";
-                packetBytes.append(_inputFilePtr->read(4));
+                packetBytes.append(readInput(4));
                 readSize += 4;
             }
             else {
@@ -437,30 +850,89 @@ void StreamServer::processInput()
         }
     }
     if (packetBytes.isNull()) {
-        if (verbose >= 0)
+        if (SSCVN_VERBOSE(0))
             qInfo() << "EOF on input, finalizing...";
         finalizeInput();
 
-        if (verbose >= 1)
+        if (SSCVN_VERBOSE(1))
             qInfo() << "Setting up timer to open input again after" << _inputFileReopenTimeoutMillisec << "ms";
         QTimer::singleShot(_inputFileReopenTimeoutMillisec,
             this, &StreamServer::initInputSlot);
 
         return;
     }
-    if (verbose >= 3)
+    if (SSCVN_VERBOSE(3))
         qDebug() << "Read data:" << packetBytes;
 
     if (packetBytes.length() != readSize) {
-        qWarning().nospace()
-            << "Desync: Read packet should be size " << readSize
-            << ", but was " << packetBytes.length();
+        _ingestStats.desyncs.add();
+        static log::RateLimiter desyncLimiter("desyncs");
+        const auto detail = [&]() {
+            return "Read packet should be size " + QString::number(readSize) +
+                ", but was " + QString::number(packetBytes.length());
+        };
+        if (SSCVN_VERBOSE(0) && desyncLimiter.checkLazy(detail))
+            qWarning() << "Desync:" << qPrintable(detail());
         // TODO: Try a resync via TS packet sync byte?
         return;
     }
 
+    _ingestStats.packets.add();
+    _ingestStats.bytes.add(static_cast<quint64>(packetBytes.length()));
+
+    // (Skipping a TimeCode prefix, if any; the detection above has put
+    // suffixes only on 204/208-byte packets.)
+    const TS::PacketView basicView = packetBytes.length() >= TS::PacketView::sizeBasic ?
+        TS::PacketView(packetBytes.constData() + TS::PacketView::basicOffsetForPacketSize(packetBytes.length())) :
+        TS::PacketView();
+
+    // Health of the input as received, padding included.
+    if (basicView.isSyncByteValid()) {
+        stats::StageTimer analyzeTimer(profAnalyze);
+        switch (_pidAnalyzerPtr->addPacket(basicView, ingestNanosecs)) {
+        case TS::PIDAnalyzer::Result::OK:
+            break;
+        case TS::PIDAnalyzer::Result::Duplicate:
+            if (SSCVN_VERBOSE(2))
+                qDebug().nospace() << "Duplicate packet on PID 0x" << qPrintable(QString::number(basicView.pid(), 16).rightJustified(4, '0'));
+            break;
+        case TS::PIDAnalyzer::Result::ContinuityError: {
+            static log::RateLimiter continuityErrorLimiter("continuity errors");
+            const auto detail = [&]() {
+                return "PID 0x" + QString::number(basicView.pid(), 16).rightJustified(4, '0') + ", " +
+                    QString::number(_pidAnalyzerPtr->pidStats(basicView.pid()).lastGap) + " packet(s) lost upstream";
+            };
+            if (SSCVN_VERBOSE(0) && continuityErrorLimiter.checkLazy(detail))
+                qWarning() << "Continuity error:" << qPrintable(detail());
+            break;
+        }
+        case TS::PIDAnalyzer::Result::TransportError: {
+            static log::RateLimiter transportErrorLimiter("transport errors");
+            const auto detail = [&]() {
+                return "PID 0x" + QString::number(basicView.pid(), 16).rightJustified(4, '0');
+            };
+            if (SSCVN_VERBOSE(0) && transportErrorLimiter.checkLazy(detail))
+                qWarning() << "Transport error indicator set:" << qPrintable(detail());
+            break;
+        }
+        }
+    }
+
+    // Padding? Then skip it before even parsing.
+    if (basicView.isSyncByteValid() &&
+        ((_tsDropNullPackets && basicView.isNullPacket()) ||
+         (_tsDropStuffingPackets && basicView.isStuffingOnly())))
+    {
+        // (Well-formed all the same, so still in sync.)
+        acceptPacketSize(readSize);
+        _ingestStats.paddingPacketsDropped.add();
+        _ingestStats.paddingBytesDropped.add(static_cast<quint64>(packetBytes.length()));
+        return;
+    }
+
     // Actually process the read data.
     try {
+        stats::StageTimer parseTimer(profParse);
 #ifndef TS_PACKET_V2
         TSPacket packet(packetBytes);
         const QString &errmsg(packet.errorMessage());
@@ -473,73 +945,89 @@ void StreamServer::processInput()
             _tsParser.setPrefixLength(readSize - TS::PacketV2::sizeBasic);
         const bool success = _tsParser.parse(packetBytesNode, &packetNode, &errmsg);
         if (!packetNode) {
-            if (verbose >= 0)
+            static log::RateLimiter noNodeLimiter("TS packet parsing failures without packet node");
+            if (SSCVN_VERBOSE(0) && noNodeLimiter.check(errmsg))
                 qWarning() << "TS packet parsing didn't yield a packet node, skipping bytes...";
             return;
         }
         TS::PacketV2 &packet(packetNode->data);
 #endif
-        if (verbose >= 3)
+        parseTimer.stop();
+#ifndef TS_PACKET_V2
+        SSCVN_TRACE3(packet_ingest, packet.PID(), packetBytes.length(), ingestNanosecs);
+#else
+        SSCVN_TRACE3(packet_ingest, packet.pid.value, packetBytes.length(), ingestNanosecs);
+#endif
+        if (SSCVN_VERBOSE(3))
             qInfo() << "TS packet contents:" << packet;
-        if (verbose >= 0 && !success)
+        static log::RateLimiter tsErrorLimiter("TS packet errors");
+        if (SSCVN_VERBOSE(0) && !success && tsErrorLimiter.check(errmsg))
             qWarning() << "TS packet error:" << qPrintable(errmsg);
         if (!success) {
+            _ingestStats.errors.add();
+            SSCVN_TRACE2(parse_error, packetBytes.length(), _inputConsecutiveErrorCount + 1);
             if (++_inputConsecutiveErrorCount >= 16 && _tsPacketAutosize) {
                 if (_tsPacketSize > 0) {
-                    qWarning() << "Got" << _inputConsecutiveErrorCount << "consecutive errors, trying to re-sync and re-detect TS packet size...";
+                    stats::StageTimer resyncTimer(profAutodetect);
+                    static log::RateLimiter resyncLimiter("re-sync attempts");
+                    if (resyncLimiter.check())
+                        qWarning() << "Got" << _inputConsecutiveErrorCount << "consecutive errors, trying to re-sync and re-detect TS packet size...";
+                    _ingestStats.resyncs.add();
+                    // (What we skip here isn't upstream's fault.)
+                    _pidAnalyzerPtr->resetContinuity();
 
                     int iSyncByte, pass = 0;
                     while (++pass <= TSPacket::lengthBasic + 20 &&
                            (iSyncByte = packetBytes.indexOf(TSPacket::syncByte)) > 0)
                     {
-                        if (verbose >= 1)
+                        if (SSCVN_VERBOSE(1))
                             qInfo() << "Throwing away" << iSyncByte << "bytes";
                         packetBytes.remove(0, iSyncByte);
 
                         qint64 fillUp = TSPacket::lengthBasic - packetBytes.length();
-                        if (verbose >= 1)
+                        if (SSCVN_VERBOSE(1))
                             qInfo() << "Reading in" << fillUp << "additional bytes to fill up buffer...";
-                        packetBytes.append(_inputFilePtr->read(fillUp));
+                        packetBytes.append(readInput(fillUp));
                         if (packetBytes.length() < TSPacket::lengthBasic)
                             qFatal("Not enough data available for read during re-sync");
 
-                        const QByteArray followingBytes = _inputFilePtr->peek(21);
+                        const QByteArray followingBytes = peekInput(21);
                         if (followingBytes.isEmpty()) {
-                            if (verbose >= 1)
+                            if (SSCVN_VERBOSE(1))
                                 qInfo() << "Re-sync: Sync byte found, but not enough further data available. The synchronization is just a guess";
                             break;
                         }
                         else if (followingBytes.startsWith(TSPacket::syncByte)) {
-                            if (verbose >= 1)
+                            if (SSCVN_VERBOSE(1))
                                 qInfo() << "Re-sync: Good; sync byte found in this and next packet";
                             break;
                         }
                         else if (followingBytes.length() > 4 && followingBytes.at(4) == TSPacket::syncByte) {
-                            if (verbose >= 1)
+                            if (SSCVN_VERBOSE(1))
                                 qInfo() << "Re-sync: Sync byte found in this packet, and at offset 4 in following bytes;"
                                         << "next read will probably get a 4-byte TimeCode prefix style packet";
                             break;
                         }
                         else if (followingBytes.length() > 16 && followingBytes.at(16) == TSPacket::syncByte) {
-                            if (verbose >= 1) {
+                            if (SSCVN_VERBOSE(1)) {
                                 qInfo() << "Re-sync: Sync byte found in this packet, and at offset 16 in following bytes";
                                 qInfo() << "Need to read & discard 16 additional bytes...";
                             }
-                            if (_inputFilePtr->read(16).length() != 16)
+                            if (readInput(16).length() != 16)
                                 qFatal("Failed to read & discard 16 bytes during re-sync");
                             break;
                         }
                         else if (followingBytes.length() > 20 && followingBytes.at(20) == TSPacket::syncByte) {
-                            if (verbose >= 1) {
+                            if (SSCVN_VERBOSE(1)) {
                                 qInfo() << "Re-sync: Sync byte found in this packet, and at offset 20 in following bytes";
                                 qInfo() << "Need to read & discard 20 additional bytes...";
                             }
-                            if (_inputFilePtr->read(16).length() != 20)
+                            if (readInput(16).length() != 20)
                                 qFatal("Failed to read & discard 20 bytes during re-sync");
                             break;
                         }
 
-                        if (verbose >= 1)
+                        if (SSCVN_VERBOSE(1))
                             qInfo() << "Re-sync: Not good, found a sync byte but no related other sync byte in pass" << pass;
                     }
                     if (!packetBytes.startsWith(TSPacket::syncByte))
@@ -551,12 +1039,13 @@ void StreamServer::processInput()
             }
         }
         else {
-            _inputConsecutiveErrorCount = 0;
-            if (_tsPacketSize == 0) {
-                _tsPacketSize = readSize;
-                if (verbose >= 0)
-                    qInfo().nospace() << "Detected TS packet size of " << _tsPacketSize << ", which is basic length plus " << (_tsPacketSize - TSPacket::lengthBasic);
-            }
+            acceptPacketSize(readSize);
+        }
+
+        if (success && basicView.isSyncByteValid()) {
+            // (packetBytes only gets changed by a resync, i.e., without success.)
+            stats::StageTimer psiTimer(profPSI);
+            _psiDemux.addPacket(basicView);
         }
 
 #ifndef TS_PACKET_V2
@@ -573,12 +1062,20 @@ void StreamServer::processInput()
             if (!_openRealTimeValid) {
                 _openRealTime = timenow() - pcr;
                 _openRealTimeValid = true;
-                if (verbose >= 0)
+                if (SSCVN_VERBOSE(0))
                     qDebug() << "Initialized _openRealTime to" << fixed << _openRealTime;
             }
             double now = timenow() - _openRealTime;
             double dt = (pcr - _lastPacketTime) - (now - _lastRealTime);
-            if (_lastPacketTime + 1 < pcr || pcr < _lastPacketTime) {
+            const bool isDiscontinuity = _lastPacketTime + 1 < pcr || pcr < _lastPacketTime;
+            if (!isDiscontinuity) {
+                const qint64 jitterMicrosecs = static_cast<qint64>(dt * 1e6);
+                _ingestStats.pcrJitterMicrosecs.set(jitterMicrosecs);
+                _ingestStats.pcrJitterMaxMicrosecs.setMax(std::abs(jitterMicrosecs));
+            }
+            if (isDiscontinuity) {
+                _ingestStats.discontinuities.add();
+                SSCVN_TRACE2(discontinuity, static_cast<qint64>(pcr * 1e6), static_cast<qint64>(_lastPacketTime * 1e6));
                 // Discontinuity, just keep sending.
 #ifndef TS_PACKET_V2
                 bool discontinuityBefore = af->discontinuityIndicator();
@@ -588,7 +1085,7 @@ void StreamServer::processInput()
                 af.discontinuityIndicator.value = true;
 #endif
                 afModified = true;
-                if (verbose >= 0) {
+                if (SSCVN_VERBOSE(0)) {
                     qInfo().nospace()
                         << "Discontinuity detected; Discontinuity Indicator was "
                         << discontinuityBefore << ", now set to "
@@ -599,22 +1096,25 @@ void StreamServer::processInput()
 #endif
                 }
                 _openRealTime = timenow() - pcr;
-                if (verbose >= 0)
+                if (SSCVN_VERBOSE(0))
                     qDebug() << "Reset _openRealTime to" << fixed << _openRealTime;
             }
             else if (_brakeType == BrakeType::PCRSleep) {
                 if (dt > 0 && pcr >= now) {
-                    if (verbose >= 1) {
+                    stats::StageTimer brakeTimer(profBrake);
+                    if (SSCVN_VERBOSE(1)) {
                         qDebug().nospace()
                             << "Sleeping: " << pcr - now << ", dt = " << dt
                             << " = (" << pcr << " - " << _lastPacketTime
                             << ") - (" << now << " - " << _lastRealTime
                             << ")";
                     }
+                    SSCVN_TRACE2(brake_sleep, static_cast<qint64>(pcr * 1e6), static_cast<qint64>((pcr - now) * 1e6));
                     usleep((unsigned int)((pcr - now) * 1000000.));
+                    _ingestStats.brakeSleepNanosecs.add(static_cast<quint64>((pcr - now) * 1e9));
                 }
                 else {
-                    if (verbose >= 1)
+                    if (SSCVN_VERBOSE(1))
                         qDebug() << "Passing.";
                 }
             }
@@ -630,32 +1130,118 @@ void StreamServer::processInput()
 #endif
         }
 
-        for (auto client : _clients) {
-            try {
+        if (_timeShiftRingPtr || _hlsSegmenterPtr) {
+            QByteArray basicBytes;
+            stats::StageTimer encodeTimer(profEncodeBasic);
+#ifndef TS_PACKET_V2
+            basicBytes = packet.toBasicPacketBytes();
+            encodeTimer.stop();
+#else
+            QSharedPointer<ConversionNode<QByteArray>> basicBytesNode;
+            QString generateErrMsg;
+            const bool generated = _basicGenerator.generate(packetNode, &basicBytesNode, &generateErrMsg);
+            encodeTimer.stop();
+            if (generated)
+                basicBytes = basicBytesNode->data;
+            else {
+                static log::RateLimiter generateErrorLimiter("basic packet generation errors");
+                if (SSCVN_VERBOSE(0) && generateErrorLimiter.check(generateErrMsg))
+                    qWarning() << "Basic packet generation error, not storing packet:" << qPrintable(generateErrMsg);
+            }
+#endif
+            if (basicBytes.length() == TS::PacketView::sizeBasic) {
+                // (Falls back to scanning for IDR/IRAP NAL units
+                // where the muxer didn't set random_access_indicator.)
+                const bool isRandomAccess = _keyframeDetector.isRandomAccess(TS::PacketView(basicBytes));
+                if (_timeShiftRingPtr)
+                    _timeShiftRingPtr->append(basicBytes, clock::monotonicMillisecs(), isRandomAccess);
+                if (_hlsSegmenterPtr)
+                    _hlsSegmenterPtr->addPacket(basicBytes, isRandomAccess);
+            }
+        }
+
+        stats::StageTimer fanOutTimer(profFanOut);
+        // Decide once per distinct filter, not per client.
+        for (auto it = _streamFilters.begin(); it != _streamFilters.end(); ) {
+            const QSharedPointer<StreamFilter> filterPtr = it.value().toStrongRef();
+            if (!filterPtr) {
+                it = _streamFilters.erase(it);
+                continue;
+            }
+            filterPtr->processPacket(packetBytes);
+            ++it;
+        }
 #ifndef TS_PACKET_V2
-                client->queuePacket(packet);
+        const TSPacket &inputPacket(packet);
 #else
-                client->queuePacket(packetNode);
+        const QSharedPointer<ConversionNode<TS::PacketV2>> &inputPacket(packetNode);
 #endif
+        for (auto client : _clients) {
+            try {
+                const StreamFilter *const filter = client->streamFilter();
+                if (!filter) {
+                    client->queuePacket(inputPacket, ingestNanosecs);
+                    continue;
+                }
+                switch (filter->lastResult()) {
+                case StreamFilter::Result::Drop:
+                    break;
+                case StreamFilter::Result::Pass:
+                    client->queuePacket(inputPacket, ingestNanosecs);
+                    break;
+                case StreamFilter::Result::Replace:
+                    for (const auto &replacement : filter->replacementPackets())
+                        client->queuePacket(replacement, ingestNanosecs);
+                    break;
+                }
             }
             catch (std::exception &ex) {
-                qWarning().nospace()
-                    << qPrintable(client->logPrefix()) << " "
-                    << "Error sending TS packet to client " << client->id() << ": " << QString(ex.what());
+                static log::RateLimiter sendErrorLimiter("errors sending TS packet to clients");
+                if (sendErrorLimiter.check(client->logPrefix() + " " + ex.what())) {
+                    qWarning().nospace()
+                        << qPrintable(client->logPrefix()) << " "
+                        << "Error sending TS packet to client " << client->id() << ": " << QString(ex.what());
+                }
                 continue;
             }
         }
     }
     catch (std::exception &ex) {
-        qWarning() << "Error processing input bytes as TS packet & sending to clients:" << QString(ex.what());
+        static log::RateLimiter processErrorLimiter("errors processing input bytes");
+        if (processErrorLimiter.check(ex.what()))
+            qWarning() << "Error processing input bytes as TS packet & sending to clients:" << QString(ex.what());
+        return;
+    }
+}
+
+void StreamServer::dumpProfile()
+{
+    if (!stats::ProfileStage::isEnabled()) {
+        if (SSCVN_VERBOSE(-1))
+            qInfo() << "Profile: Profiling is not enabled";
         return;
     }
+
+    const QList<stats::ProfileStage::Snapshot> snapshots = stats::ProfileStage::snapshotAll();
+    const qint64 nowNanosecs = clock::monotonicNanosecs();
+    const qint64 elapsedNanosecs = nowNanosecs - _profileSnapshotPrevNanosecs;
+
+    if (SSCVN_VERBOSE(-1)) {
+        qInfo() << "Profile: Per-stage times over the last"
+                << qPrintable(HumanReadable::timeDuration(elapsedNanosecs / 1000000))
+                << "(including nested stages; brake includes sleeping):";
+        for (const QString &line : profileReport(_profileSnapshotPrev, snapshots, elapsedNanosecs))
+            qInfo() << "Profile:" << qPrintable(line);
+    }
+
+    _profileSnapshotPrev = snapshots;
+    _profileSnapshotPrevNanosecs = nowNanosecs;
 }
 
 void StreamServer::shutdown(int sigNum, const QString &sigStr)
 {
     if (sigNum > 0) {
-        if (verbose >= -1) {
+        if (SSCVN_VERBOSE(-1)) {
             if (sigStr.isEmpty())
                 qInfo() << "Got signal number" << sigNum;
             else
@@ -674,25 +1260,28 @@ void StreamServer::shutdown(int sigNum, const QString &sigStr)
             qFatal("Shutdown: Can't access application object to exit event loop");
     }
 
-    if (verbose >= 0)
+    if (SSCVN_VERBOSE(0))
         qInfo() << "Shutting down...";
     _isShuttingDown = true;
 
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(0) && _latencyHistogram.count() > 0)
+        qInfo() << "Ingest-to-wire latency, all clients:" << qPrintable(latencySummary(_latencyHistogram));
+
+    if (SSCVN_VERBOSE(1))
         qInfo() << "Shutdown: Closing listening socket...";
     _httpServer->closeListeningSocket();
 
     if (_clients.length() > 0) {
-        if (verbose >= 0)
+        if (SSCVN_VERBOSE(0))
             qInfo() << "Shutdown: Closing client connections...";
         for (auto client : _clients)
             client->close();
         // Be sure to return to event loop after this!
-        if (verbose >= 0)
+        if (SSCVN_VERBOSE(0))
             qInfo() << "Shutdown: Done requesting close of all client connections";
     }
     else {
-        if (verbose >= -1)
+        if (SSCVN_VERBOSE(-1))
             qInfo() << "Shutdown: No clients, exiting event loop";
         if (qApp)
             qApp->exit();
@@ -700,7 +1289,7 @@ void StreamServer::shutdown(int sigNum, const QString &sigStr)
             qFatal("Shutdown: Can't access application object to exit event loop");
     }
 
-    if (verbose >= 1)
+    if (SSCVN_VERBOSE(1))
         qDebug() << "Shutdown: Returning to caller, expecting to ultimately return to event loop";
 }
 
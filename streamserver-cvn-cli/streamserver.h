@@ -11,9 +11,19 @@
 #include <QFile>
 #include <QSocketNotifier>
 #include <QTimer>
+#include <QElapsedTimer>
 
 #include "streamclient.h"
+#include "hlssegmenter.h"
+#include "serverstats.h"
+#include "inputcapture.h"
+#include "streamfilter.h"
 #include "http/httpserver.h"
+#include "tstimeshiftring.h"
+#include "tspsi.h"
+#include "tskeyframe.h"
+#include "tspidanalyzer.h"
+#include "stageprofiler.h"
 
 namespace SSCvn {
 
@@ -38,6 +48,7 @@ class StreamServer : public QObject
     Q_OBJECT
 
     bool                    _isShuttingDown = false;
+    QElapsedTimer           _uptimeElapsed;
     QPointer<HTTP::Server>  _httpServer;
     QSharedPointer<StreamHandler>  _httpServerHandler;
     std::unique_ptr<QFile>  _inputFilePtr;
@@ -46,12 +57,35 @@ class StreamServer : public QObject
     std::unique_ptr<QSocketNotifier>  _inputFileNotifierPtr;
     int                     _inputFileReopenTimeoutMillisec = 1000;
     int                     _inputConsecutiveErrorCount = 0;
+    std::unique_ptr<InputRecorder>  _inputRecorderPtr;
+    std::unique_ptr<InputReplayer>  _inputReplayerPtr;
+    double                  _inputReplaySpeed = 1;
+    bool                    _inputReplayActive = false;
+    qint64                  _inputReplayStartNanosecs = -1;
+    QTimer                  _inputReplayTimer;
     qint64                  _tsPacketSize = 0;  // Request immediate automatic detection.
     bool                    _tsPacketAutosize = true;
     bool                    _tsStripAdditionalInfoDefault = true;
+    bool                    _tsDropNullPackets = false;
+    bool                    _tsDropStuffingPackets = false;
 #ifdef TS_PACKET_V2
     TS::PacketV2Parser      _tsParser;
+    TS::PacketV2Generator   _basicGenerator;
 #endif
+    TS::PSIDemux                        _psiDemux;
+    TS::KeyframeDetector                _keyframeDetector;
+    // (On the heap, as its per-PID table is rather large.)
+    std::unique_ptr<TS::PIDAnalyzer>    _pidAnalyzerPtr;
+    // By StreamFilter::Spec::toString(); owned by the clients using them.
+    QHash<QString, QWeakPointer<StreamFilter>>  _streamFilters;
+    std::unique_ptr<TS::TimeShiftRing>  _timeShiftRingPtr;
+    std::unique_ptr<HLSSegmenter>       _hlsSegmenterPtr;
+    QSharedPointer<HLSHandler>          _hlsHandler;
+    IngestStats                         _ingestStats;
+    stats::Histogram                    _latencyHistogram;  // Microseconds, all clients.
+    QSharedPointer<StatsHandler>        _statsHandler;
+    QList<stats::ProfileStage::Snapshot>  _profileSnapshotPrev;
+    qint64                  _profileSnapshotPrevNanosecs = 0;
     bool                    _openRealTimeValid = false;
     double                  _openRealTime = 0;
     double                  _lastRealTime = 0;
@@ -75,6 +109,8 @@ public:
 
     HTTP::Server *httpServer() const;
     StreamClient *client(HTTP::ServerContext *ctx);
+    const QList<StreamClient*> &clients() const;
+    const QElapsedTimer &uptimeElapsed() const;
 
     QFile       &inputFile();
     const QFile &inputFile() const;
@@ -82,21 +118,65 @@ public:
     void         setInputFileOpenNonblocking(bool nonblock);
     int          inputFileReopenTimeoutMillisec() const;
     void         setInputFileReopenTimeoutMillisec(int timeoutMillisec);
+    InputRecorder *inputRecorder() const;
+    // Record every input read with its timing (see InputRecorder).
+    void         setInputCapture(const QString &fileName);
+    InputReplayer *inputReplayer() const;
+    // Take input reads from a capture instead of the input file,
+    // at the recorded times divided by speed; speed 0 doesn't wait at all.
+    void         setInputReplay(const QString &fileName, double speed = 1);
+    double       inputReplaySpeed() const;
     qint64       tsPacketSize() const;
     void         setTSPacketSize(qint64 size);
     bool         tsPacketAutosize() const;
     void         setTSPacketAutosize(bool autosize);
     bool         tsStripAdditionalInfoDefault() const;
     void         setTSStripAdditionalInfoDefault(bool strip);
+    // Leave out padding (PID 0x1fff null packets, and adaptation-field-only
+    // packets carrying nothing but stuffing) once, before fan-out.
+    bool         tsDropNullPackets() const;
+    void         setTSDropNullPackets(bool drop);
+    bool         tsDropStuffingPackets() const;
+    void         setTSDropStuffingPackets(bool drop);
     BrakeType    brakeType() const;
     void         setBrakeType(BrakeType type);
+    // PAT/PMT of the input, kept up to date while ingesting.
+    const TS::PSIDemux &psiDemux() const;
+    // Shared by all clients requesting the same filter.
+    QSharedPointer<StreamFilter> streamFilter(const StreamFilter::Spec &spec);
+    TS::TimeShiftRing *timeShiftRing() const;
+    void         setTimeShift(const QString &fileName, qint64 capacityBytes);
+    HLSSegmenter *hlsSegmenter() const;
+    QSharedPointer<HLSHandler> hlsHandler() const;
+    void         setHLSEnabled(bool enable);
+    // Per-PID continuity, errors and bitrate of the input as received,
+    // i.e., before anything of ours could have dropped packets.
+    const TS::PIDAnalyzer &pidAnalyzer() const;
+    const IngestStats &ingestStats() const;
+    stats::Histogram       &latencyHistogram();
+    const stats::Histogram &latencyHistogram() const;
+    QSharedPointer<StatsHandler> statsHandler() const;
+    void         setStatsEnabled(bool enable);
+    bool         isProfilingEnabled() const;
+    void         setProfilingEnabled(bool enable);
 
     void initInput();
     void finalizeInput();
 
+private:
+    QByteArray readInput(qint64 maxSize);
+    QByteArray peekInput(qint64 maxSize);
+    QByteArray takeReplayInput(qint64 maxSize, bool isPeek);
+    void scheduleReplayInput();
+    void updateStreamFilters();
+    // After a well-formed packet: Resets the consecutive error count,
+    // and settles on the packet size if it was being detected.
+    void acceptPacketSize(qint64 readSize);
+
 signals:
 
 private slots:
+    void processReplayInput();
     void handleStreamClientDestroyed(QObject *obj);
     void handleHTTPServerClientDestroyed(QObject *obj);
 
@@ -104,6 +184,8 @@ public slots:
     void initInputSlot();
     void processInput();
     void shutdown(int sigNum = 0, const QString &sigStr = QString());
+    // Logs per-stage processing times since the previous dump.
+    void dumpProfile();
 };
 
 
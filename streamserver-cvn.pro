@@ -6,10 +6,14 @@ SUBDIRS += \
     streamserver-cvn-cli \
     ts-dump \
     ts-split \
+    ts-loadgen \
+    ts-gen \
     tests
 
 libmedia.depends             = libinfra
 streamserver-cvn-cli.depends = libinfra libmedia
 ts-dump.depends              = libinfra libmedia
 ts-split.depends             = libinfra libmedia
+ts-loadgen.depends           = libinfra libmedia
+ts-gen.depends               = libinfra libmedia
 tests.depends                = libinfra libmedia streamserver-cvn-cli ts-dump ts-split
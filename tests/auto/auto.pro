@@ -2,4 +2,5 @@ TEMPLATE = subdirs
 SUBDIRS = \
     libinfra \
     libmedia \
-    streamserver-cvn-cli
+    streamserver-cvn-cli \
+    ts-dump
@@ -0,0 +1,118 @@
+#include <QtTest>
+
+#include "histogram.h"
+
+using namespace SSCvn;
+
+class TestHistogram : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void invalidArguments();
+    void empty();
+    void exactSmallValues();
+    void relativePrecision_data();
+    void relativePrecision();
+    void percentiles();
+    void highestTrackableValue();
+    void reset();
+};
+
+void TestHistogram::invalidArguments()
+{
+    QVERIFY_EXCEPTION_THROWN(stats::Histogram(100), std::invalid_argument);
+}
+
+void TestHistogram::empty()
+{
+    stats::Histogram histogram;
+    QCOMPARE(histogram.count(), quint64(0));
+    QCOMPARE(histogram.min(), quint64(0));
+    QCOMPARE(histogram.max(), quint64(0));
+    QCOMPARE(histogram.valueAtPercentile(50), quint64(0));
+}
+
+void TestHistogram::exactSmallValues()
+{
+    stats::Histogram histogram;
+    for (quint64 value = 0; value < 128; value++)
+        histogram.record(value);
+
+    QCOMPARE(histogram.count(), quint64(128));
+    QCOMPARE(histogram.sum(), quint64(127 * 128 / 2));
+    QCOMPARE(histogram.min(), quint64(0));
+    QCOMPARE(histogram.max(), quint64(127));
+    QCOMPARE(histogram.valueAtPercentile(50), quint64(63));
+    QCOMPARE(histogram.valueAtPercentile(100), quint64(127));
+}
+
+void TestHistogram::relativePrecision_data()
+{
+    QTest::addColumn<quint64>("value");
+
+    QTest::newRow("128")      << quint64(128);
+    QTest::newRow("129")      << quint64(129);
+    QTest::newRow("1000")     << quint64(1000);
+    QTest::newRow("65535")    << quint64(65535);
+    QTest::newRow("65536")    << quint64(65536);
+    QTest::newRow("12345678") << quint64(12345678);
+}
+
+void TestHistogram::relativePrecision()
+{
+    QFETCH(quint64, value);
+
+    // Make max() not cap the result, to see the bucket's bound.
+    stats::Histogram histogram;
+    histogram.record(value);
+    histogram.record(value * 2);
+
+    const quint64 reported = histogram.valueAtPercentile(50);
+    QVERIFY2(reported >= value, qPrintable(QString::number(reported)));
+    QVERIFY2(reported - value <= value / 64, qPrintable(QString::number(reported)));
+}
+
+void TestHistogram::percentiles()
+{
+    stats::Histogram histogram;
+    // 990 fast, 9 slow, 1 very slow.
+    for (int i = 0; i < 990; i++)
+        histogram.record(100);
+    for (int i = 0; i < 9; i++)
+        histogram.record(5000);
+    histogram.record(200000);
+
+    QCOMPARE(histogram.valueAtPercentile(50), quint64(100));
+    QCOMPARE(histogram.valueAtPercentile(99), quint64(100));
+    const quint64 p999 = histogram.valueAtPercentile(99.9);
+    QVERIFY(p999 >= 5000 && p999 < 5000 + 5000 / 64);
+    QCOMPARE(histogram.valueAtPercentile(100), quint64(200000));
+    QCOMPARE(histogram.max(), quint64(200000));
+}
+
+void TestHistogram::highestTrackableValue()
+{
+    stats::Histogram histogram(1000);
+    histogram.record(5000);
+    QCOMPARE(histogram.max(), quint64(1000));
+    QCOMPARE(histogram.valueAtPercentile(100), quint64(1000));
+}
+
+void TestHistogram::reset()
+{
+    stats::Histogram histogram;
+    histogram.record(42);
+    histogram.reset();
+    QCOMPARE(histogram.count(), quint64(0));
+    QCOMPARE(histogram.sum(), quint64(0));
+    QCOMPARE(histogram.valueAtPercentile(99), quint64(0));
+
+    histogram.record(7);
+    QCOMPARE(histogram.min(), quint64(7));
+    QCOMPARE(histogram.max(), quint64(7));
+}
+
+QTEST_APPLESS_MAIN(TestHistogram)
+
+#include "tst_histogram.moc"
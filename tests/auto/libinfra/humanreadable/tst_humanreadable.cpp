@@ -2,6 +2,7 @@
 
 #include "humanreadable.h"
 
+#include <limits>
 #include <QDebug>
 
 using namespace HumanReadable;
@@ -12,6 +13,8 @@ class TestHumanReadable : public QObject
 
 private slots:
     void hexdumpEmpty();
+    void timeDurationToMsec_data();
+    void timeDurationToMsec();
 };
 
 void TestHumanReadable::hexdumpEmpty()
@@ -21,5 +24,43 @@ void TestHumanReadable::hexdumpEmpty()
     QCOMPARE(result, QString("(empty)"));
 }
 
+void TestHumanReadable::timeDurationToMsec_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<qint64>("msec");
+
+    QTest::newRow("plain seconds") << "90"      << true  << qint64(90000);
+    QTest::newRow("seconds")       << "30s"     << true  << qint64(30000);
+    QTest::newRow("milliseconds")  << "1500ms"  << true  << qint64(1500);
+    QTest::newRow("minutes")       << "2min"    << true  << qint64(120000);
+    QTest::newRow("combined")      << "1h30min" << true  << qint64(5400000);
+    QTest::newRow("spaced")        << " 1min 5s " << true << qint64(65000);
+    QTest::newRow("empty")         << ""        << false << qint64(-1);
+    QTest::newRow("negative")      << "-5"      << false << qint64(-1);
+    QTest::newRow("unknown unit")  << "5x"      << false << qint64(-1);
+    QTest::newRow("trailing junk") << "5s foo"  << false << qint64(-1);
+
+    const qint64 msecMax = std::numeric_limits<qint64>::max();
+    QTest::newRow("huge seconds")  << "9223372036854775807" << true << msecMax;
+    QTest::newRow("huge digits")   << "99999999999999999999" << true << msecMax;
+    QTest::newRow("huge days")     << "106751991167301d" << true << msecMax;
+    QTest::newRow("huge sum")      << "9223372036854775s 9223372036854775s" << true << msecMax;
+    QTest::newRow("maximum")       << "9223372036854775s 807ms" << true << msecMax;
+    QTest::newRow("huge unit value") << "99999999999999999999ms" << true << msecMax;
+}
+
+void TestHumanReadable::timeDurationToMsec()
+{
+    QFETCH(QString, input);
+    QFETCH(bool, ok);
+    QFETCH(qint64, msec);
+
+    bool resultOk = !ok;
+    const qint64 result = HumanReadable::timeDurationToMsec(input, &resultOk);
+    QCOMPARE(resultOk, ok);
+    QCOMPARE(result, msec);
+}
+
 QTEST_APPLESS_MAIN(TestHumanReadable)
 #include "tst_humanreadable.moc"
@@ -1,3 +1,7 @@
 TEMPLATE = subdirs
 SUBDIRS = \
-    humanreadable
+    humanreadable \
+    mpscqueue \
+    lograte \
+    histogram \
+    stageprofiler
@@ -0,0 +1,115 @@
+#include <QtTest>
+
+#include "lograte.h"
+
+using namespace SSCvn;
+
+class TestLogRate : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void invalidArguments();
+    void burstThenSummary();
+    void reasonsAreIndependent();
+    void lazyDetail();
+    void flush();
+    void flushAllPending();
+};
+
+void TestLogRate::invalidArguments()
+{
+    QVERIFY_EXCEPTION_THROWN(log::RateLimiter("errors", -1), std::invalid_argument);
+    QVERIFY_EXCEPTION_THROWN(log::RateLimiter("errors", 5, 0), std::invalid_argument);
+}
+
+void TestLogRate::burstThenSummary()
+{
+    log::RateLimiter limiter("TS packet errors", 2, 1000);
+    QVERIFY(limiter.check(0, "a"));
+    QVERIFY(limiter.check(10, "b"));
+    QVERIFY(!limiter.check(20, "c"));
+    QVERIFY(!limiter.check(30, "d"));
+    QCOMPARE(limiter.suppressedTotal(), qint64(2));
+
+    // Next interval: Summary of the previous one, and a fresh burst.
+    QTest::ignoreMessage(QtWarningMsg, "2 TS packet errors in last 1s, last: d");
+    QVERIFY(limiter.check(1000, "e"));
+    QVERIFY(limiter.check(1010, "f"));
+    QVERIFY(!limiter.check(1020, "g"));
+
+    QTest::ignoreMessage(QtWarningMsg, "1 TS packet errors in last 1s, last: g");
+    QVERIFY(limiter.check(2500, "h"));
+    QCOMPARE(limiter.suppressedTotal(), qint64(3));
+}
+
+void TestLogRate::reasonsAreIndependent()
+{
+    log::RateLimiter limiter("resyncs", 1, 1000);
+    QVERIFY(limiter.check(0, "a", "no sync byte"));
+    QVERIFY(limiter.check(0, "b", "bad distance"));
+    QVERIFY(!limiter.check(10, "c", "no sync byte"));
+    QVERIFY(limiter.check(1010, "d", "bad distance"));
+
+    QTest::ignoreMessage(QtWarningMsg, "1 resyncs (no sync byte) in last 1s, last: c");
+    QVERIFY(limiter.check(1020, "e", "no sync byte"));
+}
+
+void TestLogRate::lazyDetail()
+{
+    log::RateLimiter limiter("desyncs", 1, 1000);
+    int built = 0;
+    auto detail = [&]() { return "d" + QString::number(++built); };
+
+    // Not built for what gets through, and only once for what doesn't.
+    QVERIFY(limiter.checkLazy(0, detail));
+    QVERIFY(!limiter.checkLazy(10, detail));
+    QVERIFY(!limiter.checkLazy(20, detail));
+    QVERIFY(!limiter.checkLazy(30, detail));
+    QCOMPARE(built, 1);
+    QCOMPARE(limiter.suppressedTotal(), qint64(3));
+
+    QTest::ignoreMessage(QtWarningMsg, "3 desyncs in last 1s, first: d1");
+    QVERIFY(limiter.checkLazy(1000, detail));
+    QCOMPARE(built, 1);
+
+    // Per reason, too.
+    QVERIFY(limiter.checkLazy(1010, detail, "short read"));
+    QVERIFY(!limiter.checkLazy(1020, detail, "short read"));
+    QCOMPARE(built, 2);
+    QTest::ignoreMessage(QtWarningMsg, "1 desyncs (short read) in last 1s, first: d2");
+    QVERIFY(limiter.checkLazy(2020, detail, "short read"));
+}
+
+void TestLogRate::flush()
+{
+    log::RateLimiter limiter("send errors", 1, 1000, QtInfoMsg);
+    QVERIFY(limiter.check(0, "a"));
+    QVERIFY(!limiter.check(10, "b"));
+
+    // Interval not elapsed, yet: Nothing to summarize.
+    limiter.flush(500);
+
+    QTest::ignoreMessage(QtInfoMsg, "1 send errors in last 1s, last: b");
+    limiter.flush(1500);
+
+    // Already summarized; and the burst starts over.
+    limiter.flush(3000);
+    QVERIFY(limiter.check(3000, "c"));
+}
+
+void TestLogRate::flushAllPending()
+{
+    log::RateLimiter limiter("write errors", 1, 1000);
+    QVERIFY(limiter.check(0, "a"));
+    QVERIFY(!limiter.check(10, "b"));
+
+    // Regardless of the interval; the destructor won't log it.
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("^1 write errors in last \\d+m?s, last: b$"));
+    log::RateLimiter::flushAllPending();
+    QCOMPARE(limiter.suppressedTotal(), qint64(1));
+}
+
+QTEST_APPLESS_MAIN(TestLogRate)
+
+#include "tst_lograte.moc"
@@ -0,0 +1,102 @@
+#include <QtTest>
+
+#include "mpscqueue.h"
+
+#include <thread>
+#include <vector>
+
+using namespace SSCvn;
+
+class TestMPSCQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void capacity();
+    void pushPopInOrder();
+    void full();
+    void multipleProducers();
+};
+
+void TestMPSCQueue::capacity()
+{
+    QVERIFY_EXCEPTION_THROWN(BoundedMPSCQueue<int>(1), std::invalid_argument);
+    QCOMPARE(BoundedMPSCQueue<int>(2).capacity(), size_t(2));
+    QCOMPARE(BoundedMPSCQueue<int>(1000).capacity(), size_t(1024));
+}
+
+void TestMPSCQueue::pushPopInOrder()
+{
+    BoundedMPSCQueue<QString> queue(4);
+    QString value;
+    QVERIFY(!queue.tryPop(&value));
+
+    // Wrap around a couple of times.
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 3; i++)
+            QVERIFY(queue.tryPush(QString::number(round * 10 + i)));
+        for (int i = 0; i < 3; i++) {
+            QVERIFY(queue.tryPop(&value));
+            QCOMPARE(value, QString::number(round * 10 + i));
+        }
+        QVERIFY(!queue.tryPop(&value));
+    }
+}
+
+void TestMPSCQueue::full()
+{
+    BoundedMPSCQueue<int> queue(4);
+    for (int i = 0; i < 4; i++)
+        QVERIFY(queue.tryPush(std::move(i)));
+    QVERIFY(!queue.tryPush(4));
+
+    int value = -1;
+    QVERIFY(queue.tryPop(&value));
+    QCOMPARE(value, 0);
+    QVERIFY(queue.tryPush(5));
+    QVERIFY(!queue.tryPush(6));
+}
+
+void TestMPSCQueue::multipleProducers()
+{
+    const int producerCount = 4;
+    const int perProducer = 20000;
+    BoundedMPSCQueue<int> queue(256);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producerCount; p++) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < perProducer; i++) {
+                while (!queue.tryPush(p * perProducer + i))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    // Each producer's values have to arrive in order, and none may be lost.
+    std::vector<int> nextPerProducer(producerCount, 0);
+    bool inOrder = true;
+    int received = 0;
+    while (received < producerCount * perProducer) {
+        int value;
+        if (!queue.tryPop(&value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int p = value / perProducer;
+        if (value % perProducer != nextPerProducer[p])
+            inOrder = false;
+        nextPerProducer[p]++;
+        received++;
+    }
+
+    for (std::thread &producer : producers)
+        producer.join();
+    QVERIFY(inOrder);
+    int value;
+    QVERIFY(!queue.tryPop(&value));
+}
+
+QTEST_APPLESS_MAIN(TestMPSCQueue)
+
+#include "tst_mpscqueue.moc"
@@ -0,0 +1,79 @@
+#include <QtTest>
+
+#include "stageprofiler.h"
+
+using namespace SSCvn;
+
+class TestStageProfiler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void disabledByDefault();
+    void timesWhenEnabled();
+    void snapshotAll();
+};
+
+void TestStageProfiler::cleanup()
+{
+    stats::ProfileStage::setEnabled(false);
+}
+
+void TestStageProfiler::disabledByDefault()
+{
+    QVERIFY(!stats::ProfileStage::isEnabled());
+
+    stats::ProfileStage stage("disabled");
+    {
+        stats::StageTimer timer(stage);
+    }
+    QCOMPARE(stage.count(), quint64(0));
+    QCOMPARE(stage.nanosecs(), quint64(0));
+}
+
+void TestStageProfiler::timesWhenEnabled()
+{
+    stats::ProfileStage::setEnabled(true);
+
+    stats::ProfileStage stage("enabled");
+    {
+        stats::StageTimer timer(stage);
+        QThread::msleep(2);
+        timer.stop();
+        // Stopping again, or destruction, must not add once more.
+        timer.stop();
+    }
+    QCOMPARE(stage.count(), quint64(1));
+    QVERIFY(stage.nanosecs() >= 2 * 1000 * 1000);
+}
+
+void TestStageProfiler::snapshotAll()
+{
+    stats::ProfileStage::setEnabled(true);
+
+    stats::ProfileStage stageB("b stage");
+    stats::ProfileStage stageA("a stage");
+    stageA.add(100);
+    stageA.add(50);
+
+    {
+        const QList<stats::ProfileStage::Snapshot> snapshots = stats::ProfileStage::snapshotAll();
+        QCOMPARE(snapshots.length(), 2);
+        QCOMPARE(snapshots.at(0).name, QString("a stage"));
+        QCOMPARE(snapshots.at(0).nanosecs, quint64(150));
+        QCOMPARE(snapshots.at(0).count, quint64(2));
+        QCOMPARE(snapshots.at(1).name, QString("b stage"));
+        QCOMPARE(snapshots.at(1).count, quint64(0));
+    }
+
+    {
+        stats::ProfileStage stageC("c stage");
+        QCOMPARE(stats::ProfileStage::snapshotAll().length(), 3);
+    }
+    QCOMPARE(stats::ProfileStage::snapshotAll().length(), 2);
+}
+
+QTEST_APPLESS_MAIN(TestStageProfiler)
+
+#include "tst_stageprofiler.moc"
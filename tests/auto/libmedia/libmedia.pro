@@ -1,3 +1,9 @@
 TEMPLATE = subdirs
 SUBDIRS = \
-    tsparser
+    tsparser \
+    tstimeshiftring \
+    tsstreamgenerator \
+    tspsi \
+    tskeyframe \
+    tspidanalyzer \
+    tspacketview
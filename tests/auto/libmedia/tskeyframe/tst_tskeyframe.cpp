@@ -0,0 +1,157 @@
+#include <QtTest>
+
+#include "tskeyframe.h"
+#include "tspacketview.h"
+#include "tspsi.h"
+#include "tsstreamgenerator.h"
+
+Q_DECLARE_METATYPE(TS::KeyframeDetector::Codec)
+
+class TestKeyframe : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void randomAccessPoint_data();
+    void randomAccessPoint();
+    void generatedStream();
+    void unknownPID();
+    void videoPIDsOnly();
+};
+
+void TestKeyframe::randomAccessPoint_data()
+{
+    using Codec = TS::KeyframeDetector::Codec;
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<Codec>("codec");
+    QTest::addColumn<bool>("expected");
+
+    QTest::newRow("h264 idr")          << QByteArray("\x00\x00\x00\x01\x65\x88", 6) << Codec::H264 << true;
+    QTest::newRow("h264 aud, idr")     << QByteArray("\x00\x00\x00\x01\x09\xf0\x00\x00\x01\x65", 10) << Codec::H264 << true;
+    QTest::newRow("h264 sps")          << QByteArray("\x00\x00\x01\x67\x64\x00", 6) << Codec::H264 << true;
+    QTest::newRow("h264 non-idr")      << QByteArray("\x00\x00\x00\x01\x09\xf0\x00\x00\x01\x41", 10) << Codec::H264 << false;
+    QTest::newRow("h264 truncated")    << QByteArray("\x00\x00\x01", 3) << Codec::H264 << false;
+    QTest::newRow("h264 one zero")     << QByteArray("\xff\x00\x01\x65", 4) << Codec::H264 << false;
+    QTest::newRow("hevc idr_w_radl")   << QByteArray("\x00\x00\x01\x26\x01", 5) << Codec::HEVC << true;
+    QTest::newRow("hevc cra")          << QByteArray("\x00\x00\x01\x2a\x01", 5) << Codec::HEVC << true;
+    QTest::newRow("hevc vps")          << QByteArray("\x00\x00\x01\x40\x01", 5) << Codec::HEVC << true;
+    QTest::newRow("hevc trail_r")      << QByteArray("\x00\x00\x01\x02\x01", 5) << Codec::HEVC << false;
+    QTest::newRow("hevc aud")          << QByteArray("\x00\x00\x01\x46\x01", 5) << Codec::HEVC << false;
+    QTest::newRow("mpeg2 sequence")    << QByteArray("\x00\x00\x01\xb3\x14", 5) << Codec::MPEG2Video << true;
+    QTest::newRow("mpeg2 picture")     << QByteArray("\x00\x00\x01\x00\x14", 5) << Codec::MPEG2Video << false;
+    QTest::newRow("unknown")           << QByteArray("\x00\x00\x01\x65\x88", 5) << Codec::Unknown << false;
+}
+
+void TestKeyframe::randomAccessPoint()
+{
+    using Codec = TS::KeyframeDetector::Codec;
+    QFETCH(QByteArray, data);
+    QFETCH(Codec, codec);
+    QFETCH(bool, expected);
+
+    const quint8 *const bytes = reinterpret_cast<const quint8 *>(data.constData());
+    QCOMPARE(TS::KeyframeDetector::containsRandomAccessPoint(bytes, data.length(), codec), expected);
+
+    // Found the same behind a long stretch of slice data, too.
+    QByteArray padded(1000, '\x11');
+    padded[500] = '\x01';
+    padded.append(data);
+    const quint8 *const paddedBytes = reinterpret_cast<const quint8 *>(padded.constData());
+    QCOMPARE(TS::KeyframeDetector::containsRandomAccessPoint(paddedBytes, padded.length(), codec), expected);
+}
+
+void TestKeyframe::generatedStream()
+{
+    TS::StreamGenerator::Config config;
+    config.randomAccessIntervalNanosecs = 500000000;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(10000);
+
+    TS::PSIDemux psi;
+    TS::KeyframeDetector detector;
+    QObject::connect(&psi, &TS::PSIDemux::pmtChanged, [&]() { detector.update(psi); });
+
+    int randomAccessCount = 0;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic) {
+        QByteArray packetBytes = input.mid(pos, TS::PacketView::sizeBasic);
+        const TS::PacketView view(packetBytes);
+        psi.addPacket(view);
+        if (detector.pidCodec(config.videoPID) == TS::KeyframeDetector::Codec::Unknown)
+            continue;
+
+        // Scanning agrees with the generator's random_access_indicator.
+        const bool flagged = view.randomAccessIndicator();
+        QCOMPARE(detector.scanPacket(view), flagged);
+        if (!flagged)
+            continue;
+        randomAccessCount++;
+
+        // And still finds it with the flag cleared.
+        packetBytes[5] = static_cast<char>(packetBytes.at(5) & ~0x40);
+        const TS::PacketView strippedView(packetBytes);
+        QVERIFY(!strippedView.randomAccessIndicator());
+        QVERIFY(detector.isRandomAccess(strippedView));
+    }
+
+    QCOMPARE(detector.pidCodec(config.videoPID), TS::KeyframeDetector::Codec::H264);
+    QCOMPARE(detector.pidCodec(config.audioPID), TS::KeyframeDetector::Codec::Unknown);
+    QVERIFY(randomAccessCount >= 5);
+    QCOMPARE(detector.detectedCount(), qint64(randomAccessCount));
+}
+
+void TestKeyframe::unknownPID()
+{
+    TS::KeyframeDetector detector;
+
+    // An IDR PES start, but the PID isn't known to carry video.
+    QByteArray packetBytes(TS::PacketView::sizeBasic, '\xff');
+    const QByteArray start("\x47\x41\x00\x10"  // PUSI, PID 0x100, payload only
+                           "\x00\x00\x01\xe0\x00\x00\x80\x00\x00"  // PES header, no optional fields
+                           "\x00\x00\x00\x01\x65", 4 + 9 + 5);
+    packetBytes.replace(0, start.length(), start);
+    const TS::PacketView view(packetBytes);
+    QVERIFY(!detector.scanPacket(view));
+    QVERIFY(!detector.isRandomAccess(view));
+    QCOMPARE(detector.detectedCount(), qint64(0));
+}
+
+void TestKeyframe::videoPIDsOnly()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(1000);
+
+    // Adaptation field only, with random_access_indicator, on the audio PID.
+    QByteArray packetBytes(TS::PacketView::sizeBasic, '\xff');
+    packetBytes[0] = '\x47';
+    packetBytes[1] = static_cast<char>(config.audioPID >> 8);
+    packetBytes[2] = static_cast<char>(config.audioPID & 0xff);
+    packetBytes[3] = '\x20';
+    packetBytes[4] = static_cast<char>(183);
+    packetBytes[5] = '\x40';
+    const TS::PacketView view(packetBytes);
+    QVERIFY(view.randomAccessIndicator());
+
+    // Without PSI, any PID's flag is trusted.
+    TS::KeyframeDetector detector;
+    QVERIFY(detector.isRandomAccess(view));
+
+    // With video known, only the video PIDs'.
+    TS::PSIDemux psi;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic)
+        psi.addPacket(TS::PacketView(input.constData() + pos));
+    detector.update(psi);
+    QVERIFY(!detector.isRandomAccess(view));
+
+    packetBytes[1] = static_cast<char>(config.videoPID >> 8);
+    packetBytes[2] = static_cast<char>(config.videoPID & 0xff);
+    QVERIFY(detector.isRandomAccess(TS::PacketView(packetBytes)));
+
+    detector.clear();
+    packetBytes[1] = static_cast<char>(config.audioPID >> 8);
+    packetBytes[2] = static_cast<char>(config.audioPID & 0xff);
+    QVERIFY(detector.isRandomAccess(TS::PacketView(packetBytes)));
+}
+
+QTEST_APPLESS_MAIN(TestKeyframe)
+#include "tst_tskeyframe.moc"
@@ -0,0 +1,81 @@
+#include <QtTest>
+
+#include "tspacketview.h"
+#include "tsstreamgenerator.h"
+
+class TestPacketView : public QObject
+{
+    Q_OBJECT
+
+    static QByteArray makePacket(quint16 pid, quint8 afc, int afLength, quint8 afFlags);
+
+private slots:
+    void stuffingOnly_data();
+    void stuffingOnly();
+    void generatedStream();
+};
+
+// All 0xff after the header and (if afLength >= 1) the flags byte,
+// like stuffing bytes and payload padding both would be.
+QByteArray TestPacketView::makePacket(quint16 pid, quint8 afc, int afLength, quint8 afFlags)
+{
+    QByteArray bytes(TS::PacketView::sizeBasic, '\xff');
+    bytes[0] = '\x47';
+    bytes[1] = static_cast<char>(pid >> 8);
+    bytes[2] = static_cast<char>(pid & 0xff);
+    bytes[3] = static_cast<char>(afc << 4 | 0x07);
+    if (afc & 0x2) {
+        bytes[4] = static_cast<char>(afLength);
+        if (afLength >= 1)
+            bytes[5] = static_cast<char>(afFlags);
+    }
+    return bytes;
+}
+
+void TestPacketView::stuffingOnly_data()
+{
+    QTest::addColumn<QByteArray>("packet");
+    QTest::addColumn<bool>("expected");
+
+    QTest::newRow("af only, all stuffing")  << makePacket(0x100, 0x2, 183, 0x00) << true;
+    QTest::newRow("af only, pcr")           << makePacket(0x100, 0x2, 183, 0x10) << false;
+    QTest::newRow("af only, discontinuity") << makePacket(0x100, 0x2, 183, 0x80) << false;
+    QTest::newRow("af only, private data")  << makePacket(0x100, 0x2, 183, 0x02) << false;
+    QTest::newRow("af and payload")         << makePacket(0x100, 0x3, 100, 0x00) << false;
+    QTest::newRow("payload only")           << makePacket(0x100, 0x1,   0, 0x00) << false;
+    QTest::newRow("null packet")            << makePacket(TS::PacketView::pidNullPacket, 0x1, 0, 0x00) << false;
+}
+
+void TestPacketView::stuffingOnly()
+{
+    QFETCH(QByteArray, packet);
+    QFETCH(bool, expected);
+
+    const TS::PacketView view(packet);
+    QVERIFY(view.isSyncByteValid());
+    QCOMPARE(view.isStuffingOnly(), expected);
+}
+
+void TestPacketView::generatedStream()
+{
+    // Fills up with null packets, but has no stuffing-only ones:
+    // PES packets get padded by adaptation fields that come with payload.
+    TS::StreamGenerator generator;
+    const QByteArray input = generator.generatePackets(10000);
+
+    int nullCount = 0;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic) {
+        const TS::PacketView view(input.constData() + pos);
+        QVERIFY(view.isSyncByteValid());
+        QVERIFY(!view.isStuffingOnly());
+        if (view.isNullPacket()) {
+            QVERIFY(view.hasPayload());
+            QVERIFY(!view.hasAdaptationField());
+            nullCount++;
+        }
+    }
+    QVERIFY(nullCount > 0);
+}
+
+QTEST_APPLESS_MAIN(TestPacketView)
+#include "tst_tspacketview.moc"
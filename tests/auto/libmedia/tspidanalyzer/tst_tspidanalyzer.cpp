@@ -0,0 +1,196 @@
+#include <QtTest>
+
+#include "tspidanalyzer.h"
+#include "tspacketview.h"
+#include "tsstreamgenerator.h"
+
+class TestPIDAnalyzer : public QObject
+{
+    Q_OBJECT
+
+    // Basic packet with payload (and adaptation field, if flags are given).
+    static QByteArray makePacket(quint16 pid, quint8 cc, bool hasPayload = true, quint8 afFlags = 0);
+
+private slots:
+    void cleanStream();
+    void generatedContinuityErrors();
+    void generatedTransportErrors();
+    void duplicates();
+    void discontinuityIndicator();
+    void resetContinuity();
+};
+
+QByteArray TestPIDAnalyzer::makePacket(quint16 pid, quint8 cc, bool hasPayload, quint8 afFlags)
+{
+    QByteArray bytes(TS::PacketView::sizeBasic, '\xff');
+    bytes[0] = '\x47';
+    bytes[1] = static_cast<char>(pid >> 8);
+    bytes[2] = static_cast<char>(pid & 0xff);
+    const bool hasAF = afFlags != 0 || !hasPayload;
+    bytes[3] = static_cast<char>((hasAF ? 0x20 : 0x00) | (hasPayload ? 0x10 : 0x00) | (cc & 0x0f));
+    if (hasAF) {
+        bytes[4] = static_cast<char>(hasPayload ? 1 : 183);
+        bytes[5] = static_cast<char>(afFlags);
+    }
+    return bytes;
+}
+
+void TestPIDAnalyzer::cleanStream()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(20000);
+
+    TS::PIDAnalyzer analyzer;
+    const double nanosecsPerPacket = TS::PacketView::sizeBasic * 8 * 1e9 / config.bitrate;
+    int index = 0;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic, index++) {
+        const TS::PacketView view(input.constData() + pos);
+        QCOMPARE(analyzer.addPacket(view, static_cast<qint64>(index * nanosecsPerPacket)), TS::PIDAnalyzer::Result::OK);
+    }
+
+    const TS::PIDAnalyzer::PIDStats &totals(analyzer.totals());
+    QCOMPARE(totals.packets, quint64(20000));
+    QCOMPARE(totals.continuityErrors, quint64(0));
+    QCOMPARE(totals.duplicatePackets, quint64(0));
+    QCOMPARE(totals.transportErrors, quint64(0));
+
+    // PAT, PMT, video, audio and null packets.
+    QCOMPARE(analyzer.activePIDs().length(), 5);
+    QCOMPARE(analyzer.activePIDs().first(), quint16(0));
+    quint64 sum = 0;
+    for (quint16 pid : analyzer.activePIDs())
+        sum += analyzer.pidStats(pid).packets;
+    QCOMPARE(sum, totals.packets);
+
+    // 20000 packets are several bitrate windows' worth.
+    QVERIFY(qAbs(totals.bitrate - config.bitrate) < config.bitrate / 100);
+    const qint64 videoBitrate = analyzer.pidStats(config.videoPID).bitrate;
+    QVERIFY(videoBitrate > config.videoBitrate / 2);
+    QVERIFY(videoBitrate < config.bitrate);
+    QCOMPARE(analyzer.pidStats(0x1234).packets, quint64(0));
+}
+
+void TestPIDAnalyzer::generatedContinuityErrors()
+{
+    TS::StreamGenerator::Config config;
+    config.corruptInterval = 1000;
+    config.corruptionKind = TS::StreamGenerator::CorruptionKind::ContinuityCounter;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(10000);
+
+    TS::PIDAnalyzer analyzer;
+    int errorCount = 0;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic) {
+        const TS::PacketView view(input.constData() + pos);
+        const TS::PIDAnalyzer::Result result = analyzer.addPacket(view, 0);
+        QVERIFY(result != TS::PIDAnalyzer::Result::Duplicate);
+        if (result == TS::PIDAnalyzer::Result::ContinuityError) {
+            // Each corruption skips exactly one value.
+            QCOMPARE(int(analyzer.pidStats(view.pid()).lastGap), 1);
+            errorCount++;
+        }
+    }
+
+    QVERIFY(errorCount >= 5);
+    QVERIFY(errorCount <= 10);
+    QCOMPARE(analyzer.totals().continuityErrors, quint64(errorCount));
+    QCOMPARE(analyzer.totals().lostPackets, quint64(errorCount));
+}
+
+void TestPIDAnalyzer::generatedTransportErrors()
+{
+    TS::StreamGenerator::Config config;
+    config.corruptInterval = 100;
+    config.corruptionKind = TS::StreamGenerator::CorruptionKind::TransportErrorIndicator;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(10000);
+
+    TS::PIDAnalyzer analyzer;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic)
+        analyzer.addPacket(TS::PacketView(input.constData() + pos), 0);
+
+    QCOMPARE(analyzer.totals().transportErrors, quint64(100));
+    // Not counted as losses a second time.
+    QCOMPARE(analyzer.totals().continuityErrors, quint64(0));
+}
+
+void TestPIDAnalyzer::duplicates()
+{
+    TS::PIDAnalyzer analyzer;
+    using Result = TS::PIDAnalyzer::Result;
+
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 3)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 4)), 0), Result::OK);
+    // One repetition is allowed...
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 4)), 0), Result::Duplicate);
+    // ...a second one isn't.
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 4)), 0), Result::ContinuityError);
+    QCOMPARE(int(analyzer.pidStats(0x100).lastGap), 0);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 5)), 0), Result::OK);
+
+    // No payload: the counter doesn't advance, and isn't checked.
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 9, false)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 6)), 0), Result::OK);
+
+    // Wrap-around, and a gap across it.
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x101, 15)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x101, 0)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x101, 14)), 0), Result::ContinuityError);
+    QCOMPARE(int(analyzer.pidStats(0x101).lastGap), 13);
+
+    // Null packets aren't checked at all.
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(TS::PacketView::pidNullPacket, 0)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(TS::PacketView::pidNullPacket, 0)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(TS::PacketView::pidNullPacket, 0)), 0), Result::OK);
+
+    QCOMPARE(analyzer.pidStats(0x100).duplicatePackets, quint64(1));
+    QCOMPARE(analyzer.pidStats(0x100).continuityErrors, quint64(1));
+    QCOMPARE(analyzer.pidStats(0x100).lostPackets, quint64(0));
+    QCOMPARE(analyzer.totals().continuityErrors, quint64(2));
+    QCOMPARE(analyzer.totals().lostPackets, quint64(13));
+    QCOMPARE(analyzer.activePIDs().length(), 3);
+}
+
+void TestPIDAnalyzer::discontinuityIndicator()
+{
+    TS::PIDAnalyzer analyzer;
+    using Result = TS::PIDAnalyzer::Result;
+
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 3)), 0), Result::OK);
+    // Announced jump.
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 11, true, 0x80)), 0), Result::OK);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 12)), 0), Result::OK);
+    QCOMPARE(analyzer.pidStats(0x100).discontinuityIndicators, quint64(1));
+    QCOMPARE(analyzer.pidStats(0x100).continuityErrors, quint64(0));
+
+    // Transport errors don't count against continuity.
+    QByteArray errorPacket = makePacket(0x100, 7);
+    errorPacket[1] = static_cast<char>(errorPacket.at(1) | 0x80);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(errorPacket), 0), Result::TransportError);
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 13)), 0), Result::OK);
+    QCOMPARE(analyzer.pidStats(0x100).transportErrors, quint64(1));
+}
+
+void TestPIDAnalyzer::resetContinuity()
+{
+    TS::PIDAnalyzer analyzer;
+    using Result = TS::PIDAnalyzer::Result;
+
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 3)), 0), Result::OK);
+    analyzer.resetContinuity();
+    QCOMPARE(analyzer.addPacket(TS::PacketView(makePacket(0x100, 9)), 0), Result::OK);
+    QCOMPARE(analyzer.pidStats(0x100).packets, quint64(2));
+
+    analyzer.clear();
+    QCOMPARE(analyzer.pidStats(0x100).packets, quint64(0));
+    QVERIFY(analyzer.activePIDs().isEmpty());
+    QCOMPARE(analyzer.totals().packets, quint64(0));
+
+    QByteArray badSync = makePacket(0x100, 0);
+    badSync[0] = '\x00';
+    QVERIFY_EXCEPTION_THROWN(analyzer.addPacket(TS::PacketView(badSync), 0), std::invalid_argument);
+}
+
+QTEST_APPLESS_MAIN(TestPIDAnalyzer)
+#include "tst_tspidanalyzer.moc"
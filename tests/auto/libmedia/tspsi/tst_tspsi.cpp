@@ -0,0 +1,333 @@
+#include <QtTest>
+
+#include "tspsi.h"
+#include "tscrc32.h"
+#include "tspacketview.h"
+#include "tsstreamgenerator.h"
+
+#include <QSignalSpy>
+
+class TestPSI : public QObject
+{
+    Q_OBJECT
+
+    // Long-form section with the given body, and CRC_32 appended.
+    static QByteArray makeSection(quint8 tableId, quint16 tableIdExtension, int version, const QByteArray &body);
+    static QByteArray patSection(int version, const QList<QPair<quint16, quint16>> &programs);
+    static QByteArray pmtSection(quint16 programNumber, int version, quint16 pcrPID,
+                                 const QList<QPair<quint8, quint16>> &streams);
+    // Splits sections into as many packets as needed.
+    static QList<QByteArray> packetize(quint16 pid, const QByteArray &sections, quint8 *ccPtr);
+
+private slots:
+    void generatedStream_data();
+    void generatedStream();
+    void multiPacketSection();
+    void multipleSectionsPerPacket();
+    void versionChange();
+    void crcError();
+    void continuityGap();
+    void streamKind();
+};
+
+QByteArray TestPSI::makeSection(quint8 tableId, quint16 tableIdExtension, int version, const QByteArray &body)
+{
+    const int sectionLength = 5 + body.length() + 4;
+    QByteArray section;
+    section.append(static_cast<char>(tableId));
+    section.append(static_cast<char>(0xb0 | (sectionLength >> 8)));
+    section.append(static_cast<char>(sectionLength & 0xff));
+    section.append(static_cast<char>(tableIdExtension >> 8));
+    section.append(static_cast<char>(tableIdExtension & 0xff));
+    section.append(static_cast<char>(0xc1 | (version << 1)));  // current_next_indicator set
+    section.append('\x00');  // section_number
+    section.append('\x00');  // last_section_number
+    section.append(body);
+
+    const quint32 crc = TS::crc32Mpeg2(section);
+    section.append(static_cast<char>(crc >> 24));
+    section.append(static_cast<char>(crc >> 16));
+    section.append(static_cast<char>(crc >>  8));
+    section.append(static_cast<char>(crc));
+    return section;
+}
+
+QByteArray TestPSI::patSection(int version, const QList<QPair<quint16, quint16>> &programs)
+{
+    QByteArray body;
+    for (const auto &program : programs) {
+        body.append(static_cast<char>(program.first >> 8));
+        body.append(static_cast<char>(program.first & 0xff));
+        body.append(static_cast<char>(0xe0 | (program.second >> 8)));
+        body.append(static_cast<char>(program.second & 0xff));
+    }
+    return makeSection(0x00, 1, version, body);
+}
+
+QByteArray TestPSI::pmtSection(quint16 programNumber, int version, quint16 pcrPID,
+                               const QList<QPair<quint8, quint16>> &streams)
+{
+    QByteArray body;
+    body.append(static_cast<char>(0xe0 | (pcrPID >> 8)));
+    body.append(static_cast<char>(pcrPID & 0xff));
+    body.append('\xf0');  // program_info_length
+    body.append('\x00');
+    for (const auto &stream : streams) {
+        body.append(static_cast<char>(stream.first));
+        body.append(static_cast<char>(0xe0 | (stream.second >> 8)));
+        body.append(static_cast<char>(stream.second & 0xff));
+        body.append('\xf0');  // ES_info_length
+        body.append('\x00');
+    }
+    return makeSection(0x02, programNumber, version, body);
+}
+
+QList<QByteArray> TestPSI::packetize(quint16 pid, const QByteArray &sections, quint8 *ccPtr)
+{
+    QList<QByteArray> packets;
+    int pos = 0;
+    bool first = true;
+    do {
+        QByteArray packet;
+        packet.append('\x47');
+        packet.append(static_cast<char>((first ? 0x40 : 0x00) | (pid >> 8)));
+        packet.append(static_cast<char>(pid & 0xff));
+        packet.append(static_cast<char>(0x10 | *ccPtr));
+        *ccPtr = (*ccPtr + 1) & 0x0f;
+        if (first)
+            packet.append('\x00');  // pointer_field
+        const QByteArray chunk = sections.mid(pos, TS::PacketView::sizeBasic - packet.length());
+        packet.append(chunk);
+        pos += chunk.length();
+        packet.append(QByteArray(TS::PacketView::sizeBasic - packet.length(), '\xff'));
+        packets.append(packet);
+        first = false;
+    } while (pos < sections.length());
+    return packets;
+}
+
+void TestPSI::generatedStream_data()
+{
+    QTest::addColumn<int>("packetSize");
+    QTest::addColumn<int>("prefixLength");
+
+    QTest::newRow("188") << 188 << 0;
+    QTest::newRow("192") << 192 << 4;
+}
+
+void TestPSI::generatedStream()
+{
+    QFETCH(int, packetSize);
+    QFETCH(int, prefixLength);
+
+    TS::StreamGenerator::Config config;
+    config.packetSize = packetSize;
+    TS::StreamGenerator generator(config);
+
+    TS::PSIDemux demux;
+    QSignalSpy patSpy(&demux, &TS::PSIDemux::patChanged);
+    QSignalSpy pmtSpy(&demux, &TS::PSIDemux::pmtChanged);
+
+    // A bit more than a second; PSI repeats every 100 ms.
+    const QByteArray bytes = generator.generatePackets(3000);
+    for (int pos = 0; pos + packetSize <= bytes.length(); pos += packetSize)
+        demux.addPacket(TS::PacketView(bytes.constData() + pos + prefixLength));
+
+    QCOMPARE(patSpy.count(), 1);
+    QCOMPARE(pmtSpy.count(), 1);
+    QCOMPARE(demux.patVersion(), 0);
+    QCOMPARE(demux.transportStreamId(), config.transportStreamId);
+    QVERIFY(demux.isPSIPID(TS::PSIDemux::pidPAT));
+    QVERIFY(demux.isPSIPID(config.pmtPID));
+    QVERIFY(!demux.isPSIPID(config.videoPID));
+
+    QCOMPARE(demux.programs().length(), 1);
+    const TS::ProgramInfo *programPtr = demux.program(config.programNumber);
+    QVERIFY(programPtr);
+    QVERIFY(programPtr->hasPMT());
+    QCOMPARE(programPtr->pmtPID, config.pmtPID);
+    QCOMPARE(programPtr->pcrPID, config.videoPID);
+    QCOMPARE(programPtr->streams.length(), 2);
+    QCOMPARE(programPtr->streams.at(0).pid, config.videoPID);
+    QCOMPARE(programPtr->streams.at(0).kind(), TS::ElementaryStreamInfo::Kind::Video);
+    QCOMPARE(programPtr->streams.at(0).streamTypeName(), QString("H.264"));
+    QCOMPARE(programPtr->streams.at(1).pid, config.audioPID);
+    QCOMPARE(programPtr->streams.at(1).kind(), TS::ElementaryStreamInfo::Kind::Audio);
+
+    // All but the first PAT and PMT were dismissed as repetitions.
+    QVERIFY(demux.sectionCount() > 2);
+    QCOMPARE(demux.sectionRepeatCount(), demux.sectionCount() - 2);
+    QCOMPARE(demux.crcErrorCount(), qint64(0));
+    QCOMPARE(demux.sectionErrorCount(), qint64(0));
+}
+
+void TestPSI::multiPacketSection()
+{
+    QList<QPair<quint16, quint16>> programs;
+    for (quint16 i = 1; i <= 100; i++)
+        programs.append(qMakePair(i, static_cast<quint16>(0x1000 + i)));
+    const QByteArray pat = patSection(0, programs);
+    QVERIFY(pat.length() > 2 * TS::PacketView::sizeBasic);
+
+    quint8 cc = 0;
+    const QList<QByteArray> packets = packetize(TS::PSIDemux::pidPAT, pat, &cc);
+    QCOMPARE(packets.length(), 3);
+
+    TS::SectionAssembler assembler;
+    QList<QByteArray> sections;
+    for (const QByteArray &packet : packets)
+        assembler.addPacket(TS::PacketView(packet), &sections);
+    QCOMPARE(sections.length(), 1);
+    QCOMPARE(sections.first(), pat);
+    QCOMPARE(assembler.discardCount(), qint64(0));
+
+    TS::PSIDemux demux;
+    for (const QByteArray &packet : packets)
+        demux.addPacket(TS::PacketView(packet));
+    QCOMPARE(demux.programs().length(), 100);
+    QCOMPARE(demux.programs().last().pmtPID, quint16(0x1000 + 100));
+}
+
+void TestPSI::multipleSectionsPerPacket()
+{
+    const QByteArray pmt1 = pmtSection(1, 0, 0x100, {{0x1b, 0x100}});
+    const QByteArray pmt2 = pmtSection(2, 0, 0x200, {{0x02, 0x200}, {0x04, 0x201}});
+
+    quint8 cc = 0;
+    const QList<QByteArray> packets = packetize(0x1000, pmt1 + pmt2, &cc);
+    QCOMPARE(packets.length(), 1);
+
+    TS::SectionAssembler assembler;
+    QList<QByteArray> sections;
+    assembler.addPacket(TS::PacketView(packets.first()), &sections);
+    QCOMPARE(sections.length(), 2);
+    QCOMPARE(sections.at(0), pmt1);
+    QCOMPARE(sections.at(1), pmt2);
+
+    // Both programs share a PMT PID.
+    TS::PSIDemux demux;
+    quint8 patCC = 0;
+    demux.addPacket(TS::PacketView(packetize(TS::PSIDemux::pidPAT, patSection(0, {{1, 0x1000}, {2, 0x1000}}), &patCC).first()));
+    demux.addPacket(TS::PacketView(packets.first()));
+    QVERIFY(demux.program(1) && demux.program(1)->hasPMT());
+    QVERIFY(demux.program(2) && demux.program(2)->hasPMT());
+    QCOMPARE(demux.program(2)->streams.length(), 2);
+    QCOMPARE(demux.program(2)->pcrPID, quint16(0x200));
+}
+
+void TestPSI::versionChange()
+{
+    TS::PSIDemux demux;
+    QSignalSpy patSpy(&demux, &TS::PSIDemux::patChanged);
+    QSignalSpy pmtSpy(&demux, &TS::PSIDemux::pmtChanged);
+    QSignalSpy removedSpy(&demux, &TS::PSIDemux::programRemoved);
+
+    quint8 patCC = 0, pmtCC = 0;
+    auto feed = [&demux](const QList<QByteArray> &packets) {
+        for (const QByteArray &packet : packets)
+            demux.addPacket(TS::PacketView(packet));
+    };
+
+    feed(packetize(TS::PSIDemux::pidPAT, patSection(0, {{0, 0x10}, {1, 0x1000}, {2, 0x1001}}), &patCC));
+    feed(packetize(0x1000, pmtSection(1, 0, 0x100, {{0x1b, 0x100}}), &pmtCC));
+    feed(packetize(0x1000, pmtSection(1, 0, 0x100, {{0x1b, 0x100}}), &pmtCC));
+    QCOMPARE(patSpy.count(), 1);
+    QCOMPARE(pmtSpy.count(), 1);
+    QCOMPARE(demux.networkPID(), quint16(0x10));
+    QCOMPARE(demux.programs().length(), 2);
+
+    // New PMT version.
+    feed(packetize(0x1000, pmtSection(1, 1, 0x100, {{0x1b, 0x100}, {0x0f, 0x101}}), &pmtCC));
+    QCOMPARE(pmtSpy.count(), 2);
+    QCOMPARE(pmtSpy.last().at(0).value<quint16>(), quint16(1));
+    QCOMPARE(demux.program(1)->pmtVersion, 1);
+    QCOMPARE(demux.program(1)->streams.length(), 2);
+
+    // New PAT version drops program 2, keeps what's known about program 1.
+    feed(packetize(TS::PSIDemux::pidPAT, patSection(1, {{1, 0x1000}}), &patCC));
+    QCOMPARE(patSpy.count(), 2);
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(removedSpy.first().at(0).value<quint16>(), quint16(2));
+    QCOMPARE(demux.patVersion(), 1);
+    QCOMPARE(demux.networkPID(), quint16(0x1fff));
+    QVERIFY(!demux.isPSIPID(0x1001));
+    QVERIFY(!demux.program(2));
+    QVERIFY(demux.program(1)->hasPMT());
+    QCOMPARE(demux.program(1)->streams.length(), 2);
+
+    demux.reset();
+    QCOMPARE(demux.patVersion(), -1);
+    QVERIFY(demux.programs().isEmpty());
+    QVERIFY(!demux.isPSIPID(0x1000));
+}
+
+void TestPSI::crcError()
+{
+    TS::PSIDemux demux;
+    QSignalSpy errorSpy(&demux, &TS::PSIDemux::sectionError);
+
+    QByteArray pat = patSection(0, {{1, 0x1000}});
+    pat[9] = static_cast<char>(pat.at(9) ^ 0x01);
+
+    quint8 cc = 0;
+    demux.addPacket(TS::PacketView(packetize(TS::PSIDemux::pidPAT, pat, &cc).first()));
+    QCOMPARE(demux.crcErrorCount(), qint64(1));
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy.first().at(0).value<quint16>(), quint16(0));
+    QCOMPARE(demux.patVersion(), -1);
+
+    // The intact repetition gets through.
+    demux.addPacket(TS::PacketView(packetize(TS::PSIDemux::pidPAT, patSection(0, {{1, 0x1000}}), &cc).first()));
+    QCOMPARE(demux.patVersion(), 0);
+    QCOMPARE(demux.programs().length(), 1);
+}
+
+void TestPSI::continuityGap()
+{
+    QList<QPair<quint16, quint16>> programs;
+    for (quint16 i = 1; i <= 100; i++)
+        programs.append(qMakePair(i, static_cast<quint16>(0x1000 + i)));
+
+    quint8 cc = 0;
+    QList<QByteArray> packets = packetize(TS::PSIDemux::pidPAT, patSection(0, programs), &cc);
+    QCOMPARE(packets.length(), 3);
+    packets.removeAt(1);
+
+    TS::SectionAssembler assembler;
+    QList<QByteArray> sections;
+    for (const QByteArray &packet : packets)
+        assembler.addPacket(TS::PacketView(packet), &sections);
+    QVERIFY(sections.isEmpty());
+    QCOMPARE(assembler.discardCount(), qint64(1));
+
+    // A duplicate packet is ignored, though.
+    cc = 0;
+    packets = packetize(TS::PSIDemux::pidPAT, patSection(0, programs), &cc);
+    packets.insert(1, packets.at(1));
+    for (const QByteArray &packet : packets)
+        assembler.addPacket(TS::PacketView(packet), &sections);
+    QCOMPARE(sections.length(), 1);
+}
+
+void TestPSI::streamKind()
+{
+    TS::ElementaryStreamInfo stream;
+    stream.streamType = 0x24;
+    QCOMPARE(stream.kind(), TS::ElementaryStreamInfo::Kind::Video);
+    stream.streamType = 0x03;
+    QCOMPARE(stream.kind(), TS::ElementaryStreamInfo::Kind::Audio);
+    stream.streamType = 0x86;
+    QCOMPARE(stream.kind(), TS::ElementaryStreamInfo::Kind::Other);
+    QCOMPARE(stream.streamTypeName(), QString("SCTE-35"));
+    stream.streamType = 0xc0;
+    QCOMPARE(stream.streamTypeName(), QString("type 0xc0"));
+
+    // Private data, with DVB AC-3 descriptor.
+    stream.streamType = 0x06;
+    QCOMPARE(stream.kind(), TS::ElementaryStreamInfo::Kind::Other);
+    stream.descriptors = QByteArray("\x6a\x01\x00", 3);
+    QCOMPARE(stream.kind(), TS::ElementaryStreamInfo::Kind::Audio);
+}
+
+QTEST_APPLESS_MAIN(TestPSI)
+#include "tst_tspsi.moc"
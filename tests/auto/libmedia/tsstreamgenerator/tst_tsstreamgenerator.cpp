@@ -0,0 +1,196 @@
+#include <QtTest>
+
+#include "tsstreamgenerator.h"
+#include "tscrc32.h"
+#include "tspacketview.h"
+
+#include <QHash>
+
+class TestStreamGenerator : public QObject
+{
+    Q_OBJECT
+
+    static const int packetsPerSecond = 4000000 / (TS::PacketView::sizeBasic * 8);
+
+private slots:
+    void crcCheckValue();
+    void packetSizes_data();
+    void packetSizes();
+    void psiSections();
+    void continuityAndTiming();
+    void reproducible();
+    void discontinuity();
+    void corruption();
+};
+
+void TestStreamGenerator::crcCheckValue()
+{
+    QCOMPARE(TS::crc32Mpeg2(QByteArray("123456789")), quint32(0x0376e6e7));
+
+    // Continuing over split data gives the same result.
+    QCOMPARE(TS::crc32Mpeg2(QByteArray("6789"), TS::crc32Mpeg2(QByteArray("12345"))),
+             quint32(0x0376e6e7));
+}
+
+void TestStreamGenerator::packetSizes_data()
+{
+    QTest::addColumn<int>("packetSize");
+    QTest::addColumn<int>("prefixLength");
+
+    QTest::newRow("188") << 188 << 0;
+    QTest::newRow("192") << 192 << 4;
+    QTest::newRow("204") << 204 << 0;
+    QTest::newRow("208") << 208 << 0;
+}
+
+void TestStreamGenerator::packetSizes()
+{
+    QFETCH(int, packetSize);
+    QFETCH(int, prefixLength);
+
+    TS::StreamGenerator::Config config;
+    config.packetSize = packetSize;
+    TS::StreamGenerator generator(config);
+
+    const QByteArray bytes = generator.generatePackets(100);
+    QCOMPARE(bytes.length(), 100 * packetSize);
+    QCOMPARE(generator.packetCount(), qint64(100));
+    for (int i = 0; i < 100; i++)
+        QVERIFY(TS::PacketView(bytes.constData() + i * packetSize + prefixLength).isSyncByteValid());
+}
+
+void TestStreamGenerator::psiSections()
+{
+    TS::StreamGenerator generator;
+    const QByteArray bytes = generator.generatePackets(2);
+
+    const TS::PacketView pat(bytes.constData());
+    QCOMPARE(pat.pid(), quint16(0x0000));
+    QVERIFY(pat.payloadUnitStartIndicator());
+    const TS::PacketView pmt(bytes.constData() + TS::PacketView::sizeBasic);
+    QCOMPARE(pmt.pid(), generator.config().pmtPID);
+    QVERIFY(pmt.payloadUnitStartIndicator());
+
+    for (const TS::PacketView &packet : { pat, pmt }) {
+        // Skip pointer_field; CRC over the whole section must be zero.
+        const char *section = reinterpret_cast<const char *>(packet.payload()) + 1;
+        const int sectionLength = (static_cast<quint8>(section[1]) & 0x0f) << 8 | static_cast<quint8>(section[2]);
+        QCOMPARE(TS::crc32Mpeg2(section, 3 + sectionLength), quint32(0));
+    }
+
+    // PAT points to the PMT PID.
+    const quint8 *patSection = pat.payload() + 1;
+    QCOMPARE(static_cast<quint16>((patSection[10] & 0x1f) << 8 | patSection[11]), generator.config().pmtPID);
+}
+
+void TestStreamGenerator::continuityAndTiming()
+{
+    TS::StreamGenerator generator;
+    const TS::StreamGenerator::Config &config(generator.config());
+    const QByteArray bytes = generator.generatePackets(packetsPerSecond);
+    QVERIFY(qAbs(generator.streamNanosecs() - 1000000000) < 1000000);
+
+    QHash<quint16, int> lastCC;
+    QHash<quint16, int> packetCounts;
+    int pcrCount = 0, randomAccessCount = 0, nullCount = 0;
+    quint64 lastPCR = 0;
+    for (int i = 0; i < packetsPerSecond; i++) {
+        const TS::PacketView packet(bytes.constData() + i * TS::PacketView::sizeBasic);
+        if (packet.isNullPacket()) {
+            nullCount++;
+            continue;
+        }
+        packetCounts[packet.pid()]++;
+
+        const int cc = packet.continuityCounter();
+        if (lastCC.contains(packet.pid())) {
+            const int expected = packet.hasPayload() ? (lastCC.value(packet.pid()) + 1) & 0x0f : lastCC.value(packet.pid());
+            QCOMPARE(cc, expected);
+        }
+        lastCC[packet.pid()] = cc;
+
+        if (packet.hasPCR()) {
+            QCOMPARE(packet.pid(), config.videoPID);
+            QVERIFY(packet.pcrValue() > lastPCR || pcrCount == 0);
+            lastPCR = packet.pcrValue();
+            pcrCount++;
+        }
+        if (packet.randomAccessIndicator()) {
+            QCOMPARE(packet.pid(), config.videoPID);
+            QVERIFY(packet.payloadUnitStartIndicator());
+            randomAccessCount++;
+        }
+    }
+
+    QCOMPARE(packetCounts.value(0x0000), 10);
+    QCOMPARE(packetCounts.value(config.pmtPID), 10);
+    QVERIFY(pcrCount >= 24 && pcrCount <= 26);
+    QCOMPARE(randomAccessCount, 1);
+    QVERIFY(nullCount > 0);
+
+    // Elementary streams get about their share of the bitrate.
+    const double videoBits = packetCounts.value(config.videoPID) * 184.0 * 8;
+    QVERIFY(qAbs(videoBits - config.videoBitrate) < config.videoBitrate * 0.05);
+    const double audioBits = packetCounts.value(config.audioPID) * 184.0 * 8;
+    QVERIFY(qAbs(audioBits - config.audioBitrate) < config.audioBitrate * 0.05);
+}
+
+void TestStreamGenerator::reproducible()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator1(config), generator2(config);
+    QCOMPARE(generator1.generatePackets(500), generator2.generatePackets(500));
+
+    TS::StreamGenerator::Config otherConfig;
+    otherConfig.seed = 2;
+    TS::StreamGenerator generator3(config), generator4(otherConfig);
+    QVERIFY(generator3.generatePackets(500) != generator4.generatePackets(500));
+}
+
+void TestStreamGenerator::discontinuity()
+{
+    TS::StreamGenerator::Config config;
+    config.discontinuityIntervalNanosecs = 500000000;
+    TS::StreamGenerator generator(config);
+    const QByteArray bytes = generator.generatePackets(packetsPerSecond);
+
+    int discontinuityCount = 0;
+    quint64 lastPCR = 0;
+    for (int i = 0; i < packetsPerSecond; i++) {
+        const TS::PacketView packet(bytes.constData() + i * TS::PacketView::sizeBasic);
+        if (!packet.hasPCR())
+            continue;
+
+        if (packet.discontinuityIndicator()) {
+            discontinuityCount++;
+            if (lastPCR > 0)
+                QVERIFY(packet.pcrSecs() - lastPCR / 27000000. > config.discontinuityJumpNanosecs / 1e9);
+        }
+        lastPCR = packet.pcrValue();
+    }
+    QCOMPARE(discontinuityCount, 1);
+}
+
+void TestStreamGenerator::corruption()
+{
+    TS::StreamGenerator::Config config;
+    config.corruptInterval = 10;
+    TS::StreamGenerator generator(config);
+    const QByteArray bytes = generator.generatePackets(100);
+
+    for (int i = 0; i < 100; i++) {
+        const TS::PacketView packet(bytes.constData() + i * TS::PacketView::sizeBasic);
+        QCOMPARE(packet.transportErrorIndicator(), (i + 1) % 10 == 0);
+    }
+
+    config.corruptionKind = TS::StreamGenerator::CorruptionKind::SyncByte;
+    TS::StreamGenerator syncGenerator(config);
+    const QByteArray syncBytes = syncGenerator.generatePackets(100);
+    for (int i = 0; i < 100; i++) {
+        const TS::PacketView packet(syncBytes.constData() + i * TS::PacketView::sizeBasic);
+        QCOMPARE(packet.isSyncByteValid(), (i + 1) % 10 != 0);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestStreamGenerator)
+#include "tst_tsstreamgenerator.moc"
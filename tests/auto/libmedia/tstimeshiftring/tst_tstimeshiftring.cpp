@@ -0,0 +1,148 @@
+#include <QtTest>
+
+#include "tstimeshiftring.h"
+#include "tspacketview.h"
+
+#include <algorithm>
+#include <QTemporaryDir>
+
+class TestTimeShiftRing : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir  _tmpDir;
+
+    static QByteArray makePacket(quint8 marker, bool randomAccess);
+
+private slots:
+    void openTooSmall();
+    void appendAndCopy();
+    void wrapAround();
+    void randomAccessLookup();
+    void seqLimitForTime();
+    void seqLimitGranularity();
+};
+
+QByteArray TestTimeShiftRing::makePacket(quint8 marker, bool randomAccess)
+{
+    QByteArray bytes(TS::PacketView::sizeBasic, '\xff');
+    bytes[0] = '\x47';
+    bytes[1] = '\x01';
+    bytes[2] = '\x00';
+    // Adaptation field then payload, with a minimal adaptation field.
+    bytes[3] = '\x30';
+    bytes[4] = '\x01';
+    bytes[5] = randomAccess ? '\x40' : '\x00';
+    bytes[6] = static_cast<char>(marker);
+    return bytes;
+}
+
+void TestTimeShiftRing::openTooSmall()
+{
+    TS::TimeShiftRing ring;
+    QString errMsg;
+    QVERIFY(!ring.open(_tmpDir.filePath("small.ring"), 10 * TS::PacketView::sizeBasic, &errMsg));
+    QVERIFY(!errMsg.isEmpty());
+    QVERIFY(!ring.isOpen());
+}
+
+void TestTimeShiftRing::appendAndCopy()
+{
+    TS::TimeShiftRing ring;
+    QVERIFY(ring.open(_tmpDir.filePath("copy.ring"), 1024 * TS::PacketView::sizeBasic));
+    QCOMPARE(ring.capacityPackets(), qint64(1024));
+
+    for (int i = 0; i < 10; i++)
+        ring.append(makePacket(i, false), i, false);
+    QCOMPARE(ring.firstSeq(), qint64(0));
+    QCOMPARE(ring.nextSeq(), qint64(10));
+
+    QByteArray out;
+    QCOMPARE(ring.copyPackets(3, 4, &out), 4);
+    QCOMPARE(out.length(), 4 * TS::PacketView::sizeBasic);
+    QCOMPARE(static_cast<quint8>(out.at(6)), quint8(3));
+    QCOMPARE(static_cast<quint8>(out.at(3 * TS::PacketView::sizeBasic + 6)), quint8(6));
+
+    // Asking for more than available only yields what's there.
+    out.clear();
+    QCOMPARE(ring.copyPackets(8, 10, &out), 2);
+}
+
+void TestTimeShiftRing::wrapAround()
+{
+    TS::TimeShiftRing ring;
+    QVERIFY(ring.open(_tmpDir.filePath("wrap.ring"), 1024 * TS::PacketView::sizeBasic));
+
+    for (int i = 0; i < 1030; i++)
+        ring.append(makePacket(i % 256, false), i, false);
+    QCOMPARE(ring.firstSeq(), qint64(6));
+
+    QByteArray out;
+    QCOMPARE(ring.copyPackets(0, 1, &out), -1);
+    QCOMPARE(ring.copyPackets(1020, 10, &out), 10);
+    for (int i = 0; i < 10; i++)
+        QCOMPARE(static_cast<quint8>(out.at(i * TS::PacketView::sizeBasic + 6)), quint8((1020 + i) % 256));
+}
+
+void TestTimeShiftRing::randomAccessLookup()
+{
+    TS::TimeShiftRing ring;
+    QVERIFY(ring.open(_tmpDir.filePath("rap.ring"), 1024 * TS::PacketView::sizeBasic));
+
+    // A RAP every 100 packets, one packet per millisecond.
+    for (int i = 0; i < 1000; i++)
+        ring.append(makePacket(0, i % 100 == 0), i, i % 100 == 0);
+
+    QCOMPARE(ring.seekRandomAccess(550), qint64(500));
+    QCOMPARE(ring.seekRandomAccess(500), qint64(500));
+    QCOMPARE(ring.seekRandomAccess(-1), qint64(-1));
+    QCOMPARE(ring.nextRandomAccess(501), qint64(600));
+    QCOMPARE(ring.nextRandomAccess(950), qint64(-1));
+
+    // Overwriting the oldest packets drops their RAPs from the index, too.
+    for (int i = 1000; i < 1250; i++)
+        ring.append(makePacket(0, false), i, false);
+    QCOMPARE(ring.seekRandomAccess(150), qint64(-1));
+    QCOMPARE(ring.nextRandomAccess(ring.firstSeq()), qint64(300));
+}
+
+void TestTimeShiftRing::seqLimitForTime()
+{
+    TS::TimeShiftRing ring;
+    QVERIFY(ring.open(_tmpDir.filePath("limit.ring"), 1024 * TS::PacketView::sizeBasic));
+
+    // One packet per 100 ms, so every one gets indexed.
+    for (int i = 0; i < 50; i++)
+        ring.append(makePacket(0, false), i * 100, false);
+
+    QCOMPARE(ring.seqLimitForTime(-1), qint64(0));
+    QCOMPARE(ring.seqLimitForTime(1500), qint64(16));
+    QCOMPARE(ring.seqLimitForTime(1550), qint64(16));
+    QCOMPARE(ring.seqLimitForTime(4900), ring.nextSeq());
+    QCOMPARE(ring.seqLimitForTime(100000), ring.nextSeq());
+}
+
+void TestTimeShiftRing::seqLimitGranularity()
+{
+    TS::TimeShiftRing ring;
+    QVERIFY(ring.open(_tmpDir.filePath("granularity.ring"), 1024 * TS::PacketView::sizeBasic));
+
+    // One packet per 7 ms, none of them with a PCR.
+    const int packetIntervalMillisec = 7;
+    for (int i = 0; i < 1000; i++)
+        ring.append(makePacket(0, false), i * packetIntervalMillisec, false);
+
+    for (qint64 t = 0; t < 7000; t += 13) {
+        const qint64 limit = ring.seqLimitForTime(t);
+        // Never lets through a packet ingested after t...
+        QVERIFY2(limit == 0 || (limit - 1) * packetIntervalMillisec <= t,
+                 qPrintable(QString("t=%1, limit=%2").arg(t).arg(limit)));
+        // ...and holds back at most 100 ms worth of packets.
+        const qint64 dueCount = std::min<qint64>(t / packetIntervalMillisec + 1, ring.nextSeq());
+        QVERIFY2((dueCount - limit) * packetIntervalMillisec <= 100 + packetIntervalMillisec,
+                 qPrintable(QString("t=%1, limit=%2").arg(t).arg(limit)));
+    }
+}
+
+QTEST_APPLESS_MAIN(TestTimeShiftRing)
+#include "tst_tstimeshiftring.moc"
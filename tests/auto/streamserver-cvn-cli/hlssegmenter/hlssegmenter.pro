@@ -0,0 +1,26 @@
+TARGET = tst_hlssegmenter
+CONFIG += testcase
+CONFIG += console
+CONFIG -= app_bundle
+QT += network testlib
+QT -= gui
+
+SSCVN_REL_ROOT = ../../../..
+include($${SSCVN_REL_ROOT}/config.pri)
+
+SOURCES += tst_hlssegmenter.cpp
+
+SSCVN_APP_REL_DIR = $${SSCVN_REL_ROOT}/streamserver-cvn-cli
+
+# The segmenter, and what its HTTP handler needs.
+SSCVN_APP_OBJS = \
+    hlssegmenter.o \
+    httputil.o httpheader_netside.o httprequest_netside.o httpresponse.o \
+    httpserver.o moc_httpserver.o httprouter.o
+for(OBJ, SSCVN_APP_OBJS): OBJECTS += $${OUT_PWD}/$${SSCVN_APP_REL_DIR}/$${OBJ}
+INCLUDEPATH += $${PWD}/$${SSCVN_APP_REL_DIR}
+DEPENDPATH  += $${PWD}/$${SSCVN_APP_REL_DIR}
+
+# Link against internal libraries used.
+SSCVN_LIB_NAMES = infra media
+for(SSCVN_LIB_NAME, SSCVN_LIB_NAMES): include($${SSCVN_REL_ROOT}/include/internal_lib.pri)
@@ -0,0 +1,257 @@
+#include <QtTest>
+
+#include "hlssegmenter.h"
+#include "tspacketview.h"
+#include "tspsi.h"
+#include "tsstreamgenerator.h"
+
+using namespace SSCvn;
+
+class TestHLSSegmenter : public QObject
+{
+    Q_OBJECT
+
+    static const int packetsPerSecond = 4000000 / (TS::PacketView::sizeBasic * 8);
+    static const quint16 strayPCRPID = 0x0200;
+
+    // Feeds the bytes to PSI demux and segmenter, like the server does.
+    static void feed(const QByteArray &bytes, TS::PSIDemux *psi, HLSSegmenter *segmenter);
+    static QByteArray makePCRPacket(quint16 pid, quint64 pcrBase);
+    // All segments still available, in order.
+    static QList<QSharedPointer<const HLSSegmenter::Segment>> segments(const HLSSegmenter &segmenter);
+
+private slots:
+    void segmentation();
+    void discontinuity();
+    void pcrPID();
+    void noClock();
+};
+
+void TestHLSSegmenter::feed(const QByteArray &bytes, TS::PSIDemux *psi, HLSSegmenter *segmenter)
+{
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= bytes.length(); pos += TS::PacketView::sizeBasic) {
+        const QByteArray packetBytes = bytes.mid(pos, TS::PacketView::sizeBasic);
+        const TS::PacketView view(packetBytes);
+        psi->addPacket(view);
+        segmenter->addPacket(packetBytes, view.randomAccessIndicator());
+    }
+}
+
+QByteArray TestHLSSegmenter::makePCRPacket(quint16 pid, quint64 pcrBase)
+{
+    QByteArray bytes(TS::PacketView::sizeBasic, '\xff');
+    bytes[0] = '\x47';
+    bytes[1] = static_cast<char>(pid >> 8);
+    bytes[2] = static_cast<char>(pid & 0xff);
+    bytes[3] = '\x20';  // Adaptation field only.
+    bytes[4] = static_cast<char>(183);
+    bytes[5] = '\x10';  // PCR flag.
+    bytes[6]  = static_cast<char>(pcrBase >> 25);
+    bytes[7]  = static_cast<char>(pcrBase >> 17);
+    bytes[8]  = static_cast<char>(pcrBase >>  9);
+    bytes[9]  = static_cast<char>(pcrBase >>  1);
+    bytes[10] = static_cast<char>((pcrBase & 0x1) << 7 | 0x7e);
+    bytes[11] = '\x00';
+    return bytes;
+}
+
+QList<QSharedPointer<const HLSSegmenter::Segment>> TestHLSSegmenter::segments(const HLSSegmenter &segmenter)
+{
+    QList<QSharedPointer<const HLSSegmenter::Segment>> result;
+    const QByteArray &playlist(segmenter.playlist());
+    const QByteArray sequenceTag = "#EXT-X-MEDIA-SEQUENCE:";
+    const int tagIndex = playlist.indexOf(sequenceTag);
+    if (tagIndex < 0)
+        return result;
+    const int valueIndex = tagIndex + sequenceTag.length();
+    quint64 sequence = playlist.mid(valueIndex, playlist.indexOf('\n', valueIndex) - valueIndex).toULongLong();
+    while (const auto segment = segmenter.segment(sequence++))
+        result.append(segment);
+    return result;
+}
+
+void TestHLSSegmenter::segmentation()
+{
+    TS::StreamGenerator::Config config;
+    config.randomAccessIntervalNanosecs = 1000000000;
+    TS::StreamGenerator generator(config);
+
+    TS::PSIDemux psi;
+    HLSSegmenter segmenter;
+    segmenter.setTargetDurationSecs(1.5);
+    segmenter.setSegmentCountMax(100);
+    QObject::connect(&psi, &TS::PSIDemux::pmtChanged, [&]() { segmenter.update(psi); });
+
+    feed(generator.generatePackets(21 * packetsPerSecond), &psi, &segmenter);
+    QCOMPARE(segmenter.pcrPID(), config.videoPID);
+
+    // Cut at the first random access point (each second) past 1.5s, so every 2s.
+    const auto list = segments(segmenter);
+    QVERIFY2(list.length() >= 9 && list.length() <= 10, qPrintable(QString::number(list.length())));
+    for (int i = 0; i < list.length(); i++) {
+        const auto &segment(list.at(i));
+        QCOMPARE(segment->sequence, quint64(i));
+        QVERIFY(!segment->discontinuity);
+        QVERIFY2(segment->durationSecs > 1.9 && segment->durationSecs < 2.1,
+                 qPrintable(QString::number(segment->durationSecs)));
+        QCOMPARE(segment->data.length() % TS::PacketView::sizeBasic, 0);
+
+        // Decodable on its own: PSI first, then a random access point.
+        QCOMPARE(TS::PacketView(segment->data.constData()).pid(), quint16(0x0000));
+        QCOMPARE(TS::PacketView(segment->data.constData() + TS::PacketView::sizeBasic).pid(), config.pmtPID);
+        bool randomAccessFound = false;
+        for (int pos = 2 * TS::PacketView::sizeBasic; pos < segment->data.length(); pos += TS::PacketView::sizeBasic) {
+            const TS::PacketView view(segment->data.constData() + pos);
+            if (view.pid() == config.videoPID && view.payloadUnitStartIndicator()) {
+                randomAccessFound = view.randomAccessIndicator();
+                break;
+            }
+        }
+        QVERIFY(randomAccessFound);
+    }
+
+    const QByteArray &playlist(segmenter.playlist());
+    QVERIFY(playlist.startsWith("#EXTM3U\n"));
+    QVERIFY(playlist.contains("#EXT-X-MEDIA-SEQUENCE:0\n"));
+    QVERIFY(!playlist.contains("#EXT-X-DISCONTINUITY"));
+    QCOMPARE(playlist.count("#EXTINF:"), list.length());
+
+    // Only the most recent ones are kept.
+    segmenter.setSegmentCountMax(3);
+    feed(generator.generatePackets(5 * packetsPerSecond), &psi, &segmenter);
+    const auto recent = segments(segmenter);
+    QCOMPARE(recent.length(), 3);
+    QVERIFY(recent.last()->sequence > list.last()->sequence);
+    QCOMPARE(recent.first()->sequence + 2, recent.last()->sequence);
+    QVERIFY(!segmenter.segment(0));
+    QCOMPARE(segmenter.playlist().count("#EXTINF:"), 3);
+}
+
+void TestHLSSegmenter::discontinuity()
+{
+    TS::StreamGenerator::Config config;
+    config.randomAccessIntervalNanosecs = 1000000000;
+    TS::StreamGenerator generator(config);
+
+    TS::PSIDemux psi;
+    HLSSegmenter segmenter;
+    segmenter.setTargetDurationSecs(1.5);
+    segmenter.setSegmentCountMax(100);
+    QObject::connect(&psi, &TS::PSIDemux::pmtChanged, [&]() { segmenter.update(psi); });
+
+    // Mid-segment, not at a random access point.
+    feed(generator.generatePackets(static_cast<int>(5.25 * packetsPerSecond)), &psi, &segmenter);
+    const int countBefore = segments(segmenter).length();
+    generator.injectDiscontinuity();
+    feed(generator.generatePackets(7 * packetsPerSecond), &psi, &segmenter);
+
+    // The jump is cut at, and not counted in, either segment.
+    const auto list = segments(segmenter);
+    QVERIFY(list.length() > countBefore + 1);
+    int discontinuityCount = 0;
+    for (int i = 0; i < list.length(); i++) {
+        const auto &segment(list.at(i));
+        QVERIFY2(segment->durationSecs < 2.1, qPrintable(QString::number(segment->durationSecs)));
+        if (!segment->discontinuity)
+            continue;
+        discontinuityCount++;
+        QCOMPARE(i, countBefore + 1);
+        // (What was left before the jump.)
+        QVERIFY2(list.at(i - 1)->durationSecs < 1.9, qPrintable(QString::number(list.at(i - 1)->durationSecs)));
+    }
+    QCOMPARE(discontinuityCount, 1);
+    QCOMPARE(segmenter.playlist().count("#EXT-X-DISCONTINUITY\n"), 1);
+}
+
+void TestHLSSegmenter::pcrPID()
+{
+    TS::StreamGenerator::Config config;
+    config.randomAccessIntervalNanosecs = 1000000000;
+    TS::StreamGenerator generator(config);
+
+    TS::PSIDemux psi;
+    HLSSegmenter segmenter;
+    segmenter.setTargetDurationSecs(1.5);
+    segmenter.setSegmentCountMax(100);
+    QCOMPARE(segmenter.pcrPID(), quint16(TS::PacketView::pidNullPacket));
+    QObject::connect(&psi, &TS::PSIDemux::pmtChanged, [&]() { segmenter.update(psi); });
+
+    // Mix in PCRs of some other clock, which jump all over the place.
+    const QByteArray generated = generator.generatePackets(11 * packetsPerSecond);
+    QByteArray bytes;
+    for (int pos = 0, i = 0; pos < generated.length(); pos += TS::PacketView::sizeBasic, i++) {
+        bytes.append(generated.constData() + pos, TS::PacketView::sizeBasic);
+        if (i % 100 == 99)
+            bytes.append(makePCRPacket(strayPCRPID, (i / 100 % 2) ? 0 : quint64(90000) * 3600));
+    }
+    QVERIFY(TS::PacketView(makePCRPacket(strayPCRPID, 90000)).hasPCR());
+    feed(bytes, &psi, &segmenter);
+    QCOMPARE(segmenter.pcrPID(), config.videoPID);
+
+    const auto list = segments(segmenter);
+    QVERIFY(list.length() >= 4);
+    for (const auto &segment : list) {
+        QVERIFY(!segment->discontinuity);
+        QVERIFY2(segment->durationSecs > 1.9 && segment->durationSecs < 2.1,
+                 qPrintable(QString::number(segment->durationSecs)));
+    }
+
+    // Gone from the PSI, so no clock to follow anymore.
+    psi.reset();
+    segmenter.update(psi);
+    QCOMPARE(segmenter.pcrPID(), quint16(TS::PacketView::pidNullPacket));
+}
+
+void TestHLSSegmenter::noClock()
+{
+    TS::StreamGenerator::Config config;
+    config.randomAccessIntervalNanosecs = 1000000000;
+    TS::StreamGenerator generator(config);
+
+    // Without PAT & PMT, so there's no PCR PID to go by.
+    const QByteArray generated = generator.generatePackets(12 * packetsPerSecond);
+    QByteArray bytes;
+    for (int pos = 0; pos < generated.length(); pos += TS::PacketView::sizeBasic) {
+        const quint16 pid = TS::PacketView(generated.constData() + pos).pid();
+        if (pid != 0 && pid != config.pmtPID)
+            bytes.append(generated.constData() + pos, TS::PacketView::sizeBasic);
+    }
+    const int bytesMax = 1024 * 1024;
+
+    // Cut at the first random access point past half the size.
+    {
+        TS::PSIDemux psi;
+        HLSSegmenter segmenter;
+        segmenter.setSegmentCountMax(100);
+        segmenter.setSegmentBytesMax(bytesMax);
+        feed(bytes, &psi, &segmenter);
+        QCOMPARE(segmenter.pcrPID(), quint16(TS::PacketView::pidNullPacket));
+
+        const auto list = segments(segmenter);
+        QVERIFY2(list.length() >= 4, qPrintable(QString::number(list.length())));
+        for (const auto &segment : list) {
+            QVERIFY2(segment->data.length() >= bytesMax / 2 && segment->data.length() <= bytesMax,
+                     qPrintable(QString::number(segment->data.length())));
+            QVERIFY(TS::PacketView(segment->data.constData()).randomAccessIndicator());
+            QCOMPARE(segment->durationSecs, 0.);
+        }
+    }
+
+    // Nor any random access points: Start anyway, and cut at the size.
+    {
+        HLSSegmenter segmenter;
+        segmenter.setSegmentCountMax(100);
+        segmenter.setSegmentBytesMax(bytesMax);
+        for (int pos = 0; pos < bytes.length(); pos += TS::PacketView::sizeBasic)
+            segmenter.addPacket(bytes.mid(pos, TS::PacketView::sizeBasic), false);
+
+        const auto list = segments(segmenter);
+        QVERIFY2(list.length() >= 3, qPrintable(QString::number(list.length())));
+        for (const auto &segment : list)
+            QVERIFY2(segment->data.length() > bytesMax - TS::PacketView::sizeBasic && segment->data.length() <= bytesMax,
+                     qPrintable(QString::number(segment->data.length())));
+    }
+}
+
+QTEST_APPLESS_MAIN(TestHLSSegmenter)
+#include "tst_hlssegmenter.moc"
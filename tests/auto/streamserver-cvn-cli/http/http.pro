@@ -1,3 +1,5 @@
 TEMPLATE = subdirs
 SUBDIRS = \
-    httpresponse
+    httprequest_netside \
+    httpresponse \
+    httprouter
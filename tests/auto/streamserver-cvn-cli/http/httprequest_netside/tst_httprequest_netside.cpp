@@ -0,0 +1,163 @@
+#include <QtTest>
+
+#include "http/httprequest_netside.h"
+
+#include <stdexcept>
+
+using namespace SSCvn;
+
+namespace {
+
+const QByteArray typicalRequest =
+    "GET /live.m2ts?delay=30s HTTP/1.1\r\n"
+    "Host: Example.org:8000\r\n"
+    "User-Agent: VLC/3.0.8 LibVLC/3.0.8\r\n"
+    "Range: bytes=0-\r\n"
+    "Connection: close\r\n"
+    "Icy-MetaData: 1\r\n"
+    "\r\n";
+
+}  // namespace
+
+class TestHTTPRequestNetside : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void wholeRequest();
+    void chunkedRequest_data();
+    void chunkedRequest();
+    void headerLookup();
+    void linearWhiteSpace();
+    void invalidRequests_data();
+    void invalidRequests();
+    void byteCountMax();
+};
+
+void TestHTTPRequestNetside::wholeRequest()
+{
+    HTTP::RequestNetside request;
+    QVERIFY_EXCEPTION_THROWN(request.method(), std::runtime_error);
+
+    request.processChunk(typicalRequest);
+    QCOMPARE(request.receiveState(), HTTP::RequestNetside::ReceiveState::Ready);
+    QCOMPARE(request.byteCount(), static_cast<qint64>(typicalRequest.length()));
+    QCOMPARE(request.requestLine(), QByteArray("GET /live.m2ts?delay=30s HTTP/1.1"));
+    QCOMPARE(request.method(), QByteArray("GET"));
+    QCOMPARE(request.path(), QByteArray("/live.m2ts?delay=30s"));
+    QCOMPARE(request.urlPath(), QByteArray("/live.m2ts"));
+    QCOMPARE(request.urlQuery(), QByteArray("delay=30s"));
+    QCOMPARE(request.httpVersion(), QByteArray("HTTP/1.1"));
+    QCOMPARE(request.header().fields().length(), 5);
+
+    QVERIFY_EXCEPTION_THROWN(request.processChunk("more"), std::runtime_error);
+}
+
+void TestHTTPRequestNetside::chunkedRequest_data()
+{
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("byte by byte") << 1;
+    QTest::newRow("split line separators") << 3;
+    QTest::newRow("small segments") << 17;
+    QTest::newRow("whole") << typicalRequest.length();
+}
+
+void TestHTTPRequestNetside::chunkedRequest()
+{
+    QFETCH(int, chunkSize);
+
+    HTTP::RequestNetside request;
+    for (int i = 0; i < typicalRequest.length(); i += chunkSize) {
+        QCOMPARE(request.receiveState() == HTTP::RequestNetside::ReceiveState::Ready, false);
+        request.processChunk(typicalRequest.mid(i, chunkSize));
+    }
+    QCOMPARE(request.receiveState(), HTTP::RequestNetside::ReceiveState::Ready);
+    QCOMPARE(request.method(), QByteArray("GET"));
+    QCOMPARE(request.urlPath(), QByteArray("/live.m2ts"));
+    QCOMPARE(request.header().fieldValues("Range"), QList<QByteArray>() << "bytes=0-");
+}
+
+void TestHTTPRequestNetside::headerLookup()
+{
+    HTTP::RequestNetside request;
+    request.processChunk(
+        "HEAD / HTTP/1.0\r\n"
+        "X-Dup: first\r\n"
+        "Host: example.org\r\n"
+        "x-dup: second\r\n"
+        "\r\n");
+    const HTTP::HeaderNetside &header(request.header());
+
+    QCOMPARE(header.fieldCount("HOST"), 1);
+    QVERIFY(header.field("host"));
+    QCOMPARE(header.field("host")->fieldName(), QByteArray("Host"));
+    QCOMPARE(header.field("host")->fieldValue(), QByteArray("example.org"));
+
+    QCOMPARE(header.fieldCount("X-DUP"), 2);
+    QCOMPARE(header.fieldValues("x-Dup"), QList<QByteArray>() << "first" << "second");
+    QCOMPARE(header.fields("X-Dup").length(), 2);
+    QCOMPARE(header.fields("X-Dup").last().fieldName(), QByteArray("x-dup"));
+
+    QCOMPARE(header.fieldCount("Missing"), 0);
+    QVERIFY(!header.field("Missing"));
+    QVERIFY(header.fieldValues("Missing").isEmpty());
+}
+
+void TestHTTPRequestNetside::linearWhiteSpace()
+{
+    HTTP::RequestNetside request;
+    request.processChunk(
+        "GET / HTTP/1.1\r\n"
+        "Trimmed:  \t value \t\r\n"
+        "Folded: first\r\n"
+        "  second\r\n"
+        "\tthird\r\n"
+        "Inner: a  b\r\n"
+        "Empty:\r\n"
+        "\r\n");
+    const HTTP::HeaderNetside &header(request.header());
+
+    QCOMPARE(header.fields().length(), 4);
+    QCOMPARE(header.field("Trimmed")->fieldValue(), QByteArray("value"));
+    QCOMPARE(header.field("Trimmed")->fieldValueRaw(), QByteArray("  \t value \t"));
+    QCOMPARE(header.field("Folded")->fieldValue(), QByteArray("first second third"));
+    QCOMPARE(header.field("Folded")->bytes(), QByteArray("Folded: first\r\n  second\r\n\tthird"));
+    QCOMPARE(header.field("Inner")->fieldValue(), QByteArray("a b"));
+    QCOMPARE(header.field("Empty")->fieldValue(), QByteArray());
+}
+
+void TestHTTPRequestNetside::invalidRequests_data()
+{
+    QTest::addColumn<QByteArray>("bytes");
+
+    QTest::newRow("no path") << QByteArray("GET\r\n\r\n");
+    QTest::newRow("no version") << QByteArray("GET / \r\n\r\n");
+    QTest::newRow("empty method") << QByteArray(" / HTTP/1.0\r\n\r\n");
+    QTest::newRow("missing colon") << QByteArray("GET / HTTP/1.0\r\nHost\r\n\r\n");
+    QTest::newRow("empty field name") << QByteArray("GET / HTTP/1.0\r\n: value\r\n\r\n");
+    QTest::newRow("leading continuation") << QByteArray("GET / HTTP/1.0\r\n continued\r\n\r\n");
+    QTest::newRow("trailing data") << QByteArray("GET / HTTP/1.0\r\n\r\nGET");
+    QTest::newRow("body") << QByteArray("POST / HTTP/1.0\r\nContent-Length: 1\r\n\r\nx");
+}
+
+void TestHTTPRequestNetside::invalidRequests()
+{
+    QFETCH(QByteArray, bytes);
+
+    HTTP::RequestNetside request;
+    QVERIFY_EXCEPTION_THROWN(request.processChunk(bytes), std::runtime_error);
+}
+
+void TestHTTPRequestNetside::byteCountMax()
+{
+    HTTP::RequestNetside request;
+    request.setByteCountMax(16);
+    request.processChunk("GET / HTTP/1.0\r\n");
+    QCOMPARE(request.receiveState(), HTTP::RequestNetside::ReceiveState::Header);
+    QVERIFY_EXCEPTION_THROWN(request.processChunk("X"), std::runtime_error);
+}
+
+QTEST_APPLESS_MAIN(TestHTTPRequestNetside)
+
+#include "tst_httprequest_netside.moc"
@@ -0,0 +1,112 @@
+#include <QtTest>
+
+#include "http/httprouter.h"
+#include "http/httpserver.h"
+
+using namespace SSCvn;
+
+class DummyHandler : public HTTP::ServerHandler {
+    QString _name;
+
+public:
+    explicit DummyHandler(const QString &name) : _name(name) { }
+
+    QString name() const override { return _name; }
+    void handleRequest(HTTP::ServerContext *) override { }
+};
+
+class TestHTTPRouter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void invalidRoutes();
+    void exactRoutes();
+    void prefixRoutes();
+    void exactBeforePrefix();
+    void removeRoutes();
+};
+
+void TestHTTPRouter::invalidRoutes()
+{
+    HTTP::Router router;
+    auto handler = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("dummy"));
+    QVERIFY_EXCEPTION_THROWN(router.addRoute("relative", handler), std::invalid_argument);
+    QVERIFY_EXCEPTION_THROWN(router.addRoute("/null", QSharedPointer<HTTP::ServerHandler>()), std::invalid_argument);
+    QCOMPARE(router.routeCount(), 0);
+    QVERIFY(!router.route("/"));
+}
+
+void TestHTTPRouter::exactRoutes()
+{
+    HTTP::Router router;
+    auto root   = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("root"));
+    auto stream = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("stream"));
+    router.addRoute("/", root);
+    router.addRoute("/stream.m2ts", stream);
+    QCOMPARE(router.routeCount(), 2);
+
+    QCOMPARE(router.route("/"), root);
+    QCOMPARE(router.route("/stream.m2ts"), stream);
+    QVERIFY(!router.route("/stream.m2ts/more"));
+    QVERIFY(!router.route("/other"));
+
+    // Replacing doesn't count twice.
+    router.addRoute("/", stream);
+    QCOMPARE(router.routeCount(), 2);
+    QCOMPARE(router.route("/"), stream);
+}
+
+void TestHTTPRouter::prefixRoutes()
+{
+    HTTP::Router router;
+    auto hls    = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("hls"));
+    auto hlsSub = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("hls-sub"));
+    router.addRoute("/hls/", hls, HTTP::Router::MatchKind::Prefix);
+    router.addRoute("/hls/sub", hlsSub, HTTP::Router::MatchKind::Prefix);
+
+    QCOMPARE(router.route("/hls/index.m3u8"), hls);
+    QCOMPARE(router.route("/hls"), hls);
+    QCOMPARE(router.route("/hls/sub/segment0.ts"), hlsSub);
+    QCOMPARE(router.route("/hls/subway"), hls);
+    QVERIFY(!router.route("/hlsx/index.m3u8"));
+    QVERIFY(!router.route("/"));
+
+    auto fallback = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("fallback"));
+    router.addRoute("/", fallback, HTTP::Router::MatchKind::Prefix);
+    QCOMPARE(router.route("/anything/else"), fallback);
+    QCOMPARE(router.route("/hls/index.m3u8"), hls);
+}
+
+void TestHTTPRouter::exactBeforePrefix()
+{
+    HTTP::Router router;
+    auto exact  = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("exact"));
+    auto prefix = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("prefix"));
+    router.addRoute("/", prefix, HTTP::Router::MatchKind::Prefix);
+    router.addRoute("/live.m2ts", exact);
+
+    QCOMPARE(router.route("/live.m2ts"), exact);
+    QCOMPARE(router.route("/live.m2ts/x"), prefix);
+}
+
+void TestHTTPRouter::removeRoutes()
+{
+    HTTP::Router router;
+    auto handler = QSharedPointer<HTTP::ServerHandler>(new DummyHandler("dummy"));
+    router.addRoute("/exact", handler);
+    router.addRoute("/prefix/", handler, HTTP::Router::MatchKind::Prefix);
+    QCOMPARE(router.routeCount(), 2);
+
+    QVERIFY(!router.removeRoute("/prefix/", HTTP::Router::MatchKind::Exact));
+    QVERIFY(!router.removeRoute("/nonexistent/", HTTP::Router::MatchKind::Prefix));
+    QVERIFY(router.removeRoute("/prefix/", HTTP::Router::MatchKind::Prefix));
+    QVERIFY(!router.route("/prefix/x"));
+    QVERIFY(router.removeRoute("/exact"));
+    QVERIFY(!router.route("/exact"));
+    QCOMPARE(router.routeCount(), 0);
+}
+
+QTEST_APPLESS_MAIN(TestHTTPRouter)
+
+#include "tst_httprouter.moc"
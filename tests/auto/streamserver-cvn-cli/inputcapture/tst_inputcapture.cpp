@@ -0,0 +1,111 @@
+#include <QtTest>
+
+#include "inputcapture.h"
+
+#include <QTemporaryDir>
+
+using namespace SSCvn;
+
+class TestInputCapture : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void truncated();
+    void notACapture();
+};
+
+void TestInputCapture::roundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("input.cap");
+
+    const QByteArray packet(188, '\x47');
+    {
+        InputRecorder recorder(fileName);
+        recorder.record(1000000000, false, packet);
+        recorder.record(1000000500, true, packet.left(20));
+        recorder.record(1040000000, false, QByteArray());   // Nothing available.
+        recorder.record(1040000000, false, QByteArray(""));  // Empty, but not null.
+        recorder.record(3000000000LL, false, packet);
+        QCOMPARE(recorder.recordCount(), qint64(5));
+    }
+
+    InputReplayer replayer(fileName);
+    QVERIFY(!replayer.atEnd());
+    QCOMPARE(replayer.nextNanosecs(), qint64(0));
+
+    InputCaptureRecord record = replayer.take();
+    QCOMPARE(record.nanosecs, qint64(0));
+    QVERIFY(!record.isPeek());
+    QVERIFY(!record.isNull());
+    QCOMPARE(record.bytes, packet);
+
+    record = replayer.take();
+    QCOMPARE(record.nanosecs, qint64(500));
+    QVERIFY(record.isPeek());
+    QCOMPARE(record.bytes, packet.left(20));
+
+    record = replayer.take();
+    QCOMPARE(record.nanosecs, qint64(40000000));
+    QVERIFY(record.isNull());
+    QVERIFY(record.bytes.isNull());
+
+    record = replayer.take();
+    QVERIFY(!record.isNull());
+    QVERIFY(!record.bytes.isNull());
+    QVERIFY(record.bytes.isEmpty());
+
+    QCOMPARE(replayer.nextNanosecs(), qint64(2000000000));
+    record = replayer.take();
+    QCOMPARE(record.bytes, packet);
+
+    QVERIFY(replayer.atEnd());
+    QCOMPARE(replayer.recordCount(), qint64(5));
+    QVERIFY_EXCEPTION_THROWN(replayer.take(), std::logic_error);
+}
+
+void TestInputCapture::truncated()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("input.cap");
+
+    {
+        InputRecorder recorder(fileName);
+        recorder.record(0, false, QByteArray(188, '\x47'));
+        recorder.record(10, false, QByteArray(188, '\x47'));
+    }
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.resize(file.size() - 100));
+    }
+
+    // Replay ends with the last complete record.
+    InputReplayer replayer(fileName);
+    QVERIFY(!replayer.atEnd());
+    replayer.take();
+    QVERIFY(replayer.atEnd());
+}
+
+void TestInputCapture::notACapture()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("input.ts");
+
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(188, '\x47'));
+    }
+
+    QVERIFY_EXCEPTION_THROWN(InputReplayer replayer(fileName), std::runtime_error);
+    QVERIFY_EXCEPTION_THROWN(InputReplayer replayer(dir.filePath("missing.cap")), std::runtime_error);
+}
+
+QTEST_APPLESS_MAIN(TestInputCapture)
+#include "tst_inputcapture.moc"
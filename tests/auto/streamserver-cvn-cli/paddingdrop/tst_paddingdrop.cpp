@@ -0,0 +1,112 @@
+#include <QtTest>
+
+#include "streamserver.h"
+#include "log.h"
+#include "tspacketview.h"
+#include "tsstreamgenerator.h"
+
+#include <QTemporaryFile>
+
+using namespace SSCvn;
+
+// A StreamServer reads a synthetic stream (the generator's null packets,
+// plus stuffing-only packets mixed in) from a file, as fast as possible,
+// and leaves out what the drop options ask for.
+class TestPaddingDrop : public QObject
+{
+    Q_OBJECT
+
+    static const int packetCount = 4000;
+    static const int stuffingInterval = 50;
+    static const quint16 stuffingPID = 0x0200;
+    // (HTTP::Server can't report an ephemeral port, so use a fixed one.)
+    static const quint16 listenPort = 18090;
+    static const int timeoutMillisec = 30000;
+
+    QTemporaryFile  _inputFile;
+    int  _inputPacketCount   = 0;
+    int  _nullPacketCount     = 0;
+    int  _stuffingPacketCount = 0;
+
+private slots:
+    void initTestCase();
+    void drop_data();
+    void drop();
+};
+
+void TestPaddingDrop::initTestCase()
+{
+    // Keep the per-packet and reopen logging out of the test output.
+    log::verbose = -2;
+
+    TS::StreamGenerator generator;
+    const QByteArray generated = generator.generatePackets(packetCount);
+
+    // Adaptation field only, no flags, all stuffing.
+    QByteArray stuffingPacket(TS::PacketView::sizeBasic, '\xff');
+    stuffingPacket[0] = '\x47';
+    stuffingPacket[1] = static_cast<char>(stuffingPID >> 8);
+    stuffingPacket[2] = static_cast<char>(stuffingPID & 0xff);
+    stuffingPacket[3] = '\x20';
+    stuffingPacket[4] = static_cast<char>(183);
+    stuffingPacket[5] = '\x00';
+    QVERIFY(TS::PacketView(stuffingPacket).isStuffingOnly());
+
+    QByteArray bytes;
+    for (int i = 0; i < packetCount; i++) {
+        const int pos = i * TS::PacketView::sizeBasic;
+        if (TS::PacketView(generated.constData() + pos).isNullPacket())
+            _nullPacketCount++;
+        bytes.append(generated.constData() + pos, TS::PacketView::sizeBasic);
+        if ((i + 1) % stuffingInterval == 0) {
+            bytes.append(stuffingPacket);
+            _stuffingPacketCount++;
+        }
+    }
+    _inputPacketCount = bytes.length() / TS::PacketView::sizeBasic;
+    QVERIFY(_nullPacketCount > 0);
+
+    QVERIFY(_inputFile.open());
+    QCOMPARE(_inputFile.write(bytes), qint64(bytes.length()));
+    QVERIFY(_inputFile.flush());
+}
+
+void TestPaddingDrop::drop_data()
+{
+    QTest::addColumn<bool>("dropNull");
+    QTest::addColumn<bool>("dropStuffing");
+
+    QTest::newRow("keep all")       << false << false;
+    QTest::newRow("drop null")      << true  << false;
+    QTest::newRow("drop stuffing")  << false << true;
+    QTest::newRow("drop both")      << true  << true;
+}
+
+void TestPaddingDrop::drop()
+{
+    QFETCH(bool, dropNull);
+    QFETCH(bool, dropStuffing);
+
+    HTTP::Server httpServer(listenPort);
+    StreamServer server(std::make_unique<QFile>(_inputFile.fileName()), &httpServer);
+    server.setBrakeType(StreamServer::BrakeType::None);
+    // Don't start over at EOF while we're still counting.
+    server.setInputFileReopenTimeoutMillisec(timeoutMillisec);
+    server.setTSDropNullPackets(dropNull);
+    server.setTSDropStuffingPackets(dropStuffing);
+    server.initInput();
+
+    const IngestStats &stats(server.ingestStats());
+    QTRY_COMPARE_WITH_TIMEOUT(stats.packets.value(), quint64(_inputPacketCount), timeoutMillisec);
+
+    const quint64 expectedDropped = (dropNull ? _nullPacketCount : 0) + (dropStuffing ? _stuffingPacketCount : 0);
+    QCOMPARE(stats.paddingPacketsDropped.value(), expectedDropped);
+    QCOMPARE(stats.paddingBytesDropped.value(), expectedDropped * TS::PacketView::sizeBasic);
+    // Left out, not mistaken for broken input.
+    QCOMPARE(stats.errors.value(), quint64(0));
+    QCOMPARE(stats.resyncs.value(), quint64(0));
+}
+
+QTEST_GUILESS_MAIN(TestPaddingDrop)
+
+#include "tst_paddingdrop.moc"
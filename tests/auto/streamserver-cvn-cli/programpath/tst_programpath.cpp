@@ -0,0 +1,82 @@
+#include <QtTest>
+
+#include "streamserver.h"
+#include "log.h"
+
+#include <QTcpSocket>
+#include <QTemporaryFile>
+
+using namespace SSCvn;
+
+// Requests for per-program paths, with and without a query,
+// against a real StreamServer over loopback TCP. Only the status line
+// of the response is looked at; the input is never opened.
+class TestProgramPath : public QObject
+{
+    Q_OBJECT
+
+    // (HTTP::Server can't report an ephemeral port, so use a fixed one.)
+    static const quint16 listenPort = 18091;
+    static const int timeoutMillisec = 10000;
+
+    QTemporaryFile  _inputFile;
+
+private slots:
+    void initTestCase();
+    void request_data();
+    void request();
+};
+
+void TestProgramPath::initTestCase()
+{
+    // Keep the per-client logging out of the test output.
+    log::verbose = -2;
+    QVERIFY(_inputFile.open());
+}
+
+void TestProgramPath::request_data()
+{
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<int>("statusCode");
+
+    QTest::newRow("program")                  << QByteArray("/program/1.m2ts")                << 200;
+    QTest::newRow("program, streams")         << QByteArray("/program/1.m2ts?streams=audio")  << 200;
+    QTest::newRow("program, same program")    << QByteArray("/program/1.m2ts?program=1")      << 200;
+    QTest::newRow("program, other program")   << QByteArray("/program/1.m2ts?program=2")      << 404;
+    QTest::newRow("program 0, streams")       << QByteArray("/program/0.m2ts?streams=audio")  << 404;
+    QTest::newRow("no number, streams")       << QByteArray("/program/x.m2ts?streams=audio")  << 404;
+    QTest::newRow("wrong suffix, streams")    << QByteArray("/program/1.ts?streams=audio")    << 404;
+    QTest::newRow("program, invalid streams") << QByteArray("/program/1.m2ts?streams=foo")    << 400;
+}
+
+void TestProgramPath::request()
+{
+    QFETCH(QByteArray, path);
+    QFETCH(int, statusCode);
+
+    HTTP::Server httpServer(listenPort);
+    StreamServer server(std::make_unique<QFile>(_inputFile.fileName()), &httpServer);
+
+    QTcpSocket socket;
+    QByteArray responseBytes;
+    connect(&socket, &QTcpSocket::connected, [&]() {
+        socket.write("GET " + path + " HTTP/1.0\r\nHost: localhost\r\n\r\n");
+    });
+    connect(&socket, &QTcpSocket::readyRead, [&]() {
+        responseBytes.append(socket.readAll());
+    });
+    socket.connectToHost(QHostAddress::LocalHost, listenPort);
+
+    QTRY_VERIFY_WITH_TIMEOUT(responseBytes.contains("\r\n"), timeoutMillisec);
+    const QByteArray statusLine = responseBytes.left(responseBytes.indexOf("\r\n"));
+    QVERIFY2(statusLine.startsWith("HTTP/"), statusLine.constData());
+    QCOMPARE(statusLine.split(' ').value(1).toInt(), statusCode);
+
+    // Tear down the connection before the server goes away.
+    socket.abort();
+    QTRY_VERIFY_WITH_TIMEOUT(server.clients().isEmpty(), timeoutMillisec);
+}
+
+QTEST_GUILESS_MAIN(TestProgramPath)
+
+#include "tst_programpath.moc"
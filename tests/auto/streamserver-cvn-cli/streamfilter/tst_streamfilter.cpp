@@ -0,0 +1,314 @@
+#include <QtTest>
+
+#include "streamfilter.h"
+#include "tspacketview.h"
+#include "tspsi.h"
+#include "tsstreamgenerator.h"
+
+using namespace SSCvn;
+
+class TestStreamFilter : public QObject
+{
+    Q_OBJECT
+
+    static QByteArray replacementBytes(const StreamFilter &filter, int index);
+
+private slots:
+    void specFromQuery_data();
+    void specFromQuery();
+    void audioOnly();
+    void versionBump();
+    void singleProgram();
+    void packetSizes_data();
+    void packetSizes();
+};
+
+QByteArray TestStreamFilter::replacementBytes(const StreamFilter &filter, int index)
+{
+#ifndef TS_PACKET_V2
+    return filter.replacementPackets().at(index).bytes();
+#else
+    TS::PacketV2Generator generator;
+    QByteArray bytes;
+    if (!generator.generate(filter.replacementPackets().at(index)->data, &bytes))
+        return QByteArray();
+    return bytes;
+#endif
+}
+
+void TestStreamFilter::specFromQuery_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("canonical");
+
+    QTest::newRow("none")      << "delay=10s" << true << "";
+    QTest::newRow("audio")     << "streams=audio" << true << "streams=audio";
+    QTest::newRow("order")     << "streams=audio,video" << true << "streams=video,audio";
+    QTest::newRow("pids")      << "pids=257,0x100" << true << "pids=0x0100,0x0101";
+    QTest::newRow("both")      << "pids=0x20&streams=other" << true << "streams=other&pids=0x0020";
+    QTest::newRow("program")   << "program=2&streams=audio" << true << "program=2&streams=audio";
+    QTest::newRow("bad kind")  << "streams=subtitles" << false << "";
+    QTest::newRow("bad pid")   << "pids=0x1fff" << false << "";
+    QTest::newRow("not a pid") << "pids=foo" << false << "";
+    QTest::newRow("program 0") << "program=0" << false << "";
+}
+
+void TestStreamFilter::specFromQuery()
+{
+    QFETCH(QString, query);
+    QFETCH(bool, valid);
+    QFETCH(QString, canonical);
+
+    StreamFilter::Spec spec;
+    QString errorMessage;
+    QCOMPARE(StreamFilter::Spec::fromQuery(QUrlQuery(query), &spec, &errorMessage), valid);
+    if (!valid) {
+        QVERIFY(!errorMessage.isEmpty());
+        return;
+    }
+    QCOMPARE(spec.toString(), canonical);
+    QCOMPARE(spec.isEmpty(), canonical.isEmpty());
+}
+
+void TestStreamFilter::audioOnly()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(3000);
+
+    StreamFilter::Spec spec;
+    spec.audio = true;
+    StreamFilter filter(spec);
+    TS::PSIDemux inputPSI;
+    QObject::connect(&inputPSI, &TS::PSIDemux::patChanged, [&]() { filter.update(inputPSI); });
+    QObject::connect(&inputPSI, &TS::PSIDemux::pmtChanged, [&]() { filter.update(inputPSI); });
+
+    TS::PSIDemux outputPSI;
+    int inputVideoCount = 0, outputAudioCount = 0, outputPCRCount = 0;
+    QByteArray output;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic) {
+        const QByteArray packetBytes = input.mid(pos, TS::PacketView::sizeBasic);
+        const TS::PacketView inputView(packetBytes);
+        inputPSI.addPacket(inputView);
+        if (inputView.pid() == config.videoPID)
+            inputVideoCount++;
+
+        QList<QByteArray> outPackets;
+        switch (filter.processPacket(packetBytes)) {
+        case StreamFilter::Result::Drop:
+            break;
+        case StreamFilter::Result::Pass:
+            outPackets.append(packetBytes);
+            break;
+        case StreamFilter::Result::Replace:
+            for (int i = 0; i < filter.replacementPackets().length(); i++)
+                outPackets.append(replacementBytes(filter, i));
+            break;
+        }
+
+        for (const QByteArray &outBytes : outPackets) {
+            QCOMPARE(outBytes.length(), int(TS::PacketView::sizeBasic));
+            const TS::PacketView view(outBytes);
+            QVERIFY(view.isSyncByteValid());
+            QVERIFY(!view.isNullPacket());
+            if (view.pid() == config.audioPID)
+                outputAudioCount++;
+            else if (view.pid() == config.videoPID) {
+                // Only the PCRs are left of the video.
+                QVERIFY(view.hasPCR());
+                QVERIFY(!view.hasPayload());
+                outputPCRCount++;
+            }
+            else
+                QVERIFY(view.pid() == 0 || view.pid() == config.pmtPID);
+            outputPSI.addPacket(view);
+            output.append(outBytes);
+        }
+    }
+
+    QVERIFY(inputVideoCount > 0);
+    QVERIFY(outputAudioCount > 0);
+    QVERIFY(outputPCRCount > 0);
+    QVERIFY(outputPCRCount < inputVideoCount);
+    QVERIFY(output.length() < input.length() / 10);
+
+    // Rewritten PSI lists just the audio.
+    QCOMPARE(outputPSI.crcErrorCount(), qint64(0));
+    QCOMPARE(outputPSI.programs().length(), 1);
+    const TS::ProgramInfo *programPtr = outputPSI.program(config.programNumber);
+    QVERIFY(programPtr);
+    QVERIFY(programPtr->hasPMT());
+    QCOMPARE(programPtr->pcrPID, config.videoPID);
+    QCOMPARE(programPtr->streams.length(), 1);
+    QCOMPARE(programPtr->streams.first().pid, config.audioPID);
+    QCOMPARE(programPtr->streams.first().kind(), TS::ElementaryStreamInfo::Kind::Audio);
+
+    QCOMPARE(filter.pidAction(config.videoPID), StreamFilter::Action::PCROnly);
+    QCOMPARE(filter.pidAction(config.audioPID), StreamFilter::Action::Pass);
+    QCOMPARE(filter.pidAction(config.pmtPID), StreamFilter::Action::ReplacePSI);
+    QCOMPARE(filter.pidAction(TS::PacketView::pidNullPacket), StreamFilter::Action::Drop);
+}
+
+void TestStreamFilter::versionBump()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(500);
+
+    TS::PSIDemux psi;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic)
+        psi.addPacket(TS::PacketView(input.constData() + pos));
+    QVERIFY(psi.program(config.programNumber) && psi.program(config.programNumber)->hasPMT());
+
+    StreamFilter::Spec spec;
+    spec.audio = true;
+    StreamFilter filter(spec);
+
+    auto patVersion = [&]() {
+        QByteArray pat(TS::PacketView::sizeBasic, '\xff');
+        pat[0] = '\x47';
+        pat[1] = '\x40';  // PUSI, PID 0
+        pat[2] = '\x00';
+        pat[3] = '\x10';
+        if (filter.processPacket(pat) != StreamFilter::Result::Replace)
+            return -1;
+        const QByteArray bytes = replacementBytes(filter, 0);
+        // Header, pointer_field, then the section's version_number.
+        return (static_cast<quint8>(bytes.at(4 + 1 + 5)) >> 1) & 0x1f;
+    };
+
+    filter.update(psi);
+    QCOMPARE(patVersion(), 0);
+    // Same content, same version.
+    filter.update(psi);
+    QCOMPARE(patVersion(), 0);
+
+    // Changed content, new version.
+    TS::StreamGenerator::Config otherConfig;
+    otherConfig.programNumber = 2;
+    TS::StreamGenerator otherGenerator(otherConfig);
+    const QByteArray otherInput = otherGenerator.generatePackets(500);
+    TS::PSIDemux otherPSI;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= otherInput.length(); pos += TS::PacketView::sizeBasic)
+        otherPSI.addPacket(TS::PacketView(otherInput.constData() + pos));
+    filter.update(otherPSI);
+    QCOMPARE(patVersion(), 1);
+
+    // Nothing selected: the program drops out of the PAT.
+    StreamFilter::Spec otherSpec;
+    otherSpec.other = true;
+    StreamFilter otherFilter(otherSpec);
+    otherFilter.update(psi);
+    QCOMPARE(otherFilter.pidAction(config.pmtPID), StreamFilter::Action::Drop);
+    QCOMPARE(otherFilter.pidAction(config.videoPID), StreamFilter::Action::Drop);
+    QCOMPARE(otherFilter.pidAction(TS::PacketView::pidNullPacket - 1), StreamFilter::Action::Drop);
+    QCOMPARE(otherFilter.pidAction(0x0011), StreamFilter::Action::Pass);  // SDT
+}
+
+void TestStreamFilter::singleProgram()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(500);
+
+    TS::PSIDemux psi;
+    for (int pos = 0; pos + TS::PacketView::sizeBasic <= input.length(); pos += TS::PacketView::sizeBasic)
+        psi.addPacket(TS::PacketView(input.constData() + pos));
+
+    StreamFilter::Spec spec;
+    QVERIFY(StreamFilter::Spec::fromQuery(QUrlQuery("program=" + QString::number(config.programNumber)), &spec, nullptr));
+    QVERIFY(spec.selectsAllStreams());
+    QVERIFY(!spec.isEmpty());
+    StreamFilter filter(spec);
+    filter.update(psi);
+
+    // All of the program's streams, nothing else.
+    QCOMPARE(filter.pidAction(config.videoPID), StreamFilter::Action::Pass);
+    QCOMPARE(filter.pidAction(config.audioPID), StreamFilter::Action::Pass);
+    QCOMPARE(filter.pidAction(config.pmtPID), StreamFilter::Action::ReplacePSI);
+    QCOMPARE(filter.pidAction(0), StreamFilter::Action::ReplacePSI);
+    QCOMPARE(filter.pidAction(TS::PacketView::pidNullPacket), StreamFilter::Action::Drop);
+
+    StreamFilter::Spec otherSpec;
+    otherSpec.programNumber = config.programNumber + 1;
+    StreamFilter otherFilter(otherSpec);
+    otherFilter.update(psi);
+    QCOMPARE(otherFilter.pidAction(config.videoPID), StreamFilter::Action::Drop);
+    QCOMPARE(otherFilter.pidAction(config.audioPID), StreamFilter::Action::Drop);
+    QCOMPARE(otherFilter.pidAction(config.pmtPID), StreamFilter::Action::Drop);
+}
+
+void TestStreamFilter::packetSizes_data()
+{
+    QTest::addColumn<int>("packetSize");
+
+    QTest::newRow("188") << 188;
+    QTest::newRow("192") << 192;
+    QTest::newRow("204") << 204;
+    QTest::newRow("208") << 208;
+}
+
+void TestStreamFilter::packetSizes()
+{
+    QFETCH(int, packetSize);
+
+    TS::StreamGenerator::Config config;
+    config.packetSize = packetSize;
+    TS::StreamGenerator generator(config);
+    const QByteArray input = generator.generatePackets(3000);
+    const int basicOffset = TS::PacketView::basicOffsetForPacketSize(packetSize);
+
+    StreamFilter::Spec spec;
+    spec.audio = true;
+    StreamFilter filter(spec);
+    TS::PSIDemux inputPSI;
+    QObject::connect(&inputPSI, &TS::PSIDemux::patChanged, [&]() { filter.update(inputPSI); });
+    QObject::connect(&inputPSI, &TS::PSIDemux::pmtChanged, [&]() { filter.update(inputPSI); });
+
+    int passCount = 0, replaceCount = 0;
+    for (int pos = 0; pos + packetSize <= input.length(); pos += packetSize) {
+        const QByteArray packetBytes = input.mid(pos, packetSize);
+        const TS::PacketView inputView(packetBytes.constData() + basicOffset);
+        QVERIFY(inputView.isSyncByteValid());
+        inputPSI.addPacket(inputView);
+
+        switch (filter.processPacket(packetBytes)) {
+        case StreamFilter::Result::Drop:
+            break;
+        case StreamFilter::Result::Pass:
+            // Filtered, not the whole mux.
+            QCOMPARE(inputView.pid(), config.audioPID);
+            passCount++;
+            break;
+        case StreamFilter::Result::Replace:
+            for (int i = 0; i < filter.replacementPackets().length(); i++) {
+                const QByteArray outBytes = replacementBytes(filter, i);
+#ifndef TS_PACKET_V2
+                // Prefix stays in front, suffix stays behind.
+                QCOMPARE(outBytes.length(), packetSize);
+                QCOMPARE(outBytes.left(basicOffset), packetBytes.left(basicOffset));
+                QCOMPARE(outBytes.mid(basicOffset + TS::PacketView::sizeBasic),
+                         packetBytes.mid(basicOffset + TS::PacketView::sizeBasic));
+                const TS::PacketView view(outBytes.constData() + basicOffset);
+#else
+                // (replacementBytes() generates basic packets only.)
+                QCOMPARE(outBytes.length(), int(TS::PacketView::sizeBasic));
+                const TS::PacketView view(outBytes);
+#endif
+                QVERIFY(view.isSyncByteValid());
+                QVERIFY(view.pid() == 0 || view.pid() == config.pmtPID || view.pid() == config.videoPID);
+                replaceCount++;
+            }
+            break;
+        }
+    }
+
+    QVERIFY(passCount > 0);
+    QVERIFY(replaceCount > 0);
+    QCOMPARE(filter.pidAction(config.videoPID), StreamFilter::Action::PCROnly);
+    QCOMPARE(filter.pidAction(config.audioPID), StreamFilter::Action::Pass);
+}
+
+QTEST_APPLESS_MAIN(TestStreamFilter)
+#include "tst_streamfilter.moc"
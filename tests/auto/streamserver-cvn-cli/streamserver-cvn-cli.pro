@@ -1,3 +1,8 @@
 TEMPLATE = subdirs
 SUBDIRS = \
-    http
+    hlssegmenter \
+    http \
+    inputcapture \
+    paddingdrop \
+    programpath \
+    streamfilter
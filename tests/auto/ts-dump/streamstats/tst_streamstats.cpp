@@ -0,0 +1,161 @@
+#include <QtTest>
+
+#include "streamstats.h"
+#include "tspacketview.h"
+#include "tsstreamgenerator.h"
+
+#include <cmath>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+class TestStreamStats : public QObject
+{
+    Q_OBJECT
+
+    static const int packetsPerSecond = 4000000 / (TS::PacketView::sizeBasic * 8);
+
+    static void feed(const QByteArray &bytes, int packetSize, StreamStats *stats);
+    static QJsonObject jsonReport(const StreamStats &stats);
+    static QJsonObject pidObject(const QJsonObject &report, quint16 pid);
+
+private slots:
+    void generatedStream();
+    void packetSizes_data();
+    void packetSizes();
+};
+
+void TestStreamStats::feed(const QByteArray &bytes, int packetSize, StreamStats *stats)
+{
+    for (int pos = 0; pos + packetSize <= bytes.length(); pos += packetSize)
+        stats->addPacket(bytes.constData() + pos);
+}
+
+QJsonObject TestStreamStats::jsonReport(const StreamStats &stats)
+{
+    QByteArray out;
+    stats.appendReport(&out, PacketFormatter::Format::JSONLines, QString());
+    return QJsonDocument::fromJson(out).object();
+}
+
+QJsonObject TestStreamStats::pidObject(const QJsonObject &report, quint16 pid)
+{
+    for (const QJsonValue &value : report.value("pids").toArray()) {
+        const QJsonObject obj = value.toObject();
+        if (obj.value("pid").toInt() == pid)
+            return obj;
+    }
+    return QJsonObject();
+}
+
+void TestStreamStats::generatedStream()
+{
+    TS::StreamGenerator::Config config;
+    TS::StreamGenerator generator(config);
+    StreamStats stats(TS::PacketView::sizeBasic, 0, false);
+
+    // 25s of stream time, with two PCR jumps of 10s in between.
+    feed(generator.generatePackets(10 * packetsPerSecond), TS::PacketView::sizeBasic, &stats);
+    generator.injectDiscontinuity();
+    feed(generator.generatePackets(10 * packetsPerSecond), TS::PacketView::sizeBasic, &stats);
+    generator.injectDiscontinuity();
+    feed(generator.generatePackets(5 * packetsPerSecond), TS::PacketView::sizeBasic, &stats);
+    const qint64 packetCount = 25 * packetsPerSecond;
+    const double streamSecs = generator.streamNanosecs() / 1e9;
+    QCOMPARE(stats.packetCount(), packetCount);
+
+    const QJsonObject report = jsonReport(stats);
+    QCOMPARE(report.value("packets").toDouble(), double(packetCount));
+    QCOMPARE(report.value("syncErrors").toDouble(), 0.);
+    QCOMPARE(report.value("continuityErrors").toDouble(), 0.);
+    QCOMPARE(report.value("transportErrors").toDouble(), 0.);
+    QCOMPARE(report.value("timelinePID").toInt(), int(config.videoPID));
+
+    // Duration and bitrate by PCR, leaving out the jumps.
+    const double duration = report.value("durationSecs").toDouble();
+    QVERIFY2(std::fabs(duration - streamSecs) < 0.2,
+             qPrintable(QString("%1 vs. %2").arg(duration).arg(streamSecs)));
+    const double bitrate = report.value("bitrate").toDouble();
+    QVERIFY2(std::fabs(bitrate - config.bitrate) < config.bitrate * 0.01, qPrintable(QString::number(bitrate)));
+
+    QCOMPARE(report.value("discontinuities").toDouble(), 2.);
+    const QJsonArray boundaries = report.value("boundaries").toArray();
+    QCOMPARE(boundaries.size(), 2);
+    for (const QJsonValue &value : boundaries) {
+        const QJsonObject boundary = value.toObject();
+        QVERIFY(boundary.value("indicated").toBool());
+        const double jumpSecs = boundary.value("pcrAfterSecs").toDouble() - boundary.value("pcrBeforeSecs").toDouble();
+        QVERIFY2(jumpSecs >= 10 && jumpSecs < 10.1, qPrintable(QString::number(jumpSecs)));
+        QCOMPARE(boundary.value("offset").toDouble(),
+                 (boundary.value("packet").toDouble() - 1) * TS::PacketView::sizeBasic);
+    }
+    QVERIFY(boundaries.at(0).toObject().value("packet").toDouble() > 10 * packetsPerSecond);
+    QVERIFY(boundaries.at(1).toObject().value("packet").toDouble() > 20 * packetsPerSecond);
+
+    // PCR every 40ms, unless PSI took precedence, up to a few packets' time later.
+    const QJsonObject video = pidObject(report, config.videoPID);
+    QVERIFY(!video.isEmpty());
+    const QJsonObject pcr = video.value("pcr").toObject();
+    const double pcrCount = pcr.value("count").toDouble();
+    QVERIFY2(std::fabs(pcrCount - streamSecs / 0.040) < streamSecs, qPrintable(QString::number(pcrCount)));
+    QVERIFY(pcr.value("intervalMinSecs").toDouble() > 0.0399);
+    QVERIFY(pcr.value("intervalAvgSecs").toDouble() < 0.041);
+    QVERIFY(pcr.value("intervalMaxSecs").toDouble() < 0.042);
+    // (Constant bitrate, so the PCRs are just where the bitrate puts them.)
+    QVERIFY(pcr.value("jitterMaxSecs").toDouble() < 1e-5);
+
+    // Per PID, the video share of the bitrate.
+    const double videoBitrate = video.value("bitrate").toDouble();
+    QVERIFY2(videoBitrate > config.videoBitrate * 0.9 && videoBitrate < config.bitrate,
+             qPrintable(QString::number(videoBitrate)));
+    QVERIFY(!pidObject(report, config.audioPID).isEmpty());
+    QVERIFY(pidObject(report, config.videoPID).value("description").toString().contains("with PCR"));
+    QCOMPARE(pidObject(report, config.pmtPID).value("description").toString(), QString("PMT, program 1"));
+
+    // The same numbers for humans.
+    QByteArray text;
+    stats.appendReport(&text, PacketFormatter::Format::Text, QString());
+    QVERIFY(text.contains("Packets: " + QByteArray::number(packetCount) + " ("));
+    QVERIFY(text.contains("Discontinuities: 2\n"));
+    QVERIFY(text.contains(", indicated\n"));
+}
+
+void TestStreamStats::packetSizes_data()
+{
+    QTest::addColumn<int>("packetSize");
+    QTest::addColumn<int>("basicOffset");
+
+    QTest::newRow("188") << 188 << 0;
+    QTest::newRow("192") << 192 << 4;
+    QTest::newRow("204") << 204 << 0;
+    QTest::newRow("208") << 208 << 0;
+}
+
+void TestStreamStats::packetSizes()
+{
+    QFETCH(int, packetSize);
+    QFETCH(int, basicOffset);
+
+    TS::StreamGenerator::Config config;
+    config.packetSize = packetSize;
+    TS::StreamGenerator generator(config);
+    const QByteArray bytes = generator.generatePackets(2 * packetsPerSecond);
+
+    QCOMPARE(StreamStats::detectPacketSize(bytes.left(10 * packetSize)), packetSize);
+    QCOMPARE(TS::PacketView::basicOffsetForPacketSize(packetSize), basicOffset);
+
+    StreamStats stats(packetSize, basicOffset, true);
+    feed(bytes, packetSize, &stats);
+
+    const QJsonObject report = jsonReport(stats);
+    QCOMPARE(report.value("packetSize").toInt(), packetSize);
+    QCOMPARE(report.value("basicOffset").toInt(), basicOffset);
+    QCOMPARE(report.value("packets").toDouble(), double(2 * packetsPerSecond));
+    QCOMPARE(report.value("syncErrors").toDouble(), 0.);
+    QCOMPARE(report.value("continuityErrors").toDouble(), 0.);
+    QCOMPARE(report.value("discontinuities").toDouble(), 0.);
+    QVERIFY(report.value("durationSecs").toDouble() > 1.9);
+}
+
+QTEST_APPLESS_MAIN(TestStreamStats)
+#include "tst_streamstats.moc"
@@ -0,0 +1,172 @@
+#include <QtTest>
+
+#include "tspacket.h"
+#include "tspacketv2.h"
+#include "tsstreamgenerator.h"
+
+// Parses/generates single packets of a realistic synthetic stream
+// (PSI, PES starts with PCR/adaptation field, payload, null packets)
+// through the V1 TSPacket and the V2 PacketV2Parser/PacketV2Generator,
+// as the reader and the server do for every input packet.
+class BenchTSPacket : public QObject
+{
+    Q_OBJECT
+
+    static const int packetsPerIteration = 10000;
+
+    static QList<QByteArray> generatePackets(int packetSize)
+    {
+        TS::StreamGenerator::Config config;
+        config.packetSize = packetSize;
+        TS::StreamGenerator generator(config);
+        const QByteArray bytes = generator.generatePackets(packetsPerIteration);
+
+        QList<QByteArray> packets;
+        packets.reserve(packetsPerIteration);
+        for (int i = 0; i < packetsPerIteration; i++)
+            packets.append(bytes.mid(i * packetSize, packetSize));
+        return packets;
+    }
+
+    static void addPacketSizeRows()
+    {
+        QTest::addColumn<int>("packetSize");
+
+        QTest::newRow("188 bytes")                       << 188;
+        QTest::newRow("192 bytes (time-code prefix)")    << 192;
+    }
+
+private slots:
+    void parseV1_data();
+    void parseV1();
+    void parseV2_data();
+    void parseV2();
+    void generateV2_data();
+    void generateV2();
+};
+
+void BenchTSPacket::parseV1_data()
+{
+    addPacketSizeRows();
+}
+
+void BenchTSPacket::parseV1()
+{
+    QFETCH(int, packetSize);
+
+    const QList<QByteArray> packets = generatePackets(packetSize);
+
+    qint64 totalNsecs = 0;
+    qint64 totalPackets = 0;
+    QBENCHMARK {
+        int errorCount = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (const QByteArray &bytes : packets) {
+            TSPacket packet(bytes);
+            if (!packet.errorMessage().isNull())
+                errorCount++;
+        }
+        totalNsecs += timer.nsecsElapsed();
+        totalPackets += packets.length();
+
+        if (errorCount > 0)
+            QFAIL("Unexpected packet errors");
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f packets/second", QTest::currentDataTag(),
+              totalPackets * 1e9 / totalNsecs);
+}
+
+void BenchTSPacket::parseV2_data()
+{
+    addPacketSizeRows();
+}
+
+void BenchTSPacket::parseV2()
+{
+    QFETCH(int, packetSize);
+
+    const QList<QByteArray> packets = generatePackets(packetSize);
+    TS::PacketV2Parser parser;
+    parser.setPrefixLength(packetSize - TS::PacketV2::sizeBasic);
+
+    qint64 totalNsecs = 0;
+    qint64 totalPackets = 0;
+    QBENCHMARK {
+        int errorCount = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (const QByteArray &bytes : packets) {
+            TS::PacketV2 packet;
+            if (!parser.parse(bytes, &packet))
+                errorCount++;
+        }
+        totalNsecs += timer.nsecsElapsed();
+        totalPackets += packets.length();
+
+        if (errorCount > 0)
+            QFAIL("Unexpected packet errors");
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f packets/second", QTest::currentDataTag(),
+              totalPackets * 1e9 / totalNsecs);
+}
+
+void BenchTSPacket::generateV2_data()
+{
+    addPacketSizeRows();
+}
+
+void BenchTSPacket::generateV2()
+{
+    QFETCH(int, packetSize);
+
+    const int prefixLength = packetSize - TS::PacketV2::sizeBasic;
+    QList<TS::PacketV2> packets;
+    {
+        TS::PacketV2Parser parser;
+        parser.setPrefixLength(prefixLength);
+        for (const QByteArray &bytes : generatePackets(packetSize)) {
+            TS::PacketV2 packet;
+            QString errorMessage;
+            if (!parser.parse(bytes, &packet, &errorMessage))
+                QFAIL(qPrintable("Can't parse input packet: " + errorMessage));
+            packets.append(packet);
+        }
+    }
+    TS::PacketV2Generator generator;
+    generator.setPrefixLength(prefixLength);
+
+    qint64 totalNsecs = 0;
+    qint64 totalPackets = 0;
+    QBENCHMARK {
+        QByteArray bytes;
+        bytes.reserve(packets.length() * packetSize);
+        int errorCount = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (const TS::PacketV2 &packet : packets) {
+            if (!generator.generate(packet, &bytes))
+                errorCount++;
+        }
+        totalNsecs += timer.nsecsElapsed();
+        totalPackets += packets.length();
+
+        if (errorCount > 0 || bytes.length() != packets.length() * packetSize)
+            QFAIL("Unexpected generate result");
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f packets/second", QTest::currentDataTag(),
+              totalPackets * 1e9 / totalNsecs);
+}
+
+QTEST_APPLESS_MAIN(BenchTSPacket)
+
+#include "bench_tspacket.moc"
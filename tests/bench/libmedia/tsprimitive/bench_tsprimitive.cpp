@@ -0,0 +1,176 @@
+#include <QtTest>
+
+#include "tsprimitive.h"
+
+using namespace TS;
+
+// Takes/puts a packet-sized stream of fields of typical widths from/to
+// a TS::BitStream, which all of PacketV2 parsing and generation is built on.
+class BenchTSPrimitive : public QObject
+{
+    Q_OBJECT
+
+    static const int bytesPerIteration = 188 * 1000;
+
+    enum FieldKind {
+        FlagField,         // bslbf1, e.g., payload_unit_start_indicator
+        PIDField,          // uimsbf<13>
+        PCRBaseField,      // uimsbf<33>
+        AlignedByteField,  // uimsbf<8> on byte boundaries
+    };
+
+    template <typename T>
+    static int fieldCount()
+    {
+        return static_cast<int>(bytesPerIteration * 8 / T::stream_bit_size);
+    }
+
+    template <typename T>
+    static qint64 takeFields(BitStream &bitSource)
+    {
+        const int count = fieldCount<T>();
+        T field;
+        qint64 sum = 0;
+        for (int i = 0; i < count; i++) {
+            bitSource >> field;
+            sum += field.value;
+        }
+        return sum;
+    }
+
+    template <typename T>
+    static void putFields(BitStream &bitSink)
+    {
+        using working_type = typename T::working_type;
+        const quint64 mask = (T::stream_bit_size >= 64) ? ~quint64(0) : (quint64(1) << T::stream_bit_size) - 1;
+
+        const int count = fieldCount<T>();
+        T field;
+        for (int i = 0; i < count; i++) {
+            field.value = static_cast<working_type>(static_cast<quint64>(i) * 0x9e3779b97f4a7c15ull & mask);
+            bitSink << field;
+        }
+        bitSink.flush();
+    }
+
+    static void addFieldKindRows();
+
+private slots:
+    void take_data();
+    void take();
+    void put_data();
+    void put();
+};
+
+void BenchTSPrimitive::addFieldKindRows()
+{
+    QTest::addColumn<int>("fieldKind");
+
+    QTest::newRow("flag, 1 bit")         << static_cast<int>(FlagField);
+    QTest::newRow("PID, 13 bits")        << static_cast<int>(PIDField);
+    QTest::newRow("PCR base, 33 bits")   << static_cast<int>(PCRBaseField);
+    QTest::newRow("aligned byte, 8 bits") << static_cast<int>(AlignedByteField);
+}
+
+void BenchTSPrimitive::take_data()
+{
+    addFieldKindRows();
+}
+
+void BenchTSPrimitive::take()
+{
+    QFETCH(int, fieldKind);
+
+    // Pseudo-random bytes, so the bits aren't all the same.
+    QByteArray bytes(bytesPerIteration, '\0');
+    quint32 state = 1;
+    for (int i = 0; i < bytes.length(); i++) {
+        state = state * 1664525u + 1013904223u;
+        bytes[i] = static_cast<char>(state >> 24);
+    }
+
+    qint64 totalNsecs = 0;
+    qint64 totalFields = 0;
+    qint64 checksum = 0;
+    QBENCHMARK {
+        BitStream bitSource(bytes);
+
+        QElapsedTimer timer;
+        timer.start();
+        switch (static_cast<FieldKind>(fieldKind)) {
+        case FlagField:
+            checksum += takeFields<bslbf1>(bitSource);
+            totalFields += fieldCount<bslbf1>();
+            break;
+        case PIDField:
+            checksum += takeFields<uimsbf<13, quint16>>(bitSource);
+            totalFields += fieldCount<uimsbf<13, quint16>>();
+            break;
+        case PCRBaseField:
+            checksum += takeFields<uimsbf<33, quint64>>(bitSource);
+            totalFields += fieldCount<uimsbf<33, quint64>>();
+            break;
+        case AlignedByteField:
+            checksum += takeFields<uimsbf<8, quint8>>(bitSource);
+            totalFields += fieldCount<uimsbf<8, quint8>>();
+            break;
+        }
+        totalNsecs += timer.nsecsElapsed();
+    }
+
+    QVERIFY(checksum != 0);
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f fields/second", QTest::currentDataTag(),
+              totalFields * 1e9 / totalNsecs);
+}
+
+void BenchTSPrimitive::put_data()
+{
+    addFieldKindRows();
+}
+
+void BenchTSPrimitive::put()
+{
+    QFETCH(int, fieldKind);
+
+    const QByteArray bytes(bytesPerIteration, '\0');
+
+    qint64 totalNsecs = 0;
+    qint64 totalFields = 0;
+    QBENCHMARK {
+        BitStream bitSink(bytes);
+
+        QElapsedTimer timer;
+        timer.start();
+        switch (static_cast<FieldKind>(fieldKind)) {
+        case FlagField:
+            putFields<bslbf1>(bitSink);
+            totalFields += fieldCount<bslbf1>();
+            break;
+        case PIDField:
+            putFields<uimsbf<13, quint16>>(bitSink);
+            totalFields += fieldCount<uimsbf<13, quint16>>();
+            break;
+        case PCRBaseField:
+            putFields<uimsbf<33, quint64>>(bitSink);
+            totalFields += fieldCount<uimsbf<33, quint64>>();
+            break;
+        case AlignedByteField:
+            putFields<uimsbf<8, quint8>>(bitSink);
+            totalFields += fieldCount<uimsbf<8, quint8>>();
+            break;
+        }
+        totalNsecs += timer.nsecsElapsed();
+
+        if (bitSink.bytes().length() != bytesPerIteration)
+            QFAIL("Unexpected output length");
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f fields/second", QTest::currentDataTag(),
+              totalFields * 1e9 / totalNsecs);
+}
+
+QTEST_APPLESS_MAIN(BenchTSPrimitive)
+
+#include "bench_tsprimitive.moc"
@@ -0,0 +1,205 @@
+#include <QtTest>
+
+#include "log.h"
+#include "tsreader.h"
+#include "tsstreamgenerator.h"
+
+using namespace SSCvn;
+
+// Pushes a large, valid stream through TS::Reader, to measure the cost
+// of the per-packet path including its (normally disabled) debug tracing.
+//
+// Compare a default build against one with SSCVN_LOG_MAX_VERBOSE=0
+// (see config.pri) to see what the run-time verbosity checks cost.
+class BenchTSReader : public QObject
+{
+    Q_OBJECT
+
+    static const int packetsPerIteration = 100000;
+    static const int readersPerIteration = 1000;
+
+private slots:
+    void readStream_data();
+    void readStream();
+    void readGeneratedStream_data();
+    void readGeneratedStream();
+    void autoDetect_data();
+    void autoDetect();
+};
+
+void BenchTSReader::readStream_data()
+{
+    QTest::addColumn<int>("verboseLevel");
+
+    QTest::newRow("verbose 0")  << 0;
+    QTest::newRow("verbose 2")  << 2;
+}
+
+void BenchTSReader::readStream()
+{
+    QFETCH(int, verboseLevel);
+
+    // Null packets: PID 0x1FFF, payload only, all-ones stuffing.
+    QByteArray packetBytes(188, '\xff');
+    packetBytes[0] = '\x47';
+    packetBytes[1] = '\x1f';
+    packetBytes[2] = '\xff';
+    packetBytes[3] = '\x10';
+    QByteArray streamBytes;
+    streamBytes.reserve(packetBytes.length() * packetsPerIteration);
+    for (int i = 0; i < packetsPerIteration; i++)
+        streamBytes.append(packetBytes);
+
+    const int verbosePrev = log::verbose;
+    log::verbose = verboseLevel;
+
+    qint64 totalNsecs = 0;
+    qint64 totalPackets = 0;
+    QBENCHMARK {
+        QBuffer buffer(&streamBytes);
+        buffer.open(QIODevice::ReadOnly);
+        TS::Reader reader(&buffer);
+        reader.setTSPacketAutoSize(false);
+        reader.setTSPacketSize(188);
+
+        qint64 packetCount = 0;
+        connect(&reader, &TS::Reader::tsPacketReady, [&packetCount](const QSharedPointer<ConversionNode<TS::Packet>> &) {
+            packetCount++;
+        });
+
+        QElapsedTimer timer;
+        timer.start();
+        reader.readData();
+        totalNsecs += timer.nsecsElapsed();
+        totalPackets += packetCount;
+
+        if (packetCount != packetsPerIteration) {
+            log::verbose = verbosePrev;
+            QFAIL("Unexpected packet count");
+        }
+    }
+
+    log::verbose = verbosePrev;
+
+#ifdef SSCVN_LOG_MAX_VERBOSE
+    const QByteArray maxVerbose = QByteArray::number(SSCVN_LOG_MAX_VERBOSE);
+#else
+    const QByteArray maxVerbose = "none";
+#endif
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f packets/second (compile-time maximum verbosity: %s)", QTest::currentDataTag(),
+              totalPackets * 1e9 / totalNsecs, maxVerbose.constData());
+}
+
+void BenchTSReader::readGeneratedStream_data()
+{
+    QTest::addColumn<int>("packetSize");
+
+    QTest::newRow("188 bytes")                     << 188;
+    QTest::newRow("192 bytes (time-code prefix)")  << 192;
+}
+
+// Like readStream, but on a large realistic stream instead of null packets,
+// so parsing adaptation fields/PCRs and discontinuity checks are included.
+void BenchTSReader::readGeneratedStream()
+{
+    QFETCH(int, packetSize);
+
+    TS::StreamGenerator::Config config;
+    config.packetSize = packetSize;
+    TS::StreamGenerator generator(config);
+    QByteArray streamBytes = generator.generatePackets(packetsPerIteration);
+
+    qint64 totalNsecs = 0;
+    qint64 totalPackets = 0;
+    QBENCHMARK {
+        QBuffer buffer(&streamBytes);
+        buffer.open(QIODevice::ReadOnly);
+        TS::Reader reader(&buffer);
+        reader.setTSPacketAutoSize(false);
+        reader.setTSPacketSize(packetSize);
+
+        qint64 packetCount = 0, errorCount = 0;
+        connect(&reader, &TS::Reader::tsPacketReady, [&packetCount](const QSharedPointer<ConversionNode<TS::Packet>> &) {
+            packetCount++;
+        });
+        connect(&reader, &TS::Reader::errorEncountered, [&errorCount](TS::Reader::ErrorKind, const QString &) {
+            errorCount++;
+        });
+
+        QElapsedTimer timer;
+        timer.start();
+        reader.readData();
+        totalNsecs += timer.nsecsElapsed();
+        totalPackets += packetCount;
+
+        if (packetCount != packetsPerIteration || errorCount > 0)
+            QFAIL("Unexpected packet or error count");
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f packets/second", QTest::currentDataTag(),
+              totalPackets * 1e9 / totalNsecs);
+}
+
+void BenchTSReader::autoDetect_data()
+{
+    QTest::addColumn<int>("packetSize");
+
+    QTest::newRow("188 bytes")                     << 188;
+    QTest::newRow("192 bytes (time-code prefix)")  << 192;
+    QTest::newRow("204 bytes (16 bytes suffix)")   << 204;
+    QTest::newRow("208 bytes (20 bytes suffix)")   << 208;
+}
+
+// Packet size auto-detection, as done on every (re)opened input:
+// Fresh readers on the start of a stream, until the packet size is known.
+void BenchTSReader::autoDetect()
+{
+    QFETCH(int, packetSize);
+
+    TS::StreamGenerator::Config config;
+    config.packetSize = packetSize;
+    TS::StreamGenerator generator(config);
+    // (Detection needs 16 basic packets' worth of buffer.)
+    QByteArray streamBytes = generator.generatePackets(24);
+
+    // Each detection is logged at verbose level 0.
+    const int verbosePrev = log::verbose;
+    log::verbose = -1;
+
+    qint64 totalNsecs = 0;
+    qint64 totalReaders = 0;
+    QBENCHMARK {
+        int failCount = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < readersPerIteration; i++) {
+            QBuffer buffer(&streamBytes);
+            buffer.open(QIODevice::ReadOnly);
+            TS::Reader reader(&buffer);
+            reader.setTSPacketAutoSize(true);
+            reader.readData();
+            if (reader.tsPacketSize() != packetSize)
+                failCount++;
+        }
+        totalNsecs += timer.nsecsElapsed();
+        totalReaders += readersPerIteration;
+
+        if (failCount > 0) {
+            log::verbose = verbosePrev;
+            QFAIL("Packet size not detected");
+        }
+    }
+
+    log::verbose = verbosePrev;
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f detections/second", QTest::currentDataTag(),
+              totalReaders * 1e9 / totalNsecs);
+}
+
+QTEST_APPLESS_MAIN(BenchTSReader)
+
+#include "bench_tsreader.moc"
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Runs all benchmark executables of a build tree and stores their results
+# in machine-readable form, to track performance across releases:
+#
+#   RESULTS_DIR/info.txt     what was measured (git describe, host, date)
+#   RESULTS_DIR/NAME.xml     Qt Test XML, incl. <BenchmarkResult> per data row
+#   RESULTS_DIR/NAME.csv     Qt Test CSV, benchmark results only
+#   RESULTS_DIR/NAME.txt     human-readable output, incl. the rates printed
+#
+# Usage: run-benchmarks.sh BUILD_DIR [RESULTS_DIR [QTEST_OPTION...]]
+#
+# Further options go to each benchmark, e.g. "-iterations 10" or "-callgrind".
+
+set -e
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 BUILD_DIR [RESULTS_DIR [QTEST_OPTION...]]" >&2
+	exit 2
+fi
+
+SRC_DIR=$(cd "$(dirname "$0")/../.." && pwd)
+BUILD_DIR=$1
+shift
+DESCRIBE=$(git -C "$SRC_DIR" describe --always --dirty 2>/dev/null || echo unknown)
+RESULTS_DIR=${1:-bench-results/$DESCRIBE-$(date +%Y%m%d-%H%M%S)}
+[ $# -ge 1 ] && shift
+
+BENCH_BUILD_DIR=$BUILD_DIR/tests/bench
+if [ ! -d "$BENCH_BUILD_DIR" ]; then
+	echo "$0: No benchmarks built in $BUILD_DIR" >&2
+	exit 1
+fi
+
+mkdir -p "$RESULTS_DIR"
+{
+	echo "describe: $DESCRIBE"
+	echo "date: $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+	echo "host: $(uname -a)"
+	echo "cpus: $(getconf _NPROCESSORS_ONLN 2>/dev/null || echo unknown)"
+} >"$RESULTS_DIR/info.txt"
+
+failed=0
+for BENCH in $(find "$BENCH_BUILD_DIR" -type f -name 'bench_*' -perm -u+x | sort); do
+	NAME=$(basename "$BENCH")
+	echo "Running $NAME..."
+	if ! "$BENCH" \
+		-o "$RESULTS_DIR/$NAME.xml,xml" \
+		-o "$RESULTS_DIR/$NAME.csv,csv" \
+		-o "$RESULTS_DIR/$NAME.txt,txt" \
+		"$@"
+	then
+		echo "$0: $NAME failed" >&2
+		failed=1
+	fi
+done
+
+echo "Results in $RESULTS_DIR"
+exit $failed
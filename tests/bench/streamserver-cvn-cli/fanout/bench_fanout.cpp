@@ -0,0 +1,183 @@
+#include <QtTest>
+
+#include "streamserver.h"
+#include "log.h"
+#include "tsstreamgenerator.h"
+
+#include <memory>
+#include <vector>
+#include <QTcpSocket>
+#include <QTemporaryFile>
+
+using namespace SSCvn;
+
+// End-to-end: A StreamServer reads a synthetic stream from a file
+// (without PCR brake, so as fast as possible) and fans it out over
+// real loopback TCP connections to M in-process clients, each of which
+// reads until it has got the whole stream.
+//
+// Only the time from opening the input until the last client has
+// received the last byte is counted; connection setup and teardown are
+// not. So, instead of QBENCHMARK (which would time the whole iteration),
+// that data phase is measured directly, and reported as the result.
+class BenchFanOut : public QObject
+{
+    Q_OBJECT
+
+    static const int packetsPerIteration = 20000;
+    static const int iterations = 3;
+    // (HTTP::Server can't report an ephemeral port, so use a fixed one.)
+    static const quint16 listenPort = 18089;
+    static const int timeoutMillisec = 60000;
+
+    QTemporaryFile  _inputFile;
+
+    struct Client {
+        std::unique_ptr<QTcpSocket>  socket;
+        QByteArray  headerBytes;
+        bool        headerDone = false;
+        qint64      bodyBytes  = 0;
+    };
+
+private slots:
+    void initTestCase();
+    void fanOut_data();
+    void fanOut();
+};
+
+void BenchFanOut::initTestCase()
+{
+    QVERIFY(_inputFile.open());
+    TS::StreamGenerator generator;
+    const QByteArray bytes = generator.generatePackets(packetsPerIteration);
+    QCOMPARE(_inputFile.write(bytes), qint64(bytes.length()));
+    QVERIFY(_inputFile.flush());
+}
+
+void BenchFanOut::fanOut_data()
+{
+    QTest::addColumn<int>("clientCount");
+
+    QTest::newRow("1 client")     << 1;
+    QTest::newRow("10 clients")   << 10;
+    QTest::newRow("100 clients")  << 100;
+}
+
+void BenchFanOut::fanOut()
+{
+    QFETCH(int, clientCount);
+
+    const qint64 expectedBodyBytes = _inputFile.size();
+
+    // The server logs every client (dis)connect at verbose level -1.
+    const int verbosePrev = log::verbose;
+    log::verbose = -2;
+
+    qint64 totalNsecs = 0;
+    qint64 totalPackets = 0;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        HTTP::Server httpServer(listenPort);
+        StreamServer server(std::make_unique<QFile>(_inputFile.fileName()), &httpServer);
+        server.setBrakeType(StreamServer::BrakeType::None);
+        // Don't start over at EOF while we're still measuring.
+        server.setInputFileReopenTimeoutMillisec(timeoutMillisec);
+
+        QEventLoop loop;
+        QTimer timeoutTimer;
+        timeoutTimer.setSingleShot(true);
+        connect(&timeoutTimer, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+        int bodiesDone = 0;
+        bool failed = false;
+
+        std::vector<Client> clients(clientCount);
+        for (Client &client : clients) {
+            client.socket = std::make_unique<QTcpSocket>();
+            QTcpSocket *socket = client.socket.get();
+            Client *clientPtr = &client;
+
+            connect(socket, &QTcpSocket::connected, [socket]() {
+                socket->write("GET /stream.m2ts HTTP/1.0\r\nHost: localhost\r\n\r\n");
+            });
+            connect(socket, &QTcpSocket::readyRead, [&, socket, clientPtr]() {
+                const QByteArray bytes = socket->readAll();
+                qint64 bodyBytes = bytes.length();
+                if (!clientPtr->headerDone) {
+                    clientPtr->headerBytes.append(bytes);
+                    const int headerEnd = clientPtr->headerBytes.indexOf("\r\n\r\n");
+                    if (headerEnd < 0)
+                        return;
+                    clientPtr->headerDone = true;
+                    bodyBytes = clientPtr->headerBytes.length() - (headerEnd + 4);
+                    if (!clientPtr->headerBytes.startsWith("HTTP/") ||
+                        clientPtr->headerBytes.indexOf(" 200 ") < 0)
+                    {
+                        failed = true;
+                        loop.quit();
+                        return;
+                    }
+                }
+
+                const bool wasDone = clientPtr->bodyBytes >= expectedBodyBytes;
+                clientPtr->bodyBytes += bodyBytes;
+                if (!wasDone && clientPtr->bodyBytes >= expectedBodyBytes && ++bodiesDone == clientCount)
+                    loop.quit();
+            });
+            connect(socket, &QTcpSocket::disconnected, [&]() {
+                failed = true;
+                loop.quit();
+            });
+
+            socket->connectToHost(QHostAddress::LocalHost, listenPort);
+        }
+
+        // Wait for all stream clients to be set up, server-side.
+        QTimer pollTimer;
+        connect(&pollTimer, &QTimer::timeout, [&]() {
+            if (server.clients().length() == clientCount)
+                loop.quit();
+        });
+        pollTimer.start(1);
+        timeoutTimer.start(timeoutMillisec);
+        loop.exec();
+        pollTimer.stop();
+        if (failed || server.clients().length() != clientCount) {
+            log::verbose = verbosePrev;
+            QFAIL("Clients failed to connect");
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        server.initInput();
+        timeoutTimer.start(timeoutMillisec);
+        loop.exec();
+        totalNsecs += timer.nsecsElapsed();
+        totalPackets += qint64(clientCount) * packetsPerIteration;
+
+        if (failed || bodiesDone != clientCount) {
+            log::verbose = verbosePrev;
+            QFAIL("Clients didn't receive the whole stream");
+        }
+
+        // Tear down client connections before the server goes away.
+        for (Client &client : clients)
+            client.socket->abort();
+        QElapsedTimer teardownTimer;
+        teardownTimer.start();
+        while (!server.clients().isEmpty() && teardownTimer.elapsed() < timeoutMillisec)
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+
+    log::verbose = verbosePrev;
+
+    // Per iteration, like QBENCHMARK would have it.
+    QTest::setBenchmarkResult(totalNsecs / 1e6 / iterations, QTest::WalltimeMilliseconds);
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f packets/second delivered, %.1f MB/second", QTest::currentDataTag(),
+              totalPackets * 1e9 / totalNsecs,
+              totalPackets * 188 * 1e3 / totalNsecs);
+}
+
+QTEST_GUILESS_MAIN(BenchFanOut)
+
+#include "bench_fanout.moc"
@@ -0,0 +1,100 @@
+#include <QtTest>
+
+#include "http/httprequest_netside.h"
+
+using namespace SSCvn;
+
+// Simulates a reconnect storm: Many players (re-)connecting at once,
+// each sending one typical request, which has to be parsed on a fresh
+// RequestNetside and looked up the way HTTP::Server does.
+class BenchHTTPRequestNetside : public QObject
+{
+    Q_OBJECT
+
+    static const int requestsPerIteration = 10000;
+
+private slots:
+    void reconnectStorm_data();
+    void reconnectStorm();
+};
+
+void BenchHTTPRequestNetside::reconnectStorm_data()
+{
+    QTest::addColumn<QByteArray>("request");
+    QTest::addColumn<int>("chunkSize");
+
+    const QByteArray vlc =
+        "GET /live.m2ts HTTP/1.1\r\n"
+        "Host: streamserver.example.org:8000\r\n"
+        "User-Agent: VLC/3.0.8 LibVLC/3.0.8\r\n"
+        "Range: bytes=0-\r\n"
+        "Connection: close\r\n"
+        "Icy-MetaData: 1\r\n"
+        "\r\n";
+    const QByteArray mpv =
+        "GET /stream.m2ts HTTP/1.1\r\n"
+        "User-Agent: Lavf/58.29.100\r\n"
+        "Accept: */*\r\n"
+        "Range: bytes=0-\r\n"
+        "Connection: close\r\n"
+        "Host: streamserver.example.org:8000\r\n"
+        "Icy-MetaData: 1\r\n"
+        "\r\n";
+    const QByteArray browserHLS =
+        "GET /hls/index.m3u8 HTTP/1.1\r\n"
+        "Host: streamserver.example.org:8000\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:68.0) Gecko/20100101 Firefox/68.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Origin: https://player.example.org\r\n"
+        "Connection: keep-alive\r\n"
+        "Referer: https://player.example.org/watch\r\n"
+        "Pragma: no-cache\r\n"
+        "Cache-Control: no-cache\r\n"
+        "\r\n";
+
+    QTest::newRow("VLC, whole")          << vlc        << vlc.length();
+    QTest::newRow("mpv, whole")          << mpv        << mpv.length();
+    QTest::newRow("browser HLS, whole")  << browserHLS << browserHLS.length();
+    QTest::newRow("browser HLS, 64-byte segments") << browserHLS << 64;
+}
+
+void BenchHTTPRequestNetside::reconnectStorm()
+{
+    QFETCH(QByteArray, request);
+    QFETCH(int, chunkSize);
+
+    QList<QByteArray> chunks;
+    for (int i = 0; i < request.length(); i += chunkSize)
+        chunks.append(request.mid(i, chunkSize));
+
+    qint64 totalNsecs = 0;
+    qint64 totalRequests = 0;
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < requestsPerIteration; i++) {
+            HTTP::RequestNetside netside;
+            for (const QByteArray &chunk : chunks)
+                netside.processChunk(chunk);
+
+            const HTTP::HeaderNetside &header(netside.header());
+            if (netside.urlPath().isEmpty() || header.fieldCount("Host") != 1 ||
+                header.field("Host")->fieldValue().isEmpty())
+            {
+                QFAIL("Unexpected parse result");
+            }
+        }
+        totalNsecs += timer.nsecsElapsed();
+        totalRequests += requestsPerIteration;
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f requests/second", QTest::currentDataTag(),
+              totalRequests * 1e9 / totalNsecs);
+}
+
+QTEST_APPLESS_MAIN(BenchHTTPRequestNetside)
+
+#include "bench_httprequest_netside.moc"
@@ -0,0 +1,73 @@
+#include <QtTest>
+
+#include "http/httpresponse.h"
+
+using namespace SSCvn;
+
+// Serializes the responses the server sends most: the header-only
+// stream response every player gets on (re-)connect, and small
+// HLS playlist/stats bodies that are polled periodically.
+class BenchHTTPResponse : public QObject
+{
+    Q_OBJECT
+
+    static const int responsesPerIteration = 10000;
+
+private slots:
+    void toBytes_data();
+    void toBytes();
+};
+
+void BenchHTTPResponse::toBytes_data()
+{
+    QTest::addColumn<QString>("contentType");
+    QTest::addColumn<QByteArray>("body");
+
+    QByteArray playlist =
+        "#EXTM3U\n"
+        "#EXT-X-VERSION:3\n"
+        "#EXT-X-TARGETDURATION:4\n"
+        "#EXT-X-MEDIA-SEQUENCE:1234\n";
+    for (int i = 0; i < 6; i++)
+        playlist += "#EXTINF:4.000,\nsegment" + QByteArray::number(1234 + i) + ".ts\n";
+
+    QTest::newRow("stream, header only")     << "video/mp2t"                     << QByteArray();
+    QTest::newRow("HLS playlist")            << "application/vnd.apple.mpegurl"  << playlist;
+    QTest::newRow("stats, 4 KiB")            << "application/json"               << QByteArray(4096, 'x');
+}
+
+void BenchHTTPResponse::toBytes()
+{
+    QFETCH(QString, contentType);
+    QFETCH(QByteArray, body);
+
+    qint64 totalNsecs = 0;
+    qint64 totalResponses = 0;
+    QBENCHMARK {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < responsesPerIteration; i++) {
+            // (Built anew each time, like the handlers do.)
+            HTTP::Response response(HTTP::SC_200_OK, "OK");
+            response.setHeader("Content-Type", contentType);
+            if (!body.isEmpty()) {
+                response.setHeader("Cache-Control", "no-cache");
+                response.setHeader("Content-Length", QString::number(body.length()));
+                response.setBody(body);
+            }
+
+            if (response.toBytes().length() <= body.length())
+                QFAIL("Unexpected response length");
+        }
+        totalNsecs += timer.nsecsElapsed();
+        totalResponses += responsesPerIteration;
+    }
+
+    if (totalNsecs > 0)
+        qInfo("%s: %.0f responses/second", QTest::currentDataTag(),
+              totalResponses * 1e9 / totalNsecs);
+}
+
+QTEST_APPLESS_MAIN(BenchHTTPResponse)
+
+#include "bench_httpresponse.moc"
@@ -0,0 +1,66 @@
+#include "bufferedwriter.h"
+
+#include <stdexcept>
+#include <QIODevice>
+
+BufferedWriter::BufferedWriter(QIODevice *device, int capacity) :
+    _device(device), _capacity(capacity)
+{
+    if (!_device)
+        throw std::invalid_argument("Buffered writer ctor: Device must not be null");
+    if (!(_capacity > 0))
+        throw std::invalid_argument("Buffered writer ctor: Capacity must be positive");
+
+    // (Some slack, so a line appended past capacity doesn't reallocate.)
+    _buffer.reserve(_capacity + _capacity / 8);
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    flush();
+}
+
+QByteArray &BufferedWriter::buffer()
+{
+    return _buffer;
+}
+
+void BufferedWriter::append(const QByteArray &bytes)
+{
+    _buffer.append(bytes);
+}
+
+bool BufferedWriter::flushIfFull()
+{
+    if (_buffer.length() < _capacity)
+        return true;
+    return flush();
+}
+
+bool BufferedWriter::flush()
+{
+    if (_buffer.isEmpty())
+        return true;
+
+    const char *data = _buffer.constData();
+    qint64 left = _buffer.length();
+    while (left > 0) {
+        const qint64 written = _device->write(data, left);
+        if (written <= 0) {
+            // (Writing nothing would otherwise loop forever.)
+            _errorString = written < 0 ? _device->errorString() : QString("Device accepted no data");
+            _buffer.clear();
+            return false;
+        }
+        data += written;
+        left -= written;
+    }
+    // (Keeps the capacity.)
+    _buffer.resize(0);
+    return true;
+}
+
+QString BufferedWriter::errorString() const
+{
+    return _errorString;
+}
@@ -0,0 +1,39 @@
+#ifndef BUFFEREDWRITER_H
+#define BUFFEREDWRITER_H
+
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+
+
+// Collects output in a large buffer that callers append to directly,
+// and writes it out in big chunks, instead of once (or, with endl,
+// flushing) per line. Keeps dumping at disk/pipe speed.
+class BufferedWriter
+{
+    QIODevice  *_device;
+    int         _capacity;
+    QByteArray  _buffer;
+    QString     _errorString;
+
+public:
+    static constexpr int capacityDefault = 1 << 20;
+
+    explicit BufferedWriter(QIODevice *device, int capacity = capacityDefault);
+    // Flushes what's left; errors go unnoticed, so flush() explicitly first.
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    // To append to. Call flushIfFull() every now and then.
+    QByteArray &buffer();
+    void append(const QByteArray &bytes);
+
+    // Writes out the buffer once it reached capacity.
+    bool flushIfFull();
+    bool flush();
+    QString errorString() const;
+};
+
+#endif // BUFFEREDWRITER_H
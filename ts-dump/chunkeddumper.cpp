@@ -0,0 +1,99 @@
+#include "chunkeddumper.h"
+
+#include "bufferedwriter.h"
+#include "packetformatter.h"
+
+#include <stdexcept>
+#include <QFile>
+#include <QFuture>
+#include <QQueue>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+ChunkedDumper::ChunkedDumper(int jobs, qint64 chunkPackets) :
+    _jobs(jobs), _chunkPackets(chunkPackets)
+{
+    if (!(_jobs > 0))
+        throw std::invalid_argument("Chunked dumper ctor: Number of jobs must be positive");
+    if (!(_chunkPackets > 0))
+        throw std::invalid_argument("Chunked dumper ctor: Packets per chunk must be positive");
+}
+
+bool ChunkedDumper::dump(QFile *file, const PacketFormatter &formatter, BufferedWriter *writer, qint64 *packetCountPtr)
+{
+    if (!file || !writer || !packetCountPtr)
+        throw std::invalid_argument("Chunked dumper: File, writer and packet count can't be null");
+
+    const qint64 packetSize = formatter.packetSize();
+    const qint64 totalPackets = file->size() / packetSize;
+    *packetCountPtr = 0;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(_jobs);
+
+    struct Chunk {
+        uchar               *data;
+        qint64               packets;
+        QFuture<QByteArray>  future;
+    };
+    QQueue<Chunk> inFlight;
+    qint64 writtenPackets = 0;
+    bool ok = true;
+
+    auto writeOldest = [&]() {
+        Chunk chunk = inFlight.dequeue();
+        const QByteArray result = chunk.future.result();
+        file->unmap(chunk.data);
+        if (!ok)
+            return;
+        writer->append(result);
+        writtenPackets += chunk.packets;
+        if (!writer->flushIfFull()) {
+            _errorString = "Error writing output: " + writer->errorString();
+            ok = false;
+        }
+    };
+
+    qint64 nextPacket = 0;
+    while (ok && nextPacket < totalPackets) {
+        // Keep the threads busy, but don't map the whole file.
+        if (inFlight.length() >= 2 * _jobs) {
+            writeOldest();
+            continue;
+        }
+
+        const qint64 firstPacket = nextPacket;
+        const qint64 packets = qMin(_chunkPackets, totalPackets - firstPacket);
+        uchar *const data = file->map(firstPacket * packetSize, packets * packetSize);
+        if (!data) {
+            _errorString = "Error mapping file at offset " + QString::number(firstPacket * packetSize) +
+                ": " + file->errorString();
+            ok = false;
+            break;
+        }
+
+        inFlight.enqueue({ data, packets, QtConcurrent::run(&pool,
+                [chunkFormatter = formatter, data, firstPacket, packets, packetSize]() mutable {
+            const char *const bytes = reinterpret_cast<const char *>(data);
+            QByteArray out;
+            for (qint64 i = 0; i < packets; i++) {
+                const qint64 packetIndex = firstPacket + i;
+                chunkFormatter.appendPacket(bytes + i * packetSize, packetIndex * packetSize, packetIndex + 1, &out);
+            }
+            return out;
+        }) });
+        nextPacket += packets;
+    }
+
+    // (Also on errors, so no task is left reading from an unmapped chunk.)
+    while (!inFlight.isEmpty())
+        writeOldest();
+
+    *packetCountPtr = writtenPackets;
+    return ok;
+}
+
+QString ChunkedDumper::errorString() const
+{
+    return _errorString;
+}
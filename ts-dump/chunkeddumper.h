@@ -0,0 +1,38 @@
+#ifndef CHUNKEDDUMPER_H
+#define CHUNKEDDUMPER_H
+
+#include <QString>
+
+class QFile;
+class BufferedWriter;
+class PacketFormatter;
+
+
+// Dumps the whole packets of a seekable file in parallel: Splits it
+// into packet-aligned chunks, formats those on a thread pool, each
+// with a copy of the formatter, and writes the results in file order,
+// so offsets, packet counts and line order come out the same as when
+// dumping sequentially.
+//
+// Chunks are memory-mapped one by one, and only a few more of them
+// than there are threads are in flight at any time, so memory use
+// stays bounded regardless of the file size.
+class ChunkedDumper
+{
+    int      _jobs;
+    qint64   _chunkPackets;
+    QString  _errorString;
+
+public:
+    static constexpr qint64 chunkPacketsDefault = 16384;
+
+    explicit ChunkedDumper(int jobs, qint64 chunkPackets = chunkPacketsDefault);
+
+    // Starts at the beginning of the file; leaves a trailing partial
+    // packet, if any, to the caller. Sets *packetCountPtr to the number
+    // of packets dumped. Returns false on errors; see errorString().
+    bool dump(QFile *file, const PacketFormatter &formatter, BufferedWriter *writer, qint64 *packetCountPtr);
+    QString errorString() const;
+};
+
+#endif // CHUNKEDDUMPER_H
@@ -0,0 +1,232 @@
+#include "livedumper.h"
+
+#include "bufferedwriter.h"
+#include "streamstats.h"
+#ifndef TS_PACKET_V2
+#include "tspacket.h"
+#else
+#include "tspacketv2.h"
+#endif
+#include "tspacketview.h"
+
+#include <stdexcept>
+#include <QEventLoop>
+#include <QFile>
+#include <QTimer>
+
+LiveDumper::LiveDumper(PacketFormatter::Format format, bool doOffset, bool dumpContents,
+                       bool doStats, qint64 statsIntervalMillisecs, BufferedWriter *writer,
+                       QObject *parent) :
+    QObject(parent),
+    _format(format), _doOffset(doOffset), _dumpContents(dumpContents),
+    _doStats(doStats), _statsIntervalMillisecs(statsIntervalMillisecs), _writer(writer)
+{
+    if (!_writer)
+        throw std::invalid_argument("Live dumper ctor: Writer can't be null");
+    if (!(_statsIntervalMillisecs > 0))
+        throw std::invalid_argument("Live dumper ctor: Stats interval must be positive");
+}
+
+LiveDumper::~LiveDumper()
+{
+
+}
+
+bool LiveDumper::run(QFile *file, const QString &fileName, bool withFileName, qint64 packetSize)
+{
+    if (!file)
+        throw std::invalid_argument("Live dumper: File can't be null");
+
+    _fileName = fileName;
+    _withFileName = withFileName;
+    _packetSizeFixed = packetSize > 0;
+    _ok = true;
+    _errorString.clear();
+    _formatterPtr.reset();
+    _statsPtr.reset();
+    _dueCheckCount = 0;
+    _file = file;
+
+    _readerPtr = std::make_unique<TS::Reader>(file);
+    TS::Reader &reader(*_readerPtr);
+    reader.setLogPrefix("{" + fileName + "}");
+    if (_packetSizeFixed) {
+        reader.setTSPacketAutoSize(false);
+        reader.setTSPacketSize(packetSize);
+    }
+
+    connect(&reader, &TS::Reader::tsPacketReady, this, &LiveDumper::handleTSPacketReady);
+    connect(&reader, &TS::Reader::discontEncountered, this, &LiveDumper::handleDiscontEncountered);
+    connect(&reader, &TS::Reader::eofEncountered, this, &LiveDumper::handleEOFEncountered);
+    connect(&reader, &TS::Reader::errorEncountered, this, &LiveDumper::handleErrorEncountered);
+
+    _flushTimer.start();
+    _statsTimer.start();
+
+    // For input that trickles in; see checkDue() for the other case.
+    QTimer dueTimer;
+    connect(&dueTimer, &QTimer::timeout, this, &LiveDumper::writeDue);
+    dueTimer.start(flushIntervalMillisecs);
+
+    // The reader gets going on its input notifier.
+    QEventLoop loop;
+    _loop = &loop;
+    loop.exec();
+    _loop = nullptr;
+    dueTimer.stop();
+
+    const qint64 offset = reader.tsPacketOffset();
+    _readerPtr.reset();
+    _file = nullptr;
+
+    // Even after errors, show what got read.
+    if (_doStats)
+        appendStatsReport(true);
+    else if (_doOffset && _format == PacketFormatter::Format::Text)
+        _writer->append("offset=" + QByteArray::number(offset) + (_ok ? " (EOF)\n" : " (err)\n"));
+
+    if (!flush() && _ok) {
+        _ok = false;
+        _errorString = "Error writing output: " + _writer->errorString();
+    }
+    return _ok;
+}
+
+QString LiveDumper::errorString() const
+{
+    return _errorString;
+}
+
+void LiveDumper::handleTSPacketReady(const QSharedPointer<ConversionNode<TS::Packet>> &packetNode)
+{
+    // (After a write error, until the reader gets to notice the closed input.)
+    if (!_ok)
+        return;
+
+#ifndef TS_PACKET_V2
+    const QByteArray bytes = packetNode->data.bytes();
+#else
+    QByteArray bytes;
+    const auto bytesNodeElements = packetNode->findOtherFormat<QByteArray>();
+    if (!bytesNodeElements.isEmpty())
+        bytes = bytesNodeElements.first().node->data;
+#endif
+    if (bytes.length() < TS::PacketView::sizeBasic)
+        return;
+
+    if (_doStats) {
+        // (Not by the reader's parser, whose prefix covers a 204/208-byte suffix, too.)
+        const int basicOffset = TS::PacketView::basicOffsetForPacketSize(bytes.length());
+        if (!_statsPtr)
+            _statsPtr = std::make_unique<StreamStats>(bytes.length(), basicOffset, !_packetSizeFixed);
+        else if (_statsPtr->packetSize() != bytes.length())
+            _statsPtr->setPacketSize(bytes.length(), basicOffset);
+        _statsPtr->addPacket(bytes.constData());
+    }
+    else {
+        if (!_formatterPtr || _formatterPtr->packetSize() != bytes.length()) {
+            _formatterPtr = std::make_unique<PacketFormatter>(_format, bytes.length(), _doOffset, _dumpContents);
+            if (_withFileName)
+                _formatterPtr->setFileName(_fileName);
+        }
+
+        // (The reader has already counted this packet, but advances the offset after signalling.)
+        const TS::Reader &reader(*_readerPtr);
+        _formatterPtr->appendPacket(bytes.constData(), reader.tsPacketOffset(), reader.tsPacketCount(),
+                                    &_writer->buffer());
+    }
+
+    checkDue();
+}
+
+void LiveDumper::handleDiscontEncountered(double pcrPrev)
+{
+    if (_doStats || _format != PacketFormatter::Format::Text)
+        return;
+
+    _writer->append("discontinuity seg=" + QByteArray::number(_readerPtr->discontSegment()) +
+                    " pcrPrev=" + QByteArray::number(pcrPrev, 'f', 6) + "\n");
+}
+
+void LiveDumper::handleEOFEncountered()
+{
+    stop(true);
+}
+
+void LiveDumper::handleErrorEncountered(TS::Reader::ErrorKind errorKind, QString errorMessage)
+{
+    switch (errorKind) {
+    case TS::Reader::ErrorKind::Unknown:
+    case TS::Reader::ErrorKind::IO:
+        stop(false, errorMessage);
+        break;
+    case TS::Reader::ErrorKind::TS:
+        // Shows in the packet dump or stats, anyway.
+        break;
+    }
+}
+
+void LiveDumper::checkDue()
+{
+    // Saturated input keeps the reader from returning to the event loop,
+    // so the timer won't fire. (Asking the clock for every packet would
+    // cost more than the dump, though.)
+    if (++_dueCheckCount % 64 != 0)
+        return;
+    writeDue();
+}
+
+void LiveDumper::writeDue()
+{
+    if (!_ok)
+        return;
+
+    bool ok = true;
+    if (_doStats && _statsTimer.elapsed() >= _statsIntervalMillisecs) {
+        _statsTimer.restart();
+        appendStatsReport(false);
+        ok = flush();
+    }
+    else if (_flushTimer.elapsed() >= flushIntervalMillisecs)
+        ok = flush();
+    else
+        ok = _writer->flushIfFull();
+
+    if (!ok) {
+        stop(false, "Error writing output: " + _writer->errorString());
+        // Makes the reader's next read fail, so it stops reading.
+        if (_file)
+            _file->close();
+    }
+}
+
+void LiveDumper::appendStatsReport(bool final)
+{
+    // Report an empty input, too.
+    if (!_statsPtr && final)
+        _statsPtr = std::make_unique<StreamStats>(TS::PacketView::sizeBasic, 0, false);
+    if (!_statsPtr)
+        return;
+
+    if (_format == PacketFormatter::Format::Text) {
+        _writer->append(final ? "--- Final summary ---\n" :
+            "--- Summary so far, after " + QByteArray::number(_statsPtr->packetCount()) + " packets ---\n");
+    }
+    _statsPtr->appendReport(&_writer->buffer(), _format, _withFileName ? _fileName : QString());
+}
+
+bool LiveDumper::flush()
+{
+    _flushTimer.restart();
+    return _writer->flush();
+}
+
+void LiveDumper::stop(bool ok, const QString &errorString)
+{
+    if (!ok && _ok) {
+        _ok = false;
+        _errorString = errorString;
+    }
+    if (_loop)
+        _loop->quit();
+}
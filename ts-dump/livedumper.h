@@ -0,0 +1,84 @@
+#ifndef LIVEDUMPER_H
+#define LIVEDUMPER_H
+
+#include "packetformatter.h"
+#include "tsreader.h"
+
+#include <memory>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+
+class QEventLoop;
+class QFile;
+class BufferedWriter;
+class StreamStats;
+
+
+// Dumps or summarizes input through the event-driven TS::Reader, for
+// live feeds (pipes, FIFOs, a tee of the server input) and damaged
+// files: The packet size gets auto-detected (and re-detected, should
+// it change), sync is regained after garbage, and reads that come up
+// short just wait for more data instead of ending the dump.
+//
+// In stats mode, a report of everything so far is written each
+// interval, and a final one at EOF. Output gets flushed frequently, so
+// it can be followed as it happens. Both are driven by a timer while
+// the input trickles in, and checked on the packet path while the
+// reader is kept busy by saturated input.
+class LiveDumper : public QObject
+{
+    Q_OBJECT
+
+    PacketFormatter::Format  _format;
+    bool                     _doOffset;
+    bool                     _dumpContents;
+    bool                     _doStats;
+    qint64                   _statsIntervalMillisecs;
+    BufferedWriter          *_writer;
+
+    // Per run:
+    QFile                            *_file = nullptr;
+    std::unique_ptr<TS::Reader>       _readerPtr;
+    std::unique_ptr<PacketFormatter>  _formatterPtr;
+    std::unique_ptr<StreamStats>      _statsPtr;
+    QEventLoop                       *_loop = nullptr;
+    QString                           _fileName;
+    bool                              _withFileName = false;
+    bool                              _packetSizeFixed = false;
+    bool                              _ok = true;
+    QString                           _errorString;
+    qint64                            _dueCheckCount = 0;
+    QElapsedTimer                     _flushTimer;
+    QElapsedTimer                     _statsTimer;
+
+public:
+    static constexpr qint64 statsIntervalMillisecsDefault = 10000;
+    static constexpr qint64 flushIntervalMillisecs = 200;
+
+    LiveDumper(PacketFormatter::Format format, bool doOffset, bool dumpContents,
+               bool doStats, qint64 statsIntervalMillisecs, BufferedWriter *writer,
+               QObject *parent = nullptr);
+    ~LiveDumper();
+
+    // Runs an event loop until EOF on the already opened file, or an
+    // I/O error. packetSize 0 means auto-detection. Returns false
+    // on errors; see errorString().
+    bool run(QFile *file, const QString &fileName, bool withFileName, qint64 packetSize);
+    QString errorString() const;
+
+protected slots:
+    void handleTSPacketReady(const QSharedPointer<ConversionNode<TS::Packet>> &packetNode);
+    void handleDiscontEncountered(double pcrPrev);
+    void handleEOFEncountered();
+    void handleErrorEncountered(TS::Reader::ErrorKind errorKind, QString errorMessage);
+    void writeDue();
+
+private:
+    void checkDue();
+    void appendStatsReport(bool final);
+    bool flush();
+    void stop(bool ok, const QString &errorString = QString());
+};
+
+#endif // LIVEDUMPER_H
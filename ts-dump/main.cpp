@@ -5,14 +5,101 @@
 #else
 #include "tspacketv2.h"
 #endif
+#include "packetformatter.h"
+#include "bufferedwriter.h"
+#include "chunkeddumper.h"
+#include "livedumper.h"
+#include "streamstats.h"
+#include "tspacketview.h"
+#include "log.h"
+#include "lograte.h"
 
 #include <QCommandLineParser>
 #include <QDebug>
 #include <QFile>
 #include <QTextStream>
+#include <QThread>
+#include <cstring>
+#include <unistd.h>
 
 namespace {
-    QTextStream out(stdout), errout(stderr);
+    QTextStream errout(stderr);
+
+    // Packets per read call.
+    const qint64 readPackets = 4096;
+    // Enough for packet size detection by StreamStats.
+    const qint64 probeBytes = 8 * 208;
+}
+
+// "-" stands for standard input. Unbuffered, so live input gets
+// passed on as it arrives, not once some read-ahead is filled up.
+static bool openInput(QFile *file, const QString &fileName)
+{
+    if (fileName == "-")
+        return file->open(STDIN_FILENO, QIODevice::ReadOnly | QIODevice::Unbuffered);
+    file->setFileName(fileName);
+    return file->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+// Reads the whole (opened) file through StreamStats and appends its report.
+// Read errors are reported and set *retPtr, but still give a report
+// of what was read so far; returns false if main should give up.
+static bool statsFile(QFile &file, const QString &fileName, PacketFormatter::Format format, bool withFileName,
+                      int packetSizeGiven, BufferedWriter *writer, int *retPtr)
+{
+    const QString appName = QCoreApplication::applicationName();
+
+    int packetSize = packetSizeGiven;
+    if (!packetSize) {
+        packetSize = StreamStats::detectPacketSize(file.peek(probeBytes));
+        if (!packetSize) {
+            errout << appName
+                   << ": Can't detect TS packet size of \"" << fileName << "\", "
+                   << "assuming " << TS::PacketView::sizeBasic << "; try --ts-packet-size"
+                   << endl;
+            packetSize = TS::PacketView::sizeBasic;
+        }
+    }
+    StreamStats stats(packetSize, TS::PacketView::basicOffsetForPacketSize(packetSize), !packetSizeGiven);
+
+    // Carry partial packets over to the next read, just in case.
+    QByteArray buf(static_cast<int>(packetSize * readPackets), 0);
+    qint64 carried = 0;
+    while (true) {
+        const qint64 readResult = file.read(buf.data() + carried, buf.size() - carried);
+        if (readResult < 0) {
+            errout << appName
+                   << ": Error reading from \"" << fileName << "\": "
+                   << file.errorString()
+                   << endl;
+            if (!(*retPtr >= 1))
+                *retPtr = 1;
+            break;
+        }
+        else if (readResult == 0) {
+            // Reached EOF.
+            break;
+        }
+
+        const qint64 available = carried + readResult;
+        const qint64 packetsLength = available - available % packetSize;
+        for (qint64 pos = 0; pos < packetsLength; pos += packetSize)
+            stats.addPacket(buf.constData() + pos);
+
+        carried = available - packetsLength;
+        if (carried > 0)
+            std::memmove(buf.data(), buf.constData() + packetsLength, static_cast<size_t>(carried));
+    }
+    stats.setTrailingBytes(carried);
+
+    stats.appendReport(&writer->buffer(), format, withFileName ? fileName : QString());
+    if (!writer->flushIfFull()) {
+        errout << appName
+               << ": Error writing output: " << writer->errorString()
+               << endl;
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char *argv[])
@@ -21,6 +108,12 @@ int main(int argc, char *argv[])
     int ret = 0;
     int verbose = 0;
     bool doOffset = false;
+    PacketFormatter::Format format = PacketFormatter::Format::Text;
+    int jobs = 1;
+    bool doStats = false;
+    bool doLive = false;
+    qint64 statsIntervalMillisecs = LiveDumper::statsIntervalMillisecsDefault;
+    bool tsPacketSizeGiven = false;
     qint64 tsPacketSize
 #ifndef TS_PACKET_V2
         = TSPacket::lengthBasic;
@@ -31,14 +124,33 @@ int main(int argc, char *argv[])
     QCommandLineParser parser;
     parser.setApplicationDescription("Dump MPEG-TS packet contents");
     parser.addHelpOption();
-    parser.addPositionalArgument("FILE", "File to parse as MPEG-TS stream", "FILE [...]");
+    parser.addPositionalArgument("FILE", "File to parse as MPEG-TS stream (\"-\": standard input)", "FILE [...]");
     parser.addOptions({
         { { "v", "verbose" }, "Increase verbose level" },
         { { "q", "quiet"   }, "Decrease verbose level" },
         { "offset",
-          "Output file offset of TS packet" },
+          "Output file offset of TS packet (text format; the others always have it)" },
+        { { "f", "format" },
+          "Output format: text (full packet dump), jsonl (JSON Lines) "
+              "or csv (header fields, one packet per line) (default: text)",
+          "FORMAT" },
+        { { "j", "jobs" },
+          "Parse seekable files in chunks on this many threads; output stays in order "
+              "(default: 1, i.e. sequentially; 0: one per core)",
+          "NUM" },
+        { "stats",
+          "Instead of dumping packets, analyze each file in a single pass and output a summary: "
+              "per-PID packets, bitrates and errors, PCR intervals and jitter, discontinuities "
+              "(format text, jsonl: one object per file, or csv: one row per PID)" },
+        { "live",
+          "Read through the TS reader, as for a live feed: auto-detect the packet size, "
+              "resync after garbage, wait on short reads (default for pipes, FIFOs and standard input)" },
+        { "interval",
+          "With --stats on live input, also output a summary of everything so far "
+              "every SECS seconds (default: 10)",
+          "SECS" },
         { { "s", "ts-packet-size" },
-          "MPEG-TS packet size (e.g., 188 bytes)",
+          "MPEG-TS packet size (e.g., 188 bytes) (default: 188; with --stats or live input: detected)",
           "SIZE" },
     });
     parser.process(a);
@@ -55,6 +167,63 @@ int main(int argc, char *argv[])
     if (parser.isSet("offset"))
         doOffset = true;
 
+    // stats
+    if (parser.isSet("stats"))
+        doStats = true;
+
+    // live
+    if (parser.isSet("live"))
+        doLive = true;
+
+    // Stats interval
+    {
+        QString valueStr = parser.value("interval");
+        if (!valueStr.isNull()) {
+            bool ok = false;
+            const double secs = valueStr.toDouble(&ok);
+            if (!ok || !(secs > 0)) {
+                errout << a.applicationName() << ": "
+                       << "Interval: Invalid number of seconds \""
+                       << valueStr << "\""
+                       << endl;
+                return 2;
+            }
+            statsIntervalMillisecs = qMax(static_cast<qint64>(secs * 1000), static_cast<qint64>(1));
+        }
+    }
+
+    // The TS reader logs packet size detection and resyncs.
+    SSCvn::log::verbose = verbose;
+
+    // Output format
+    {
+        QString valueStr = parser.value("format");
+        if (!valueStr.isNull() && !PacketFormatter::formatFromString(valueStr, &format)) {
+            errout << a.applicationName() << ": "
+                   << "Invalid output format \"" << valueStr << "\""
+                   << endl;
+            return 2;
+        }
+    }
+
+    // Jobs
+    {
+        QString valueStr = parser.value("jobs");
+        if (!valueStr.isNull()) {
+            bool ok = false;
+            jobs = valueStr.toInt(&ok);
+            if (!ok || jobs < 0) {
+                errout << a.applicationName() << ": "
+                       << "Jobs: Invalid number \""
+                       << valueStr << "\""
+                       << endl;
+                return 2;
+            }
+            if (jobs == 0)
+                jobs = qMax(QThread::idealThreadCount(), 1);
+        }
+    }
+
     // TS packet size
     {
         QString valueStr = parser.value("ts-packet-size");
@@ -68,6 +237,7 @@ int main(int argc, char *argv[])
                        << endl;
                 return 2;
             }
+            tsPacketSizeGiven = true;
         }
     }
 
@@ -79,19 +249,79 @@ int main(int argc, char *argv[])
         return 2;
     }
 
-#ifdef TS_PACKET_V2
-    TS::PacketV2Parser tsParser;
-    if (tsPacketSize != TS::PacketV2::sizeBasic)
-        tsParser.setPrefixLength(tsPacketSize - TS::PacketV2::sizeBasic);
-#endif
+    if (!(tsPacketSize >= 188 && tsPacketSize <= 65536)) {
+        errout << a.applicationName() << ": "
+               << "TS packet size out of range: " << tsPacketSize
+               << endl;
+        return 2;
+    }
+
+    QFile outFile;
+    if (!outFile.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        errout << a.applicationName()
+               << ": Can't open standard output: " << outFile.errorString()
+               << endl;
+        return 1;
+    }
+    BufferedWriter writer(&outFile);
+    LiveDumper liveDumper(format, doOffset, verbose >= 0, doStats, statsIntervalMillisecs, &writer);
+
+    if (doStats) {
+        StreamStats::appendReportHeader(&writer.buffer(), format, args.length() > 1);
+        for (QString fileName : args) {
+            if (args.length() > 1 && format == PacketFormatter::Format::Text)
+                writer.append(fileName.toUtf8() + ":\n");
+
+            QFile file;
+            if (!openInput(&file, fileName)) {
+                errout << a.applicationName()
+                       << ": Error opening file \"" << fileName << "\": "
+                       << file.errorString()
+                       << endl;
+                return 1;
+            }
+            if (doLive || file.isSequential()) {
+                if (!liveDumper.run(&file, fileName, args.length() > 1, tsPacketSizeGiven ? tsPacketSize : 0)) {
+                    errout << a.applicationName()
+                           << ": Error reading from \"" << fileName << "\": "
+                           << liveDumper.errorString()
+                           << endl;
+                    if (!(ret >= 1))
+                        ret = 1;
+                }
+            }
+            else if (!statsFile(file, fileName, format, args.length() > 1,
+                                tsPacketSizeGiven ? static_cast<int>(tsPacketSize) : 0, &writer, &ret)) {
+                return 1;
+            }
+            if (args.length() > 1 && format == PacketFormatter::Format::Text)
+                writer.append("\n");
+        }
+
+        if (!writer.flush()) {
+            errout << a.applicationName()
+                   << ": Error writing output: " << writer.errorString()
+                   << endl;
+            return 1;
+        }
+        SSCvn::log::RateLimiter::flushAllPending();
+        return ret;
+    }
+
+    PacketFormatter formatter(format, static_cast<int>(tsPacketSize), doOffset, verbose >= 0);
+    formatter.appendHeader(&writer.buffer(), args.length() > 1);
 
     for (QString arg : args) {
         QString fileName = arg;
-        if (args.length() > 1)
-            out << fileName << ":" << endl;
+        if (args.length() > 1) {
+            if (format == PacketFormatter::Format::Text)
+                writer.append(fileName.toUtf8() + ":\n");
+            else
+                formatter.setFileName(fileName);
+        }
 
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly)) {
+        QFile file;
+        if (!openInput(&file, fileName)) {
             errout << a.applicationName()
                    << ": Error opening file \"" << fileName << "\": "
                    << file.errorString()
@@ -99,16 +329,51 @@ int main(int argc, char *argv[])
             return 1;
         }
 
+        if (doLive || file.isSequential()) {
+            // Auto-detects the packet size, unless given.
+            if (!liveDumper.run(&file, fileName, args.length() > 1, tsPacketSizeGiven ? tsPacketSize : 0)) {
+                errout << a.applicationName()
+                       << ": Error reading from \"" << fileName << "\": "
+                       << liveDumper.errorString()
+                       << endl;
+                if (!(ret >= 1))
+                    ret = 1;
+            }
+            if (args.length() > 1 && format == PacketFormatter::Format::Text)
+                writer.append("\n");
+            continue;
+        }
+
+        const bool textOffset = doOffset && format == PacketFormatter::Format::Text;
         qint64 offset = 0, tsPacketCount = 0;
-        QByteArray buf(tsPacketSize, 0);
-        while (true) {
-            if (doOffset)
-                out << "offset=" << offset << " ";
 
+        if (jobs > 1 && !file.isSequential()) {
+            ChunkedDumper dumper(jobs);
+            if (!dumper.dump(&file, formatter, &writer, &tsPacketCount)) {
+                errout << a.applicationName()
+                       << ": Error dumping \"" << fileName << "\": "
+                       << dumper.errorString()
+                       << endl;
+                return 1;
+            }
+            // Leave what's left (a partial packet, or nothing) to the loop below.
+            offset = tsPacketCount * tsPacketSize;
+            if (!file.seek(offset)) {
+                errout << a.applicationName()
+                       << ": Error seeking in \"" << fileName << "\": "
+                       << file.errorString()
+                       << endl;
+                return 1;
+            }
+        }
+
+        // Read many packets at once, to keep read calls cheap.
+        QByteArray buf(static_cast<int>(tsPacketSize * readPackets), 0);
+        while (true) {
             qint64 readResult = file.read(buf.data(), buf.size());
             if (readResult < 0) {
-                if (doOffset)
-                    out << "(err)" << endl;
+                if (textOffset)
+                    writer.append("offset=" + QByteArray::number(offset) + " (err)\n");
 
                 errout << a.applicationName()
                        << ": Error reading from \"" << fileName << "\": "
@@ -120,53 +385,52 @@ int main(int argc, char *argv[])
             }
             else if (readResult == 0) {
                 // Reached EOF.
-                if (doOffset)
-                    out << "(EOF)" << endl;
+                if (textOffset)
+                    writer.append("offset=" + QByteArray::number(offset) + " (EOF)\n");
                 break;
             }
-            // TODO: Handle partial reads gracefully.
-            else if (readResult != tsPacketSize) {
-                if (doOffset)
-                    out << "(short)" << endl;
+
+            const qint64 packetsLength = readResult - readResult % tsPacketSize;
+            for (qint64 pos = 0; pos < packetsLength; pos += tsPacketSize) {
+                formatter.appendPacket(buf.constData() + pos, offset, ++tsPacketCount, &writer.buffer());
+                offset += tsPacketSize;
+
+                if (!writer.flushIfFull()) {
+                    errout << a.applicationName()
+                           << ": Error writing output: " << writer.errorString()
+                           << endl;
+                    return 1;
+                }
+            }
+
+            // (A file read only comes up short at EOF; pipes go through the live dumper.)
+            if (packetsLength != readResult) {
+                if (textOffset)
+                    writer.append("offset=" + QByteArray::number(offset) + " (short)\n");
 
                 errout << a.applicationName()
-                       << ": Got invalid bytes length of " << readResult
+                       << ": Got invalid bytes length of " << (readResult - packetsLength)
                        << " for file \"" << fileName << "\""
                        << endl;
                 if (!(ret >= 1))
                     ret = 1;
                 break;
             }
-
-#ifndef TS_PACKET_V2
-            const TSPacket packet(buf);
-            const QString errMsg = packet.errorMessage();
-            const bool success = errMsg.isEmpty();
-#else
-            TS::PacketV2 packet;
-            QString errMsg;
-            const bool success = tsParser.parse(buf, &packet, &errMsg);
-#endif
-            if (doOffset)
-                out << "count=" << ++tsPacketCount << " ";
-
-            if (verbose >= 0) {
-                QString outStr;
-                QDebug(&outStr) << packet;
-                out << outStr << endl;
-            }
-
-            if (!success)
-                out << "^ TS packet error: " << errMsg << endl;
-
-            if (doOffset)
-                offset += buf.length();
         }
 
-        if (args.length() > 1)
-            out << endl;
+        if (args.length() > 1 && format == PacketFormatter::Format::Text)
+            writer.append("\n");
+    }
+
+    if (!writer.flush()) {
+        errout << a.applicationName()
+               << ": Error writing output: " << writer.errorString()
+               << endl;
+        return 1;
     }
 
+    // (E.g., the TS reader's resync messages.)
+    SSCvn::log::RateLimiter::flushAllPending();
     //return a.exec();
     return ret;
 }
@@ -0,0 +1,301 @@
+#include "packetformatter.h"
+
+#ifndef TS_PACKET_V2
+#include "tspacket.h"
+#endif
+#include "tspacketview.h"
+
+#include <stdexcept>
+#include <QDebug>
+
+namespace {
+
+void appendNumber(QByteArray *out, qint64 value)
+{
+    char digits[24];
+    int i = sizeof digits;
+    // (Via unsigned, so the most negative value works, too.)
+    quint64 magnitude = value < 0 ? 0 - static_cast<quint64>(value) : static_cast<quint64>(value);
+    do {
+        digits[--i] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+        digits[--i] = '-';
+    out->append(digits + i, static_cast<int>(sizeof digits) - i);
+}
+
+QByteArray jsonString(const QByteArray &utf8)
+{
+    QByteArray result("\"");
+    for (const char c : utf8) {
+        switch (c) {
+        case '"':  result.append("\\\""); break;
+        case '\\': result.append("\\\\"); break;
+        case '\n': result.append("\\n");  break;
+        case '\r': result.append("\\r");  break;
+        case '\t': result.append("\\t");  break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                result.append("\\u00").append(QByteArray::number(static_cast<int>(c), 16).rightJustified(2, '0'));
+            else
+                result.append(c);
+        }
+    }
+    result.append('"');
+    return result;
+}
+
+QByteArray csvString(const QByteArray &utf8)
+{
+    if (utf8.indexOf(',') < 0 && utf8.indexOf('"') < 0 && utf8.indexOf('\n') < 0 && utf8.indexOf('\r') < 0)
+        return utf8;
+    QByteArray result(utf8);
+    result.replace('"', "\"\"");
+    return '"' + result + '"';
+}
+
+// Writes one JSON object or CSV row; fields must come in the same order
+// as in PacketFormatter::appendHeader().
+class FieldWriter
+{
+    QByteArray  *_out;
+    const bool   _json;
+    bool         _first = true;
+
+    void begin(const char *key)
+    {
+        if (!_first)
+            _out->append(',');
+        _first = false;
+        if (_json)
+            _out->append('"').append(key).append("\":");
+    }
+
+public:
+    FieldWriter(QByteArray *out, bool json) :
+        _out(out), _json(json)
+    {
+        if (_json)
+            _out->append('{');
+    }
+
+    void number(const char *key, qint64 value)
+    {
+        begin(key);
+        appendNumber(_out, value);
+    }
+
+    void boolean(const char *key, bool value)
+    {
+        begin(key);
+        if (_json)
+            _out->append(value ? "true" : "false");
+        else
+            _out->append(value ? '1' : '0');
+    }
+
+    // Already escaped/quoted for the format.
+    void escaped(const char *key, const QByteArray &value)
+    {
+        begin(key);
+        _out->append(value);
+    }
+
+    // Left out in JSON, an empty cell in CSV.
+    void none(const char *key)
+    {
+        if (_json)
+            return;
+        begin(key);
+    }
+
+    void end()
+    {
+        if (_json)
+            _out->append('}');
+        _out->append('\n');
+    }
+};
+
+}  // namespace
+
+
+bool PacketFormatter::formatFromString(const QString &str, Format *format)
+{
+    if (!format)
+        throw std::invalid_argument("Packet formatter: Format can't be null");
+
+    if (str == "text")
+        *format = Format::Text;
+    else if (str == "jsonl")
+        *format = Format::JSONLines;
+    else if (str == "csv")
+        *format = Format::CSV;
+    else
+        return false;
+    return true;
+}
+
+QByteArray PacketFormatter::csvField(const QByteArray &utf8)
+{
+    return csvString(utf8);
+}
+
+PacketFormatter::PacketFormatter(Format format, int packetSize, bool doOffset, bool dumpContents) :
+    _format(format), _packetSize(packetSize), _basicOffset(TS::PacketView::basicOffsetForPacketSize(packetSize)),
+    _doOffset(doOffset), _dumpContents(dumpContents)
+{
+    if (!(_packetSize >= TS::PacketView::sizeBasic))
+        throw std::invalid_argument("Packet formatter ctor: Packet size must be at least the basic packet size");
+#ifdef TS_PACKET_V2
+    if (_basicOffset > 0)
+        _tsParser.setPrefixLength(_basicOffset);
+#endif
+}
+
+PacketFormatter::PacketFormatter(const PacketFormatter &other) :
+    PacketFormatter(other._format, other._packetSize, other._doOffset, other._dumpContents)
+{
+    _fileNameField = other._fileNameField;
+}
+
+PacketFormatter::Format PacketFormatter::format() const
+{
+    return _format;
+}
+
+int PacketFormatter::packetSize() const
+{
+    return _packetSize;
+}
+
+void PacketFormatter::setFileName(const QString &fileName)
+{
+    if (fileName.isEmpty()) {
+        _fileNameField.clear();
+        return;
+    }
+    switch (_format) {
+    case Format::Text:
+        _fileNameField.clear();
+        break;
+    case Format::JSONLines:
+        _fileNameField = jsonString(fileName.toUtf8());
+        break;
+    case Format::CSV:
+        _fileNameField = csvString(fileName.toUtf8());
+        break;
+    }
+}
+
+void PacketFormatter::appendHeader(QByteArray *out, bool withFileName) const
+{
+    if (_format != Format::CSV)
+        return;
+    if (withFileName)
+        out->append("file,");
+    out->append("offset,count,pid,tei,pusi,priority,scrambling,afc,cc,"
+                "afLength,discontinuity,rai,pcr,payloadLength,error\n");
+}
+
+bool PacketFormatter::appendPacket(const char *data, qint64 offset, qint64 count, QByteArray *out)
+{
+    if (!data || !out)
+        throw std::invalid_argument("Packet formatter: Data and output buffer can't be null");
+
+    if (_format == Format::Text)
+        return appendText(data, offset, count, out);
+    return appendFields(data, offset, count, out);
+}
+
+bool PacketFormatter::appendText(const char *data, qint64 offset, qint64 count, QByteArray *out)
+{
+    // (Without a suffix, which neither parser knows about.)
+    const QByteArray bytes = QByteArray::fromRawData(data, _basicOffset + TS::PacketView::sizeBasic);
+#ifndef TS_PACKET_V2
+    const TSPacket packet(bytes);
+    const QString errMsg = packet.errorMessage();
+    const bool success = errMsg.isEmpty();
+#else
+    TS::PacketV2 packet;
+    QString errMsg;
+    const bool success = _tsParser.parse(bytes, &packet, &errMsg);
+#endif
+
+    if (_doOffset) {
+        out->append("offset=");
+        appendNumber(out, offset);
+        out->append(" count=");
+        appendNumber(out, count);
+        out->append(' ');
+    }
+    if (_dumpContents) {
+        QString outStr;
+        QDebug(&outStr) << packet;
+        out->append(outStr.toUtf8());
+    }
+    if (_doOffset || _dumpContents)
+        out->append('\n');
+
+    if (!success)
+        out->append("^ TS packet error: ").append(errMsg.toUtf8()).append('\n');
+    return success;
+}
+
+bool PacketFormatter::appendFields(const char *data, qint64 offset, qint64 count, QByteArray *out) const
+{
+    const bool json = _format == Format::JSONLines;
+    const TS::PacketView view(data + _basicOffset);
+
+    FieldWriter fields(out, json);
+    if (!_fileNameField.isEmpty())
+        fields.escaped("file", _fileNameField);
+    fields.number("offset", offset);
+    fields.number("count", count);
+
+    const char *error = nullptr;
+    if (!view.isSyncByteValid()) {
+        error = "Invalid sync byte";
+        for (const char *key : { "pid", "tei", "pusi", "priority", "scrambling", "afc", "cc",
+                                 "afLength", "discontinuity", "rai", "pcr", "payloadLength" })
+            fields.none(key);
+    }
+    else {
+        fields.number("pid", view.pid());
+        fields.boolean("tei", view.transportErrorIndicator());
+        fields.boolean("pusi", view.payloadUnitStartIndicator());
+        fields.boolean("priority", view.transportPriority());
+        fields.number("scrambling", view.transportScramblingControl());
+        fields.number("afc", view.adaptationFieldControl());
+        fields.number("cc", view.continuityCounter());
+
+        const int afLength = view.adaptationFieldLength();
+        if (afLength > (view.hasPayload() ? 182 : 183))
+            error = "Adaptation field length exceeds packet";
+        if (afLength >= 0)
+            fields.number("afLength", afLength);
+        else
+            fields.none("afLength");
+        if (afLength > 0 && !error) {
+            fields.boolean("discontinuity", view.discontinuityIndicator());
+            fields.boolean("rai", view.randomAccessIndicator());
+        }
+        else {
+            fields.none("discontinuity");
+            fields.none("rai");
+        }
+        if (view.hasPCR() && !error)
+            fields.number("pcr", static_cast<qint64>(view.pcrValue()));
+        else
+            fields.none("pcr");
+        fields.number("payloadLength", view.payloadLength());
+    }
+
+    if (error)
+        fields.escaped("error", json ? '"' + QByteArray(error) + '"' : QByteArray(error));
+    else
+        fields.none("error");
+    fields.end();
+    return !error;
+}
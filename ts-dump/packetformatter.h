@@ -0,0 +1,74 @@
+#ifndef PACKETFORMATTER_H
+#define PACKETFORMATTER_H
+
+#ifdef TS_PACKET_V2
+#include "tspacketv2.h"
+#endif
+
+#include <QByteArray>
+#include <QString>
+
+
+// Formats the TS packets ts-dump reads, one line per packet,
+// appended to a caller-provided buffer:
+//
+// Text is the full QDebug dump of a parsed packet, for humans.
+// JSON Lines and CSV carry the header and adaptation field basics,
+// taken straight from the bytes via TS::PacketView and written out
+// field by field, without a full parse or any per-packet allocation,
+// for piping into analysis tools.
+class PacketFormatter
+{
+public:
+    enum class Format {
+        Text,
+        JSONLines,
+        CSV,
+    };
+
+    // "text", "jsonl" or "csv".
+    static bool formatFromString(const QString &str, Format *format);
+    // Quoted, if needed.
+    static QByteArray csvField(const QByteArray &utf8);
+
+private:
+    Format      _format;
+    int         _packetSize;
+    int         _basicOffset;
+    bool        _doOffset;
+    bool        _dumpContents;
+    // Escaped for the format; empty to leave out.
+    QByteArray  _fileNameField;
+#ifdef TS_PACKET_V2
+    TS::PacketV2Parser  _tsParser;
+#endif
+
+public:
+    // doOffset and dumpContents only apply to Text; the other formats
+    // always have offset and count, and never a full dump.
+    PacketFormatter(Format format, int packetSize, bool doOffset, bool dumpContents);
+    // (Copies get a parser of their own, so can be used on other threads.)
+    PacketFormatter(const PacketFormatter &other);
+    PacketFormatter &operator=(const PacketFormatter &) = delete;
+
+    Format format() const;
+    int packetSize() const;
+
+    // Include the file name with each packet (for JSON Lines and CSV),
+    // e.g. when dumping several files; or not, if empty.
+    void setFileName(const QString &fileName);
+
+    // CSV column names line; nothing for the other formats.
+    void appendHeader(QByteArray *out, bool withFileName) const;
+    // data must hold packetSize() bytes; the basic packet is at
+    // TS::PacketView::basicOffsetForPacketSize(), i.e., after a prefix
+    // or before a 204/208-byte packet's suffix.
+    // Returns false on TS packet errors (which are part of the output).
+    bool appendPacket(const char *data, qint64 offset, qint64 count, QByteArray *out);
+
+private:
+    bool appendText(const char *data, qint64 offset, qint64 count, QByteArray *out);
+    bool appendFields(const char *data, qint64 offset, qint64 count, QByteArray *out) const;
+};
+
+#endif // PACKETFORMATTER_H
@@ -0,0 +1,429 @@
+#include "streamstats.h"
+
+#include "tspacketview.h"
+#include "humanreadable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+// PCR base is 33 bits, at 300 extension units each.
+const qint64 pcrWrap = (qint64(1) << 33) * 300;
+const double pcrHz = 27e6;
+// Larger PCR steps than this count as discontinuity, as in StreamServer.
+const double pcrJumpSecs = 1.0;
+const double bitsPerPacket = TS::PacketView::sizeBasic * 8;
+
+QString pidString(quint16 pid)
+{
+    return "0x" + QString::number(pid, 16).rightJustified(4, '0');
+}
+
+}  // namespace
+
+
+StreamStats::StreamStats(int packetSize, int basicOffset, bool packetSizeDetected) :
+    _packetSize(packetSize), _basicOffset(basicOffset), _packetSizeDetected(packetSizeDetected),
+    _analyzerPtr(std::make_unique<TS::PIDAnalyzer>())
+{
+    if (!(_basicOffset >= 0 && _basicOffset + TS::PacketView::sizeBasic <= _packetSize))
+        throw std::invalid_argument("Stream stats ctor: Basic packet must be within packet size");
+}
+
+void StreamStats::setPacketSize(int packetSize, int basicOffset)
+{
+    if (!(basicOffset >= 0 && basicOffset + TS::PacketView::sizeBasic <= packetSize))
+        throw std::invalid_argument("Stream stats: Set packet size: Basic packet must be within packet size");
+
+    _packetSize = packetSize;
+    _basicOffset = basicOffset;
+    _packetSizeDetected = true;
+}
+
+int StreamStats::packetSize() const
+{
+    return _packetSize;
+}
+
+int StreamStats::detectPacketSize(const QByteArray &probe)
+{
+    // Enough consecutive sync bytes to not be a coincidence.
+    const int syncsRequired = 5;
+    for (const int size : { 188, 192, 204, 208 }) {
+        const int basicOffset = TS::PacketView::basicOffsetForPacketSize(size);
+        if (probe.length() < basicOffset + (syncsRequired - 1) * size + 1)
+            continue;
+        bool match = true;
+        for (int i = 0; i < syncsRequired && match; i++)
+            match = static_cast<quint8>(probe.at(basicOffset + i * size)) == TS::PacketView::syncByteFixedValue;
+        if (match)
+            return size;
+    }
+    return 0;
+}
+
+void StreamStats::addPacket(const char *data)
+{
+    _packetCount++;
+    _byteCount += _packetSize;
+    const TS::PacketView view(data + _basicOffset);
+    if (!view.isSyncByteValid()) {
+        _syncErrorCount++;
+        return;
+    }
+
+    _analyzerPtr->addPacket(view, _timelineNanosecs);
+    _psi.addPacket(view);
+    if (view.hasPCR() && !view.transportErrorIndicator())
+        addPCR(view.pid(), static_cast<qint64>(view.pcrValue()), view.discontinuityIndicator());
+}
+
+void StreamStats::addPCR(quint16 pid, qint64 pcr, bool indicated)
+{
+    const qint64 packetIndex = _packetCount - 1;
+    if (_timelinePID == TS::PacketView::pidNullPacket)
+        _timelinePID = pid;
+
+    PCRStats &stats(_pcrStats[pid]);
+    stats.count++;
+    if (stats.lastPCR >= 0) {
+        qint64 delta = pcr - stats.lastPCR;
+        if (delta < 0)
+            delta += pcrWrap;  // Wrap-around, or (then, huge) backward jump.
+        const double deltaSecs = delta / pcrHz;
+        const qint64 packetsSince = packetIndex - stats.lastPacketIndex;
+
+        if (indicated || deltaSecs > pcrJumpSecs) {
+            if (pid == _timelinePID) {
+                _boundaryCount++;
+                if (_boundaries.length() < boundariesListedMax) {
+                    Boundary boundary;
+                    boundary.packetIndex = packetIndex;
+                    boundary.offset = _byteCount - _packetSize;
+                    boundary.pcrBeforeSecs = stats.lastPCR / pcrHz;
+                    boundary.pcrAfterSecs = pcr / pcrHz;
+                    boundary.indicated = indicated;
+                    _boundaries.append(boundary);
+                }
+            }
+            stats.lastIntervalBitrate = 0;
+        }
+        else {
+            if (stats.intervalCount == 0 || deltaSecs < stats.intervalMinSecs)
+                stats.intervalMinSecs = deltaSecs;
+            if (stats.intervalCount == 0 || deltaSecs > stats.intervalMaxSecs)
+                stats.intervalMaxSecs = deltaSecs;
+            stats.intervalSumSecs += deltaSecs;
+            stats.intervalCount++;
+
+            if (stats.lastIntervalBitrate > 0) {
+                const double jitterAbsSecs = std::fabs(deltaSecs - packetsSince * bitsPerPacket / stats.lastIntervalBitrate);
+                stats.jitterMaxAbsSecs = std::max(stats.jitterMaxAbsSecs, jitterAbsSecs);
+                stats.jitterSumAbsSecs += jitterAbsSecs;
+                stats.jitterCount++;
+            }
+            stats.lastIntervalBitrate = deltaSecs > 0 ? packetsSince * bitsPerPacket / deltaSecs : 0;
+
+            if (pid == _timelinePID)
+                _timelineNanosecs += delta * 1000 / 27;
+        }
+    }
+    stats.lastPCR = pcr;
+    stats.lastPacketIndex = packetIndex;
+}
+
+void StreamStats::setTrailingBytes(qint64 count)
+{
+    _trailingBytes = count;
+}
+
+qint64 StreamStats::packetCount() const
+{
+    return _packetCount;
+}
+
+double StreamStats::durationSecs() const
+{
+    return _timelineNanosecs / 1e9;
+}
+
+const TS::PIDAnalyzer &StreamStats::pidAnalyzer() const
+{
+    return *_analyzerPtr;
+}
+
+const QHash<quint16, StreamStats::PCRStats> &StreamStats::pcrStats() const
+{
+    return _pcrStats;
+}
+
+qint64 StreamStats::boundaryCount() const
+{
+    return _boundaryCount;
+}
+
+const QList<StreamStats::Boundary> &StreamStats::boundaries() const
+{
+    return _boundaries;
+}
+
+QString StreamStats::pidDescription(quint16 pid) const
+{
+    switch (pid) {
+    case 0x0000:  return "PAT";
+    case 0x0001:  return "CAT";
+    case 0x0010:  return "NIT";
+    case 0x0011:  return "SDT/BAT";
+    case 0x0012:  return "EIT";
+    case 0x0013:  return "RST";
+    case 0x0014:  return "TDT/TOT";
+    case 0x1fff:  return "null packets";
+    default:
+        break;
+    }
+
+    for (const TS::ProgramInfo &program : _psi.programs()) {
+        const QString programSuffix = ", program " + QString::number(program.programNumber);
+        if (pid == program.pmtPID)
+            return "PMT" + programSuffix;
+        for (const TS::ElementaryStreamInfo &stream : program.streams) {
+            if (pid == stream.pid)
+                return stream.streamTypeName() + (pid == program.pcrPID ? " with PCR" : "") + programSuffix;
+        }
+        if (pid == program.pcrPID)
+            return "PCR" + programSuffix;
+    }
+    return QString();
+}
+
+void StreamStats::appendReportHeader(QByteArray *out, PacketFormatter::Format format, bool withFileName)
+{
+    if (format != PacketFormatter::Format::CSV)
+        return;
+    if (withFileName)
+        out->append("file,");
+    out->append("pid,packets,bitrate,continuityErrors,lostPackets,duplicatePackets,transportErrors,"
+                "scrambledPackets,pcrCount,pcrIntervalAvgSecs,pcrIntervalMaxSecs,pcrJitterMaxSecs,description\n");
+}
+
+void StreamStats::appendReport(QByteArray *out, PacketFormatter::Format format, const QString &fileName) const
+{
+    if (!out)
+        throw std::invalid_argument("Stream stats: Output buffer can't be null");
+
+    switch (format) {
+    case PacketFormatter::Format::Text:
+        appendText(out);
+        break;
+    case PacketFormatter::Format::JSONLines:
+        appendJSON(out, fileName);
+        break;
+    case PacketFormatter::Format::CSV:
+        appendCSV(out, fileName);
+        break;
+    }
+}
+
+void StreamStats::appendText(QByteArray *out) const
+{
+    const TS::PIDAnalyzer::PIDStats &totals(_analyzerPtr->totals());
+    const double duration = durationSecs();
+    QStringList lines;
+
+    lines.append(QString("Packet size: %1 bytes (%2), basic packet at offset %3")
+                 .arg(_packetSize).arg(_packetSizeDetected ? "detected" : "given").arg(_basicOffset));
+    lines.append(QString("Packets: %1 (%2), sync errors: %3, trailing bytes: %4")
+                 .arg(_packetCount)
+                 .arg(HumanReadable::byteCount(static_cast<quint64>(_byteCount)))
+                 .arg(_syncErrorCount).arg(_trailingBytes));
+    if (_timelinePID == TS::PacketView::pidNullPacket)
+        lines.append("Duration: unknown, no PCRs");
+    else
+        lines.append(QString("Duration: %1 s by PCR of PID %2, bitrate: %3 bit/s")
+                     .arg(duration, 0, 'f', 3).arg(pidString(_timelinePID))
+                     .arg(duration > 0 ? static_cast<qint64>(totals.packets * bitsPerPacket / duration) : 0));
+    lines.append(QString("Continuity errors: %1 (about %2 packets lost), duplicates: %3, "
+                         "transport errors: %4, scrambled: %5")
+                 .arg(totals.continuityErrors).arg(totals.lostPackets).arg(totals.duplicatePackets)
+                 .arg(totals.transportErrors).arg(totals.scrambledPackets));
+
+    lines.append(QString("Discontinuities: %1").arg(_boundaryCount));
+    for (const Boundary &boundary : _boundaries) {
+        lines.append(QString("  packet %1 (offset %2): PCR %3 s -> %4 s%5")
+                     .arg(boundary.packetIndex + 1).arg(boundary.offset)
+                     .arg(boundary.pcrBeforeSecs, 0, 'f', 6).arg(boundary.pcrAfterSecs, 0, 'f', 6)
+                     .arg(boundary.indicated ? ", indicated" : ""));
+    }
+    if (_boundaryCount > _boundaries.length())
+        lines.append(QString("  (%1 more)").arg(_boundaryCount - _boundaries.length()));
+
+    QList<quint16> pids = _analyzerPtr->activePIDs();
+    std::sort(pids.begin(), pids.end());
+    lines.append("PIDs:");
+    lines.append("     PID     Packets        %        bit/s  CC errors    Lost     Dup     TEI  Scrambled  Description");
+    for (const quint16 pid : pids) {
+        const TS::PIDAnalyzer::PIDStats &stats(_analyzerPtr->pidStats(pid));
+        lines.append(QString("  %1  %2  %3%  %4  %5  %6  %7  %8  %9  %10")
+                     .arg(pidString(pid))
+                     .arg(stats.packets, 10)
+                     .arg(100. * stats.packets / std::max<qint64>(_packetCount, 1), 6, 'f', 2)
+                     .arg(duration > 0 ? static_cast<qint64>(stats.packets * bitsPerPacket / duration) : 0, 11)
+                     .arg(stats.continuityErrors, 9)
+                     .arg(stats.lostPackets, 6)
+                     .arg(stats.duplicatePackets, 6)
+                     .arg(stats.transportErrors, 6)
+                     .arg(stats.scrambledPackets, 9)
+                     .arg(pidDescription(pid)));
+    }
+
+    QList<quint16> pcrPIDs = _pcrStats.keys();
+    std::sort(pcrPIDs.begin(), pcrPIDs.end());
+    if (!pcrPIDs.isEmpty())
+        lines.append("PCRs:");
+    for (const quint16 pid : pcrPIDs) {
+        const PCRStats &stats(_pcrStats[pid]);
+        QString line = QString("  PID %1: %2 PCRs").arg(pidString(pid)).arg(stats.count);
+        if (stats.intervalCount > 0) {
+            line += QString(", interval min/avg/max %1/%2/%3 ms")
+                .arg(stats.intervalMinSecs * 1e3, 0, 'f', 3)
+                .arg(stats.intervalSumSecs / stats.intervalCount * 1e3, 0, 'f', 3)
+                .arg(stats.intervalMaxSecs * 1e3, 0, 'f', 3);
+        }
+        if (stats.jitterCount > 0) {
+            line += QString(", jitter max/avg %1/%2 us")
+                .arg(stats.jitterMaxAbsSecs * 1e6, 0, 'f', 1)
+                .arg(stats.jitterSumAbsSecs / stats.jitterCount * 1e6, 0, 'f', 1);
+        }
+        lines.append(line);
+    }
+
+    out->append(lines.join('\n').toUtf8()).append('\n');
+}
+
+void StreamStats::appendJSON(QByteArray *out, const QString &fileName) const
+{
+    const TS::PIDAnalyzer::PIDStats &totals(_analyzerPtr->totals());
+    const double duration = durationSecs();
+
+    QJsonObject rootObj;
+    if (!fileName.isEmpty())
+        rootObj.insert("file", fileName);
+    rootObj.insert("packetSize",         _packetSize);
+    rootObj.insert("packetSizeDetected", _packetSizeDetected);
+    rootObj.insert("basicOffset",        _basicOffset);
+    // (JSON numbers are doubles; fine for these magnitudes.)
+    rootObj.insert("packets",          static_cast<double>(_packetCount));
+    rootObj.insert("syncErrors",       static_cast<double>(_syncErrorCount));
+    rootObj.insert("trailingBytes",    static_cast<double>(_trailingBytes));
+    if (_timelinePID != TS::PacketView::pidNullPacket) {
+        rootObj.insert("timelinePID",  _timelinePID);
+        rootObj.insert("durationSecs", duration);
+        if (duration > 0)
+            rootObj.insert("bitrate",  std::floor(totals.packets * bitsPerPacket / duration));
+    }
+    rootObj.insert("continuityErrors", static_cast<double>(totals.continuityErrors));
+    rootObj.insert("lostPackets",      static_cast<double>(totals.lostPackets));
+    rootObj.insert("duplicatePackets", static_cast<double>(totals.duplicatePackets));
+    rootObj.insert("transportErrors",  static_cast<double>(totals.transportErrors));
+    rootObj.insert("scrambledPackets", static_cast<double>(totals.scrambledPackets));
+    rootObj.insert("discontinuities",  static_cast<double>(_boundaryCount));
+
+    QJsonArray boundariesArr;
+    for (const Boundary &boundary : _boundaries) {
+        QJsonObject boundaryObj;
+        boundaryObj.insert("packet",        static_cast<double>(boundary.packetIndex + 1));
+        boundaryObj.insert("offset",        static_cast<double>(boundary.offset));
+        boundaryObj.insert("pcrBeforeSecs", boundary.pcrBeforeSecs);
+        boundaryObj.insert("pcrAfterSecs",  boundary.pcrAfterSecs);
+        boundaryObj.insert("indicated",     boundary.indicated);
+        boundariesArr.append(boundaryObj);
+    }
+    rootObj.insert("boundaries", boundariesArr);
+
+    QList<quint16> pids = _analyzerPtr->activePIDs();
+    std::sort(pids.begin(), pids.end());
+    QJsonArray pidsArr;
+    for (const quint16 pid : pids) {
+        const TS::PIDAnalyzer::PIDStats &stats(_analyzerPtr->pidStats(pid));
+        QJsonObject pidObj;
+        pidObj.insert("pid",              pid);
+        pidObj.insert("packets",          static_cast<double>(stats.packets));
+        if (duration > 0)
+            pidObj.insert("bitrate",      std::floor(stats.packets * bitsPerPacket / duration));
+        pidObj.insert("continuityErrors", static_cast<double>(stats.continuityErrors));
+        pidObj.insert("lostPackets",      static_cast<double>(stats.lostPackets));
+        pidObj.insert("duplicatePackets", static_cast<double>(stats.duplicatePackets));
+        pidObj.insert("transportErrors",  static_cast<double>(stats.transportErrors));
+        pidObj.insert("scrambledPackets", static_cast<double>(stats.scrambledPackets));
+        const QString description = pidDescription(pid);
+        if (!description.isEmpty())
+            pidObj.insert("description",  description);
+
+        const auto pcrIt = _pcrStats.constFind(pid);
+        if (pcrIt != _pcrStats.constEnd()) {
+            const PCRStats &pcr(pcrIt.value());
+            QJsonObject pcrObj;
+            pcrObj.insert("count", static_cast<double>(pcr.count));
+            if (pcr.intervalCount > 0) {
+                pcrObj.insert("intervalMinSecs", pcr.intervalMinSecs);
+                pcrObj.insert("intervalAvgSecs", pcr.intervalSumSecs / pcr.intervalCount);
+                pcrObj.insert("intervalMaxSecs", pcr.intervalMaxSecs);
+            }
+            if (pcr.jitterCount > 0) {
+                pcrObj.insert("jitterMaxSecs", pcr.jitterMaxAbsSecs);
+                pcrObj.insert("jitterAvgSecs", pcr.jitterSumAbsSecs / pcr.jitterCount);
+            }
+            pidObj.insert("pcr", pcrObj);
+        }
+        pidsArr.append(pidObj);
+    }
+    rootObj.insert("pids", pidsArr);
+
+    out->append(QJsonDocument(rootObj).toJson(QJsonDocument::Compact)).append('\n');
+}
+
+void StreamStats::appendCSV(QByteArray *out, const QString &fileName) const
+{
+    const double duration = durationSecs();
+    const QByteArray filePrefix = fileName.isEmpty() ?
+        QByteArray() : PacketFormatter::csvField(fileName.toUtf8()) + ',';
+
+    QList<quint16> pids = _analyzerPtr->activePIDs();
+    std::sort(pids.begin(), pids.end());
+    for (const quint16 pid : pids) {
+        const TS::PIDAnalyzer::PIDStats &stats(_analyzerPtr->pidStats(pid));
+        out->append(filePrefix)
+            .append(pidString(pid).toUtf8()).append(',')
+            .append(QByteArray::number(stats.packets)).append(',')
+            .append(duration > 0 ? QByteArray::number(static_cast<qint64>(stats.packets * bitsPerPacket / duration)) : QByteArray()).append(',')
+            .append(QByteArray::number(stats.continuityErrors)).append(',')
+            .append(QByteArray::number(stats.lostPackets)).append(',')
+            .append(QByteArray::number(stats.duplicatePackets)).append(',')
+            .append(QByteArray::number(stats.transportErrors)).append(',')
+            .append(QByteArray::number(stats.scrambledPackets)).append(',');
+
+        const auto pcrIt = _pcrStats.constFind(pid);
+        if (pcrIt != _pcrStats.constEnd()) {
+            const PCRStats &pcr(pcrIt.value());
+            out->append(QByteArray::number(pcr.count)).append(',');
+            if (pcr.intervalCount > 0) {
+                out->append(QByteArray::number(pcr.intervalSumSecs / pcr.intervalCount, 'g', 9)).append(',')
+                    .append(QByteArray::number(pcr.intervalMaxSecs, 'g', 9)).append(',');
+            }
+            else
+                out->append(",,");
+            if (pcr.jitterCount > 0)
+                out->append(QByteArray::number(pcr.jitterMaxAbsSecs, 'g', 9));
+            out->append(',');
+        }
+        else
+            out->append("0,,,,");
+
+        out->append(PacketFormatter::csvField(pidDescription(pid).toUtf8())).append('\n');
+    }
+}
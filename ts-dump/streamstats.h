@@ -0,0 +1,115 @@
+#ifndef STREAMSTATS_H
+#define STREAMSTATS_H
+
+#include "packetformatter.h"
+#include "tspidanalyzer.h"
+#include "tspsi.h"
+
+#include <memory>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+
+// Aggregate statistics of a whole TS, tsanalyze-style, for ts-dump --stats:
+// Per-PID packet counts, bitrates and continuity/transport errors
+// (via TS::PIDAnalyzer), PCR intervals and jitter, discontinuity
+// segment boundaries, and what the PSI says the PIDs are.
+//
+// Takes a single streaming pass in constant memory, looking at packet
+// headers only (via TS::PacketView), besides reassembling PSI.
+class StreamStats
+{
+public:
+    struct PCRStats {
+        qint64  count = 0;
+        // Between consecutive PCRs (not across discontinuities).
+        qint64  intervalCount = 0;
+        double  intervalMinSecs = 0;
+        double  intervalMaxSecs = 0;
+        double  intervalSumSecs = 0;
+        // How far each PCR is off from where the bitrate of the previous
+        // PCR interval would put it, by its position in the stream.
+        qint64  jitterCount = 0;
+        double  jitterMaxAbsSecs = 0;
+        double  jitterSumAbsSecs = 0;
+
+        qint64  lastPCR = -1;  // 27 MHz units.
+        qint64  lastPacketIndex = 0;
+        double  lastIntervalBitrate = 0;
+    };
+
+    // Where the PCR timeline jumps.
+    struct Boundary {
+        qint64  packetIndex = 0;
+        qint64  offset = 0;
+        double  pcrBeforeSecs = 0;
+        double  pcrAfterSecs = 0;
+        bool    indicated = false;  // By discontinuity_indicator.
+    };
+
+    // Beyond that, boundaries are only counted.
+    static constexpr int boundariesListedMax = 100;
+
+private:
+    int     _packetSize;
+    int     _basicOffset;
+    bool    _packetSizeDetected;
+    qint64  _packetCount = 0;
+    qint64  _byteCount = 0;
+    qint64  _syncErrorCount = 0;
+    qint64  _trailingBytes = 0;
+
+    // (On the heap, as its per-PID table is rather large.)
+    std::unique_ptr<TS::PIDAnalyzer>  _analyzerPtr;
+    TS::PSIDemux                      _psi;
+    QHash<quint16, PCRStats>          _pcrStats;
+
+    // The PCR PID that got seen first provides the timeline.
+    quint16  _timelinePID = 0x1fff;
+    qint64   _timelineNanosecs = 0;
+    qint64   _boundaryCount = 0;
+    QList<Boundary>  _boundaries;
+
+public:
+    // basicOffset is where the 188-byte packet starts; see
+    // TS::PacketView::basicOffsetForPacketSize().
+    StreamStats(int packetSize, int basicOffset, bool packetSizeDetected);
+
+    // Sizes 188, 192 (4-byte prefix), 204 and 208 (suffix) are recognized
+    // by sync bytes at consistent positions; returns 0 if none matches.
+    static int detectPacketSize(const QByteArray &probe);
+
+    // For live input, where the packet size may get re-detected.
+    void setPacketSize(int packetSize, int basicOffset);
+    int packetSize() const;
+
+    // data must hold packetSize bytes.
+    void addPacket(const char *data);
+    // Partial packet at the end of the input.
+    void setTrailingBytes(qint64 count);
+
+    qint64 packetCount() const;
+    double durationSecs() const;
+    const TS::PIDAnalyzer &pidAnalyzer() const;
+    const QHash<quint16, PCRStats> &pcrStats() const;
+    qint64 boundaryCount() const;
+    const QList<Boundary> &boundaries() const;
+
+    // CSV column names line; nothing for the other formats.
+    static void appendReportHeader(QByteArray *out, PacketFormatter::Format format, bool withFileName);
+    // A report in the given format: human-readable text, a JSON object
+    // on a single line, or CSV rows per PID. For the latter two, fileName
+    // is included if non-empty.
+    void appendReport(QByteArray *out, PacketFormatter::Format format, const QString &fileName) const;
+
+private:
+    void addPCR(quint16 pid, qint64 pcr, bool indicated);
+    QString pidDescription(quint16 pid) const;
+    void appendText(QByteArray *out) const;
+    void appendJSON(QByteArray *out, const QString &fileName) const;
+    void appendCSV(QByteArray *out, const QString &fileName) const;
+};
+
+#endif // STREAMSTATS_H
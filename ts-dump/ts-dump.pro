@@ -1,4 +1,4 @@
-QT += core
+QT += core concurrent
 QT -= gui
 
 TARGET = ts-dump
@@ -7,7 +7,19 @@ CONFIG -= app_bundle
 
 TEMPLATE = app
 
-SOURCES += main.cpp
+SOURCES += main.cpp \
+    packetformatter.cpp \
+    bufferedwriter.cpp \
+    chunkeddumper.cpp \
+    livedumper.cpp \
+    streamstats.cpp
+
+HEADERS += \
+    packetformatter.h \
+    bufferedwriter.h \
+    chunkeddumper.h \
+    livedumper.h \
+    streamstats.h
 
 include(../config.pri)
 
@@ -0,0 +1,266 @@
+#include <QCoreApplication>
+
+#include "tsstreamgenerator.h"
+#include "tspacketv2.h"
+#include "log_backend.h"
+#include "humanreadable.h"
+#include "monotonicclock.h"
+#include "numericconverter.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+using SSCvn::log::verbose;
+using SSCvn::log::debug_level;
+
+using namespace SSCvn;
+
+namespace {
+    QTextStream errout(stderr);
+
+    template <typename T>
+    bool convertOptionToNum(const QCommandLineParser &parser, const QString &name,
+        const char *errPrefix, T minValue, T *valuePtr)
+    {
+        const QString valueStr = parser.value(name);
+        if (valueStr.isNull())
+            return true;
+
+        bool ok = false;
+        const T value = HumanReadable::numericConverter<T>(valueStr, &ok);
+        if (!ok) {
+            qCritical() << errPrefix << "Can't convert to number:" << valueStr;
+            return false;
+        }
+        if (!(value >= minValue)) {
+            qCritical() << errPrefix << "Must be at least" << minValue << "but got" << value;
+            return false;
+        }
+
+        *valuePtr = value;
+        return true;
+    }
+
+    bool convertOptionToNanosecs(const QCommandLineParser &parser, const QString &name,
+        const char *errPrefix, qint64 *valuePtr)
+    {
+        const QString valueStr = parser.value(name);
+        if (valueStr.isNull())
+            return true;
+
+        bool ok = false;
+        const qint64 msec = HumanReadable::timeDurationToMsec(valueStr, &ok);
+        if (!ok) {
+            qCritical() << errPrefix << "Can't convert to time duration:" << valueStr;
+            return false;
+        }
+
+        *valuePtr = msec * 1000000;
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    log::backend::logoutPtr = &errout;
+    qInstallMessageHandler(&log::backend::msgHandler);
+
+    QCoreApplication a(argc, argv);
+    TS::StreamGenerator::Config config;
+    qint64 durationNanosecs = 0, packetLimit = 0;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate a synthetic MPEG-TS stream");
+    parser.addHelpOption();
+    parser.addOptions({
+        { { "v", "verbose" }, "Increase verbose level" },
+        { { "q", "quiet"   }, "Decrease verbose level" },
+        { { "d", "debug"   }, "Enable debugging. (Increase debug level.)" },
+        { { "o", "output" },
+          "Output file or named pipe (default: standard output)",
+          "FILE" },
+        { { "s", "ts-packet-size" },
+          "MPEG-TS packet size: 188, 192, 204 or 208 bytes (default: " +
+              QString::number(config.packetSize) + ")",
+          "SIZE" },
+        { { "b", "bitrate" },
+          "Stream bitrate in bits per second (default: " + QString::number(config.bitrate) + ")",
+          "BITS" },
+        { "video-bitrate",
+          "Video elementary stream bitrate (default: " + QString::number(config.videoBitrate) + ")",
+          "BITS" },
+        { "audio-bitrate",
+          "Audio elementary stream bitrate (default: " + QString::number(config.audioBitrate) + ")",
+          "BITS" },
+        { { "t", "duration" },
+          "Stop after this much stream time, e.g., 30s or 5min (default: no limit)",
+          "DURATION" },
+        { { "n", "packets" },
+          "Stop after this many packets (default: no limit)",
+          "NUM" },
+        { { "r", "realtime" },
+          "Output at wall-clock rate, instead of as fast as possible" },
+        { "pcr-interval",
+          "Time between PCRs (default: " +
+              HumanReadable::timeDuration(config.pcrIntervalNanosecs / 1000000) + ")",
+          "DURATION" },
+        { "psi-interval",
+          "Time between PAT/PMT repetitions (default: " +
+              HumanReadable::timeDuration(config.psiIntervalNanosecs / 1000000) + ")",
+          "DURATION" },
+        { "random-access-interval",
+          "Time between video random access points (default: " +
+              HumanReadable::timeDuration(config.randomAccessIntervalNanosecs / 1000000) + ")",
+          "DURATION" },
+        { "discontinuity-interval",
+          "Inject a PCR discontinuity this often (default: never)",
+          "DURATION" },
+        { "discontinuity-jump",
+          "How far the PCR jumps at a discontinuity (default: " +
+              HumanReadable::timeDuration(config.discontinuityJumpNanosecs / 1000000) + ")",
+          "DURATION" },
+        { "corrupt-interval",
+          "Corrupt every NUM-th packet (default: none)",
+          "NUM" },
+        { "corrupt-kind",
+          "How to corrupt packets: tei (transport error indicator), "
+              "sync (sync byte) or cc (continuity counter) (default: tei)",
+          "KIND" },
+        { "seed",
+          "Seed for the pseudo-random payload (default: " + QString::number(config.seed) + ")",
+          "NUM" },
+    });
+    parser.process(a);
+
+    // Apply incremental options.
+    for (QString opt : parser.optionNames()) {
+        if (opt == "v" || opt == "verbose")
+            verbose++;
+        else if (opt == "q" || opt == "quiet")
+            verbose--;
+        else if (opt == "d" || opt == "debug")
+#ifdef QT_NO_DEBUG_OUTPUT
+            qFatal("No debug output compiled in, can't enable debugging!");
+#else
+            debug_level++;
+#endif
+    }
+
+#ifdef SSCVN_LOG_MAX_VERBOSE
+    if (verbose > SSCVN_LOG_MAX_VERBOSE)
+        qWarning("Verbose level %d exceeds the compiled-in maximum of %d, more verbose messages won't be shown!",
+                 verbose, SSCVN_LOG_MAX_VERBOSE);
+#endif
+
+    qint64 seed = static_cast<qint64>(config.seed);
+    if (!convertOptionToNum<int>(parser, "ts-packet-size", "Invalid TS packet size:", 188, &config.packetSize) ||
+        !convertOptionToNum<qint64>(parser, "bitrate", "Invalid bitrate:", 10000, &config.bitrate) ||
+        !convertOptionToNum<qint64>(parser, "video-bitrate", "Invalid video bitrate:", 0, &config.videoBitrate) ||
+        !convertOptionToNum<qint64>(parser, "audio-bitrate", "Invalid audio bitrate:", 0, &config.audioBitrate) ||
+        !convertOptionToNanosecs(parser, "duration", "Invalid duration:", &durationNanosecs) ||
+        !convertOptionToNum<qint64>(parser, "packets", "Invalid number of packets:", 0, &packetLimit) ||
+        !convertOptionToNanosecs(parser, "pcr-interval", "Invalid PCR interval:", &config.pcrIntervalNanosecs) ||
+        !convertOptionToNanosecs(parser, "psi-interval", "Invalid PSI interval:", &config.psiIntervalNanosecs) ||
+        !convertOptionToNanosecs(parser, "random-access-interval", "Invalid random access interval:",
+                                 &config.randomAccessIntervalNanosecs) ||
+        !convertOptionToNanosecs(parser, "discontinuity-interval", "Invalid discontinuity interval:",
+                                 &config.discontinuityIntervalNanosecs) ||
+        !convertOptionToNanosecs(parser, "discontinuity-jump", "Invalid discontinuity jump:",
+                                 &config.discontinuityJumpNanosecs) ||
+        !convertOptionToNum<qint64>(parser, "corrupt-interval", "Invalid corrupt interval:", 0, &config.corruptInterval) ||
+        !convertOptionToNum<qint64>(parser, "seed", "Invalid seed:", 1, &seed))
+        return 2;
+    config.seed = static_cast<quint64>(seed);
+
+    {
+        const QString kind = parser.value("corrupt-kind");
+        if (kind.isNull() || kind == "tei")
+            config.corruptionKind = TS::StreamGenerator::CorruptionKind::TransportErrorIndicator;
+        else if (kind == "sync")
+            config.corruptionKind = TS::StreamGenerator::CorruptionKind::SyncByte;
+        else if (kind == "cc")
+            config.corruptionKind = TS::StreamGenerator::CorruptionKind::ContinuityCounter;
+        else {
+            qCritical() << "Invalid corruption kind:" << kind;
+            return 2;
+        }
+    }
+
+    const bool realtime = parser.isSet("realtime");
+
+    if (!parser.positionalArguments().isEmpty()) {
+        qCritical() << "No positional arguments supported!";
+        return 2;
+    }
+
+    QFile outputFile;
+    const QString outputFileName = parser.value("output");
+    if (outputFileName.isNull() || outputFileName == "-") {
+        if (!outputFile.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+            qCritical() << "Can't open standard output:" << outputFile.errorString();
+            return 1;
+        }
+    }
+    else {
+        outputFile.setFileName(outputFileName);
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+            qCritical() << "Can't open output file" << outputFileName << ":" << outputFile.errorString();
+            return 1;
+        }
+    }
+
+    try {
+        TS::StreamGenerator generator(config);
+
+        if (verbose >= 1)
+            qInfo() << "Generating at" << config.bitrate << "bit/s,"
+                    << config.packetSize << "bytes per packet,"
+                    << (realtime ? "at wall-clock rate" : "as fast as possible");
+
+        // Write in chunks of up to about 10 ms worth of stream time,
+        // but at least a few packets, to keep write calls cheap.
+        const int chunkPackets = qBound(7,
+            static_cast<int>(config.bitrate / 100 / (TS::PacketV2::sizeBasic * 8)), 700);
+        const qint64 startNanosecs = clock::monotonicNanosecs();
+        QByteArray chunk;
+        chunk.reserve(chunkPackets * config.packetSize);
+
+        for (;;) {
+            chunk.clear();
+            while (chunk.length() < chunkPackets * config.packetSize) {
+                if (packetLimit > 0 && generator.packetCount() >= packetLimit)
+                    break;
+                if (durationNanosecs > 0 && generator.streamNanosecs() >= durationNanosecs)
+                    break;
+                generator.generatePacket(&chunk);
+            }
+            if (chunk.isEmpty())
+                break;
+
+            if (realtime) {
+                const qint64 aheadNanosecs = generator.streamNanosecs() -
+                    (clock::monotonicNanosecs() - startNanosecs);
+                if (aheadNanosecs > 0)
+                    QThread::usleep(static_cast<unsigned long>(aheadNanosecs / 1000));
+            }
+
+            if (outputFile.write(chunk) != chunk.length()) {
+                qCritical() << "Error writing output:" << outputFile.errorString();
+                return 1;
+            }
+        }
+
+        if (verbose >= 0)
+            qInfo() << "Generated" << generator.packetCount() << "packets,"
+                    << qPrintable(HumanReadable::timeDuration(generator.streamNanosecs() / 1000000))
+                    << "of stream time";
+    }
+    catch (std::exception &ex) {
+        qCritical() << "Error generating stream:" << ex.what();
+        return 1;
+    }
+
+    return 0;
+}
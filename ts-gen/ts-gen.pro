@@ -0,0 +1,16 @@
+QT += core
+QT -= gui
+
+TARGET = ts-gen
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+include(../config.pri)
+
+SSCVN_REL_ROOT = ..
+SSCVN_LIB_NAMES = infra media
+include(../include/app_internal_libs.pri)
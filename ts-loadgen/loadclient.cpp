@@ -0,0 +1,353 @@
+#include "loadclient.h"
+
+#include "log.h"
+#include "monotonicclock.h"
+#include "tspacketview.h"
+#include "http/httputil.h"
+#include "http/httpheader_netside.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <QDebug>
+#include <QTcpSocket>
+
+using namespace SSCvn;
+
+LoadClient::LoadClient(int id, qint64 rateBytesPerSec, QObject *parent) :
+    QObject(parent),
+    _id(id), _rateBytesPerSec(rateBytesPerSec)
+{
+    if (!(rateBytesPerSec >= 0))
+        throw std::invalid_argument("Load client ctor: Rate must not be negative, but got " +
+                                    std::to_string(rateBytesPerSec));
+
+    std::memset(_lastCC, -1, sizeof(_lastCC));
+}
+
+int LoadClient::id() const
+{
+    return _id;
+}
+
+qint64 LoadClient::rateBytesPerSec() const
+{
+    return _rateBytesPerSec;
+}
+
+LoadClient::State LoadClient::state() const
+{
+    return _state;
+}
+
+const LoadClient::Stats &LoadClient::stats() const
+{
+    return _stats;
+}
+
+void LoadClient::start(const QString &host, quint16 port, const QByteArray &path)
+{
+    if (_state != State::Idle)
+        throw std::logic_error("Load client: Start: Already started");
+
+    _request =
+        "GET " + path + " HTTP/1.0" + HTTP::lineSep +
+        "Host: " + host.toUtf8() + ":" + QByteArray::number(port) + HTTP::lineSep +
+        "User-Agent: ts-loadgen" + HTTP::lineSep +
+        HTTP::lineSep;
+
+    const qint64 now = clock::monotonicNanosecs();
+    _stats.startNanosecs = now;
+    _lastTickNanosecs = now;
+    _lastProgressNanosecs = now;
+    _allowanceBytes = burstBytes();
+    _state = State::Connecting;
+
+    _socketPtr = new QTcpSocket(this);
+    if (_rateBytesPerSec > 0)
+        _socketPtr->setReadBufferSize(rateLimitedReadBufferSize);
+    connect(_socketPtr, &QTcpSocket::connected,    this, &LoadClient::handleConnected);
+    connect(_socketPtr, &QTcpSocket::readyRead,    this, &LoadClient::handleReadyRead);
+    connect(_socketPtr, &QTcpSocket::disconnected, this, &LoadClient::handleDisconnected);
+    connect(_socketPtr, static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+            this, &LoadClient::handleError);
+    _socketPtr->connectToHost(host, port);
+}
+
+void LoadClient::stop()
+{
+    finish();
+}
+
+void LoadClient::tick(qint64 nowNanosecs, qint64 stallThresholdNanosecs)
+{
+    if (_state == State::Idle || _state == State::Finished)
+        return;
+
+    if (_rateBytesPerSec > 0 && _state != State::Connecting) {
+        _allowanceBytes += static_cast<double>(_rateBytesPerSec) *
+            (nowNanosecs - _lastTickNanosecs) / 1000000000;
+        if (_allowanceBytes > burstBytes())
+            _allowanceBytes = burstBytes();
+        _lastTickNanosecs = nowNanosecs;
+
+        if (_allowanceBytes >= 1)
+            readSocket(static_cast<qint64>(_allowanceBytes), nowNanosecs);
+        if (_state == State::Finished)
+            return;
+
+        // Data waiting that we're not allowed to read yet is no stall;
+        // the server is keeping up, we aren't.
+        if (_socketPtr->bytesAvailable() > 0) {
+            endStall(nowNanosecs);
+            _lastProgressNanosecs = nowNanosecs;
+        }
+    }
+
+    if (_stallStartNanosecs < 0 &&
+        nowNanosecs - _lastProgressNanosecs > stallThresholdNanosecs)
+    {
+        _stallStartNanosecs = _lastProgressNanosecs;
+        _stats.stalls++;
+        if (SSCVN_VERBOSE(1))
+            qInfo() << "Client" << _id << "stalled in state" << _state;
+    }
+}
+
+void LoadClient::handleConnected()
+{
+    if (SSCVN_VERBOSE(2))
+        qInfo() << "Client" << _id << "connected";
+
+    _state = State::ReceivingHeader;
+    _socketPtr->write(_request);
+}
+
+void LoadClient::handleReadyRead()
+{
+    const qint64 now = clock::monotonicNanosecs();
+    if (_rateBytesPerSec <= 0)
+        readSocket(std::numeric_limits<qint64>::max(), now);
+    else if (_allowanceBytes >= 1)
+        readSocket(static_cast<qint64>(_allowanceBytes), now);
+}
+
+void LoadClient::handleDisconnected()
+{
+    finish(_state == State::ReceivingBody ?
+        "Server closed connection" :
+        "Server closed connection before end of response header");
+}
+
+void LoadClient::handleError(QAbstractSocket::SocketError error)
+{
+    // (Handled by handleDisconnected().)
+    if (error == QAbstractSocket::RemoteHostClosedError)
+        return;
+
+    finish(_socketPtr ? _socketPtr->errorString() : QString("Socket error"));
+}
+
+qint64 LoadClient::burstBytes() const
+{
+    // A tenth of a second's worth, but at least a packet.
+    return qMax<qint64>(_rateBytesPerSec / 10, TS::PacketView::sizeBasic);
+}
+
+void LoadClient::readSocket(qint64 maxBytes, qint64 nowNanosecs)
+{
+    // (Unlimited readers drain all of it, a chunk at a time.)
+    while (maxBytes > 0 &&
+           (_state == State::ReceivingHeader || _state == State::ReceivingBody))
+    {
+        const int count = static_cast<int>(qMin(qMin(_socketPtr->bytesAvailable(), maxBytes),
+                                                rateLimitedReadBufferSize));
+        if (count <= 0)
+            return;
+
+        _readBuf.resize(count);
+        const qint64 got = _socketPtr->read(_readBuf.data(), count);
+        if (got <= 0)
+            return;
+        maxBytes -= got;
+
+        if (_stats.ttfbNanosecs < 0)
+            _stats.ttfbNanosecs = nowNanosecs - _stats.startNanosecs;
+        endStall(nowNanosecs);
+        _lastProgressNanosecs = nowNanosecs;
+        if (_rateBytesPerSec > 0)
+            _allowanceBytes -= got;
+
+        if (_state == State::ReceivingHeader) {
+            _headerBuf.append(_readBuf.constData(), static_cast<int>(got));
+            processHeader(nowNanosecs);
+        }
+        else {
+            processBody(_readBuf.constData(), static_cast<int>(got), nowNanosecs);
+        }
+    }
+}
+
+void LoadClient::processHeader(qint64 nowNanosecs)
+{
+    const QByteArray headerSep = HTTP::lineSep + HTTP::lineSep;
+    const int headerEnd = _headerBuf.indexOf(headerSep);
+    if (headerEnd < 0) {
+        if (_headerBuf.length() > rateLimitedReadBufferSize)
+            finish("Response header too long");
+        return;
+    }
+
+    const int statusLineEnd = _headerBuf.indexOf(HTTP::lineSep);
+    const QList<QByteArray> statusFields =
+        _headerBuf.left(statusLineEnd).split(HTTP::fieldSepStartLine.at(0));
+    bool ok = false;
+    const int statusCode = statusFields.length() >= 2 ? statusFields.at(1).toInt(&ok) : 0;
+    if (!(statusFields.at(0).startsWith("HTTP/") && ok)) {
+        finish("Invalid status line: " + QString::fromLatin1(_headerBuf.left(statusLineEnd)));
+        return;
+    }
+    _stats.statusCode = statusCode;
+
+    HTTP::HeaderNetside header;
+    const int headerFrom = statusLineEnd + HTTP::lineSep.length();
+    try {
+        header.parse(_headerBuf, headerFrom, headerEnd + HTTP::lineSep.length() - headerFrom);
+    }
+    catch (std::exception &ex) {
+        finish(QString("Invalid response header: ") + ex.what());
+        return;
+    }
+
+    if (statusCode != HTTP::SC_200_OK) {
+        finish(QString("HTTP status %1").arg(statusCode));
+        return;
+    }
+
+    if (SSCVN_VERBOSE(1)) {
+        const HTTP::HeaderNetside::Field *contentType = header.field("Content-Type");
+        if (!contentType || contentType->fieldValue() != "video/mp2t")
+            qInfo() << "Client" << _id << "got unexpected content type"
+                    << (contentType ? contentType->fieldValue() : QByteArray());
+    }
+
+    _state = State::ReceivingBody;
+    const QByteArray rest = _headerBuf.mid(headerEnd + headerSep.length());
+    _headerBuf.clear();
+    if (!rest.isEmpty())
+        processBody(rest.constData(), rest.length(), nowNanosecs);
+}
+
+void LoadClient::processBody(const char *data, int length, qint64 nowNanosecs)
+{
+    const int packetSize = TS::PacketView::sizeBasic;
+    const char syncByte = static_cast<char>(TS::PacketView::syncByteFixedValue);
+
+    _stats.bytesReceived += length;
+    _packetBuf.append(data, length);
+
+    const char *const buf = _packetBuf.constData();
+    const int bufLength = _packetBuf.length();
+    int pos = 0;
+    while (pos < bufLength) {
+        if (!_synced) {
+            // (Re-)gain sync on two sync bytes a packet apart.
+            const void *found = std::memchr(buf + pos, syncByte, bufLength - pos);
+            if (!found) {
+                pos = bufLength;
+                break;
+            }
+            pos = static_cast<int>(static_cast<const char *>(found) - buf);
+            if (bufLength - pos <= packetSize)
+                break;
+            if (buf[pos + packetSize] != syncByte) {
+                pos++;
+                continue;
+            }
+
+            _synced = true;
+            if (_stats.ttfsNanosecs < 0)
+                _stats.ttfsNanosecs = nowNanosecs - _stats.startNanosecs;
+        }
+
+        if (bufLength - pos < packetSize)
+            break;
+
+        if (buf[pos] != syncByte) {
+            _stats.syncErrors++;
+            if (SSCVN_VERBOSE(1))
+                qInfo() << "Client" << _id << "lost sync after" << _stats.packetsReceived << "packets";
+            _synced = false;
+            std::memset(_lastCC, -1, sizeof(_lastCC));
+            continue;
+        }
+
+        checkPacket(buf + pos);
+        pos += packetSize;
+    }
+
+    _packetBuf.remove(0, pos);
+}
+
+void LoadClient::checkPacket(const char *data)
+{
+    const TS::PacketView packet(data);
+    _stats.packetsReceived++;
+
+    if (packet.isNullPacket())
+        return;
+
+    const quint16 pid = packet.pid();
+    const quint8 cc = packet.continuityCounter();
+    const qint8 lastCC = _lastCC[pid];
+    _lastCC[pid] = static_cast<qint8>(cc);
+    if (lastCC < 0 || packet.discontinuityIndicator())
+        return;
+
+    // The counter only advances on packets with payload;
+    // one duplicate packet is allowed.
+    const quint8 last = static_cast<quint8>(lastCC);
+    const bool ccOk = packet.hasPayload() ?
+        (cc == ((last + 1) & 0x0f) || cc == last) :
+        cc == last;
+    if (!ccOk) {
+        _stats.ccErrors++;
+        if (SSCVN_VERBOSE(2))
+            qInfo() << "Client" << _id << "continuity error on PID" << pid
+                    << "expected" << ((last + 1) & 0x0f) << "got" << cc;
+    }
+}
+
+void LoadClient::endStall(qint64 nowNanosecs)
+{
+    if (_stallStartNanosecs < 0)
+        return;
+
+    _stats.stallNanosecs += nowNanosecs - _stallStartNanosecs;
+    _stallStartNanosecs = -1;
+}
+
+void LoadClient::finish(const QString &error)
+{
+    if (_state == State::Finished)
+        return;
+
+    const qint64 now = clock::monotonicNanosecs();
+    endStall(now);
+    _stats.endNanosecs = now;
+    _stats.error = error;
+    _state = State::Finished;
+
+    if (_socketPtr) {
+        _socketPtr->disconnect(this);
+        _socketPtr->abort();
+        _socketPtr->deleteLater();
+        _socketPtr = nullptr;
+    }
+
+    if (!error.isEmpty() && SSCVN_VERBOSE(1))
+        qInfo() << "Client" << _id << "finished:" << error;
+
+    emit finished(this);
+}
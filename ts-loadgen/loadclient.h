@@ -0,0 +1,103 @@
+#ifndef LOADCLIENT_H
+#define LOADCLIENT_H
+
+#include <QObject>
+
+#include <QAbstractSocket>
+#include <QByteArray>
+#include <QString>
+
+class QTcpSocket;
+
+// A single synthetic HTTP stream consumer.
+//
+// Requests the stream, parses the response header with the server's own
+// HTTP header parser, then reads the body, at most at rateBytesPerSec
+// (0 means as fast as possible). A rate-limited client keeps its socket
+// read buffer small, so it applies TCP backpressure to the server just
+// like a slow real-world player would.
+//
+// The body is checked to be an MPEG-TS stream: sync bytes at packet
+// boundaries and, per PID, continuity counters.
+class LoadClient : public QObject
+{
+    Q_OBJECT
+public:
+    enum class State {
+        Idle,
+        Connecting,
+        ReceivingHeader,
+        ReceivingBody,
+        Finished,
+    };
+    Q_ENUM(State)
+
+    struct Stats {
+        int     statusCode = 0;
+        qint64  bytesReceived = 0;  // (Body only.)
+        qint64  packetsReceived = 0;
+        qint64  syncErrors = 0;
+        qint64  ccErrors = 0;
+        int     stalls = 0;
+        qint64  stallNanosecs = 0;
+        // Relative to the start of connecting; -1 if not reached.
+        qint64  ttfbNanosecs = -1;
+        qint64  ttfsNanosecs = -1;
+        qint64  startNanosecs = -1;
+        qint64  endNanosecs = -1;
+        QString error;
+    };
+
+private:
+    const int     _id;
+    const qint64  _rateBytesPerSec;
+    QTcpSocket   *_socketPtr = nullptr;
+    State         _state = State::Idle;
+    Stats         _stats;
+    QByteArray    _request;
+    QByteArray    _readBuf;
+    QByteArray    _headerBuf;
+    QByteArray    _packetBuf;
+    bool          _synced = false;
+    qint8         _lastCC[8192];
+    double        _allowanceBytes = 0;
+    qint64        _lastTickNanosecs = -1;
+    qint64        _lastProgressNanosecs = -1;
+    qint64        _stallStartNanosecs = -1;
+
+public:
+    static constexpr qint64 rateLimitedReadBufferSize = 64 * 1024;
+
+    explicit LoadClient(int id, qint64 rateBytesPerSec, QObject *parent = nullptr);
+
+    int id() const;
+    qint64 rateBytesPerSec() const;
+    State state() const;
+    const Stats &stats() const;
+
+    void start(const QString &host, quint16 port, const QByteArray &path);
+    void stop();
+    // Reads what the rate allows, and keeps track of stalls.
+    // Called periodically by the load generator.
+    void tick(qint64 nowNanosecs, qint64 stallThresholdNanosecs);
+
+signals:
+    void finished(LoadClient *client);
+
+private slots:
+    void handleConnected();
+    void handleReadyRead();
+    void handleDisconnected();
+    void handleError(QAbstractSocket::SocketError error);
+
+private:
+    qint64 burstBytes() const;
+    void readSocket(qint64 maxBytes, qint64 nowNanosecs);
+    void processHeader(qint64 nowNanosecs);
+    void processBody(const char *data, int length, qint64 nowNanosecs);
+    void checkPacket(const char *data);
+    void endStall(qint64 nowNanosecs);
+    void finish(const QString &error = QString());
+};
+
+#endif // LOADCLIENT_H
@@ -0,0 +1,225 @@
+#include "loadgenerator.h"
+
+#include "log.h"
+#include "histogram.h"
+#include "humanreadable.h"
+#include "monotonicclock.h"
+#include "http/httputil.h"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <QDebug>
+
+using namespace SSCvn;
+
+namespace {
+
+QString msecsStr(qint64 nanosecs)
+{
+    if (nanosecs < 0)
+        return "-";
+    return QString::number(static_cast<double>(nanosecs) / 1000000, 'f', 3) + " ms";
+}
+
+QString kbitsPerSecStr(double kbitsPerSec)
+{
+    return QString::number(kbitsPerSec, 'f', 1) + " kbit/s";
+}
+
+double kbitsPerSec(const LoadClient::Stats &stats)
+{
+    const qint64 nanosecs = stats.endNanosecs - stats.startNanosecs;
+    if (stats.startNanosecs < 0 || nanosecs <= 0)
+        return 0;
+    return static_cast<double>(stats.bytesReceived) * 8 / 1000 * 1000000000 / nanosecs;
+}
+
+}  // namespace
+
+
+LoadGenerator::LoadGenerator(const Config &config, QObject *parent) :
+    QObject(parent),
+    _config(config)
+{
+    if (!(config.clientCount >= 1))
+        throw std::invalid_argument("Load generator ctor: Client count must be at least 1, but got " +
+                                    std::to_string(config.clientCount));
+    if (!(config.slowClientCount >= 0 && config.slowClientCount <= config.clientCount))
+        throw std::invalid_argument("Load generator ctor: Slow client count must be between 0 and the client count, but got " +
+                                    std::to_string(config.slowClientCount));
+    if (!(config.rampUpClientsPerSec >= 1))
+        throw std::invalid_argument("Load generator ctor: Ramp-up must be at least 1 client per second, but got " +
+                                    std::to_string(config.rampUpClientsPerSec));
+
+    for (int i = 0; i < config.clientCount; i++) {
+        const bool slow = isSlowClient(i);
+        auto client = new LoadClient(i + 1, slow ? config.slowRateBytesPerSec : config.rateBytesPerSec, this);
+        connect(client, &LoadClient::finished, this, &LoadGenerator::handleClientFinished);
+        _clients.append(client);
+    }
+
+    _rampUpTimer.setInterval(tickIntervalMsec);
+    connect(&_rampUpTimer, &QTimer::timeout, this, &LoadGenerator::startClients);
+    _tickTimer.setInterval(tickIntervalMsec);
+    connect(&_tickTimer, &QTimer::timeout, this, &LoadGenerator::tickClients);
+    _durationTimer.setSingleShot(true);
+    connect(&_durationTimer, &QTimer::timeout, this, &LoadGenerator::stop);
+}
+
+const LoadGenerator::Config &LoadGenerator::config() const
+{
+    return _config;
+}
+
+const QList<LoadClient *> &LoadGenerator::clients() const
+{
+    return _clients;
+}
+
+bool LoadGenerator::isSlowClient(int index) const
+{
+    // Spread slow clients evenly over the start order, so they don't
+    // all connect last, when the server might be under the most load.
+    return (static_cast<qint64>(index) * _config.slowClientCount) % _config.clientCount
+        < _config.slowClientCount;
+}
+
+void LoadGenerator::start()
+{
+    if (SSCVN_VERBOSE(0))
+        qInfo().nospace()
+            << "Starting " << _config.clientCount << " clients"
+            << " (" << _config.slowClientCount << " slow)"
+            << " against " << _config.host << ":" << _config.port << _config.path
+            << " at " << _config.rampUpClientsPerSec << " clients/s"
+            << " for " << qPrintable(HumanReadable::timeDuration(_config.durationMsec));
+
+    _startNanosecs = clock::monotonicNanosecs();
+    startClients();
+    _rampUpTimer.start();
+    _tickTimer.start();
+    if (_config.durationMsec > 0)
+        _durationTimer.start(static_cast<int>(_config.durationMsec));
+}
+
+void LoadGenerator::stop()
+{
+    _rampUpTimer.stop();
+    _tickTimer.stop();
+    _durationTimer.stop();
+
+    for (LoadClient *client : _clients)
+        client->stop();
+
+    emit finished();
+}
+
+void LoadGenerator::startClients()
+{
+    const qint64 elapsedNanosecs = clock::monotonicNanosecs() - _startNanosecs;
+    const qint64 due = qMin<qint64>(_config.clientCount,
+        1 + elapsedNanosecs * _config.rampUpClientsPerSec / 1000000000);
+
+    while (_clientsStarted < due) {
+        LoadClient *client = _clients.at(_clientsStarted++);
+        client->start(_config.host, _config.port, _config.path);
+    }
+
+    if (_clientsStarted >= _config.clientCount) {
+        _rampUpTimer.stop();
+        if (SSCVN_VERBOSE(1))
+            qInfo() << "All clients started after"
+                    << qPrintable(msecsStr(elapsedNanosecs));
+    }
+}
+
+void LoadGenerator::tickClients()
+{
+    const qint64 now = clock::monotonicNanosecs();
+    const qint64 stallThresholdNanosecs = _config.stallThresholdMsec * 1000000;
+    for (LoadClient *client : _clients)
+        client->tick(now, stallThresholdNanosecs);
+}
+
+void LoadGenerator::handleClientFinished(LoadClient *client)
+{
+    Q_UNUSED(client);
+
+    // When the server has gone away for all clients, there's no point
+    // in waiting for the rest of the duration.
+    if (++_clientsFinished >= _config.clientCount && _tickTimer.isActive()) {
+        if (SSCVN_VERBOSE(0))
+            qInfo() << "All clients finished early";
+        stop();
+    }
+}
+
+void LoadGenerator::report(QTextStream &out) const
+{
+    stats::Histogram ttfbHistogram, ttfsHistogram, throughputHistogram;
+    qint64 bytesReceived = 0, packetsReceived = 0, syncErrors = 0, ccErrors = 0;
+    int stalls = 0, stalledClients = 0, failedClients = 0;
+
+    for (int i = 0; i < _clients.length(); i++) {
+        const LoadClient *client = _clients.at(i);
+        const LoadClient::Stats &clientStats(client->stats());
+        const double kbits = kbitsPerSec(clientStats);
+        const bool slow = isSlowClient(i);
+
+        if (_config.perClientReport) {
+            out << "client " << client->id()
+                << (slow ? " slow" : "")
+                << ": status " << clientStats.statusCode
+                << ", " << HumanReadable::byteCount(clientStats.bytesReceived, false, true)
+                << ", " << kbitsPerSecStr(kbits)
+                << ", ttfb " << msecsStr(clientStats.ttfbNanosecs)
+                << ", ttfs " << msecsStr(clientStats.ttfsNanosecs)
+                << ", stalls " << clientStats.stalls << " (" << msecsStr(clientStats.stallNanosecs) << ")"
+                << ", sync errors " << clientStats.syncErrors
+                << ", cc errors " << clientStats.ccErrors;
+            if (!clientStats.error.isEmpty())
+                out << ", error: " << clientStats.error;
+            out << endl;
+        }
+
+        if (clientStats.ttfbNanosecs >= 0)
+            ttfbHistogram.record(static_cast<quint64>(clientStats.ttfbNanosecs / 1000));
+        if (clientStats.ttfsNanosecs >= 0)
+            ttfsHistogram.record(static_cast<quint64>(clientStats.ttfsNanosecs / 1000));
+        if (!slow)
+            throughputHistogram.record(static_cast<quint64>(kbits));
+        bytesReceived   += clientStats.bytesReceived;
+        packetsReceived += clientStats.packetsReceived;
+        syncErrors      += clientStats.syncErrors;
+        ccErrors        += clientStats.ccErrors;
+        stalls          += clientStats.stalls;
+        if (clientStats.stalls > 0)
+            stalledClients++;
+        if (clientStats.statusCode != HTTP::SC_200_OK || clientStats.ttfsNanosecs < 0)
+            failedClients++;
+    }
+
+    auto percentiles = [](const stats::Histogram &histogram, std::function<QString(quint64)> toString) {
+        return QString("p50 %1, p90 %2, p99 %3, max %4").arg(
+            toString(histogram.valueAtPercentile(50)),
+            toString(histogram.valueAtPercentile(90)),
+            toString(histogram.valueAtPercentile(99)),
+            toString(histogram.max()));
+    };
+    auto usecsToString = [](quint64 usecs) { return msecsStr(static_cast<qint64>(usecs) * 1000); };
+    auto kbitsToString = [](quint64 kbits) { return kbitsPerSecStr(kbits); };
+
+    out << "clients: " << _clients.length()
+        << " (" << _config.slowClientCount << " slow)"
+        << ", started " << _clientsStarted
+        << ", failed " << failedClients
+        << ", stalled " << stalledClients << " (" << stalls << " stalls)" << endl;
+    out << "received: " << HumanReadable::byteCount(bytesReceived)
+        << ", " << packetsReceived << " packets"
+        << ", sync errors " << syncErrors
+        << ", cc errors " << ccErrors << endl;
+    out << "throughput (non-slow clients): " << percentiles(throughputHistogram, kbitsToString) << endl;
+    out << "time to first byte: "      << percentiles(ttfbHistogram, usecsToString) << endl;
+    out << "time to first sync byte: " << percentiles(ttfsHistogram, usecsToString) << endl;
+}
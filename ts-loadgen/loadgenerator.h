@@ -0,0 +1,70 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+
+#include "loadclient.h"
+
+#include <QList>
+#include <QString>
+#include <QTextStream>
+#include <QTimer>
+
+// Runs a number of LoadClient instances against a stream server,
+// starting them at a configurable ramp-up rate, ticking their
+// rate limiting and stall detection, and reporting on them at the end.
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Config {
+        QString     host = "127.0.0.1";
+        quint16     port = 8000;
+        QByteArray  path = "/stream.m2ts";
+        int         clientCount = 100;
+        qint64      rateBytesPerSec = 0;  // (0 means unlimited.)
+        int         slowClientCount = 0;
+        qint64      slowRateBytesPerSec = 16 * 1024;
+        qint64      durationMsec = 30 * 1000;
+        int         rampUpClientsPerSec = 100;
+        qint64      stallThresholdMsec = 1000;
+        bool        perClientReport = true;
+    };
+
+private:
+    const Config         _config;
+    QList<LoadClient *>  _clients;
+    int                  _clientsStarted = 0;
+    int                  _clientsFinished = 0;
+    qint64               _startNanosecs = -1;
+    QTimer               _rampUpTimer;
+    QTimer               _tickTimer;
+    QTimer               _durationTimer;
+
+public:
+    static constexpr int tickIntervalMsec = 10;
+
+    explicit LoadGenerator(const Config &config, QObject *parent = nullptr);
+
+    const Config &config() const;
+    const QList<LoadClient *> &clients() const;
+
+    void report(QTextStream &out) const;
+
+signals:
+    void finished();
+
+public slots:
+    void start();
+    void stop();
+
+private:
+    bool isSlowClient(int index) const;
+
+private slots:
+    void startClients();
+    void tickClients();
+    void handleClientFinished(LoadClient *client);
+};
+
+#endif // LOADGENERATOR_H
@@ -0,0 +1,228 @@
+#include <QCoreApplication>
+
+#include "loadgenerator.h"
+#include "log_backend.h"
+#include "lograte.h"
+#include "humanreadable.h"
+#include "numericconverter.h"
+
+#include <sys/resource.h>
+
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTimer>
+
+using SSCvn::log::verbose;
+using SSCvn::log::debug_level;
+
+using namespace SSCvn;
+
+namespace {
+    QTextStream out(stdout), errout(stderr);
+
+    template <typename T>
+    bool convertOptionToNum(const QCommandLineParser &parser, const QString &name,
+        const char *errPrefix, T minValue, T *valuePtr)
+    {
+        const QString valueStr = parser.value(name);
+        if (valueStr.isNull())
+            return true;
+
+        bool ok = false;
+        const T value = HumanReadable::numericConverter<T>(valueStr, &ok);
+        if (!ok) {
+            qCritical() << errPrefix << "Can't convert to number:" << valueStr;
+            return false;
+        }
+        if (!(value >= minValue)) {
+            qCritical() << errPrefix << "Must be at least" << minValue << "but got" << value;
+            return false;
+        }
+
+        *valuePtr = value;
+        return true;
+    }
+
+    bool convertOptionToMsec(const QCommandLineParser &parser, const QString &name,
+        const char *errPrefix, qint64 *valuePtr)
+    {
+        const QString valueStr = parser.value(name);
+        if (valueStr.isNull())
+            return true;
+
+        bool ok = false;
+        const qint64 value = HumanReadable::timeDurationToMsec(valueStr, &ok);
+        if (!ok) {
+            qCritical() << errPrefix << "Can't convert to time duration:" << valueStr;
+            return false;
+        }
+
+        *valuePtr = value;
+        return true;
+    }
+
+    // Each client needs a file descriptor; try to get enough of them.
+    void ensureFileDescriptorLimit(int clientCount)
+    {
+        const rlim_t needed = static_cast<rlim_t>(clientCount) + 64;
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur >= needed)
+            return;
+
+        const rlim_t oldLimit = limit.rlim_cur;
+        limit.rlim_cur = limit.rlim_max == RLIM_INFINITY ? needed : qMin(needed, limit.rlim_max);
+        if (setrlimit(RLIMIT_NOFILE, &limit) != 0)
+            limit.rlim_cur = oldLimit;
+
+        if (limit.rlim_cur < needed)
+            qWarning() << "Open files limit of" << static_cast<qint64>(limit.rlim_cur)
+                       << "is too low for" << clientCount << "clients, some will fail to connect."
+                       << "(Raise it via ulimit -n.)";
+        else if (verbose >= 1)
+            qInfo() << "Raised open files limit from" << static_cast<qint64>(oldLimit)
+                    << "to" << static_cast<qint64>(limit.rlim_cur);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    log::backend::logoutPtr = &errout;
+    qInstallMessageHandler(&log::backend::msgHandler);
+
+    QCoreApplication a(argc, argv);
+    LoadGenerator::Config config;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate load on streamserver-cvn: "
+        "Run many concurrent HTTP stream consumers, "
+        "checking the MPEG-TS they receive");
+    parser.addHelpOption();
+    parser.addOptions({
+        { { "v", "verbose" }, "Increase verbose level" },
+        { { "q", "quiet"   }, "Decrease verbose level" },
+        { { "d", "debug"   }, "Enable debugging. (Increase debug level.)" },
+        { "host",
+          "Host to connect to (default: " + config.host + ")",
+          "HOST" },
+        { { "p", "port" },
+          "Port to connect to (default: " + QString::number(config.port) + ")",
+          "PORT" },
+        { "path",
+          "Path to request (default: " + QString::fromLatin1(config.path) + ")",
+          "PATH" },
+        { { "n", "clients" },
+          "Number of concurrent clients (default: " + QString::number(config.clientCount) + ")",
+          "NUM" },
+        { "rate",
+          "Per-client read rate in bytes per second, 0 for unlimited (default: " +
+              QString::number(config.rateBytesPerSec) + ")",
+          "BYTES" },
+        { "slow-clients",
+          "Number of the clients that are slow readers (default: " +
+              QString::number(config.slowClientCount) + ")",
+          "NUM" },
+        { "slow-rate",
+          "Slow readers' read rate in bytes per second (default: " +
+              QString::number(config.slowRateBytesPerSec) + ")",
+          "BYTES" },
+        { { "t", "duration" },
+          "How long to run, e.g., 30s or 5min; 0 to run until the server closes all connections (default: " +
+              HumanReadable::timeDuration(config.durationMsec) + ")",
+          "DURATION" },
+        { "ramp-up",
+          "How many clients to start per second (default: " +
+              QString::number(config.rampUpClientsPerSec) + ")",
+          "NUM" },
+        { "stall-threshold",
+          "Count a stall when a client receives nothing for that long (default: " +
+              HumanReadable::timeDuration(config.stallThresholdMsec) + ")",
+          "DURATION" },
+        { "summary-only", "Don't report on each client, only the summary" },
+    });
+    parser.process(a);
+
+    // Apply incremental options.
+    for (QString opt : parser.optionNames()) {
+        if (opt == "v" || opt == "verbose")
+            verbose++;
+        else if (opt == "q" || opt == "quiet")
+            verbose--;
+        else if (opt == "d" || opt == "debug")
+#ifdef QT_NO_DEBUG_OUTPUT
+            qFatal("No debug output compiled in, can't enable debugging!");
+#else
+            debug_level++;
+#endif
+    }
+
+#ifdef SSCVN_LOG_MAX_VERBOSE
+    if (verbose > SSCVN_LOG_MAX_VERBOSE)
+        qWarning("Verbose level %d exceeds the compiled-in maximum of %d, more verbose messages won't be shown!",
+                 verbose, SSCVN_LOG_MAX_VERBOSE);
+#endif
+
+    if (parser.isSet("host"))
+        config.host = parser.value("host");
+    if (parser.isSet("path")) {
+        config.path = parser.value("path").toUtf8();
+        if (!config.path.startsWith('/')) {
+            qCritical() << "Invalid path: Must start with a slash:" << config.path;
+            return 2;
+        }
+    }
+
+    int port = config.port;
+    if (!convertOptionToNum<int>(parser, "port", "Invalid port:", 1, &port))
+        return 2;
+    if (port > 65535) {
+        qCritical() << "Invalid port: Out of range:" << port;
+        return 2;
+    }
+    config.port = static_cast<quint16>(port);
+
+    if (!convertOptionToNum<int>(parser, "clients", "Invalid number of clients:", 1, &config.clientCount) ||
+        !convertOptionToNum<qint64>(parser, "rate", "Invalid rate:", 0, &config.rateBytesPerSec) ||
+        !convertOptionToNum<int>(parser, "slow-clients", "Invalid number of slow clients:", 0, &config.slowClientCount) ||
+        !convertOptionToNum<qint64>(parser, "slow-rate", "Invalid slow rate:", 1, &config.slowRateBytesPerSec) ||
+        !convertOptionToMsec(parser, "duration", "Invalid duration:", &config.durationMsec) ||
+        !convertOptionToNum<int>(parser, "ramp-up", "Invalid ramp-up:", 1, &config.rampUpClientsPerSec) ||
+        !convertOptionToMsec(parser, "stall-threshold", "Invalid stall threshold:", &config.stallThresholdMsec))
+        return 2;
+
+    if (config.slowClientCount > config.clientCount) {
+        qCritical() << "Invalid number of slow clients: More than clients in total:"
+                    << config.slowClientCount << ">" << config.clientCount;
+        return 2;
+    }
+
+    config.perClientReport = !parser.isSet("summary-only");
+
+    if (!parser.positionalArguments().isEmpty()) {
+        qCritical() << "No positional arguments supported!";
+        return 2;
+    }
+
+    ensureFileDescriptorLimit(config.clientCount);
+
+    try {
+        LoadGenerator generator(config);
+        QObject::connect(&generator, &LoadGenerator::finished, &a, &QCoreApplication::quit, Qt::QueuedConnection);
+        QTimer::singleShot(0, &generator, &LoadGenerator::start);
+
+        // Have rate-limited log messages summarized even when they stop coming.
+        QTimer logRateFlushTimer;
+        QObject::connect(&logRateFlushTimer, &QTimer::timeout, &log::RateLimiter::flushAll);
+        logRateFlushTimer.start(1000);
+
+        const int ret = a.exec();
+
+        // Don't lose what was suppressed last; later, errout is gone.
+        log::RateLimiter::flushAllPending();
+        generator.report(out);
+        return ret;
+    }
+    catch (std::exception &ex) {
+        qCritical() << "Error running load generator:" << ex.what();
+        return 1;
+    }
+}
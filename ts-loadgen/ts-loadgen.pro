@@ -0,0 +1,31 @@
+QT += core network
+QT -= gui
+
+TARGET = ts-loadgen
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+# Use the server's own HTTP code to parse responses.
+SSCVN_HTTP_DIR = ../streamserver-cvn-cli
+INCLUDEPATH += $${SSCVN_HTTP_DIR}
+DEPENDPATH  += $${SSCVN_HTTP_DIR}
+
+SOURCES += main.cpp \
+    loadclient.cpp \
+    loadgenerator.cpp \
+    $${SSCVN_HTTP_DIR}/http/httputil.cpp \
+    $${SSCVN_HTTP_DIR}/http/httpheader_netside.cpp
+
+HEADERS += \
+    loadclient.h \
+    loadgenerator.h \
+    $${SSCVN_HTTP_DIR}/http/httputil.h \
+    $${SSCVN_HTTP_DIR}/http/httpheader_netside.h
+
+include(../config.pri)
+
+SSCVN_REL_ROOT = ..
+SSCVN_LIB_NAMES = infra media
+include(../include/app_internal_libs.pri)
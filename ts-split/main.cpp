@@ -3,6 +3,7 @@
 #include "splitter.h"
 #include "tspacket.h"
 #include "log_backend.h"
+#include "lograte.h"
 #include "humanreadable.h"
 #include "numericconverter.h"
 
@@ -10,6 +11,7 @@
 #include <QCommandLineParser>
 #include <QFile>
 #include <QTextStream>
+#include <QTimer>
 
 using SSCvn::log::verbose;
 using SSCvn::log::debug_level;
@@ -114,6 +116,12 @@ int main(int argc, char *argv[])
 #endif
     }
 
+#ifdef SSCVN_LOG_MAX_VERBOSE
+    if (verbose > SSCVN_LOG_MAX_VERBOSE)
+        qWarning("Verbose level %d exceeds the compiled-in maximum of %d, more verbose messages won't be shown!",
+                 verbose, SSCVN_LOG_MAX_VERBOSE);
+#endif
+
     // TS packet size
     {
         QString valueStr = parser.value("ts-packet-size");
@@ -331,8 +339,16 @@ int main(int argc, char *argv[])
         reader.setTSPacketSize(tsPacketSize);
     }
 
+    // Have rate-limited log messages summarized even when they stop coming.
+    QTimer logRateFlushTimer;
+    QObject::connect(&logRateFlushTimer, &QTimer::timeout, &log::RateLimiter::flushAll);
+    logRateFlushTimer.start(1000);
+
     int ret = a.exec();
 
+    // Don't lose what was suppressed last; later, errout is gone.
+    log::RateLimiter::flushAllPending();
+
     if (verbose >= 1) {
         qInfo() << "Output results after run:";
         for (const Splitter::Output &result : splitter.outputResults())
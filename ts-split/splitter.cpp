@@ -8,6 +8,7 @@
 #include "tsreader.h"
 #include "tswriter.h"
 #include "log.h"
+#include "lograte.h"
 #include "exceptionbuilder.h"
 
 #include <string>
@@ -704,9 +705,13 @@ void Splitter::handleErrorEncountered(TS::Reader::ErrorKind errorKind, QString e
     case TS::Reader::ErrorKind::IO:
         qFatal("%s Splitter: IO error: %s", qPrintable(logPrefix), qPrintable(errorMessage));
     case TS::Reader::ErrorKind::TS:
-        qWarning() << qPrintable(logPrefix) << "Splitter: Ignoring TS error:" << qPrintable(errorMessage);
+    {
+        static SSCvn::log::RateLimiter tsErrorLimiter("ignored TS errors");
+        if (tsErrorLimiter.check(errorMessage))
+            qWarning() << qPrintable(logPrefix) << "Splitter: Ignoring TS error:" << qPrintable(errorMessage);
         break;
     }
+    }
 }
 
 QDebug operator<<(QDebug debug, const Splitter::Start &start)